@@ -0,0 +1,66 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+/**
+ * @file benchmark.hpp
+ * @brief Minimal helpers shared by the benchmark executables.
+ */
+
+namespace fsme
+{
+namespace benchmarks
+{
+
+/**
+ * @brief Prevents the compiler from optimizing away the computation of \p value.
+ */
+template<class T>
+void do_not_optimize(const T& value)
+{
+	static volatile std::uintptr_t sink;
+	sink = sink + std::uintptr_t(value);
+}
+
+/**
+ * @brief Runs \p func \p repetitions times and returns the best observed wall time, in seconds.
+ */
+template<class Func>
+double measure_seconds(std::size_t repetitions, Func&& func)
+{
+	double best = 1e30;
+
+	for (std::size_t i = 0; i < repetitions; ++i)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		func();
+		const auto end = std::chrono::steady_clock::now();
+
+		const double elapsed = std::chrono::duration<double>(end - start).count();
+		best = elapsed < best ? elapsed : best;
+	}
+
+	return best;
+}
+
+/**
+ * @brief Prints the time per operation of a benchmark that performed \p operations operations in \p seconds.
+ */
+inline void report(const char* name, std::size_t operations, double seconds)
+{
+	std::printf("%-48s %10.2f ns/op %12.2f Mop/s\n", name, seconds * 1e9 / double(operations), double(operations) / seconds / 1e6);
+}
+
+/**
+ * @brief Prints the time per frame of a benchmark that ran \p frames frames in \p seconds.
+ */
+inline void report_frames(const char* name, std::size_t frames, double seconds)
+{
+	std::printf("%-48s %10.3f ms/frame %8.1f fps\n", name, seconds * 1e3 / double(frames), double(frames) / seconds);
+}
+
+}
+}
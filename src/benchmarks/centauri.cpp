@@ -0,0 +1,287 @@
+#include "benchmark.hpp"
+#include "graphgen.hpp"
+
+#include "fsm-editor/visitors/centauriserializer.hpp"
+#include "fsm-editor/util/idset.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+#include <stdexcept>
+
+/**
+ * @file centauri.cpp
+ * @brief Measures the throughput of exporting graphs into the Centauri format.
+ */
+
+using namespace fsme;
+using namespace fsme::benchmarks;
+
+namespace
+{
+
+void report_export(const char* name, std::size_t branches, std::size_t bytes, double seconds)
+{
+	std::printf(
+		"%-48s %10.2f ns/branch %8.2f MB/s\n",
+		name,
+		seconds * 1e9 / double(branches),
+		double(bytes) / seconds / 1e6
+	);
+}
+
+/**
+ * @brief Exports each state with operator<< on a std::ostream, the way the Centauri export was written before going
+ * through detail::TextWriter. The output matches CentauriSerializer::serialize_states().
+ */
+class StreamStateSerializer : public NodeVisitor
+{
+public:
+	explicit StreamStateSerializer(std::ostream& output) :
+		m_out(&output)
+	{}
+
+	void serialize(nodes::StateNode& state)
+	{
+		m_visited_nodes.clear();
+		m_visited_root = false;
+
+		*m_out << std::uint32_t(std::uintptr_t(state.node_id())) << " root " << state.get_name_input().get_text() << '\n';
+		m_pending_nodes.push_back(&state);
+
+		while (!m_pending_nodes.empty())
+		{
+			Node* node = m_pending_nodes.back();
+			m_pending_nodes.pop_back();
+			node->accept(*this);
+		}
+	}
+
+	void visit(nodes::CondNode& node) override
+	{
+		std::uint32_t id = std::uintptr_t(node.node_id());
+
+		for (long i = 0; i < node.outputs().size(); ++i)
+		{
+			const ed::PinId& pin = node.outputs()[i];
+			const std::uint32_t next_id = (i + 1) < node.outputs().size()
+				? node.get_expression(node.outputs()[i + 1]).get_id()
+				: -1;
+
+			emit_branch(id, node.get_expression(pin).as_lua_expression(), get_node_id_for_pin(node, pin), next_id);
+			id = next_id;
+		}
+
+		visit_outputs(node);
+	}
+
+	void visit(nodes::IfNode& node) override
+	{
+		emit_branch(
+			std::uintptr_t(node.node_id()),
+			node.get_expression().as_lua_expression(),
+			get_node_id_for_pin(node, node.outputs()[0]),
+			get_node_id_for_pin(node, node.outputs()[1])
+		);
+
+		visit_outputs(node);
+	}
+
+	void visit(nodes::StateNode& node) override
+	{
+		if (m_visited_nodes.contains(node.node_id()))
+		{
+			return;
+		}
+
+		m_visited_nodes.insert(node.node_id());
+
+		if (!m_visited_root)
+		{
+			m_visited_root = true;
+			visit_outputs(node);
+		}
+		else
+		{
+			*m_out << std::uint32_t(std::uintptr_t(node.node_id())) << " state " << node.get_name_input().get_text()
+				<< '\n';
+		}
+	}
+
+private:
+	void emit_branch(std::uint32_t id, const std::string& lua_expression, std::uint32_t on_true, std::uint32_t on_false)
+	{
+		*m_out << id << " expr " << lua_expression << ' ' << on_true << ' ' << on_false << '\n';
+	}
+
+	void visit_outputs(Node& node)
+	{
+		const std::size_t first_pending = m_pending_nodes.size();
+
+		for (const ed::PinId& output : node.outputs())
+		{
+			for (const auto& link : node.editor().get_pin_info(output)->links)
+			{
+				m_pending_nodes.push_back(node.editor().get_node_by_pin_id(link.pins.to));
+			}
+		}
+
+		std::reverse(m_pending_nodes.begin() + first_pending, m_pending_nodes.end());
+	}
+
+	static std::uint32_t get_node_id_for_pin(const Node& node, ed::PinId pin)
+	{
+		const PinInfo* pin_info = node.editor().get_pin_info(pin);
+
+		if (pin_info == nullptr || pin_info->links.empty())
+		{
+			return -1;
+		}
+
+		const PinPair& pair = pin_info->links[0].pins;
+		return std::uintptr_t(node.editor().get_node_by_pin_id(pin != pair.from ? pair.from : pair.to)->node_id());
+	}
+
+	detail::IdSet<ed::NodeId> m_visited_nodes;
+	std::vector<Node*> m_pending_nodes;
+	bool m_visited_root = false;
+	std::ostream* m_out;
+};
+
+void run(std::size_t branch_count, double copy_probability)
+{
+	widgets::BoolExpressionAutocomplete autocomplete;
+	make_autocomplete(autocomplete);
+
+	FsmEditor editor;
+	editor.set_autocomplete_provider(&autocomplete);
+
+	SyntheticGraphParams params;
+	params.state_count = branch_count / (params.cond_outputs * 2);
+	params.copy_probability = copy_probability;
+	std::vector<nodes::StateNode*> states = make_synthetic_graph(editor, autocomplete, params);
+	std::sort(states.begin(), states.end(), [](const nodes::StateNode* a, const nodes::StateNode* b) {
+		return std::uintptr_t(a->node_id()) < std::uintptr_t(b->node_id());
+	});
+
+	const std::size_t branches = synthetic_branch_count(params);
+
+	visitors::CentauriGraphOptions unshared;
+	unshared.share_identical_branches = false;
+
+	visitors::CentauriGraphOptions merged;
+	merged.merge_equivalent_states = true;
+
+	visitors::CentauriGraphOptions flattened;
+	flattened.flatten_conditions = true;
+
+	detail::TextWriter text;
+	visitors::CentauriSerializer::serialize_graph(text, editor);
+	const std::size_t graph_bytes = text.size();
+
+	text.clear();
+	visitors::CentauriSerializer::serialize_graph(text, editor, unshared);
+	const std::size_t unshared_bytes = text.size();
+
+	text.clear();
+	const std::size_t merged_state_count = visitors::CentauriSerializer::serialize_graph(text, editor, merged);
+	const std::size_t merged_bytes = text.size();
+
+	text.clear();
+	visitors::CentauriSerializer::serialize_graph(text, editor, flattened);
+	const std::size_t flattened_bytes = text.size();
+
+	text.clear();
+	visitors::CentauriSerializer::serialize_states(text, editor);
+	const std::size_t states_bytes = text.size();
+
+	std::ostringstream baseline;
+	StreamStateSerializer baseline_serializer(baseline);
+	for (nodes::StateNode* state : states)
+	{
+		baseline_serializer.serialize(*state);
+	}
+
+	if (baseline.str() != std::string(text.data(), text.size()))
+	{
+		throw std::runtime_error("The operator<< baseline does not match serialize_states()");
+	}
+
+	std::printf(
+		"-- %zu branches, %.0f%% of states followed by copies, %zu bytes as a whole graph (%zu without sharing identical "
+		"branches, %zu with %zu of %zu states left once equivalent ones are merged, %zu with flattened conditions), "
+		"%zu bytes per state\n",
+		branches,
+		copy_probability * 100.0,
+		graph_bytes,
+		unshared_bytes,
+		merged_bytes,
+		merged_state_count,
+		params.state_count,
+		flattened_bytes,
+		states_bytes
+	);
+
+	// The writer keeps its capacity from one export to the next, as the batch exporter does
+	report_export("whole graph, reused buffer", branches, graph_bytes, measure_seconds(10, [&] {
+		text.clear();
+		visitors::CentauriSerializer::serialize_graph(text, editor);
+		do_not_optimize(text.size());
+	}));
+
+	report_export("whole graph, identical branches not shared", branches, unshared_bytes, measure_seconds(10, [&] {
+		text.clear();
+		visitors::CentauriSerializer::serialize_graph(text, editor, unshared);
+		do_not_optimize(text.size());
+	}));
+
+	report_export("whole graph, equivalent states merged", branches, merged_bytes, measure_seconds(10, [&] {
+		text.clear();
+		visitors::CentauriSerializer::serialize_graph(text, editor, merged);
+		do_not_optimize(text.size());
+	}));
+
+	report_export("whole graph, flattened conditions", branches, flattened_bytes, measure_seconds(10, [&] {
+		text.clear();
+		visitors::CentauriSerializer::serialize_graph(text, editor, flattened);
+		do_not_optimize(text.size());
+	}));
+
+	report_export("whole graph, flushed to std::ostream", branches, graph_bytes, measure_seconds(10, [&] {
+		std::ostringstream ss;
+		visitors::CentauriSerializer::serialize_graph(ss, editor);
+		do_not_optimize(ss.tellp());
+	}));
+
+	report_export("per state, reused buffer", branches, states_bytes, measure_seconds(10, [&] {
+		text.clear();
+		visitors::CentauriSerializer::serialize_states(text, editor);
+		do_not_optimize(text.size());
+	}));
+
+	report_export("per state, flushed to std::ostream", branches, states_bytes, measure_seconds(10, [&] {
+		std::ostringstream ss;
+		visitors::CentauriSerializer::serialize_states(ss, editor);
+		do_not_optimize(ss.tellp());
+	}));
+
+	report_export("per state, operator<< on std::ostream", branches, states_bytes, measure_seconds(10, [&] {
+		std::ostringstream ss;
+		StreamStateSerializer serializer(ss);
+
+		for (nodes::StateNode* state : states)
+		{
+			serializer.serialize(*state);
+		}
+
+		do_not_optimize(ss.tellp());
+	}));
+}
+
+}
+
+int main()
+{
+	run(50000, 0.0);
+	run(50000, 0.5);
+}
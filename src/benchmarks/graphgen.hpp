@@ -0,0 +1,187 @@
+#pragma once
+
+#include "fsm-editor/editor.hpp"
+#include "fsm-editor/nodes/nodes.hpp"
+#include "fsm-editor/widgets/boolexprinput.hpp"
+
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @file graphgen.hpp
+ * @brief Generation of synthetic FSM graphs shaped like real monster logic, for benchmarks.
+ */
+
+namespace fsme
+{
+namespace benchmarks
+{
+
+struct SyntheticGraphParams
+{
+	/// @brief Number of StateNode nodes
+	std::size_t state_count = 1000;
+
+	/// @brief Number of outputs of the CondNode that follows each state, each of which leads to an IfNode
+	std::size_t cond_outputs = 3;
+
+	/// @brief Probability for a condition to be a plain Lua expression rather than a simple expression
+	double lua_probability = 0.25;
+
+	/// @brief Probability for the conditions that follow a state to be a copy of those that follow an earlier state, as
+	/// NodeDuplicator would make
+	double copy_probability = 0.0;
+
+	unsigned seed = 1234;
+};
+
+/**
+ * @brief Fills \p autocomplete with \p option_count options spread over a few categories.
+ */
+inline void make_autocomplete(widgets::BoolExpressionAutocomplete& autocomplete, std::size_t option_count = 32)
+{
+	const char* categories[] = {"Keys", "Collision", "Senses", "Status"};
+
+	for (std::size_t i = 0; i < option_count; ++i)
+	{
+		const std::string index = std::to_string(i);
+		autocomplete.add_option(categories[i % 4], {"option " + index, "self.inputs:check(" + index + ")"});
+	}
+}
+
+/**
+ * @brief Returns the number of branches (IfNode and CondNode outputs) generated for \p params.
+ */
+inline std::size_t synthetic_branch_count(const SyntheticGraphParams& params)
+{
+	return params.state_count * params.cond_outputs * 2;
+}
+
+/**
+ * @brief Generates a graph where each state is followed by a CondNode, whose outputs each lead to an IfNode that
+ * transitions to random states.
+ * @details With SyntheticGraphParams::copy_probability, the CondNode and IfNode nodes that follow a state may instead be
+ * copies of those that follow an earlier state, with the same expressions and leading to the same states.
+ * @return The state nodes of the graph.
+ */
+inline std::vector<nodes::StateNode*> make_synthetic_graph(
+	FsmEditor& editor,
+	widgets::BoolExpressionAutocomplete& autocomplete,
+	const SyntheticGraphParams& params)
+{
+	std::mt19937 rng(params.seed);
+
+	std::vector<const widgets::BoolExpressionOption*> options;
+	for (std::size_t i = 0;; ++i)
+	{
+		const auto* option = autocomplete.find_by_shorthand("option " + std::to_string(i));
+
+		if (option == nullptr)
+		{
+			break;
+		}
+
+		options.push_back(option);
+	}
+
+	std::bernoulli_distribution is_lua(params.lua_probability);
+	std::uniform_int_distribution<std::size_t> pick_option(0, options.size() - 1);
+	std::uniform_int_distribution<std::size_t> option_count(1, 3);
+	std::uniform_int_distribution<int> threshold(0, 100);
+
+	const auto fill_expression = [&](widgets::BoolExpressionInput& expression) {
+		if (options.empty() || is_lua(rng))
+		{
+			const std::string lua = "self.health < " + std::to_string(threshold(rng));
+			expression.set_input_type(widgets::ExpressionInputType::PlainLuaExpression);
+			std::copy(lua.begin(), lua.end(), expression.get_raw_lua_input().text_buffer.begin());
+			return;
+		}
+
+		expression.set_input_type(widgets::ExpressionInputType::SimpleExpression);
+		for (std::size_t i = option_count(rng); i > 0; --i)
+		{
+			expression.get_raw_simple_expression_input().options.insert(options[pick_option(rng)]);
+		}
+	};
+
+	std::vector<nodes::StateNode*> states;
+	for (std::size_t i = 0; i < params.state_count; ++i)
+	{
+		auto& state = editor.make_node<nodes::StateNode>();
+		state.get_name_input().set_text("state_" + std::to_string(i));
+		states.push_back(&state);
+	}
+
+	const auto copy_expression = [](widgets::BoolExpressionInput& from, widgets::BoolExpressionInput& to) {
+		to.set_input_type(from.get_input_type());
+		to.get_raw_lua_input().text_buffer = from.get_raw_lua_input().text_buffer;
+		to.get_raw_simple_expression_input().options = from.get_raw_simple_expression_input().options;
+	};
+
+	struct Branch
+	{
+		nodes::IfNode* node;
+		nodes::StateNode* on_true;
+		nodes::StateNode* on_false;
+	};
+
+	std::uniform_int_distribution<std::size_t> pick_state(0, states.size() - 1);
+	std::bernoulli_distribution is_copy(params.copy_probability);
+
+	// The conditions that follow each state so far, as the CondNode then its branches
+	std::vector<std::pair<nodes::CondNode*, std::vector<Branch>>> subtrees;
+
+	for (auto* state : states)
+	{
+		auto& cond = editor.make_node<nodes::CondNode>();
+		cond.set_output_count(params.cond_outputs);
+		editor.create_link({state->outputs()[0], cond.inputs()[0]});
+
+		// Only drawn when enabled, so that graphs without copies do not depend on copy_probability
+		const std::pair<nodes::CondNode*, std::vector<Branch>>* original = nullptr;
+		if (params.copy_probability > 0.0 && !subtrees.empty() && is_copy(rng))
+		{
+			original = &subtrees[std::uniform_int_distribution<std::size_t>(0, subtrees.size() - 1)(rng)];
+		}
+
+		std::vector<Branch> branches;
+
+		for (long i = 0; i < cond.outputs().size(); ++i)
+		{
+			const ed::PinId output = cond.outputs()[i];
+			auto& branch = editor.make_node<nodes::IfNode>();
+			Branch added = {&branch, nullptr, nullptr};
+
+			if (original != nullptr)
+			{
+				const Branch& copied = original->second[i];
+				copy_expression(original->first->get_expression(original->first->outputs()[i]), cond.get_expression(output));
+				copy_expression(copied.node->get_expression(), branch.get_expression());
+				added.on_true = copied.on_true;
+				added.on_false = copied.on_false;
+			}
+			else
+			{
+				fill_expression(cond.get_expression(output));
+				fill_expression(branch.get_expression());
+				added.on_true = states[pick_state(rng)];
+				added.on_false = states[pick_state(rng)];
+			}
+
+			editor.create_link({output, branch.inputs()[0]});
+			editor.create_link({branch.outputs()[0], added.on_true->inputs()[0]});
+			editor.create_link({branch.outputs()[1], added.on_false->inputs()[0]});
+			branches.push_back(added);
+		}
+
+		subtrees.emplace_back(&cond, std::move(branches));
+	}
+
+	return states;
+}
+
+}
+}
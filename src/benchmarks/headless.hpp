@@ -0,0 +1,57 @@
+#pragma once
+
+#include "imgui.h"
+
+namespace fsme
+{
+namespace benchmarks
+{
+
+/**
+ * @brief RAII helper that sets up a dear imgui context without any window or renderer.
+ * @details This is enough to run FsmEditor::render() frames, as nothing is ever presented.
+ */
+class HeadlessImGui
+{
+public:
+	HeadlessImGui()
+	{
+		ImGui::CreateContext();
+
+		auto& io = ImGui::GetIO();
+		io.IniFilename = nullptr;
+		io.DisplaySize = ImVec2(2560.0f, 1440.0f);
+		io.DeltaTime = 1.0f / 60.0f;
+
+		// The editor expects a regular and a bold font
+		io.Fonts->AddFontDefault();
+		io.Fonts->AddFontDefault();
+
+		unsigned char* pixels;
+		int width, height;
+		io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+	}
+
+	~HeadlessImGui()
+	{
+		ImGui::DestroyContext();
+	}
+
+	HeadlessImGui(const HeadlessImGui&) = delete;
+	HeadlessImGui& operator=(const HeadlessImGui&) = delete;
+
+	/**
+	 * @brief Runs \p func within a frame.
+	 * @details Draw data is never built, since nothing is presented and large graphs may overflow 16-bit indices.
+	 */
+	template<class Func>
+	void frame(Func&& func)
+	{
+		ImGui::NewFrame();
+		func();
+		ImGui::EndFrame();
+	}
+};
+
+}
+}
@@ -0,0 +1,392 @@
+#include "benchmark.hpp"
+#include "graphgen.hpp"
+#include "headless.hpp"
+
+#include "fsm-editor/visitors/nativedeserializer.hpp"
+#include "fsm-editor/visitors/nativeserializer.hpp"
+#include "fsm-editor/util/bytebuffer.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+/**
+ * @file nativeformat.cpp
+ * @brief Measures the throughput of saving and loading graphs in the native format.
+ */
+
+using namespace fsme;
+using namespace fsme::benchmarks;
+
+namespace
+{
+
+void report_throughput(const char* name, std::size_t bytes, double seconds)
+{
+	std::printf("%-48s %10.2f MB/s\n", name, double(bytes) / seconds / 1e6);
+}
+
+/**
+ * @brief Writes each field straight to a std::ostream, the way the native format was written before going through
+ * detail::ByteWriter.
+ */
+class StreamWriter
+{
+public:
+	explicit StreamWriter(std::ostream& output) :
+		m_out(&output)
+	{}
+
+	void write(const void* data, std::size_t size)
+	{
+		m_out->write(static_cast<const char*>(data), size);
+	}
+
+	template<class T>
+	void write_memcpy(const T& value)
+	{
+		write(&value, sizeof(value));
+	}
+
+	void write_varint(std::uint64_t value)
+	{
+		while (value >= 0x80)
+		{
+			m_out->put(char(std::uint8_t(value) | 0x80));
+			value >>= 7;
+		}
+
+		m_out->put(char(std::uint8_t(value)));
+	}
+
+private:
+	std::ostream* m_out;
+};
+
+/**
+ * @brief Reads each field straight from a std::istream, the way the native format was read before going through
+ * detail::ByteReader.
+ */
+class StreamReader
+{
+public:
+	explicit StreamReader(std::istream& input) :
+		m_in(&input)
+	{}
+
+	void read(void* data, std::size_t size)
+	{
+		if (!m_in->read(static_cast<char*>(data), size))
+		{
+			throw std::runtime_error("Failed to deserialize: Unexpected end of data");
+		}
+	}
+
+	template<class T>
+	T read_memcpy()
+	{
+		T ret;
+		read(&ret, sizeof(ret));
+		return ret;
+	}
+
+	std::uint64_t read_varint()
+	{
+		std::uint64_t value = 0;
+
+		for (unsigned shift = 0; shift < 64; shift += 7)
+		{
+			const auto byte = std::uint8_t(read_memcpy<char>());
+			value |= std::uint64_t(byte & 0x7F) << shift;
+
+			if ((byte & 0x80) == 0)
+			{
+				return value;
+			}
+		}
+
+		throw std::runtime_error("Failed to deserialize: Malformed variable-length integer");
+	}
+
+private:
+	std::istream* m_in;
+};
+
+template<class Writer>
+void write_text(Writer& out, const visitors::GraphSnapshot& snapshot, visitors::GraphSnapshot::Text text)
+{
+	const auto chars = snapshot.get_text(text);
+	out.write_varint(text.size);
+	out.write(chars.data(), chars.size());
+}
+
+/**
+ * @brief Writes the fields of every node of \p snapshot one by one, with the same encodings as the native format but
+ * with strings inline, so that writers can be compared on the same sequence of fields.
+ */
+template<class Writer>
+void write_fields(Writer& out, const visitors::GraphSnapshot& snapshot)
+{
+	std::uint64_t previous_id = 0;
+	std::uint64_t previous_link_id = 0;
+	const auto write_id = [&](std::uint64_t id, std::uint64_t& previous) {
+		out.write_varint(detail::zigzag_encode(std::int64_t(id - previous)));
+		previous = id;
+	};
+
+	out.write_varint(snapshot.nodes.size());
+
+	for (const auto& node : snapshot.nodes)
+	{
+		out.write_memcpy(node.type);
+		write_id(node.id, previous_id);
+
+		out.write_varint(node.input_count);
+		for (std::uint32_t i = 0; i < node.input_count; ++i)
+		{
+			write_id(snapshot.inputs[node.first_input + i], previous_id);
+		}
+
+		out.write_varint(node.output_count);
+		for (std::uint32_t i = 0; i < node.output_count; ++i)
+		{
+			const auto& output = snapshot.outputs[node.first_output + i];
+			write_id(output.pin, previous_id);
+
+			out.write_varint(output.link_count);
+			for (std::uint32_t j = 0; j < output.link_count; ++j)
+			{
+				const auto& link = snapshot.links[output.first_link + j];
+				write_id(link.id, previous_link_id);
+
+				std::uint64_t from = output.pin;
+				write_id(link.to, from);
+			}
+		}
+
+		write_text(out, snapshot, node.name);
+
+		out.write_varint(node.expression_count);
+		for (std::uint32_t i = 0; i < node.expression_count; ++i)
+		{
+			const auto& expression = snapshot.expressions[node.first_expression + i];
+			out.write_memcpy(expression.input_type);
+			write_text(out, snapshot, expression.lua_expression);
+
+			out.write_varint(expression.option_count);
+			for (std::uint32_t j = 0; j < expression.option_count; ++j)
+			{
+				write_text(out, snapshot, snapshot.option_shorthands[expression.first_option + j]);
+			}
+		}
+
+		out.write_memcpy(node.position.x);
+		out.write_memcpy(node.position.y);
+	}
+}
+
+template<class Reader>
+visitors::GraphSnapshot::Text read_text(Reader& in, visitors::GraphSnapshot& snapshot)
+{
+	const auto size = std::size_t(in.read_varint());
+	const visitors::GraphSnapshot::Text text{std::uint32_t(snapshot.text.size()), std::uint32_t(size)};
+
+	snapshot.text.resize(snapshot.text.size() + size);
+	in.read(snapshot.text.data() + text.offset, size);
+
+	return text;
+}
+
+/**
+ * @brief Reads back what write_fields() wrote into a new snapshot.
+ */
+template<class Reader>
+visitors::GraphSnapshot read_fields(Reader& in)
+{
+	visitors::GraphSnapshot snapshot;
+
+	std::uint64_t previous_id = 0;
+	std::uint64_t previous_link_id = 0;
+	const auto read_id = [&](std::uint64_t& previous) {
+		previous += std::uint64_t(detail::zigzag_decode(in.read_varint()));
+		return previous;
+	};
+
+	snapshot.nodes.resize(std::size_t(in.read_varint()));
+
+	for (auto& node : snapshot.nodes)
+	{
+		node.type = in.template read_memcpy<native_format::NodeType>();
+		node.id = read_id(previous_id);
+
+		node.first_input = std::uint32_t(snapshot.inputs.size());
+		node.input_count = std::uint32_t(in.read_varint());
+		for (std::uint32_t i = 0; i < node.input_count; ++i)
+		{
+			snapshot.inputs.push_back(read_id(previous_id));
+		}
+
+		node.first_output = std::uint32_t(snapshot.outputs.size());
+		node.output_count = std::uint32_t(in.read_varint());
+		for (std::uint32_t i = 0; i < node.output_count; ++i)
+		{
+			visitors::GraphSnapshot::Output output;
+			output.pin = read_id(previous_id);
+			output.first_link = std::uint32_t(snapshot.links.size());
+			output.link_count = std::uint32_t(in.read_varint());
+
+			for (std::uint32_t j = 0; j < output.link_count; ++j)
+			{
+				visitors::GraphSnapshot::Link link;
+				link.id = read_id(previous_link_id);
+
+				std::uint64_t from = output.pin;
+				link.to = read_id(from);
+				snapshot.links.push_back(link);
+			}
+
+			snapshot.outputs.push_back(output);
+		}
+
+		node.name = read_text(in, snapshot);
+
+		node.first_expression = std::uint32_t(snapshot.expressions.size());
+		node.expression_count = std::uint32_t(in.read_varint());
+		for (std::uint32_t i = 0; i < node.expression_count; ++i)
+		{
+			visitors::GraphSnapshot::Expression expression;
+			expression.input_type = in.template read_memcpy<std::uint8_t>();
+			expression.lua_expression = read_text(in, snapshot);
+			expression.first_option = std::uint32_t(snapshot.option_shorthands.size());
+			expression.option_count = std::uint32_t(in.read_varint());
+
+			for (std::uint32_t j = 0; j < expression.option_count; ++j)
+			{
+				snapshot.option_shorthands.push_back(read_text(in, snapshot));
+			}
+
+			snapshot.expressions.push_back(expression);
+		}
+
+		node.position.x = in.template read_memcpy<float>();
+		node.position.y = in.template read_memcpy<float>();
+	}
+
+	return snapshot;
+}
+
+/**
+ * @brief Compares writing and reading the same fields through contiguous buffers against one stream call per field,
+ * which is what the native format did before.
+ */
+void run_per_field(const visitors::GraphSnapshot& snapshot)
+{
+	detail::ByteWriter buffered;
+	write_fields(buffered, snapshot);
+
+	std::ostringstream streamed;
+	StreamWriter stream_writer(streamed);
+	write_fields(stream_writer, snapshot);
+
+	const std::vector<char>& bytes = buffered.bytes();
+	if (streamed.str() != std::string(bytes.begin(), bytes.end()))
+	{
+		throw std::runtime_error("Writers disagree");
+	}
+
+	report_throughput("write fields to detail::ByteWriter", bytes.size(), measure_seconds(5, [&] {
+		detail::ByteWriter out;
+		write_fields(out, snapshot);
+		do_not_optimize(out.size());
+	}));
+
+	report_throughput("write fields to std::ostream, one call each", bytes.size(), measure_seconds(5, [&] {
+		std::ostringstream ss;
+		StreamWriter out(ss);
+		write_fields(out, snapshot);
+		do_not_optimize(ss.tellp());
+	}));
+
+	report_throughput("read fields from detail::ByteReader", bytes.size(), measure_seconds(5, [&] {
+		detail::ByteReader in(bytes);
+		do_not_optimize(read_fields(in).nodes.size());
+	}));
+
+	const std::string serialized = streamed.str();
+	report_throughput("read fields from std::istream, one call each", bytes.size(), measure_seconds(5, [&] {
+		std::istringstream ss(serialized);
+		StreamReader in(ss);
+		do_not_optimize(read_fields(in).nodes.size());
+	}));
+}
+
+void run(std::size_t state_count)
+{
+	HeadlessImGui imgui;
+
+	widgets::BoolExpressionAutocomplete autocomplete;
+	make_autocomplete(autocomplete);
+
+	FsmEditor editor;
+	editor.set_autocomplete_provider(&autocomplete);
+
+	SyntheticGraphParams params;
+	params.state_count = state_count;
+	make_synthetic_graph(editor, autocomplete, params);
+
+	const std::vector<char> bytes = visitors::NativeSerializer::serialize(editor);
+	std::printf("-- %zu states, %zu bytes\n", state_count, bytes.size());
+
+	report_throughput("serialize to buffer", bytes.size(), measure_seconds(5, [&] {
+		do_not_optimize(visitors::NativeSerializer::serialize(editor).size());
+	}));
+
+	report_throughput("serialize to std::ostream", bytes.size(), measure_seconds(5, [&] {
+		std::ostringstream ss;
+		visitors::NativeSerializer::serialize(editor, ss);
+		do_not_optimize(ss.tellp());
+	}));
+
+	// Saving from the editor only takes a snapshot on the UI thread, and encodes it on a worker thread
+	report_throughput("snapshot", bytes.size(), measure_seconds(5, [&] {
+		do_not_optimize(visitors::NativeSerializer::snapshot(editor).nodes.size());
+	}));
+
+	const visitors::GraphSnapshot snapshot = visitors::NativeSerializer::snapshot(editor);
+	report_throughput("serialize snapshot to buffer", bytes.size(), measure_seconds(5, [&] {
+		do_not_optimize(visitors::NativeSerializer::serialize(snapshot).size());
+	}));
+
+	run_per_field(snapshot);
+
+	FsmEditor target;
+	target.set_autocomplete_provider(&autocomplete);
+
+	report_throughput("deserialize from buffer", bytes.size(), measure_seconds(5, [&] {
+		visitors::NativeDeserializer::deserialize(target, bytes);
+	}));
+
+	const std::string serialized(bytes.begin(), bytes.end());
+	report_throughput("deserialize from std::istream", bytes.size(), measure_seconds(5, [&] {
+		std::istringstream ss(serialized);
+		visitors::NativeDeserializer::deserialize(target, ss);
+	}));
+
+	const std::string path = "bench-nativeformat.fsm";
+	std::ofstream(path, std::ios::binary).write(bytes.data(), bytes.size());
+
+	report_throughput("deserialize from file", bytes.size(), measure_seconds(5, [&] {
+		visitors::NativeDeserializer::deserialize_file(target, path);
+	}));
+
+	std::remove(path.c_str());
+}
+
+}
+
+int main()
+{
+	run(1000);
+	run(10000);
+}
@@ -0,0 +1,130 @@
+#include "benchmark.hpp"
+#include "headless.hpp"
+
+#include "fsm-editor/editor.hpp"
+#include "fsm-editor/nodes/nodes.hpp"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+/**
+ * @file selection.cpp
+ * @brief Measures the frame time of the editor with large selections, and the cost of the selection queries done by
+ * FsmEditor::render_links() compared to the linear scans they replaced.
+ */
+
+using namespace fsme;
+using namespace fsme::benchmarks;
+
+namespace
+{
+
+struct Graph
+{
+	std::vector<ed::NodeId> nodes;
+	std::vector<PinPair> links;
+};
+
+Graph make_graph(FsmEditor& editor, std::size_t node_count, std::size_t link_count, std::mt19937& rng)
+{
+	Graph graph;
+
+	std::vector<nodes::StateNode*> states;
+	for (std::size_t i = 0; i < node_count; ++i)
+	{
+		auto& node = editor.make_node<nodes::StateNode>();
+		states.push_back(&node);
+		graph.nodes.push_back(node.node_id());
+	}
+
+	// Lay nodes out on a grid, so that most of them are out of view like in a real large graph
+	for (std::size_t i = 0; i < node_count; ++i)
+	{
+		editor.set_node_position(graph.nodes[i], ImVec2(float(i % 100) * 300.0f, float(i / 100) * 150.0f));
+	}
+
+	// Link nodes to their close neighbours, like transitions typically are laid out
+	std::uniform_int_distribution<std::size_t> pick(1, 5);
+	for (std::size_t i = 0; graph.links.size() < link_count; i = (i + 1) % node_count)
+	{
+		const auto& from = *states[i];
+		const auto& to = *states[(i + pick(rng)) % node_count];
+
+		const PinPair pins{from.outputs()[0], to.inputs()[0]};
+		editor.create_link(pins);
+		graph.links.push_back(pins);
+	}
+
+	return graph;
+}
+
+void run(std::size_t node_count, std::size_t link_count, std::size_t selected_count)
+{
+	std::mt19937 rng(1234);
+	HeadlessImGui imgui;
+
+	std::printf("-- %zu nodes, %zu links, %zu selected\n", node_count, link_count, selected_count);
+
+	{
+		FsmEditor editor;
+		const Graph graph = make_graph(editor, node_count, link_count, rng);
+
+		imgui.frame([&] { editor.render(); });
+
+		auto selected = graph.nodes;
+		std::shuffle(selected.begin(), selected.end(), rng);
+		selected.resize(selected_count);
+
+		for (const ed::NodeId node : selected)
+		{
+			editor.select_node(node);
+		}
+
+		// Let the editor pick up the selection
+		imgui.frame([&] { editor.render(); });
+
+		const std::size_t frames = 20;
+		report_frames("FsmEditor::render() frame", frames, measure_seconds(1, [&] {
+			for (std::size_t i = 0; i < frames; ++i)
+			{
+				imgui.frame([&] { editor.render(); });
+			}
+		}));
+
+		// The queries done by render_links(), without the rest of the frame
+		const auto link_queries = [&](const auto& is_selected) {
+			std::size_t count = 0;
+			for (const PinPair& pins : graph.links)
+			{
+				count += is_selected(editor.get_node_by_pin_id(pins.from)->node_id())
+					|| is_selected(editor.get_node_by_pin_id(pins.to)->node_id());
+			}
+			do_not_optimize(count);
+		};
+
+		report_frames("render_links() queries, hashed selection", frames, measure_seconds(1, [&] {
+			for (std::size_t i = 0; i < frames; ++i)
+			{
+				link_queries([&](ed::NodeId node) { return editor.is_node_selected(node); });
+			}
+		}));
+
+		report_frames("render_links() queries, linear selection", frames, measure_seconds(1, [&] {
+			for (std::size_t i = 0; i < frames; ++i)
+			{
+				link_queries([&](ed::NodeId node) {
+					return std::find(selected.begin(), selected.end(), node) != selected.end();
+				});
+			}
+		}));
+	}
+}
+
+}
+
+int main()
+{
+	run(5000, 10000, 200);
+	run(5000, 10000, 2000);
+}
@@ -0,0 +1,336 @@
+#include "benchmark.hpp"
+#include "graphgen.hpp"
+
+#include "fsm-editor/simulation/batchsimulator.hpp"
+#include "fsm-editor/simulation/reachability.hpp"
+#include "fsm-editor/simulation/simulator.hpp"
+#include "fsm-editor/simulation/tracereplayer.hpp"
+#include "fsm-editor/visitors/fsmcompiler.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @file simulation.cpp
+ * @brief Measures how many entities per second can be stepped through a compiled FSM, one by one and in batches on
+ * several threads, how fast dead logic is found, how fast conditions are tested against input words, and how fast
+ * input traces are replayed.
+ */
+
+using namespace fsme;
+using namespace fsme::benchmarks;
+
+namespace
+{
+
+void report_ticks(const char* name, std::size_t ticks, double seconds)
+{
+	std::printf("%-48s %10.2f ns/tick %8.2f Mticks/s\n", name, seconds * 1e9 / double(ticks), double(ticks) / seconds / 1e6);
+}
+
+/**
+ * @brief Prints the states where the entities of \p simulator spent the most ticks.
+ */
+void report_occupancy(const simulation::BatchSimulator& simulator)
+{
+	const std::vector<std::uint64_t>& occupancy = simulator.get_occupancy();
+	const double entity_ticks = double(simulator.entity_count()) * double(simulator.get_tick_count());
+
+	std::vector<std::uint32_t> states(occupancy.size());
+	for (std::uint32_t i = 0; i < states.size(); ++i)
+	{
+		states[i] = i;
+	}
+
+	const std::size_t shown_count = std::min<std::size_t>(states.size(), 5);
+	std::partial_sort(states.begin(), states.begin() + shown_count, states.end(), [&](std::uint32_t lhs, std::uint32_t rhs) {
+		return occupancy[lhs] > occupancy[rhs];
+	});
+
+	std::printf("occupancy:");
+	for (std::size_t i = 0; i < shown_count; ++i)
+	{
+		std::printf(" %s %.1f%%", simulator.get_fsm().state_names[states[i]].c_str(), double(occupancy[states[i]]) / entity_ticks * 100.0);
+	}
+	std::printf("\n");
+}
+
+void run(std::size_t state_count, std::size_t entity_count, double true_probability)
+{
+	widgets::BoolExpressionAutocomplete autocomplete;
+	make_autocomplete(autocomplete);
+
+	FsmEditor editor;
+	editor.set_autocomplete_provider(&autocomplete);
+
+	SyntheticGraphParams params;
+	params.state_count = state_count;
+	make_synthetic_graph(editor, autocomplete, params);
+
+	simulation::CompiledFsm fsm;
+	const double compile_seconds = measure_seconds(3, [&] {
+		fsm = visitors::FsmCompiler::compile(editor);
+	});
+
+	std::printf(
+		"-- %zu states, %zu branches, %zu inputs, %zu entities with inputs true with a probability of %.2f\n",
+		fsm.state_count(),
+		fsm.branches.size(),
+		fsm.input_count(),
+		entity_count,
+		true_probability
+	);
+
+	report("compile, per branch", fsm.branches.size(), compile_seconds);
+
+	std::size_t dead_branch_count = 0;
+	report("reachability analysis, per branch", fsm.branches.size(), measure_seconds(3, [&] {
+		dead_branch_count += simulation::ReachabilityAnalysis::analyze(fsm).dead_branches.size();
+	}));
+	do_not_optimize(dead_branch_count);
+
+	simulation::Simulator simulator(fsm);
+	std::mt19937 rng(1234);
+	std::uniform_int_distribution<std::uint32_t> pick_state(0, std::uint32_t(fsm.state_count() - 1));
+	std::bernoulli_distribution is_true(true_probability);
+
+	for (std::size_t i = 0; i < entity_count; ++i)
+	{
+		simulator.add_entity(pick_state(rng));
+
+		for (std::uint32_t input = 0; input < fsm.input_count(); ++input)
+		{
+			simulator.set_input(i, input, is_true(rng));
+		}
+	}
+
+	const std::size_t ticks_per_run = 100;
+	std::size_t transition_count = 0;
+
+	const double seconds = measure_seconds(5, [&] {
+		for (std::size_t i = 0; i < ticks_per_run; ++i)
+		{
+			transition_count += simulator.tick();
+		}
+	});
+
+	do_not_optimize(transition_count);
+	report_ticks("tick", entity_count * ticks_per_run, seconds);
+
+	struct BatchRun
+	{
+		std::size_t thread_count;
+		bool grouping_allowed;
+	};
+
+	// Also stepping the entities in the order they are stored, on a single thread, tells whether grouping them by state
+	// pays off
+	std::vector<BatchRun> batch_runs = {{1, true}, {1, false}};
+	if (std::thread::hardware_concurrency() > 1)
+	{
+		batch_runs.push_back({std::thread::hardware_concurrency(), true});
+	}
+
+	for (const BatchRun& batch_run : batch_runs)
+	{
+		simulation::BatchSimulator batch(fsm, batch_run.thread_count);
+		batch.set_grouping_allowed(batch_run.grouping_allowed);
+		batch.reset(entity_count);
+
+		for (std::size_t i = 0; i < entity_count; ++i)
+		{
+			batch.set_state(i, simulator.get_state(i));
+
+			for (std::size_t word = 0; word < fsm.input_word_count(); ++word)
+			{
+				batch.get_input_words(word)[i] = simulator.get_inputs(i)[word];
+			}
+		}
+
+		const double batch_seconds = measure_seconds(5, [&] {
+			batch.clear_statistics();
+
+			for (std::size_t i = 0; i < ticks_per_run; ++i)
+			{
+				batch.tick();
+			}
+		});
+
+		char name[64];
+		std::snprintf(
+			name,
+			sizeof(name),
+			"tick in batches, %zu threads%s",
+			batch_run.thread_count,
+			batch_run.grouping_allowed ? "" : ", never grouped"
+		);
+		report_ticks(name, entity_count * ticks_per_run, batch_seconds);
+		std::printf("%-48s %10.2f Mtransitions/s\n", "", double(batch.get_transition_count()) / batch_seconds / 1e6);
+
+		if (&batch_run == &batch_runs.back())
+		{
+			report_occupancy(batch);
+		}
+	}
+}
+
+/**
+ * @brief Tests the conditions of a compiled FSM against the same input word of many entities, one word at a time
+ * then one batch at a time.
+ */
+void run_conditions(std::size_t entity_count)
+{
+	widgets::BoolExpressionAutocomplete autocomplete;
+	make_autocomplete(autocomplete);
+
+	FsmEditor editor;
+	editor.set_autocomplete_provider(&autocomplete);
+
+	SyntheticGraphParams params;
+	params.state_count = 100;
+	make_synthetic_graph(editor, autocomplete, params);
+
+	const simulation::CompiledFsm fsm = visitors::FsmCompiler::compile(editor);
+
+	std::vector<simulation::ConditionMask> conditions;
+	for (const simulation::CompiledFsm::Branch& branch : fsm.branches)
+	{
+		if (branch.word == 0)
+		{
+			conditions.push_back(branch.condition);
+		}
+	}
+
+	// Each option is true for half of the entities, so that conditions of 1 to 3 options hold fairly often
+	std::mt19937_64 rng(1234);
+	std::vector<std::uint64_t> words(entity_count);
+	for (std::uint64_t& word : words)
+	{
+		word = rng();
+	}
+
+	std::printf("-- %zu conditions over the first input word of %zu entities\n", conditions.size(), entity_count);
+
+	const std::size_t test_count = conditions.size() * entity_count;
+
+	// Both produce a mask of the entities each condition holds for, as a batched simulation would need
+	std::uint32_t holds = 0;
+
+	report("condition test, one word at a time", test_count, measure_seconds(5, [&] {
+		for (const simulation::ConditionMask& condition : conditions)
+		{
+			for (std::size_t i = 0; i < words.size(); i += simulation::condition_batch_size)
+			{
+				std::uint32_t batch_holds = 0;
+
+				for (std::size_t j = 0; j < simulation::condition_batch_size; ++j)
+				{
+					batch_holds |= std::uint32_t(condition.test(words[i + j]) ? 1 : 0) << j;
+				}
+
+				holds ^= batch_holds;
+			}
+		}
+	}));
+
+	report("condition test, in batches", test_count, measure_seconds(5, [&] {
+		for (const simulation::ConditionMask& condition : conditions)
+		{
+			for (std::size_t i = 0; i < words.size(); i += simulation::condition_batch_size)
+			{
+				holds ^= simulation::test_batch(condition, words.data() + i);
+			}
+		}
+	}));
+
+	do_not_optimize(holds);
+}
+
+/**
+ * @brief Replays a trace of \p entity_count entities over \p tick_count ticks, in which each option holds with a
+ * probability of \p true_probability.
+ */
+void run_replay(std::size_t entity_count, std::size_t tick_count, double true_probability)
+{
+	widgets::BoolExpressionAutocomplete autocomplete;
+	make_autocomplete(autocomplete);
+
+	FsmEditor editor;
+	editor.set_autocomplete_provider(&autocomplete);
+
+	SyntheticGraphParams params;
+	params.state_count = 1000;
+	make_synthetic_graph(editor, autocomplete, params);
+
+	const simulation::CompiledFsm fsm = visitors::FsmCompiler::compile(editor);
+
+	std::mt19937 rng(1234);
+	std::bernoulli_distribution is_true(true_probability);
+	std::string trace;
+
+	for (std::size_t tick = 0; tick < tick_count; ++tick)
+	{
+		for (std::size_t entity = 0; entity < entity_count; ++entity)
+		{
+			trace += std::to_string(tick) + '\t' + std::to_string(entity);
+
+			for (const std::string& name : fsm.input_names)
+			{
+				if (is_true(rng))
+				{
+					trace += '\t';
+					trace += name;
+				}
+			}
+
+			trace += '\n';
+		}
+	}
+
+	const std::string path = "bench-simulation-trace.tsv";
+	std::ofstream(path, std::ios::binary).write(trace.data(), std::streamsize(trace.size()));
+
+	std::printf(
+		"-- trace of %zu entities over %zu ticks with inputs true with a probability of %.2f, %.1f MiB\n",
+		entity_count,
+		tick_count,
+		true_probability,
+		double(trace.size()) / (1 << 20)
+	);
+
+	std::uint64_t transition_count = 0;
+
+	const double seconds = measure_seconds(3, [&] {
+		simulation::TraceReplayer replayer(fsm);
+		replayer.replay(path);
+		transition_count += replayer.get_transition_count();
+	});
+
+	do_not_optimize(transition_count);
+	report("replay, per step", entity_count * tick_count, seconds);
+	std::printf("%-48s %10.2f MiB/s\n", "", double(trace.size()) / (1 << 20) / seconds);
+
+	std::remove(path.c_str());
+}
+
+}
+
+int main()
+{
+	run(1000, 10000, 0.5);
+	run(1000, 10000, 0.9);
+	run(10000, 100000, 0.5);
+
+	// Many entities per state, as with thousands of monsters sharing a small FSM, which are grouped by state
+	run(20, 100000, 0.5);
+	run(5, 100000, 0.5);
+
+	run_conditions(1 << 16);
+
+	run_replay(1000, 1000, 0.1);
+}
@@ -0,0 +1,134 @@
+#include "benchmark.hpp"
+
+#include "fsm-editor/util/idhash.hpp"
+#include "fsm-editor/util/slotmap.hpp"
+
+#include <algorithm>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @file slotmap.cpp
+ * @brief Compares lookup and iteration throughput of detail::SlotMap against the std::unordered_map it replaced for
+ * the graph entities of FsmEditor.
+ */
+
+using namespace fsme;
+using namespace fsme::benchmarks;
+
+namespace
+{
+
+// Mirrors PinInfo, which is the most commonly looked up entity.
+struct Payload
+{
+	ed::NodeId node_id;
+	std::vector<std::uint64_t> links;
+};
+
+// Allocates IDs with some churn so that the slot map is fragmented like it would be after editing for a while.
+std::vector<ed::PinId> make_ids(detail::IdPool& pool, std::size_t count, std::mt19937& rng)
+{
+	std::vector<ed::PinId> ids;
+
+	for (std::size_t i = 0; i < count * 2; ++i)
+	{
+		ids.emplace_back(std::uintptr_t(pool.allocate()));
+	}
+
+	std::shuffle(ids.begin(), ids.end(), rng);
+
+	for (std::size_t i = count; i < ids.size(); ++i)
+	{
+		pool.release(std::uintptr_t(ids[i]));
+	}
+
+	ids.resize(count);
+
+	return ids;
+}
+
+void run(std::size_t count)
+{
+	std::mt19937 rng(1234);
+	detail::IdPool pool;
+
+	const auto ids = make_ids(pool, count, rng);
+
+	std::unordered_map<ed::PinId, Payload> map;
+	detail::SlotMap<ed::PinId, Payload> slot_map;
+
+	for (const ed::PinId id : ids)
+	{
+		map.emplace(id, Payload{ed::NodeId(std::uintptr_t(id) + 1), {}});
+		slot_map.emplace(id, Payload{ed::NodeId(std::uintptr_t(id) + 1), {}});
+	}
+
+	auto lookups = ids;
+	std::shuffle(lookups.begin(), lookups.end(), rng);
+
+	const std::size_t rounds = std::max(std::size_t(1), std::size_t(2000000) / count);
+	const std::size_t lookup_count = rounds * lookups.size();
+	const std::size_t iteration_count = rounds * count;
+
+	std::printf("-- %zu entities\n", count);
+
+	report("std::unordered_map lookup", lookup_count, measure_seconds(5, [&] {
+		std::uintptr_t sum = 0;
+		for (std::size_t r = 0; r < rounds; ++r)
+		{
+			for (const ed::PinId id : lookups)
+			{
+				sum += std::uintptr_t(map.find(id)->second.node_id);
+			}
+		}
+		do_not_optimize(sum);
+	}));
+
+	report("detail::SlotMap lookup", lookup_count, measure_seconds(5, [&] {
+		std::uintptr_t sum = 0;
+		for (std::size_t r = 0; r < rounds; ++r)
+		{
+			for (const ed::PinId id : lookups)
+			{
+				sum += std::uintptr_t(slot_map.find(id)->node_id);
+			}
+		}
+		do_not_optimize(sum);
+	}));
+
+	report("std::unordered_map iteration", iteration_count, measure_seconds(5, [&] {
+		std::uintptr_t sum = 0;
+		for (std::size_t r = 0; r < rounds; ++r)
+		{
+			for (const auto& p : map)
+			{
+				sum += std::uintptr_t(p.second.node_id);
+			}
+		}
+		do_not_optimize(sum);
+	}));
+
+	report("detail::SlotMap iteration", iteration_count, measure_seconds(5, [&] {
+		std::uintptr_t sum = 0;
+		for (std::size_t r = 0; r < rounds; ++r)
+		{
+			for (const auto& p : slot_map)
+			{
+				sum += std::uintptr_t(p.second.node_id);
+			}
+		}
+		do_not_optimize(sum);
+	}));
+}
+
+}
+
+int main()
+{
+	for (const std::size_t count : {1000, 10000, 100000, 1000000})
+	{
+		run(count);
+	}
+}
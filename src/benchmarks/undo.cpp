@@ -0,0 +1,207 @@
+#include "benchmark.hpp"
+#include "graphgen.hpp"
+#include "headless.hpp"
+
+#include "fsm-editor/undohistory.hpp"
+#include "fsm-editor/visitors/nativeserializer.hpp"
+
+#include <cstdio>
+#include <random>
+#include <utility>
+#include <vector>
+
+/**
+ * @file undo.cpp
+ * @brief Measures the cost of recording, undoing and redoing random edits to a large graph.
+ */
+
+using namespace fsme;
+using namespace fsme::benchmarks;
+
+namespace
+{
+
+/**
+ * @brief Performs random edits to the states and conditional blocks of a graph, each one as an undo step.
+ */
+class RandomEditor
+{
+public:
+	RandomEditor(FsmEditor& editor, const std::vector<nodes::StateNode*>& states, unsigned seed) :
+		m_editor(&editor),
+		m_rng(seed)
+	{
+		for (auto* state : states)
+		{
+			m_states.push_back(state->node_id());
+		}
+	}
+
+	void edit()
+	{
+		switch (std::uniform_int_distribution<int>(0, 5)(m_rng))
+		{
+		case 0: create_state(); break;
+		case 1: destroy_node(); break;
+		case 2: create_link(); break;
+		case 3: destroy_links(); break;
+		case 4: resize_cond(); break;
+		default: rename_state(); break;
+		}
+
+		m_editor->get_undo_history().commit_step();
+	}
+
+private:
+	nodes::StateNode& pick_state()
+	{
+		const std::size_t index = std::uniform_int_distribution<std::size_t>(0, m_states.size() - 1)(m_rng);
+		return static_cast<nodes::StateNode&>(*m_editor->get_node_by_id(m_states[index]));
+	}
+
+	void create_state()
+	{
+		auto& state = m_editor->make_node<nodes::StateNode>();
+		state.get_name_input().set_text("new_state_" + std::to_string(++m_name_count));
+		m_editor->notify_node_edited(state);
+		m_states.push_back(state.node_id());
+
+		auto& cond = m_editor->make_node<nodes::CondNode>();
+		m_conds.push_back(cond.node_id());
+		m_editor->create_link({state.outputs()[0], cond.inputs()[0]});
+	}
+
+	void destroy_node()
+	{
+		auto& nodes = m_conds.empty() || std::bernoulli_distribution(0.5)(m_rng) ? m_states : m_conds;
+
+		if (nodes.size() < 2)
+		{
+			return;
+		}
+
+		const std::size_t index = std::uniform_int_distribution<std::size_t>(0, nodes.size() - 1)(m_rng);
+		m_editor->destroy_node(nodes[index]);
+
+		std::swap(nodes[index], nodes.back());
+		nodes.pop_back();
+	}
+
+	void create_link()
+	{
+		const auto from = pick_state().outputs()[0];
+		const auto to = pick_state().inputs()[0];
+		m_editor->create_link({from, to});
+	}
+
+	void destroy_links()
+	{
+		m_editor->destroy_links_involving(pick_state().inputs()[0]);
+	}
+
+	void resize_cond()
+	{
+		if (m_conds.empty())
+		{
+			create_state();
+			return;
+		}
+
+		const std::size_t index = std::uniform_int_distribution<std::size_t>(0, m_conds.size() - 1)(m_rng);
+		auto& cond = static_cast<nodes::CondNode&>(*m_editor->get_node_by_id(m_conds[index]));
+		cond.set_output_count(std::uniform_int_distribution<std::size_t>(1, 5)(m_rng));
+	}
+
+	void rename_state()
+	{
+		auto& state = pick_state();
+
+		// This is what selecting the node does in the editor
+		const ed::NodeId id = state.node_id();
+		m_editor->get_undo_history().track({&id, 1});
+
+		state.get_name_input().set_text("renamed_" + std::to_string(++m_name_count));
+		m_editor->notify_node_edited(state);
+	}
+
+	FsmEditor* m_editor;
+	std::mt19937 m_rng;
+	std::vector<ed::NodeId> m_states;
+	std::vector<ed::NodeId> m_conds;
+	std::size_t m_name_count = 0;
+};
+
+/**
+ * @brief Serializes the graph of \p editor, leaving out the IDs allocated so far, which undoing does not give back.
+ */
+std::vector<char> serialize_graph(FsmEditor& editor)
+{
+	visitors::GraphSnapshot snapshot = visitors::NativeSerializer::snapshot(editor);
+	snapshot.id_high_water = 0;
+	return visitors::NativeSerializer::serialize(snapshot);
+}
+
+void run(std::size_t state_count, std::size_t edit_count)
+{
+	HeadlessImGui imgui;
+
+	widgets::BoolExpressionAutocomplete autocomplete;
+	make_autocomplete(autocomplete);
+
+	FsmEditor editor;
+	editor.set_autocomplete_provider(&autocomplete);
+
+	SyntheticGraphParams params;
+	params.state_count = state_count;
+	params.cond_outputs = 3;
+	const auto states = make_synthetic_graph(editor, autocomplete, params);
+
+	UndoHistory& history = editor.get_undo_history();
+	history.clear();
+	history.set_step_limit(edit_count);
+
+	const std::vector<char> original = serialize_graph(editor);
+	std::printf("-- %zu nodes, %zu edits\n", state_count * (2 + params.cond_outputs), edit_count);
+
+	RandomEditor random_editor(editor, states, params.seed);
+
+	report("edit", edit_count, measure_seconds(1, [&] {
+		for (std::size_t i = 0; i < edit_count; ++i)
+		{
+			random_editor.edit();
+		}
+	}));
+
+	const std::size_t memory_usage = history.memory_usage();
+	std::printf("%-48s %10.2f MB %10.1f B/step\n", "history memory usage", double(memory_usage) / 1e6,
+		double(memory_usage) / double(edit_count));
+
+	const std::vector<char> edited = serialize_graph(editor);
+
+	report("undo", edit_count, measure_seconds(1, [&] {
+		while (history.can_undo())
+		{
+			history.undo();
+		}
+	}));
+
+	std::printf("%-48s %10s\n", "undone graph matches original",
+		serialize_graph(editor) == original ? "yes" : "NO");
+
+	report("redo", edit_count, measure_seconds(1, [&] {
+		while (history.can_redo())
+		{
+			history.redo();
+		}
+	}));
+
+	std::printf("%-48s %10s\n", "redone graph matches edited",
+		serialize_graph(editor) == edited ? "yes" : "NO");
+}
+
+}
+
+int main()
+{
+	run(1000, 100000);
+}
@@ -0,0 +1,333 @@
+#include "fsm-editor/editor.hpp"
+#include "fsm-editor/util/backgroundsaver.hpp"
+#include "fsm-editor/util/conditionprofile.hpp"
+#include "fsm-editor/util/directory.hpp"
+#include "fsm-editor/util/threadpool.hpp"
+#include "fsm-editor/visitors/centauriserializer.hpp"
+#include "fsm-editor/visitors/nativedeserializer.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * @file exporter.cpp
+ * @brief Command line tool that exports native files into the Centauri format, without a window or a display.
+ *
+ * Every state of each file is exported, either in turn (see fsme::visitors::CentauriSerializer::serialize_states()) or
+ * as a whole graph (see fsme::visitors::CentauriSerializer::serialize_graph()). Files are exported in parallel, each one
+ * by a single worker thread.
+ *
+ * Whole graphs can have their equivalent states merged, in which case the states left out are listed next to the
+ * exported file, so that the game can still find them by the state emitted in their place, and the conditions of their
+ * states flattened into decision diagrams, see fsme::visitors::CentauriGraphOptions. Their conditions can also be
+ * reordered by how often they held, as recorded in a profile next to each native file, see
+ * fsme::detail::ConditionProfile.
+ */
+
+using namespace fsme;
+
+namespace
+{
+
+/// @brief Extension of the native files picked up within directories
+const std::string native_extension = ".fsm";
+
+/// @brief Extension of the exported files, which replaces the one of the native files
+const std::string centauri_extension = ".centauri";
+
+/// @brief Extension of the lists of merged states, see Options::merge_equivalent_states
+const std::string merge_report_extension = ".merges";
+
+/// @brief Extension of the condition profiles read next to the native files, see Options::use_profiles
+const std::string profile_extension = ".profile";
+
+struct Options
+{
+	bool show_help = false;
+
+	std::vector<std::string> inputs;
+
+	/// @brief Directory to write exported files to, rather than next to their native file
+	std::string output_directory;
+
+	/// @brief Number of files exported in parallel, 0 for as many as the hardware can run concurrently
+	std::size_t thread_count = 0;
+
+	/// @brief Whether to export each file as a whole graph, rather than each of its states in turn
+	bool whole_graph = false;
+
+	/// @brief How whole graphs are laid out. When equivalent states are merged, the states left out are written to a
+	/// file of their own.
+	visitors::CentauriGraphOptions graph;
+
+	/// @brief Whether to reorder the conditions of whole graphs by the profile next to their native file, if any, as
+	/// the IDs it refers to are those of that file only
+	bool use_profiles = false;
+};
+
+void print_usage(std::FILE* out)
+{
+	std::fputs(
+		"Usage: fsm-export [options] <file or directory>...\n"
+		"Exports native files into the Centauri format. Directories are searched for *.fsm files.\n"
+		"\n"
+		"Options:\n"
+		"  -o <directory>  Write exported files to <directory> rather than next to their native file\n"
+		"  -j <count>      Number of files exported in parallel, defaults to the number of hardware threads\n"
+		"  -g              Export each file as a whole graph, where shared and identical branches are emitted once\n"
+		"  -m              Like -g, also merging equivalent states, and listing the states merged into another one\n"
+		"                  to a .merges file next to each exported file\n"
+		"  -f              Like -g, also flattening the conditions of each state into a decision diagram that tests\n"
+		"                  each option at most once, unless they use plain Lua expressions\n"
+		"  -p              Like -g, also testing the conditions that held most often first, where this does not\n"
+		"                  change the outcome, as recorded in a .profile file next to each native file if any\n"
+		"  -h              Show this help\n",
+		out
+	);
+}
+
+/**
+ * @throws std::runtime_error if the command line is malformed.
+ */
+Options parse_options(int argc, char** argv)
+{
+	Options options;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+
+		if (arg == "-h")
+		{
+			options.show_help = true;
+			return options;
+		}
+
+		if (arg == "-g")
+		{
+			options.whole_graph = true;
+		}
+		else if (arg == "-m")
+		{
+			options.whole_graph = true;
+			options.graph.merge_equivalent_states = true;
+		}
+		else if (arg == "-f")
+		{
+			options.whole_graph = true;
+			options.graph.flatten_conditions = true;
+		}
+		else if (arg == "-p")
+		{
+			options.whole_graph = true;
+			options.use_profiles = true;
+		}
+		else if (arg == "-o" || arg == "-j")
+		{
+			if (i + 1 == argc)
+			{
+				throw std::runtime_error("Missing value for " + arg);
+			}
+
+			const std::string value = argv[++i];
+
+			if (arg == "-o")
+			{
+				options.output_directory = value;
+				continue;
+			}
+
+			char* end = nullptr;
+			const unsigned long count = std::strtoul(value.c_str(), &end, 10);
+
+			if (value.empty() || *end != '\0' || count == 0)
+			{
+				throw std::runtime_error("Invalid thread count: " + value);
+			}
+
+			options.thread_count = count;
+		}
+		else if (!arg.empty() && arg[0] == '-')
+		{
+			throw std::runtime_error("Unknown option: " + arg);
+		}
+		else
+		{
+			options.inputs.push_back(arg);
+		}
+	}
+
+	if (options.inputs.empty())
+	{
+		throw std::runtime_error("No input given");
+	}
+
+	return options;
+}
+
+std::string get_output_path(const std::string& input, const std::string& output_directory, const std::string& extension)
+{
+	const std::size_t name_begin = input.find_last_of("/\\") + 1;
+	std::size_t name_end = input.find_last_of('.');
+
+	if (name_end == std::string::npos || name_end < name_begin)
+	{
+		name_end = input.size();
+	}
+
+	if (output_directory.empty())
+	{
+		return input.substr(0, name_end) + extension;
+	}
+
+	const std::string name = input.substr(name_begin, name_end - name_begin) + extension;
+	const char last = output_directory.back();
+
+	return last == '/' || last == '\\' ? output_directory + name : output_directory + '/' + name;
+}
+
+/**
+ * @brief Exports every state of the native file at \p input to \p output, and the list of merged states to
+ * \p merge_report_output if equivalent states are merged.
+ * @return The number of states exported.
+ * @throws std::runtime_error if the file cannot be loaded or exported.
+ */
+std::size_t export_file(
+	const std::string& input,
+	const std::string& output,
+	const std::string& merge_report_output,
+	const Options& options,
+	widgets::BoolExpressionAutocomplete& autocomplete)
+{
+	// Exported files are never shown, so there is no need for a node editor context nor to read their layout
+	FsmEditor editor(FsmEditor::Mode::HEADLESS);
+	editor.set_autocomplete_provider(&autocomplete);
+
+	visitors::NativeDeserializer::deserialize_file(editor, input);
+
+	visitors::CentauriGraphOptions graph_options = options.graph;
+	detail::ConditionProfile profile;
+
+	if (options.use_profiles)
+	{
+		// Files that were never profiled are exported as they are
+		const std::string profile_path = get_output_path(input, "", profile_extension);
+
+		if (std::ifstream(profile_path))
+		{
+			profile = detail::ConditionProfile::load(profile_path);
+			graph_options.profile = &profile;
+		}
+	}
+
+	// Reused by the files exported on the same worker thread, so that they stop allocating once large enough
+	thread_local detail::TextWriter text;
+	thread_local detail::TextWriter merge_report;
+	text.clear();
+	merge_report.clear();
+
+	const std::size_t state_count = options.whole_graph
+		? visitors::CentauriSerializer::serialize_graph(text, editor, graph_options, &merge_report)
+		: visitors::CentauriSerializer::serialize_states(text, editor);
+
+	detail::BackgroundSaver::write_file(output, text.text());
+
+	if (options.graph.merge_equivalent_states)
+	{
+		// Written even when empty, so that a list left over from a previous export does not linger
+		detail::BackgroundSaver::write_file(merge_report_output, merge_report.text());
+	}
+
+	return state_count;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+
+	try
+	{
+		options = parse_options(argc, argv);
+	}
+	catch (const std::runtime_error& e)
+	{
+		std::fprintf(stderr, "fsm-export: %s\n", e.what());
+		print_usage(stderr);
+		return 2;
+	}
+
+	if (options.show_help)
+	{
+		print_usage(stdout);
+		return 0;
+	}
+
+	std::vector<std::string> files;
+
+	for (const std::string& input : options.inputs)
+	{
+		if (!detail::is_directory(input))
+		{
+			files.push_back(input);
+			continue;
+		}
+
+		try
+		{
+			const std::vector<std::string> directory_files = detail::list_files(input, native_extension);
+			files.insert(files.end(), directory_files.begin(), directory_files.end());
+		}
+		catch (const std::runtime_error& e)
+		{
+			std::fprintf(stderr, "fsm-export: %s\n", e.what());
+			return 1;
+		}
+	}
+
+	// Only ever read from once set up, so it is shared by all of the workers
+	widgets::BoolExpressionAutocomplete autocomplete;
+	widgets::add_centauri_options(autocomplete);
+
+	std::atomic<std::size_t> failed_count(0);
+
+	{
+		detail::ThreadPool pool(options.thread_count);
+
+		for (const std::string& file : files)
+		{
+			pool.submit([&, file] {
+				try
+				{
+					const std::string output = get_output_path(file, options.output_directory, centauri_extension);
+					const std::string merge_report_output =
+						get_output_path(file, options.output_directory, merge_report_extension);
+
+					const std::size_t state_count = export_file(file, output, merge_report_output, options, autocomplete);
+					std::printf("%s -> %s (%zu states)\n", file.c_str(), output.c_str(), state_count);
+				}
+				catch (const std::exception& e)
+				{
+					std::fprintf(stderr, "fsm-export: Failed to export '%s': %s\n", file.c_str(), e.what());
+					++failed_count;
+				}
+			});
+		}
+
+		pool.wait();
+	}
+
+	if (failed_count != 0)
+	{
+		std::fprintf(stderr, "fsm-export: %zu of %zu files failed to export\n", std::size_t(failed_count), files.size());
+		return 1;
+	}
+
+	return 0;
+}
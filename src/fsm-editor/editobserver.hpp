@@ -0,0 +1,51 @@
+#pragma once
+
+#include "fwd.hpp"
+#include "node.hpp"
+
+#include <onidev/core/span.h>
+
+namespace fsme
+{
+
+/**
+ * @brief Interface for an observer of the edits made to the graph through the FsmEditor mutation API.
+ *
+ * @details Notifications are sent once the graph is in a consistent state, so that observers may inspect it. Loading
+ * a graph is not an edit, and does not send any notification.
+ * When a node is destroyed, its links are destroyed first, and the corresponding notifications are sent before the
+ * node one. Likewise, the links of destroyed pins are destroyed before the pin change notification.
+ * @see FsmEditor::add_observer()
+ */
+class EditObserver
+{
+public:
+	virtual ~EditObserver() = default;
+
+	/**
+	 * @brief Called after \p node was created along with its default pins, and added to the graph.
+	 */
+	virtual void on_node_created(Node&) {}
+
+	/**
+	 * @brief Called right before \p node is removed from the graph, once it has no links left.
+	 */
+	virtual void on_node_destroyed(Node&) {}
+
+	/**
+	 * @brief Called after the input or output pins of \p node were created, destroyed or reordered.
+	 * @param side Whether the inputs or the outputs changed.
+	 * @param previous_pins The pins of that side before the change.
+	 */
+	virtual void on_pins_changed(Node&, PinType, od::gsl::span<const ed::PinId>) {}
+
+	virtual void on_link_created(ed::LinkId, const PinPair&) {}
+	virtual void on_link_destroyed(ed::LinkId, const PinPair&) {}
+
+	/**
+	 * @brief Called after the contents of \p node, i.e. its name or expressions, were edited.
+	 */
+	virtual void on_node_edited(Node&) {}
+};
+
+}
@@ -4,23 +4,74 @@
 #include "visitors/nodemenurenderer.hpp"
 #include "visitors/linkverifier.hpp"
 #include "visitors/nodeduplicator.hpp"
+#include "visitors/nodekindfinder.hpp"
 #include "visitors/nativeserializer.hpp"
 #include "visitors/nativedeserializer.hpp"
+#include "visitors/journalreader.hpp"
 #include "util/erase.hpp"
 
-#include <sstream>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
 
 namespace fsme
 {
 
-FsmEditor::FsmEditor(sf::RenderTarget& target) :
-	m_target(&target),
-	m_context(create_context()),
-	m_autocomplete_provider(nullptr)
-{}
+namespace
+{
+
+/// @brief Minimum delay between two appends to the journal, see FsmEditor::flush_journal()
+const auto journal_flush_interval = std::chrono::seconds(1);
+
+/// @brief Size past which the journal gets compacted by saving the file it applies to
+const std::size_t journal_compaction_size = std::size_t(1) << 20;
+
+/// @brief Returns the contents of the file at \p path, or nothing if it cannot be read
+std::vector<char> read_file(const std::string& path)
+{
+	std::ifstream input(path, std::ios::binary | std::ios::ate);
+	std::vector<char> bytes;
+
+	if (input)
+	{
+		bytes.resize(std::size_t(input.tellg()));
+		input.seekg(0);
+		input.read(bytes.data(), std::streamsize(bytes.size()));
+		bytes.resize(std::size_t(input.gcount()));
+	}
+
+	return bytes;
+}
+
+}
+
+FsmEditor::FsmEditor(Mode mode) :
+	m_context(mode == Mode::HEADLESS ? nullptr : create_context()),
+	m_autocomplete_provider(nullptr),
+	m_history(*this)
+{
+	if (is_headless())
+	{
+		return;
+	}
+
+	add_observer(m_journal);
+	add_observer(m_history);
+	add_observer(m_compilation);
+}
 
 FsmEditor::~FsmEditor()
 {
+	flush_journal(true);
+
+	// Nodes destroyed along with the editor are not edits
+	m_observers.clear();
+
+	if (is_headless())
+	{
+		return;
+	}
+
 	ed::DestroyEditor(m_context);
 }
 
@@ -28,6 +79,17 @@ void FsmEditor::clear()
 {
 	m_state = {};
 	m_volatile = {};
+	m_cond_tree_order.clear();
+	m_history.clear();
+	m_simulator_panel.reset();
+	m_compilation.reset();
+	m_analysis_panel.reset();
+	m_cost_panel.reset();
+
+	if (is_headless())
+	{
+		return;
+	}
 
 	ed::DestroyEditor(m_context);
 	m_context = create_context();
@@ -36,16 +98,18 @@ void FsmEditor::clear()
 void FsmEditor::render()
 {
 	ImGui::SetNextWindowPos(ImVec2(0.0, 0.0), ImGuiCond_Always);
-	ImGui::SetNextWindowSize(ImVec2(m_target->getSize().x, m_target->getSize().y), ImGuiCond_Always);
+	ImGui::SetNextWindowSize(ImGui::GetIO().DisplaySize, ImGuiCond_Always);
 
 	ImGui::Begin("FSM editor", nullptr, ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_MenuBar);
 
 	render_menu_bar();
 
-	ImGui::BeginChild("##loadsidebar", ImVec2(120.0f, ImGui::GetContentRegionAvail().y));
-/*
-	ImGui::Selectable("test");
-	ImGui::Selectable("test2");*/
+	ImGui::BeginChild("##loadsidebar", ImVec2(200.0f, ImGui::GetContentRegionAvail().y));
+
+	m_compilation.update();
+	m_simulator_panel.render(*this, m_compilation);
+	m_analysis_panel.render(*this, m_compilation);
+	m_cost_panel.render(*this, m_compilation);
 
 	ImGui::EndChild();
 	ImGui::SameLine();
@@ -56,113 +120,302 @@ void FsmEditor::render()
 	ImGui::EndChild();
 
 	ImGui::End();
+
+	m_history.commit_step();
+	flush_journal();
 }
 
 void FsmEditor::destroy_node(ed::NodeId id)
 {
-	detail::map_erase(m_state.nodes, id);
+	Node* node = get_node_by_id(id);
+
+	if (node == nullptr)
+	{
+		return;
+	}
+
+	// Links are destroyed first, so that observers see the node without any links left
+	destroy_links_involving(*node);
+
+	for (EditObserver* observer : m_observers)
+	{
+		observer->on_node_destroyed(*node);
+	}
+
+	m_state.pending_payloads.nodes.erase(id);
+	m_state.layouts.erase(id);
+	m_state.nodes.erase(id);
+	m_state.ids.release(std::uintptr_t(id));
 }
 
 ed::PinId FsmEditor::create_pin(ed::NodeId node)
 {
 	const ed::PinId id = new_unique_id();
-	m_state.pins.emplace(std::make_pair(id, PinInfo{node, {}}));
+	m_state.pins.emplace(id, PinInfo{node, {}});
 	return id;
 }
 
 void FsmEditor::destroy_pin(ed::PinId pin)
 {
 	destroy_links_involving(pin);
-	detail::map_erase(m_state.pins, pin);
+
+	if (m_state.pins.erase(pin))
+	{
+		m_state.ids.release(std::uintptr_t(pin));
+	}
 }
 
 const PinInfo* FsmEditor::get_pin_info(ed::PinId pin) const
 {
-	const auto it = m_state.pins.find(pin);
-	return (it != m_state.pins.end()) ? &it->second : nullptr;
+	return m_state.pins.find(pin);
 }
 
 ed::LinkId FsmEditor::create_link(PinPair pin_pair)
 {
 	const ed::LinkId id = new_unique_id();
 
-	m_state.links.emplace(std::make_pair(id, pin_pair));
-
-	LinkInfo link{id, pin_pair};
-	m_state.pins.at(pin_pair.from).links.push_back(link);
-	m_state.pins.at(pin_pair.to).links.push_back(link);
+	insert_link(id, pin_pair);
+	notify_link_created(id, pin_pair);
 
 	return id;
 }
 
 void FsmEditor::destroy_link(ed::LinkId link)
 {
-	const auto it = m_state.links.find(link);
-	if (it != m_state.links.end())
-	{
-		const PinPair pin_pair = it->second;
-		m_state.links.erase(it);
-
-		detail::erase(m_state.pins.at(pin_pair.from).links, pin_pair);
-		detail::erase(m_state.pins.at(pin_pair.to).links, pin_pair);
-	}
+	destroy_links({&link, &link + 1});
 }
 
 const PinPair* FsmEditor::get_link_info(ed::LinkId link) const
 {
-	const auto it = m_state.links.find(link);
-	return (it != m_state.links.end()) ? &it->second : nullptr;
+	const StoredLink* stored = m_state.links.find(link);
+	return (stored != nullptr) ? &stored->pins : nullptr;
+}
+
+void FsmEditor::destroy_links(od::gsl::span<const ed::LinkId> links)
+{
+	for (const ed::LinkId link : links)
+	{
+		const StoredLink* stored = m_state.links.find(link);
+		if (stored != nullptr)
+		{
+			const PinPair pin_pair = stored->pins;
+
+			remove_from_cond_tree_index(pin_pair);
+			remove_from_pins(*stored);
+
+			m_state.links.erase(link);
+			m_state.ids.release(std::uintptr_t(link));
+
+			for (EditObserver* observer : m_observers)
+			{
+				observer->on_link_destroyed(link, pin_pair);
+			}
+		}
+	}
 }
 
 void FsmEditor::destroy_links_involving(ed::PinId pin)
 {
-	const auto it = m_state.pins.find(pin);
-	if (it != m_state.pins.end())
+	const PinInfo* pin_infos = m_state.pins.find(pin);
+	if (pin_infos != nullptr)
 	{
-		const auto& pin_infos = it->second;
-		while (!pin_infos.links.empty())
+		std::vector<ed::LinkId> links;
+		links.reserve(pin_infos->links.size());
+
+		for (const LinkInfo& link : pin_infos->links)
 		{
-			// TODO: could be more efficient, but better
-			destroy_link(pin_infos.links.back().id);
+			links.push_back(link.id);
 		}
+
+		destroy_links(links);
 	}
 }
 
+void FsmEditor::destroy_links_involving(const Node& node)
+{
+	std::vector<ed::LinkId> links;
+
+	const auto collect_links = [&](od::gsl::span<const ed::PinId> pins) {
+		for (const ed::PinId pin : pins)
+		{
+			const PinInfo* pin_infos = m_state.pins.find(pin);
+			if (pin_infos != nullptr)
+			{
+				for (const LinkInfo& link : pin_infos->links)
+				{
+					links.push_back(link.id);
+				}
+			}
+		}
+	};
+
+	collect_links(node.inputs());
+	collect_links(node.outputs());
+
+	destroy_links(links);
+}
+
 Node* FsmEditor::get_node_by_id(ed::NodeId id) const
 {
-	const auto it = m_state.nodes.find(id);
-	return (it != m_state.nodes.end()) ? &*it->second : nullptr;
+	const auto* node = m_state.nodes.find(id);
+	return (node != nullptr) ? node->get() : nullptr;
 }
 
 Node* FsmEditor::get_node_by_pin_id(ed::PinId pin) const
 {
-	const auto it = m_state.pins.find(pin);
-	return (it != m_state.pins.end()) ? get_node_by_id(it->second.node_id) : nullptr;
+	const PinInfo* pin_info = m_state.pins.find(pin);
+	return (pin_info != nullptr) ? get_node_by_id(pin_info->node_id) : nullptr;
+}
+
+void FsmEditor::add_observer(EditObserver& observer)
+{
+	m_observers.push_back(&observer);
+}
+
+void FsmEditor::remove_observer(EditObserver& observer)
+{
+	detail::erase(m_observers, &observer);
+}
+
+void FsmEditor::notify_node_edited(Node& node)
+{
+	for (EditObserver* observer : m_observers)
+	{
+		observer->on_node_edited(node);
+	}
+}
+
+void FsmEditor::notify_node_created(Node& node)
+{
+	for (EditObserver* observer : m_observers)
+	{
+		observer->on_node_created(node);
+	}
+}
+
+void FsmEditor::notify_link_created(ed::LinkId link, const PinPair& pins)
+{
+	for (EditObserver* observer : m_observers)
+	{
+		observer->on_link_created(link, pins);
+	}
+}
+
+void FsmEditor::notify_pins_changed(Node& node, PinType side, od::gsl::span<const ed::PinId> previous_pins)
+{
+	// Nodes create and destroy their pins when constructed and destroyed, which happens out of the graph
+	if (m_observers.empty() || get_node_by_id(node.node_id()) != &node)
+	{
+		return;
+	}
+
+	for (EditObserver* observer : m_observers)
+	{
+		observer->on_pins_changed(node, side, previous_pins);
+	}
+}
+
+void FsmEditor::insert_link(ed::LinkId id, PinPair pins)
+{
+	auto& from_links = m_state.pins.at(pins.from).links;
+	auto& to_links = m_state.pins.at(pins.to).links;
+
+	m_state.links.emplace(id, StoredLink{pins, std::uint32_t(from_links.size()), std::uint32_t(to_links.size())});
+
+	const LinkInfo link{id, pins};
+	from_links.push_back(link);
+	to_links.push_back(link);
+
+	add_to_cond_tree_index(pins);
+}
+
+void FsmEditor::remove_from_pins(const StoredLink& link)
+{
+	const auto remove = [&](ed::PinId pin, std::uint32_t position) {
+		auto& pin_links = m_state.pins.at(pin).links;
+
+		if (position != pin_links.size() - 1)
+		{
+			// The last link of the list takes the place of the removed one, so its stored position follows
+			const LinkInfo& moved = pin_links.back();
+			StoredLink& moved_link = m_state.links.at(moved.id);
+			(pin == moved.pins.from ? moved_link.from_position : moved_link.to_position) = position;
+
+			pin_links[position] = moved;
+		}
+
+		pin_links.pop_back();
+	};
+
+	remove(link.pins.from, link.from_position);
+	remove(link.pins.to, link.to_position);
+}
+
+bool FsmEditor::is_predecessor_in_cond_tree(ed::NodeId predecessor, ed::NodeId node) const
+{
+	return m_cond_tree_order.reaches(predecessor, node);
 }
 
 bool FsmEditor::is_link_selected(ed::LinkId link) const
 {
-	return std::find(
-		m_volatile.selection.links.begin(),
-		m_volatile.selection.links.end(),
-		link
-	) != m_volatile.selection.links.end();
+	return m_volatile.selection.link_index.contains(link);
 }
 
 bool FsmEditor::is_node_selected(ed::NodeId node) const
 {
-	return std::find(
-		m_volatile.selection.nodes.begin(),
-		m_volatile.selection.nodes.end(),
-		node
-				) != m_volatile.selection.nodes.end();
+	return m_volatile.selection.node_index.contains(node);
+}
+
+void FsmEditor::set_node_position(ed::NodeId node, ImVec2 position)
+{
+	get_node_layout(node).position = position;
+
+	if (is_headless())
+	{
+		return;
+	}
+
+	const detail::ScopedEditorContext context(m_context);
+	ed::SetNodePosition(node, position);
+}
+
+void FsmEditor::select_node(ed::NodeId node)
+{
+	if (is_headless())
+	{
+		return;
+	}
+
+	const detail::ScopedEditorContext context(m_context);
+	ed::SelectNode(node, true);
+}
+
+FsmEditor::NodeLayout& FsmEditor::get_node_layout(ed::NodeId node)
+{
+	NodeLayout* layout = m_state.layouts.find(node);
+	return layout != nullptr ? *layout : m_state.layouts.emplace(node, NodeLayout{});
+}
+
+void FsmEditor::update_node_layout(ed::NodeId node, ImVec2 position, ImVec2 size)
+{
+	NodeLayout& layout = get_node_layout(node);
+	layout.position = position;
+
+	if (!m_state.pending_payloads.nodes.contains(node))
+	{
+		layout.size = size;
+	}
 }
 
 ed::EditorContext* FsmEditor::create_context()
 {
-	ed::EditorContext* context = ed::CreateEditor();
+	// Node positions are saved in the native format, rather than in the settings file of the node editor
+	ed::Config config;
+	config.SettingsFile = nullptr;
+
+	ed::EditorContext* context = ed::CreateEditor(&config);
 
-	ed::SetCurrentEditor(context);
+	const detail::ScopedEditorContext scope(context);
 
 	auto& style = ed::GetStyle();
 	style.LinkStrength = 500.0f;
@@ -203,15 +456,19 @@ void FsmEditor::handle_item_deletion()
 {
 	if (ed::BeginDelete())
 	{
+		std::vector<ed::LinkId> deleted_links;
+
 		ed::LinkId deleted_link;
 		while (ed::QueryDeletedLink(&deleted_link))
 		{
 			if (ed::AcceptDeletedItem())
 			{
-				destroy_link(deleted_link);
+				deleted_links.push_back(deleted_link);
 			}
 		}
 
+		destroy_links(deleted_links);
+
 		ed::NodeId deleted_node;
 		while (ed::QueryDeletedNode(&deleted_node))
 		{
@@ -226,16 +483,68 @@ void FsmEditor::handle_item_deletion()
 
 void FsmEditor::refresh_selected_objects()
 {
-	m_volatile.selection.links.resize(ed::GetSelectedObjectCount());
-	m_volatile.selection.links.resize(ed::GetSelectedLinks(m_volatile.selection.links.data(), m_volatile.selection.links.size()));
+	auto& selection = m_volatile.selection;
+
+	selection.links.resize(ed::GetSelectedObjectCount());
+	selection.links.resize(ed::GetSelectedLinks(selection.links.data(), selection.links.size()));
+
+	selection.nodes.resize(ed::GetSelectedObjectCount());
+	selection.nodes.resize(ed::GetSelectedNodes(selection.nodes.data(), selection.nodes.size()));
+
+	selection.link_index.clear();
+	for (const ed::LinkId link : selection.links)
+	{
+		selection.link_index.insert(link);
+	}
+
+	selection.node_index.clear();
+	for (const ed::NodeId node : selection.nodes)
+	{
+		selection.node_index.insert(node);
+	}
+
+	// Selected nodes are the ones whose contents can be edited next frame
+	m_history.track(selection.nodes);
+}
+
+void FsmEditor::rebuild_cond_tree_index()
+{
+	m_cond_tree_order.clear();
 
-	m_volatile.selection.nodes.resize(ed::GetSelectedObjectCount());
-	m_volatile.selection.nodes.resize(ed::GetSelectedNodes(m_volatile.selection.nodes.data(), m_volatile.selection.nodes.size()));
+	for (const auto& p : m_state.links)
+	{
+		add_to_cond_tree_index(p.second.pins);
+	}
+}
+
+void FsmEditor::add_to_cond_tree_index(PinPair pins)
+{
+	Node* target = get_node_by_pin_id(pins.to);
+
+	if (target != nullptr && visitors::NodeKindFinder::is_conditional(*target))
+	{
+		m_cond_tree_order.add_edge(m_state.pins.at(pins.from).node_id, target->node_id());
+	}
+}
+
+void FsmEditor::remove_from_cond_tree_index(PinPair pins)
+{
+	// The target node may be being destroyed already, so it cannot be visited. This is a no-op if the link was not
+	// indexed, and all links towards a given node are either indexed or not.
+	const PinInfo* from = m_state.pins.find(pins.from);
+	const PinInfo* to = m_state.pins.find(pins.to);
+
+	if (from != nullptr && to != nullptr)
+	{
+		m_cond_tree_order.remove_edge(from->node_id, to->node_id);
+	}
 }
 
 void FsmEditor::render_menu_bar()
 {
 	bool open_new = false;
+	bool open_file = false;
+	bool open_save_as = false;
 
 	ImGui::PushID(this);
 	if (ImGui::BeginMenuBar())
@@ -247,16 +556,26 @@ void FsmEditor::render_menu_bar()
 				open_new = true;
 			}
 
+			if (ImGui::MenuItem("Open..."))
+			{
+				open_file = true;
+			}
+
 			if (ImGui::MenuItem("Save"))
 			{
-				std::stringstream ss;
-				visitors::NativeSerializer::serialize(*this, ss);
-				fprintf(stderr, "Size %d\n", int(ss.str().size()));
+				if (m_file_path.empty())
+				{
+					open_save_as = true;
+				}
+				else
+				{
+					save_to(m_file_path);
+				}
 			}
 
 			if (ImGui::MenuItem("Save as..."))
 			{
-
+				open_save_as = true;
 			}
 
 			if (ImGui::MenuItem("Export to Centauri format"))
@@ -275,27 +594,48 @@ void FsmEditor::render_menu_bar()
 			ImGui::EndMenu();
 		}
 
+		if (ImGui::BeginMenu("Edit"))
+		{
+			if (ImGui::MenuItem("Undo", "Ctrl+Z", false, m_history.can_undo()))
+			{
+				undo();
+			}
+
+			if (ImGui::MenuItem("Redo", "Ctrl+Y", false, m_history.can_redo()))
+			{
+				redo();
+			}
+
+			ImGui::EndMenu();
+		}
+
 		if (ImGui::BeginMenu("Debug"))
 		{
-			ImGui::Text("Last ID: %d", int(m_state.last_allocated_id));
+			ImGui::Text("Last ID: %d", int(m_state.ids.high_water()));
 
 			ImGui::Text("Node count: %d", int(m_state.nodes.size()));
 			ImGui::Text("Link count: %d", int(m_state.links.size()));
 			ImGui::Text("Pin count: %d", int(m_state.pins.size()));
+			ImGui::Text("Pending node payloads: %d", int(m_state.pending_payloads.nodes.size()));
 
 			ImGui::Separator();
 
 			if (ImGui::MenuItem("Reload"))
 			{
-				std::stringstream ss;
-				visitors::NativeSerializer::serialize(*this, ss);
-				fprintf(stderr, "Serialized form is %d bytes\n", int(ss.str().size()));
-				visitors::NativeDeserializer::deserialize(*this, ss);
+				const std::vector<char> bytes = visitors::NativeSerializer::serialize(*this);
+				fprintf(stderr, "Serialized form is %d bytes\n", int(bytes.size()));
+
+				// Reloading does not change the graph, so the journal still applies
+				flush_journal(true);
+				visitors::NativeDeserializer::deserialize(*this, bytes);
+				m_journal.discard_pending();
 			}
 
 			ImGui::EndMenu();
 		}
 
+		render_save_status();
+
 		ImGui::EndMenuBar();
 	}
 
@@ -331,14 +671,371 @@ void FsmEditor::render_menu_bar()
 
 		ImGui::EndPopup();
 	}
+
+	if (open_file)
+	{
+		ImGui::OpenPopup("Open file");
+		m_shared_input.set_text("");
+		m_volatile.open_error.clear();
+	}
+
+	ImGui::SetNextWindowSize(ImVec2(400, 200), ImGuiCond_Always);
+	if (ImGui::BeginPopupModal("Open file", nullptr, ImGuiWindowFlags_NoResize))
+	{
+		ImGui::TextWrapped("Specify the path of the native FSM file to open.");
+
+		detail::imgui_set_default_keyboard_focus();
+		ImGui::SetNextItemWidth(ImGui::GetContentRegionAvailWidth());
+		m_shared_input.set_hint("File path");
+		m_shared_input.render();
+
+		if (!m_volatile.open_error.empty())
+		{
+			ImGui::TextWrapped("%s", m_volatile.open_error.c_str());
+		}
+
+		if (ImGui::Button("Open"))
+		{
+			try
+			{
+				open_from(m_shared_input.get_text());
+				ImGui::CloseCurrentPopup();
+			}
+			catch (const std::runtime_error& e)
+			{
+				m_volatile.open_error = e.what();
+			}
+		}
+
+		ImGui::SameLine();
+		if (ImGui::Button("Cancel"))
+		{
+			ImGui::CloseCurrentPopup();
+		}
+
+		ImGui::EndPopup();
+	}
+
+	if (open_save_as)
+	{
+		ImGui::OpenPopup("Save file");
+		m_shared_input.set_text(m_file_path);
+	}
+
+	ImGui::SetNextWindowSize(ImVec2(400, 200), ImGuiCond_Always);
+	if (ImGui::BeginPopupModal("Save file", nullptr, ImGuiWindowFlags_NoResize))
+	{
+		ImGui::TextWrapped("Specify the path to save the native FSM file to.");
+
+		detail::imgui_set_default_keyboard_focus();
+		ImGui::SetNextItemWidth(ImGui::GetContentRegionAvailWidth());
+		m_shared_input.set_hint("File path");
+		m_shared_input.render();
+
+		if (ImGui::Button("Save") && !m_shared_input.get_text().empty())
+		{
+			// Edits so far belong to the journal of the previous file, if any
+			flush_journal(true);
+
+			m_file_path = m_shared_input.get_text();
+			save_to(m_file_path);
+			ImGui::CloseCurrentPopup();
+		}
+
+		ImGui::SameLine();
+		if (ImGui::Button("Cancel"))
+		{
+			ImGui::CloseCurrentPopup();
+		}
+
+		ImGui::EndPopup();
+	}
 	ImGui::PopID();
 }
 
+void FsmEditor::undo()
+{
+	try
+	{
+		m_history.undo();
+	}
+	catch (const std::runtime_error& e)
+	{
+		fprintf(stderr, "Failed to undo: %s\n", e.what());
+	}
+}
+
+void FsmEditor::redo()
+{
+	try
+	{
+		m_history.redo();
+	}
+	catch (const std::runtime_error& e)
+	{
+		fprintf(stderr, "Failed to redo: %s\n", e.what());
+	}
+}
+
+void FsmEditor::render_save_status()
+{
+	const detail::BackgroundSaver::Status status = m_saver.status();
+
+	switch (status.state)
+	{
+	case detail::BackgroundSaver::State::IDLE:
+		break;
+	case detail::BackgroundSaver::State::SAVING:
+		ImGui::TextColored(ImVec4(1.0, 1.0, 1.0, 0.5), "Saving to %s... %d%%", status.path.c_str(), int(status.progress * 100.0f));
+		break;
+	case detail::BackgroundSaver::State::SUCCEEDED:
+		ImGui::TextColored(ImVec4(1.0, 1.0, 1.0, 0.5), "Saved to %s", status.path.c_str());
+		break;
+	case detail::BackgroundSaver::State::FAILED:
+		ImGui::TextColored(ImVec4(1.0, 0.3, 0.3, 1.0), "Save failed!");
+
+		if (ImGui::IsItemHovered())
+		{
+			ImGui::SetTooltip("%s", status.error.c_str());
+		}
+		break;
+	}
+}
+
+void FsmEditor::save_to(const std::string& path)
+{
+	// Copying the graph is cheap compared to encoding and writing it, which happen on the worker thread along with
+	// decoding the contents of nodes that were not loaded yet
+	auto snapshot = std::make_shared<visitors::GraphSnapshot>(visitors::NativeSerializer::snapshot(*this));
+
+	const std::string journal_path = get_journal_path(path);
+
+	// Should the save fail, the journal must still hold every edit made on top of the file on disk
+	if (m_journal.pending_size() != 0)
+	{
+		m_saver.append(journal_path, m_journal.take_pending());
+	}
+
+	m_journal_size = journal_format::header_size;
+
+	const auto encode = [snapshot](const std::function<void(float)>& progress) {
+		return visitors::NativeSerializer::serialize(std::move(*snapshot), progress);
+	};
+
+	// The saved file holds every edit made so far, so the journal starts over on top of it
+	m_saver.save(path, encode, [journal_path](const std::vector<char>& bytes) {
+		detail::BackgroundSaver::write_file(journal_path, visitors::JournalWriter::make_header(bytes));
+	});
+}
+
+void FsmEditor::open_from(const std::string& path)
+{
+	// Edits so far belong to the journal of the previous file, if any
+	flush_journal(true);
+
+	visitors::NativeDeserializer::deserialize_file(*this, path);
+	m_file_path = path;
+
+	recover_journal();
+}
+
+void FsmEditor::recover_journal()
+{
+	const std::string journal_path = get_journal_path(m_file_path);
+
+	// Appends may still be queued for that journal, e.g. when reopening the file that was open
+	m_saver.wait();
+
+	const std::vector<char> file = read_file(m_file_path);
+
+	// Empty if there is no journal, in which case there is nothing to recover
+	std::vector<char> journal = read_file(journal_path);
+
+	std::size_t replayed_size = 0;
+
+	if (!journal.empty() && visitors::JournalReader::applies_to(journal, file))
+	{
+		try
+		{
+			replayed_size = visitors::JournalReader::replay(*this, journal);
+		}
+		catch (const std::runtime_error& e)
+		{
+			fprintf(stderr, "Failed to recover unsaved edits from '%s': %s\n", journal_path.c_str(), e.what());
+
+			// Keep the journal around rather than overwriting it below
+			std::rename(journal_path.c_str(), (journal_path + ".failed").c_str());
+
+			visitors::NativeDeserializer::deserialize_file(*this, m_file_path);
+		}
+	}
+
+	// Replaying edits the graph, which is not an edit to journal again
+	m_journal.discard_pending();
+
+	if (replayed_size != 0)
+	{
+		// Drop the torn record a crash may have left behind, so that new records follow the replayed ones
+		if (replayed_size != journal.size())
+		{
+			journal.resize(replayed_size);
+			detail::BackgroundSaver::write_file(journal_path, journal);
+		}
+
+		m_journal_size = replayed_size;
+		return;
+	}
+
+	std::vector<char> header = visitors::JournalWriter::make_header(file);
+	m_journal_size = header.size();
+	m_saver.append(journal_path, std::move(header), true);
+}
+
+void FsmEditor::flush_journal(bool force)
+{
+	if (m_journal.pending_size() == 0)
+	{
+		return;
+	}
+
+	// A graph that was never saved has no file for the journal to apply to
+	if (m_file_path.empty())
+	{
+		m_journal.discard_pending();
+		return;
+	}
+
+	const auto now = std::chrono::steady_clock::now();
+
+	if (!force && now - m_journal_flush_time < journal_flush_interval)
+	{
+		return;
+	}
+
+	m_journal_flush_time = now;
+	m_journal_size += m_journal.pending_size();
+	m_saver.append(get_journal_path(m_file_path), m_journal.take_pending());
+
+	if (m_journal_size >= journal_compaction_size)
+	{
+		save_to(m_file_path);
+	}
+}
+
+std::string FsmEditor::get_journal_path(const std::string& path)
+{
+	return path + ".journal";
+}
+
+void FsmEditor::load_node_payload(ed::NodeId id)
+{
+	auto& pending = m_state.pending_payloads;
+
+	const auto* payload = pending.nodes.find(id);
+	Node* node = get_node_by_id(id);
+
+	if (payload == nullptr || node == nullptr)
+	{
+		return;
+	}
+
+	// Forget about the payload first, so that a malformed payload does not get decoded again every frame
+	const auto bytes = *payload;
+	pending.nodes.erase(id);
+
+	visitors::NativeDeserializer::load_payload(*node, bytes);
+
+	// Release the loaded file once everything was decoded
+	if (pending.nodes.empty())
+	{
+		pending.storage.reset();
+		pending.strings.clear();
+	}
+}
+
+void FsmEditor::load_all_node_payloads()
+{
+	while (!m_state.pending_payloads.nodes.empty())
+	{
+		load_node_payload(m_state.pending_payloads.nodes.begin()->first);
+	}
+}
+
+void FsmEditor::load_visible_node_payloads()
+{
+	if (m_state.pending_payloads.nodes.empty())
+	{
+		return;
+	}
+
+	// The canvas covers the rest of the window. Extend the visible area by half a screen in every direction, so that
+	// nodes get decoded a bit before they scroll into view.
+	const ImVec2 screen_min = ImGui::GetCursorScreenPos();
+	const ImVec2 screen_size = ImGui::GetContentRegionAvail();
+
+	const ImVec2 view_min = ed::ScreenToCanvas(ImVec2(
+		screen_min.x - screen_size.x * 0.5f,
+		screen_min.y - screen_size.y * 0.5f
+	));
+
+	const ImVec2 view_max = ed::ScreenToCanvas(ImVec2(
+		screen_min.x + screen_size.x * 1.5f,
+		screen_min.y + screen_size.y * 1.5f
+	));
+
+	auto& visible = m_volatile.visible_pending_nodes;
+	visible.clear();
+
+	for (const auto& p : m_state.pending_payloads.nodes)
+	{
+		// Nodes that were never placed sit at the origin, like in the node editor
+		const NodeLayout* layout = m_state.layouts.find(p.first);
+		const ImVec2 position = layout != nullptr ? layout->position : ImVec2();
+		const ImVec2 size = layout != nullptr ? layout->size : ImVec2();
+
+		if (position.x <= view_max.x && position.x + size.x >= view_min.x
+			&& position.y <= view_max.y && position.y + size.y >= view_min.y)
+		{
+			visible.push_back(p.first);
+		}
+	}
+
+	for (const ed::NodeId id : visible)
+	{
+		try
+		{
+			load_node_payload(id);
+		}
+		catch (const std::runtime_error& e)
+		{
+			fprintf(stderr, "Failed to load the contents of node %d: %s\n", int(detail::id_index(std::uintptr_t(id))), e.what());
+		}
+	}
+}
+
 void FsmEditor::render_canvas()
 {
 	ed::SetCurrentEditor(m_context);
+
+	load_visible_node_payloads();
+
 	ed::Begin("My Editor");
 
+	ed::NodeId node_to_show = m_simulator_panel.take_node_to_show();
+	if (std::uintptr_t(node_to_show) == 0)
+	{
+		node_to_show = m_analysis_panel.take_node_to_show();
+	}
+	if (std::uintptr_t(node_to_show) == 0)
+	{
+		node_to_show = m_cost_panel.take_node_to_show();
+	}
+	if (std::uintptr_t(node_to_show) != 0 && get_node_by_id(node_to_show) != nullptr)
+	{
+		ed::SelectNode(node_to_show);
+		ed::NavigateToSelection();
+	}
+
 	for (auto& p : m_state.nodes)
 	{
 		ImGui::PushID(p.second.get());
@@ -362,6 +1059,26 @@ void FsmEditor::render_canvas()
 		ed::Resume();
 	}
 
+	// Text inputs have an undo history of their own
+	if (ImGui::GetIO().KeyCtrl && !ImGui::GetIO().WantTextInput)
+	{
+		if (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Z)))
+		{
+			if (ImGui::GetIO().KeyShift)
+			{
+				redo();
+			}
+			else
+			{
+				undo();
+			}
+		}
+		else if (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Y)))
+		{
+			redo();
+		}
+	}
+
 	if (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Escape), false))
 	{
 		for (const ed::NodeId& id : m_volatile.selection.nodes)
@@ -383,7 +1100,22 @@ void FsmEditor::render_links()
 	for (const auto& p : m_state.links)
 	{
 		const ed::LinkId id = p.first;
-		const PinPair& pins = p.second;
+		const PinPair& pins = p.second.pins;
+
+		// Links taken by a replayed trace are tinted and flow faster the more they were taken
+		const float heat = m_simulator_panel.get_link_heat(id);
+
+		if (heat > 0.0f)
+		{
+			ed::Link(id, pins.from, pins.to, ImVec4(1.0f, 1.0f - 0.8f * heat, 1.0f - heat, 1.0f), 1.0f + 3.0f * heat);
+
+			ed::PushStyleVar(ed::StyleVar_FlowSpeed, 10.0f + 140.0f * heat);
+			ed::PushStyleVar(ed::StyleVar_FlowDuration, 0.2f);
+			ed::PushStyleVar(ed::StyleVar_FlowMarkerDistance, 30.0f);
+			ed::Flow(id);
+			ed::PopStyleVar(3);
+			continue;
+		}
 
 		ed::Link(id, pins.from, pins.to);
 
@@ -565,7 +1297,7 @@ void FsmEditor::render_popups()
 
 		if (created_node != nullptr)
 		{
-			ed::SetNodePosition(created_node->node_id(), origin);
+			set_node_position(created_node->node_id(), origin);
 			ed::SelectNode(created_node->node_id());
 		}
 
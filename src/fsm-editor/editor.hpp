@@ -1,16 +1,27 @@
 #pragma once
 
+#include <chrono>
+#include <memory>
+#include <string>
 #include <vector>
-#include <unordered_map>
-#include <SFML/Graphics/RenderTarget.hpp>
 
 #include "node.hpp"
+#include "editobserver.hpp"
+#include "undohistory.hpp"
+#include "widgets/analysispanel.hpp"
 #include "widgets/boolexprinput.hpp"
+#include "widgets/costpanel.hpp"
+#include "widgets/graphcompilation.hpp"
+#include "widgets/simulatorpanel.hpp"
 #include "widgets/stringinput.hpp"
 #include "visitors/noderenderer.hpp"
 #include "visitors/nodemenurenderer.hpp"
-#include "util/idhash.hpp"
+#include "visitors/journalwriter.hpp"
+#include "util/backgroundsaver.hpp"
+#include "util/idset.hpp"
 #include "util/imgui.hpp"
+#include "util/slotmap.hpp"
+#include "util/topologicalorder.hpp"
 #include "fwd.hpp"
 
 namespace fsme
@@ -49,6 +60,7 @@ struct LinkInfo
 
 /**
  * @brief Pin information, containing the identifier of its node and any links related to this pin.
+ * @details Links are listed in no particular order, as destroying a link moves the last link of the list in its place.
  */
 struct PinInfo
 {
@@ -62,23 +74,54 @@ struct PinInfo
 class FsmEditor
 {
 public:
+	friend class Node;
+	friend class UndoHistory;
+	friend class visitors::CentauriSerializer;
+	friend class visitors::ConditionOrderer;
+	friend class visitors::JournalReader;
 	friend class visitors::NativeSerializer;
 	friend class visitors::NativeDeserializer;
+	friend class visitors::NodeRenderer;
 
-	FsmEditor(sf::RenderTarget& target);
+	enum class Mode
+	{
+		/// @brief The editor is rendered, and tracks edits for undo, the journal and its panels.
+		INTERACTIVE,
+
+		/// @brief The editor is never rendered, e.g. when a command line tool loads files to export them. It has no node
+		/// editor context, tracks no edits, and skips the layout of the files it loads.
+		HEADLESS
+	};
+
+	explicit FsmEditor(Mode mode = Mode::INTERACTIVE);
 	~FsmEditor();
 
+	bool is_headless() const;
+
 	void clear();
 
+	/**
+	 * @brief Renders the editor within the current ImGui frame. The editor must not be headless.
+	 */
 	void render();
 
 	/**
 	 * @brief Returns a unique identifier for entities within the editor.
 	 * @details As a result, all entities have a unique identifier, and a pin will never have the same ID as a node,
 	 * for instance. This makes all IDs unique and more suitable for serialization.
+	 * IDs are generational (see detail::IdPool): the slot index of a destroyed entity may be recycled, but the ID
+	 * itself is never handed out again.
 	 */
 	std::size_t new_unique_id();
 
+	/**
+	 * @brief Returns a unique identifier for an expression of a node, see new_unique_id().
+	 * @details Expressions are not entities of the graph, but their IDs must not collide with the IDs of entities
+	 * either. Entities may be recreated with the ID they had, e.g. by undo, so expressions never recycle the slot index
+	 * of a destroyed entity.
+	 */
+	std::size_t new_expression_id();
+
 	template<class NodeType>
 	NodeType& make_node()
 	{
@@ -86,10 +129,15 @@ public:
 		auto ptr = std::make_unique<NodeType>(*this, id);
 		auto& node = *ptr;
 
-		m_state.nodes.emplace(std::make_pair(id, std::move(ptr)));
+		m_state.nodes.emplace(id, std::move(ptr));
+		notify_node_created(node);
 
 		return node;
 	}
+
+	/**
+	 * @brief Destroys a node, along with its pins and links.
+	 */
 	void destroy_node(ed::NodeId id);
 
 	/**
@@ -104,34 +152,216 @@ public:
 	 * are NOT cleared by this.
 	 */
 	void destroy_pin(ed::PinId pin);
+
+	/**
+	 * @brief Returns the information for a given pin, or nullptr if it does not exist.
+	 * @warning The returned pointer is invalidated when a pin is created or destroyed.
+	 */
 	const PinInfo* get_pin_info(ed::PinId pin) const;
 
 	ed::LinkId create_link(PinPair pin_pair);
 	void destroy_link(ed::LinkId link);
 	const PinPair* get_link_info(ed::LinkId link) const;
 
+	/**
+	 * @brief Destroys a set of links at once. Links that do not exist are ignored.
+	 * @details Each link is removed from the link lists of its pins through its stored positions in them, see
+	 * StoredLink, so this runs in time linear in the number of links destroyed.
+	 */
+	void destroy_links(od::gsl::span<const ed::LinkId> links);
+
 	void destroy_links_involving(ed::PinId pin);
+	void destroy_links_involving(const Node& node);
 
 	Node* get_node_by_id(ed::NodeId id) const;
 	Node* get_node_by_pin_id(ed::PinId pin) const;
 
+	/**
+	 * @brief Returns whether \p predecessor is a predecessor of \p node within conditional logic, i.e. whether there
+	 * is a path from \p predecessor to \p node that only goes through IfNode and CondNode nodes.
+	 * @details This is answered using an index that is updated along with links, see m_cond_tree_order.
+	 */
+	bool is_predecessor_in_cond_tree(ed::NodeId predecessor, ed::NodeId node) const;
+
+	/**
+	 * @brief Returns whether a link is selected, in constant time.
+	 * @details The selection is refreshed once per frame, see refresh_selected_objects().
+	 */
 	bool is_link_selected(ed::LinkId link) const;
+
+	/**
+	 * @brief Returns whether a node is selected, in constant time.
+	 * @details The selection is refreshed once per frame, see refresh_selected_objects().
+	 */
 	bool is_node_selected(ed::NodeId node) const;
 
+	/**
+	 * @brief Moves \p node to \p position within the canvas, e.g. to lay out a graph built outside of render().
+	 */
+	void set_node_position(ed::NodeId node, ImVec2 position);
+
+	/**
+	 * @brief Adds \p node to the selection, which is picked up by the next render().
+	 */
+	void select_node(ed::NodeId node);
+
+	/**
+	 * @brief Decodes the contents of a node, e.g. state names and expressions, if these were not loaded yet.
+	 * @details Files are loaded lazily (see NativeDeserializer): only the graph topology is decoded up front, and node
+	 * contents are decoded when nodes first become visible. Anything that reads node contents of nodes that may not
+	 * have been shown yet must load them first.
+	 * @throws std::runtime_error if the contents are malformed.
+	 */
+	void load_node_payload(ed::NodeId node);
+
+	/**
+	 * @brief Decodes the contents of all nodes that were not loaded yet.
+	 * @see load_node_payload()
+	 */
+	void load_all_node_payloads();
+
+	/**
+	 * @brief Registers \p observer to be notified of edits to the graph, see EditObserver.
+	 * @details The observer must be removed before it is destroyed.
+	 */
+	void add_observer(EditObserver& observer);
+	void remove_observer(EditObserver& observer);
+
+	/**
+	 * @brief Notifies observers that the contents of \p node, i.e. its name or expressions, were edited.
+	 * @details Node contents are edited directly through their widgets, so whatever edits them has to call this.
+	 */
+	void notify_node_edited(Node& node);
+
+	/**
+	 * @brief Returns the undo history, whose steps are committed once per frame by render().
+	 */
+	UndoHistory& get_undo_history();
+
 	void set_autocomplete_provider(widgets::BoolExpressionAutocomplete* autocomplete_provider);
 	widgets::BoolExpressionAutocomplete* get_autocomplete_provider() const;
 
+	/**
+	 * @brief Returns the panel that costs the states of the graph, which tells which states to highlight.
+	 */
+	const widgets::CostPanel& get_cost_panel() const;
+
 private:
+	/**
+	 * @brief A link along with its position within the link lists of its pins, see PinInfo::links.
+	 * @details Positions are what lets destroying a link remove it from these lists without searching through them.
+	 */
+	struct StoredLink
+	{
+		PinPair pins;
+		std::uint32_t from_position;
+		std::uint32_t to_position;
+	};
+
+	struct NodeLayout
+	{
+		ImVec2 position;
+		ImVec2 size;
+	};
+
 	static ed::EditorContext* create_context();
 
+	void notify_node_created(Node& node);
+
+	/**
+	 * @brief Notifies observers that the pins of \p node changed, if \p node is part of the graph already.
+	 * @details This is called by Node whenever it creates or destroys pins, including when it is constructed or
+	 * destroyed, which are not edits of their own.
+	 */
+	void notify_pins_changed(Node& node, PinType side, od::gsl::span<const ed::PinId> previous_pins);
+
+	void notify_link_created(ed::LinkId link, const PinPair& pins);
+
+	/**
+	 * @brief Inserts a link with a known ID, e.g. when replaying a journal, which both pins must exist for.
+	 */
+	void insert_link(ed::LinkId id, PinPair pins);
+
+	/**
+	 * @brief Removes a link from the link lists of its pins, moving the last entry of each list into its place.
+	 */
+	void remove_from_pins(const StoredLink& link);
+
+	/**
+	 * @brief Returns the layout of \p node, see PersistentState::layouts, adding an empty one if it has none yet.
+	 */
+	NodeLayout& get_node_layout(ed::NodeId node);
+
+	/**
+	 * @brief Records where \p node was just rendered, see PersistentState::layouts.
+	 * @details Nodes whose contents were not decoded yet are rendered empty, so their size is left as it was saved.
+	 */
+	void update_node_layout(ed::NodeId node, ImVec2 position, ImVec2 size);
+
 	void handle_item_creation();
 	void handle_item_deletion();
 
 	void refresh_selected_objects();
 
+	/**
+	 * @brief Rebuilds m_cond_tree_order from all links, which is required after links were loaded without
+	 * create_link().
+	 */
+	void rebuild_cond_tree_index();
+
+	void add_to_cond_tree_index(PinPair pins);
+	void remove_from_cond_tree_index(PinPair pins);
+
 	void render_menu_bar();
+
+	/**
+	 * @brief Undoes or redoes the last step of m_history, reporting failures.
+	 */
+	void undo();
+	void redo();
+
+	/**
+	 * @brief Renders the progress or outcome of the last save within the menu bar.
+	 */
+	void render_save_status();
+
+	/**
+	 * @brief Saves the graph to \p path in the background, see detail::BackgroundSaver.
+	 * @details Only a snapshot of the graph is taken on the calling thread, see visitors::NativeSerializer::snapshot().
+	 * The journal of \p path is reset once the file is saved.
+	 */
+	void save_to(const std::string& path);
+
+	/**
+	 * @brief Opens the native file at \p path, then recovers the edits recorded in its journal, if any.
+	 * @throws std::runtime_error if the file cannot be opened.
+	 */
+	void open_from(const std::string& path);
+
+	/**
+	 * @brief Replays the journal of m_file_path, which was just opened, or starts a new journal.
+	 * @details Edits that cannot be replayed are dropped, and the file is reopened as it is on disk.
+	 */
+	void recover_journal();
+
+	/**
+	 * @brief Appends the edits recorded since the last flush to the journal of m_file_path, if the last flush is old
+	 * enough or \p force is set.
+	 * @details Every append is flushed to disk, so appends are batched to limit how often that happens, at the cost of
+	 * losing the last second of edits in a crash. Once the journal grows large, the file is saved, which compacts the
+	 * journal back to its header.
+	 */
+	void flush_journal(bool force = false);
+
+	static std::string get_journal_path(const std::string& path);
+
 	void render_canvas();
 
+	/**
+	 * @brief Decodes the contents of nodes that are about to become visible in the canvas.
+	 */
+	void load_visible_node_payloads();
+
 	void render_links();
 	void render_popups();
 
@@ -141,14 +371,38 @@ private:
 	struct PersistentState
 	{
 		/**
-		 * @brief Last ID allocated through new_unique_id(), which should be persistent as to not override existing IDs
-		 * when reloading from a file.
+		 * @brief Allocator for new_unique_id(), whose high water mark should be persistent as to not override existing
+		 * IDs when reloading from a file.
 		 */
-		std::size_t last_allocated_id = 0;
+		detail::IdPool ids;
+
+		detail::SlotMap<ed::PinId, PinInfo> pins;
+		detail::SlotMap<ed::LinkId, StoredLink> links;
+		detail::SlotMap<ed::NodeId, std::unique_ptr<Node>> nodes;
+
+		/**
+		 * @brief Serialized contents of the nodes that were not decoded yet, see load_node_payload().
+		 */
+		struct
+		{
+			/// @brief Keeps the memory the payloads point into alive, e.g. the buffer the file was read into
+			std::shared_ptr<const void> storage;
 
-		std::unordered_map<ed::PinId, PinInfo> pins;
-		std::unordered_map<ed::LinkId, PinPair> links;
-		std::unordered_map<ed::NodeId, std::unique_ptr<Node>> nodes;
+			/// @brief Version of the native format the payloads are encoded with
+			std::uint16_t version = 0;
+
+			/// @brief Strings the payloads refer to, for versions of the native format that have a strings section
+			std::vector<od::gsl::span<const char>> strings;
+
+			detail::SlotMap<ed::NodeId, od::gsl::span<const char>> nodes;
+		} pending_payloads;
+
+		/**
+		 * @brief Position and size of each node within the canvas, as of the last time it was rendered or moved.
+		 * @details The node editor can only look nodes up by searching through all of them, so saving and lazy loading
+		 * read this instead. Nodes that were never placed nor rendered have no entry.
+		 */
+		detail::SlotMap<ed::NodeId, NodeLayout> layouts;
 	};
 
 	/**
@@ -161,15 +415,26 @@ private:
 		{
 			std::vector<ed::LinkId> links;
 			std::vector<ed::NodeId> nodes;
+
+			/// @brief Membership index over `links`, rebuilt along with it
+			detail::IdSet<ed::LinkId> link_index;
+
+			/// @brief Membership index over `nodes`, rebuilt along with it
+			detail::IdSet<ed::NodeId> node_index;
 		} selection;
 
 		ed::NodeId context_menu_node;
 		ed::PinId context_menu_pin;
 		ed::LinkId context_menu_link;
-	};
 
-	sf::RenderTarget* m_target;
+		/// @brief Scratch buffer for load_visible_node_payloads()
+		std::vector<ed::NodeId> visible_pending_nodes;
+
+		/// @brief Error of the last failed attempt at opening a file, shown in the "Open file" popup
+		std::string open_error;
+	};
 
+	/// @brief Context of the node editor, or null if the editor is headless
 	ed::EditorContext* m_context;
 
 	widgets::BoolExpressionAutocomplete* m_autocomplete_provider;
@@ -179,13 +444,66 @@ private:
 
 	widgets::StringInput m_shared_input;
 
+	/// @brief Shown in the sidebar, and notified of edits so that it can tell when its simulation is outdated
+	widgets::SimulatorPanel m_simulator_panel;
+
+	/// @brief Notified of edits so that the panels that inspect the compiled graph compile each revision once
+	widgets::GraphCompilation m_compilation;
+
+	/// @brief Shown in the sidebar, and analyzes the graph compiled by m_compilation
+	widgets::AnalysisPanel m_analysis_panel;
+
+	/// @brief Shown in the sidebar, and costs the graph compiled by m_compilation
+	widgets::CostPanel m_cost_panel;
+
+	std::vector<EditObserver*> m_observers;
+
+	/// @brief Path of the file the graph was last opened from or saved to, if any
+	std::string m_file_path;
+
+	detail::BackgroundSaver m_saver;
+
+	/// @brief Records edits to the graph, which are appended to the journal of m_file_path by flush_journal()
+	visitors::JournalWriter m_journal;
+
+	/// @brief Size of the journal of m_file_path once queued appends are done
+	std::size_t m_journal_size = 0;
+
+	std::chrono::steady_clock::time_point m_journal_flush_time;
+
+	UndoHistory m_history;
+
+	/**
+	 * @brief Topological order over the nodes and links that target an IfNode or a CondNode.
+	 * @details Conditional logic cannot contain loops, so these links form a DAG, which allows answering
+	 * is_predecessor_in_cond_tree() without traversing the whole graph. It is updated by create_link() and
+	 * destroy_link().
+	 * This is declared before m_state, as destroying nodes destroys links, which updates this.
+	 */
+	detail::IncrementalTopologicalOrder m_cond_tree_order;
+
 	PersistentState m_state;
 	VolatileState m_volatile;
 };
 
 inline std::size_t FsmEditor::new_unique_id()
 {
-	return ++m_state.last_allocated_id;
+	return m_state.ids.allocate();
+}
+
+inline std::size_t FsmEditor::new_expression_id()
+{
+	return m_state.ids.allocate_unrecycled();
+}
+
+inline bool FsmEditor::is_headless() const
+{
+	return m_context == nullptr;
+}
+
+inline UndoHistory& FsmEditor::get_undo_history()
+{
+	return m_history;
 }
 
 inline void FsmEditor::set_autocomplete_provider(widgets::BoolExpressionAutocomplete* autocomplete_provider)
@@ -198,4 +516,9 @@ inline widgets::BoolExpressionAutocomplete* FsmEditor::get_autocomplete_provider
 	return m_autocomplete_provider;
 }
 
+inline const widgets::CostPanel& FsmEditor::get_cost_panel() const
+{
+	return m_cost_panel;
+}
+
 }
@@ -11,9 +11,11 @@ namespace fsme
 struct PinPair;
 struct LinkInfo;
 struct PinInfo;
+class EditObserver;
 class FsmEditor;
 class Node;
 class NodeVisitor;
+class UndoHistory;
 
 /**
  * @brief Types of nodes for the FSM editor graph.
@@ -33,15 +35,38 @@ class StateNode;
 namespace visitors
 {
 class CentauriSerializer;
+class ConditionOrderer;
+class FsmCompiler;
+struct GraphSnapshot;
+class JournalReader;
+class JournalWriter;
 class LinkVerifier;
 class NativeSerializer;
 class NativeDeserializer;
 class NodeDuplicator;
 class NodeMenuRenderer;
 class NodeRenderer;
+class NodeKindFinder;
 class NodePredecessorFinder;
 }
 
+/**
+ * @brief Stepping and analysis of compiled FSM graphs, to test their logic without running the game.
+ */
+namespace simulation
+{
+class BatchSimulator;
+struct CompiledFsm;
+class CostAnalysis;
+struct CostReport;
+class DecisionDiagram;
+class ReachabilityAnalysis;
+struct ReachabilityReport;
+class Simulator;
+class StateMinimizer;
+struct StateMapping;
+}
+
 /**
  * @brief dear imgui widgets that abstract some kinds of controls.
  */
@@ -14,6 +14,9 @@ Node::Node(FsmEditor& editor, ed::NodeId id) :
 
 Node::~Node()
 {
+	// Tear down all links at once rather than pin by pin
+	m_editor->destroy_links_involving(*this);
+
 	resize_pins(m_inputs, 0);
 	resize_pins(m_outputs, 0);
 }
@@ -38,6 +41,13 @@ void Node::resize_pins(std::vector<ed::PinId>& pins, std::size_t to_size)
 {
 	const std::size_t old_size = pins.size();
 
+	if (old_size == to_size)
+	{
+		return;
+	}
+
+	const std::vector<ed::PinId> previous_pins = pins;
+
 	// Unbind old IDs
 	for (std::size_t i = to_size; i < old_size; ++i)
 	{
@@ -51,12 +61,24 @@ void Node::resize_pins(std::vector<ed::PinId>& pins, std::size_t to_size)
 	{
 		pins[i] = m_editor->create_pin(node_id());
 	}
+
+	m_editor->notify_pins_changed(*this, side_of(pins), previous_pins);
 }
 
 std::vector<ed::PinId>::iterator Node::erase_pin(std::vector<ed::PinId>& pins, std::vector<ed::PinId>::iterator it)
 {
+	const std::vector<ed::PinId> previous_pins = pins;
+
 	m_editor->destroy_pin(*it);
-	return pins.erase(it);
+	const auto next = pins.erase(it);
+
+	m_editor->notify_pins_changed(*this, side_of(pins), previous_pins);
+	return next;
+}
+
+PinType Node::side_of(const std::vector<ed::PinId>& pins) const
+{
+	return &pins == &m_outputs ? PinType::Output : PinType::Input;
 }
 
 }
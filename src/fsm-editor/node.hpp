@@ -29,6 +29,7 @@ enum class PinType
 class Node
 {
 public:
+	friend class visitors::JournalReader;
 	friend class visitors::NativeSerializer;
 	friend class visitors::NativeDeserializer;
 
@@ -55,6 +56,11 @@ protected:
 	void resize_pins(std::vector<ed::PinId>& pins, std::size_t to_size);
 	std::vector<ed::PinId>::iterator erase_pin(std::vector<ed::PinId>& pins, std::vector<ed::PinId>::iterator it);
 
+	/**
+	 * @brief Returns whether \p pins is the list of inputs or of outputs of this node.
+	 */
+	PinType side_of(const std::vector<ed::PinId>& pins) const;
+
 	std::vector<ed::PinId> m_inputs, m_outputs;
 
 private:
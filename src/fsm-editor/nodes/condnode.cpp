@@ -39,7 +39,7 @@ widgets::BoolExpressionInput& CondNode::get_expression(ed::PinId output)
 
 	if (it == m_conditions.end())
 	{
-		const auto p = m_conditions.emplace(std::make_pair(output, editor().new_unique_id()));
+		const auto p = m_conditions.emplace(std::make_pair(output, editor().new_expression_id()));
 		return p.first->second;
 	}
 
@@ -11,7 +11,7 @@ namespace nodes
 
 IfNode::IfNode(FsmEditor& editor, ed::NodeId id) :
 	Node(editor, id),
-	m_cond(editor.new_unique_id())
+	m_cond(editor.new_expression_id())
 {
 	resize_pins(m_inputs, 1);
 	resize_pins(m_outputs, 2);
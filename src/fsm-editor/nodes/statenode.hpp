@@ -20,6 +20,7 @@ class StateNode : public Node
 	StateNode(FsmEditor& editor, ed::NodeId id);
 
 	widgets::StringInput& get_name_input();
+	const widgets::StringInput& get_name_input() const;
 
 	void accept(NodeVisitor& v) override;
 
@@ -32,6 +33,11 @@ inline widgets::StringInput& StateNode::get_name_input()
 	return m_name_input;
 }
 
+inline const widgets::StringInput& StateNode::get_name_input() const
+{
+	return m_name_input;
+}
+
 inline void StateNode::accept(NodeVisitor& v)
 {
 	v.visit(*this);
@@ -0,0 +1,382 @@
+#include "batchsimulator.hpp"
+
+#include <algorithm>
+#include <bitset>
+#include <utility>
+
+#include "../util/workstealing.hpp"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace fsme
+{
+namespace simulation
+{
+
+namespace
+{
+
+/// @brief Lower bound on the number of entities in a block, so that taking a block costs little compared to running it
+constexpr std::size_t min_block_size = 4096;
+
+/// @brief Number of entities in the same state below which they are not worth stepping together
+constexpr std::size_t min_batch_size = 4;
+
+/// @brief Average number of entities per state in a block below which grouping them costs more than it saves, which
+/// bench-simulation shows grouping to save about a tenth of the time from 200 entities per state
+constexpr std::size_t min_average_group_size = 64;
+
+std::size_t count_lanes(std::uint32_t lanes)
+{
+	return std::bitset<32>(lanes).count();
+}
+
+/// @brief Returns the index of the lowest bit set in \p lanes, which must not be 0
+unsigned lowest_lane(std::uint32_t lanes)
+{
+#if defined(__GNUC__)
+	return unsigned(__builtin_ctz(lanes));
+#elif defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, lanes);
+	return unsigned(index);
+#else
+	unsigned index = 0;
+
+	while ((lanes >> index & 1) == 0)
+	{
+		++index;
+	}
+
+	return index;
+#endif
+}
+
+}
+
+struct BatchSimulator::Worker
+{
+	/// @brief Number of entities in each state within the block, then end of the group of each state in #entities
+	std::vector<std::uint32_t> group_ends;
+
+	/// @brief Entities of the block, grouped by state
+	std::vector<std::uint32_t> entities;
+
+	/// @brief Input words of the entities being stepped together, word after word
+	std::vector<std::uint64_t> lanes;
+
+	/// @brief Targets left to go through, with the mask of the lanes that reached them
+	std::vector<std::pair<std::uint32_t, std::uint32_t>> pending;
+
+	std::vector<std::uint64_t> occupancy;
+	std::uint64_t transition_count = 0;
+};
+
+BatchSimulator::BatchSimulator(const CompiledFsm& fsm, std::size_t thread_count) :
+	m_fsm(&fsm),
+	m_block_size(std::max(min_block_size, fsm.state_count() * 4)),
+	m_occupancy(fsm.state_count(), 0),
+	m_pool(thread_count)
+{
+	for (std::size_t i = 0; i < m_pool.thread_count(); ++i)
+	{
+		std::unique_ptr<Worker> worker(new Worker);
+		worker->group_ends.resize(fsm.state_count());
+		worker->lanes.resize(fsm.input_word_count() * condition_batch_size);
+		worker->occupancy.resize(fsm.state_count(), 0);
+		m_workers.push_back(std::move(worker));
+	}
+}
+
+BatchSimulator::~BatchSimulator() = default;
+
+void BatchSimulator::reset(std::size_t entity_count, std::uint32_t state)
+{
+	m_states.assign(entity_count, state);
+	m_inputs.assign(entity_count * m_fsm->input_word_count(), 0);
+	m_group_by_state = false;
+	clear_statistics();
+}
+
+od::gsl::span<std::uint64_t> BatchSimulator::get_input_words(std::size_t word)
+{
+	std::uint64_t* words = m_inputs.data() + word * m_states.size();
+	return od::gsl::span<std::uint64_t>(words, words + m_states.size());
+}
+
+std::size_t BatchSimulator::tick()
+{
+	const std::size_t block_count = (m_states.size() + m_block_size - 1) / m_block_size;
+
+	if (block_count == 1)
+	{
+		// Not worth waking up the other threads
+		step_block(0, *m_workers.front());
+	}
+	else if (block_count != 0)
+	{
+		detail::WorkStealingRanges blocks(m_workers.size(), block_count);
+
+		for (std::size_t i = 0; i < m_workers.size(); ++i)
+		{
+			m_pool.submit([this, &blocks, i] {
+				std::size_t block;
+
+				while (blocks.next(i, block))
+				{
+					step_block(block, *m_workers[i]);
+				}
+			});
+		}
+
+		m_pool.wait();
+	}
+
+	std::uint64_t transition_count = 0;
+
+	for (const std::unique_ptr<Worker>& worker : m_workers)
+	{
+		transition_count += worker->transition_count;
+		worker->transition_count = 0;
+	}
+
+	std::size_t occupied_state_count = 0;
+
+	for (std::size_t state = 0; state < m_occupancy.size(); ++state)
+	{
+		std::uint64_t occupancy = 0;
+
+		for (const std::unique_ptr<Worker>& worker : m_workers)
+		{
+			occupancy += worker->occupancy[state];
+			worker->occupancy[state] = 0;
+		}
+
+		m_occupancy[state] += occupancy;
+		occupied_state_count += occupancy != 0 ? 1 : 0;
+	}
+
+	// Entities rarely move to many more states in a single tick, so this tick tells whether the next one is worth
+	// grouping
+	const std::size_t entities_per_block = std::min(m_block_size, m_states.size());
+	m_group_by_state = m_grouping_allowed && entities_per_block >= occupied_state_count * min_average_group_size;
+
+	++m_tick_count;
+	m_transition_count += transition_count;
+
+	return std::size_t(transition_count);
+}
+
+void BatchSimulator::set_grouping_allowed(bool allowed)
+{
+	m_grouping_allowed = allowed;
+	m_group_by_state = m_group_by_state && allowed;
+}
+
+void BatchSimulator::clear_statistics()
+{
+	std::fill(m_occupancy.begin(), m_occupancy.end(), 0);
+	m_tick_count = 0;
+	m_transition_count = 0;
+}
+
+void BatchSimulator::step_block(std::size_t block, Worker& worker)
+{
+	const std::size_t begin = block * m_block_size;
+	const std::size_t end = std::min(begin + m_block_size, m_states.size());
+
+	if (!m_group_by_state)
+	{
+		step_entities(begin, end, worker);
+		return;
+	}
+
+	// Counting sort of the entities by state, whose counts are the occupancy of the block
+	std::vector<std::uint32_t>& group_ends = worker.group_ends;
+	std::fill(group_ends.begin(), group_ends.end(), 0);
+
+	for (std::size_t entity = begin; entity != end; ++entity)
+	{
+		++group_ends[m_states[entity]];
+	}
+
+	std::uint32_t group_begin = 0;
+	std::size_t group_count = 0;
+
+	for (std::size_t state = 0; state < group_ends.size(); ++state)
+	{
+		const std::uint32_t count = group_ends[state];
+		worker.occupancy[state] += count;
+		group_ends[state] = group_begin;
+		group_begin += count;
+		group_count += count != 0 ? 1 : 0;
+	}
+
+	if (end - begin < group_count * min_average_group_size)
+	{
+		// The entities are spread over too many states to be grouped, step them in the order they are stored
+		for (std::size_t entity = begin; entity != end; ++entity)
+		{
+			step_entity(std::uint32_t(entity), worker);
+		}
+
+		return;
+	}
+
+	worker.entities.resize(end - begin);
+
+	for (std::size_t entity = begin; entity != end; ++entity)
+	{
+		worker.entities[group_ends[m_states[entity]]++] = std::uint32_t(entity);
+	}
+
+	group_begin = 0;
+
+	for (std::uint32_t state = 0; state < group_ends.size(); ++state)
+	{
+		if (group_ends[state] != group_begin)
+		{
+			step_group(state, worker.entities.data() + group_begin, group_ends[state] - group_begin, worker);
+			group_begin = group_ends[state];
+		}
+	}
+}
+
+void BatchSimulator::step_entities(std::size_t begin, std::size_t end, Worker& worker)
+{
+	const CompiledFsm& fsm = *m_fsm;
+	const std::size_t entity_count = m_states.size();
+	const std::uint64_t* inputs = m_inputs.data();
+
+	std::uint64_t transition_count = 0;
+
+	for (std::size_t entity = begin; entity != end; ++entity)
+	{
+		const std::uint32_t state = m_states[entity];
+		const std::uint32_t next = fsm.next_state(state, inputs + entity, entity_count);
+
+		++worker.occupancy[state];
+		transition_count += next != state ? 1 : 0;
+		m_states[entity] = next;
+	}
+
+	worker.transition_count += transition_count;
+}
+
+void BatchSimulator::step_entity(std::uint32_t entity, Worker& worker)
+{
+	const std::uint32_t state = m_states[entity];
+	const std::uint32_t next = m_fsm->next_state(state, m_inputs.data() + entity, m_states.size());
+
+	if (next != state)
+	{
+		m_states[entity] = next;
+		++worker.transition_count;
+	}
+}
+
+void BatchSimulator::step_group(std::uint32_t state, const std::uint32_t* entities, std::size_t count, Worker& worker)
+{
+	const CompiledFsm& fsm = *m_fsm;
+	const std::uint32_t entry = fsm.entries[state];
+
+	if (entry == CompiledFsm::no_transition)
+	{
+		return;
+	}
+
+	const std::size_t entity_count = m_states.size();
+	const std::size_t word_count = fsm.input_word_count();
+	std::uint64_t* lanes = worker.lanes.data();
+
+	if (count < min_batch_size)
+	{
+		// Too few entities to fill a batch, stepping them one by one is cheaper
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			step_entity(entities[i], worker);
+		}
+
+		return;
+	}
+
+	for (std::size_t first = 0; first < count; first += condition_batch_size)
+	{
+		const std::size_t lane_count = std::min(condition_batch_size, count - first);
+		const std::uint32_t* lane_entities = entities + first;
+
+		if ((entry & CompiledFsm::state_flag) == 0)
+		{
+			for (std::size_t word = 0; word < word_count; ++word)
+			{
+				const std::uint64_t* words = m_inputs.data() + word * entity_count;
+				std::uint64_t* word_lanes = lanes + word * condition_batch_size;
+
+				for (std::size_t lane = 0; lane < lane_count; ++lane)
+				{
+					word_lanes[lane] = words[lane_entities[lane]];
+				}
+
+				std::fill(word_lanes + lane_count, word_lanes + condition_batch_size, 0);
+			}
+		}
+
+		worker.pending.clear();
+		worker.pending.emplace_back(entry, (std::uint32_t(1) << lane_count) - 1);
+
+		while (!worker.pending.empty())
+		{
+			const std::uint32_t target = worker.pending.back().first;
+			const std::uint32_t lane_mask = worker.pending.back().second;
+			worker.pending.pop_back();
+
+			if ((target & CompiledFsm::state_flag) != 0)
+			{
+				const std::uint32_t next = target & ~CompiledFsm::state_flag;
+
+				if (target != CompiledFsm::no_transition && next != state)
+				{
+					for (std::uint32_t lanes_left = lane_mask; lanes_left != 0; lanes_left &= lanes_left - 1)
+					{
+						m_states[lane_entities[lowest_lane(lanes_left)]] = next;
+					}
+
+					worker.transition_count += count_lanes(lane_mask);
+				}
+
+				continue;
+			}
+
+			const CompiledFsm::Branch& branch = fsm.branches[target];
+			std::uint32_t holds = 0;
+
+			if (branch.word != CompiledFsm::several_words)
+			{
+				holds = test_batch(branch.condition, lanes + branch.word * condition_batch_size);
+			}
+			else
+			{
+				for (std::uint32_t lanes_left = lane_mask; lanes_left != 0; lanes_left &= lanes_left - 1)
+				{
+					const unsigned lane = lowest_lane(lanes_left);
+					holds |= std::uint32_t(fsm.test(branch, lanes + lane, condition_batch_size) ? 1 : 0) << lane;
+				}
+			}
+
+			if ((lane_mask & ~holds) != 0)
+			{
+				worker.pending.emplace_back(branch.on_false, lane_mask & ~holds);
+			}
+
+			if ((lane_mask & holds) != 0)
+			{
+				worker.pending.emplace_back(branch.on_true, lane_mask & holds);
+			}
+		}
+	}
+}
+
+}
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <onidev/core/span.h>
+
+#include "../util/threadpool.hpp"
+#include "compiledfsm.hpp"
+
+namespace fsme
+{
+namespace simulation
+{
+
+/**
+ * @brief Steps many instances of a CompiledFsm at once, on several threads, and counts how much time they spend in
+ * each state.
+ *
+ * @details Unlike Simulator, states and input bits are stored as structures of arrays: the states of all entities, then
+ * the first word of input bits of all entities, the second word of all entities, and so on.
+ *
+ * Entities are stepped in blocks, which the worker threads share through detail::WorkStealingRanges. Within a block,
+ * entities are stepped one by one in the order they are stored, reading their input words with a stride, see
+ * CompiledFsm::next_state(). Only when the last tick found entities crowded into few states are they grouped by state
+ * instead, and the entities in the same state go through the branches of that state condition_batch_size at a time:
+ * each branch is tested once for all of them with test_batch(), and the entities are split between its two targets
+ * according to the result.
+ */
+class BatchSimulator
+{
+public:
+	/**
+	 * @param fsm The FSM to step entities through, which must outlive the simulator.
+	 * @param thread_count Number of worker threads, or 0 for as many as the hardware can run concurrently.
+	 */
+	explicit BatchSimulator(const CompiledFsm& fsm, std::size_t thread_count = 0);
+	~BatchSimulator();
+
+	const CompiledFsm& get_fsm() const { return *m_fsm; }
+
+	/**
+	 * @brief Replaces all the entities with \p entity_count entities in \p state, with all of their inputs false, and
+	 * clears the statistics.
+	 */
+	void reset(std::size_t entity_count, std::uint32_t state = 0);
+
+	std::size_t entity_count() const { return m_states.size(); }
+
+	std::uint32_t get_state(std::size_t entity) const;
+	void set_state(std::size_t entity, std::uint32_t state);
+
+	bool get_input(std::size_t entity, std::uint32_t input) const;
+	void set_input(std::size_t entity, std::uint32_t input, bool value);
+
+	/**
+	 * @brief Returns the word \p word of input bits of every entity, see CompiledFsm.
+	 */
+	od::gsl::span<std::uint64_t> get_input_words(std::size_t word);
+
+	/**
+	 * @brief Steps every entity once, see CompiledFsm::next_state().
+	 * @return The number of entities whose state changed.
+	 */
+	std::size_t tick();
+
+	/**
+	 * @brief Returns, for each state, the number of entities that were in it at the start of a tick, summed over all
+	 * ticks since the last reset() or clear_statistics().
+	 */
+	const std::vector<std::uint64_t>& get_occupancy() const { return m_occupancy; }
+
+	std::uint64_t get_tick_count() const { return m_tick_count; }
+	std::uint64_t get_transition_count() const { return m_transition_count; }
+
+	void clear_statistics();
+
+	std::size_t thread_count() const { return m_pool.thread_count(); }
+
+	/**
+	 * @brief Sets whether entities crowded into few states may be grouped by state, which they may by default.
+	 * @details Entities are otherwise always stepped in the order they are stored, which bench-simulation compares to.
+	 */
+	void set_grouping_allowed(bool allowed);
+
+private:
+	/// @brief Memory and statistics of a worker thread
+	struct Worker;
+
+	void step_block(std::size_t block, Worker& worker);
+
+	/**
+	 * @brief Steps the entities from \p begin to \p end in the order they are stored, counting their occupancy.
+	 */
+	void step_entities(std::size_t begin, std::size_t end, Worker& worker);
+	void step_entity(std::uint32_t entity, Worker& worker);
+	void step_group(std::uint32_t state, const std::uint32_t* entities, std::size_t count, Worker& worker);
+
+	const CompiledFsm* m_fsm;
+
+	std::vector<std::uint32_t> m_states;
+
+	/// @brief Input words, word after word, see get_input_words()
+	std::vector<std::uint64_t> m_inputs;
+
+	/// @brief Number of entities stepped by a worker at once
+	std::size_t m_block_size;
+
+	/// @brief Whether the entities of a block are grouped by state, which the occupancy of the last tick decides
+	bool m_group_by_state = false;
+	bool m_grouping_allowed = true;
+
+	std::vector<std::uint64_t> m_occupancy;
+	std::uint64_t m_tick_count = 0;
+	std::uint64_t m_transition_count = 0;
+
+	std::vector<std::unique_ptr<Worker>> m_workers;
+	detail::ThreadPool m_pool;
+};
+
+inline std::uint32_t BatchSimulator::get_state(std::size_t entity) const
+{
+	return m_states[entity];
+}
+
+inline void BatchSimulator::set_state(std::size_t entity, std::uint32_t state)
+{
+	m_states[entity] = state;
+}
+
+inline bool BatchSimulator::get_input(std::size_t entity, std::uint32_t input) const
+{
+	return (m_inputs[input / 64 * m_states.size() + entity] >> (input % 64) & 1) != 0;
+}
+
+inline void BatchSimulator::set_input(std::size_t entity, std::uint32_t input, bool value)
+{
+	std::uint64_t& word = m_inputs[input / 64 * m_states.size() + entity];
+	const std::uint64_t bit = std::uint64_t(1) << (input % 64);
+	word = value ? word | bit : word & ~bit;
+}
+
+}
+}
@@ -0,0 +1,13 @@
+#include "compiledfsm.hpp"
+
+namespace fsme
+{
+namespace simulation
+{
+
+constexpr std::uint32_t CompiledFsm::state_flag;
+constexpr std::uint32_t CompiledFsm::no_transition;
+constexpr std::uint32_t CompiledFsm::several_words;
+
+}
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../util/imgui.hpp"
+#include "conditionmask.hpp"
+
+namespace fsme
+{
+namespace simulation
+{
+
+/**
+ * @brief Flat form of an FSM graph, which can be stepped without going through nodes, pins and links.
+ *
+ * @details IfNode nodes each become a branch, and CondNode nodes become one branch per output, whose false target is
+ * the branch of the next output. Branches are laid out contiguously in the order they are reached from the states, so
+ * that the branches of a state are mostly next to each other.
+ *
+ * The condition of a branch is an AND over boolean inputs: each option of the autocomplete catalog is an input, whose
+ * index is that of the option (see widgets::BoolExpressionOption::index), and so is each distinct plain Lua expression,
+ * which cannot be evaluated otherwise. A branch without any input is always taken.
+ *
+ * Inputs are bits within 64-bit words, input i being bit i % 64 of word i / 64. A condition whose inputs all lie
+ * within the same word, which they always do with up to 64 inputs, is tested with a single AND and a single compare,
+ * see ConditionMask.
+ *
+ * @see visitors::FsmCompiler
+ */
+struct CompiledFsm
+{
+	/// @brief Flag of the targets that are states rather than branches, the state index being in the other bits
+	static constexpr std::uint32_t state_flag = 0x80000000;
+
+	/// @brief Target of the branches and states that do not lead anywhere, i.e. for which the state does not change
+	static constexpr std::uint32_t no_transition = 0xFFFFFFFF;
+
+	/// @brief Branch::word of the conditions whose inputs lie within several words
+	static constexpr std::uint32_t several_words = 0xFFFFFFFF;
+
+	struct Branch
+	{
+		/// @brief Word of input bits that #condition applies to, or #several_words if the inputs of the condition are
+		/// to be tested one by one
+		std::uint32_t word;
+		ConditionMask condition;
+
+		/// @brief First input of the condition within CompiledFsm::branch_inputs
+		std::uint32_t first_input;
+		std::uint32_t input_count;
+
+		std::uint32_t on_true;
+		std::uint32_t on_false;
+	};
+
+	/**
+	 * @brief Returns the state an entity in \p state moves to for \p inputs, which holds input_word_count() words.
+	 * @details This evaluates branches from the entry of \p state until a state is reached, which is \p state itself
+	 * if there is no transition.
+	 * @param stride Distance between the consecutive words of \p inputs, e.g. the number of entities when the words
+	 * of all entities are stored word after word.
+	 */
+	std::uint32_t next_state(std::uint32_t state, const std::uint64_t* inputs, std::size_t stride = 1) const;
+
+	/**
+	 * @brief Returns whether the condition of \p branch holds for \p inputs, see next_state().
+	 */
+	bool test(const Branch& branch, const std::uint64_t* inputs, std::size_t stride = 1) const;
+
+	std::size_t state_count() const { return entries.size(); }
+	std::size_t input_count() const { return input_names.size(); }
+
+	/**
+	 * @brief Returns the number of words that hold the input bits of an entity, which is at least 1 so that conditions
+	 * without inputs have a word to apply to.
+	 */
+	std::size_t input_word_count() const { return input_names.empty() ? 1 : (input_names.size() + 63) / 64; }
+
+	/// @brief Target of the output of each state
+	std::vector<std::uint32_t> entries;
+
+	std::vector<Branch> branches;
+
+	/// @brief Input indices of the conditions of the branches, see Branch::first_input
+	std::vector<std::uint32_t> branch_inputs;
+
+	/// @brief Node of each state, sorted by ID
+	std::vector<ed::NodeId> state_nodes;
+	std::vector<std::string> state_names;
+
+	/// @brief IfNode or CondNode each branch comes from
+	std::vector<ed::NodeId> branch_nodes;
+
+	/// @brief Link from the output of each state, or 0 if the output is not linked
+	std::vector<ed::LinkId> entry_links;
+
+	/// @brief Links followed when the condition of each branch holds then when it does not, two per branch, or 0
+	/// where no link is followed, e.g. from an output of a CondNode to the next one
+	std::vector<ed::LinkId> branch_links;
+
+	/// @brief Shorthand of the option, or text of the Lua expression, each input stands for
+	std::vector<std::string> input_names;
+};
+
+inline std::uint32_t CompiledFsm::next_state(std::uint32_t state, const std::uint64_t* inputs, std::size_t stride) const
+{
+	std::uint32_t target = entries[state];
+
+	while ((target & state_flag) == 0)
+	{
+		const Branch& branch = branches[target];
+		target = test(branch, inputs, stride) ? branch.on_true : branch.on_false;
+	}
+
+	return target == no_transition ? state : target & ~state_flag;
+}
+
+inline bool CompiledFsm::test(const Branch& branch, const std::uint64_t* inputs, std::size_t stride) const
+{
+	if (branch.word != several_words)
+	{
+		return branch.condition.test(inputs[branch.word * stride]);
+	}
+
+	const std::uint32_t* input = branch_inputs.data() + branch.first_input;
+	const std::uint32_t* inputs_end = input + branch.input_count;
+
+	while (input != inputs_end && (inputs[*input / 64 * stride] >> (*input % 64) & 1) != 0)
+	{
+		++input;
+	}
+
+	return input == inputs_end;
+}
+
+}
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+namespace fsme
+{
+namespace simulation
+{
+
+/**
+ * @brief Condition over a word of input bits, which holds when the bits of #mask have the values of #expected.
+ */
+struct ConditionMask
+{
+	std::uint64_t mask;
+	std::uint64_t expected;
+
+	bool test(std::uint64_t word) const
+	{
+		return (word & mask) == expected;
+	}
+};
+
+/// @brief Number of words tested at once by test_batch()
+constexpr std::size_t condition_batch_size = 16;
+
+/**
+ * @brief Tests \p condition against condition_batch_size consecutive input words, e.g. the same word of as many
+ * entities, using SIMD instructions where available.
+ * @return A mask where bit i is set if \p condition holds for words[i].
+ */
+inline std::uint32_t test_batch(const ConditionMask& condition, const std::uint64_t* words)
+{
+	std::uint32_t result = 0;
+
+#if defined(__AVX2__)
+	const __m256i mask = _mm256_set1_epi64x(std::int64_t(condition.mask));
+	const __m256i expected = _mm256_set1_epi64x(std::int64_t(condition.expected));
+
+	for (std::size_t i = 0; i < condition_batch_size; i += 4)
+	{
+		const __m256i batch = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + i));
+		const __m256i holds = _mm256_cmpeq_epi64(_mm256_and_si256(batch, mask), expected);
+		result |= std::uint32_t(_mm256_movemask_pd(_mm256_castsi256_pd(holds))) << i;
+	}
+#elif defined(__SSE2__) || defined(_M_X64)
+	const __m128i mask = _mm_set1_epi64x(std::int64_t(condition.mask));
+	const __m128i expected = _mm_set1_epi64x(std::int64_t(condition.expected));
+
+	for (std::size_t i = 0; i < condition_batch_size; i += 2)
+	{
+		const __m128i batch = _mm_loadu_si128(reinterpret_cast<const __m128i*>(words + i));
+
+		// SSE2 has no 64-bit comparison: both 32-bit halves of a word must match
+		const __m128i halves = _mm_cmpeq_epi32(_mm_and_si128(batch, mask), expected);
+		const __m128i holds = _mm_and_si128(halves, _mm_shuffle_epi32(halves, _MM_SHUFFLE(2, 3, 0, 1)));
+		result |= std::uint32_t(_mm_movemask_pd(_mm_castsi128_pd(holds))) << i;
+	}
+#else
+	for (std::size_t i = 0; i < condition_batch_size; ++i)
+	{
+		result |= std::uint32_t(condition.test(words[i]) ? 1 : 0) << i;
+	}
+#endif
+
+	return result;
+}
+
+}
+}
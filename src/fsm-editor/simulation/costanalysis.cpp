@@ -0,0 +1,112 @@
+#include "costanalysis.hpp"
+
+#include <algorithm>
+
+namespace fsme
+{
+namespace simulation
+{
+
+CostReport CostAnalysis::analyze(const CompiledFsm& fsm, const std::vector<float>& input_costs)
+{
+	CostAnalysis analysis(fsm, input_costs);
+	CostReport report;
+	report.states.reserve(fsm.state_count());
+
+	for (std::uint32_t state = 0; state < fsm.state_count(); ++state)
+	{
+		report.states.push_back(analysis.cost_target(fsm.entries[state]));
+	}
+
+	return report;
+}
+
+CostAnalysis::CostAnalysis(const CompiledFsm& fsm, const std::vector<float>& input_costs) :
+	m_fsm(fsm),
+	m_input_costs(input_costs),
+	m_branch_costs(fsm.branches.size()),
+	m_costed_branches(fsm.branches.size(), false)
+{}
+
+CostReport::Cost CostAnalysis::cost_target(std::uint32_t target)
+{
+	if ((target & CompiledFsm::state_flag) != 0)
+	{
+		return {};
+	}
+
+	// Post-order walk, as chains of branches can be as long as the graph is large
+	m_stack.emplace_back(target, false);
+
+	while (!m_stack.empty())
+	{
+		const std::uint32_t branch = m_stack.back().first;
+		const bool targets_done = m_stack.back().second;
+
+		if (targets_done)
+		{
+			m_stack.pop_back();
+			cost_branch(branch);
+			continue;
+		}
+
+		if (m_costed_branches[branch])
+		{
+			m_stack.pop_back();
+			continue;
+		}
+
+		// Graphs with loops are not compiled, so a branch is never reached again before it is costed
+		m_stack.back().second = true;
+
+		for (const std::uint32_t next : {m_fsm.branches[branch].on_false, m_fsm.branches[branch].on_true})
+		{
+			if ((next & CompiledFsm::state_flag) == 0 && !m_costed_branches[next])
+			{
+				m_stack.emplace_back(next, false);
+			}
+		}
+	}
+
+	return get_target_cost(target);
+}
+
+void CostAnalysis::cost_branch(std::uint32_t index)
+{
+	const CompiledFsm::Branch& branch = m_fsm.branches[index];
+	const CostReport::Cost on_true = get_target_cost(branch.on_true);
+	const CostReport::Cost on_false = get_target_cost(branch.on_false);
+
+	// Each input is only evaluated if the ones before it held
+	double worst_case = 0.0;
+	double average = 0.0;
+	double reached = 1.0;
+
+	for (std::uint32_t i = 0; i < branch.input_count; ++i)
+	{
+		const float cost = m_input_costs[m_fsm.branch_inputs[branch.first_input + i]];
+		worst_case += cost;
+		average += reached * cost;
+		reached *= 0.5;
+	}
+
+	CostReport::Cost& cost = m_branch_costs[index];
+
+	// A condition without inputs always holds, so its false target is never reached
+	const double worst_target = branch.input_count != 0
+		? std::max(on_true.worst_case, on_false.worst_case)
+		: on_true.worst_case;
+
+	cost.worst_case = worst_case + worst_target;
+	cost.average = average + reached * on_true.average + (1.0 - reached) * on_false.average;
+
+	m_costed_branches[index] = true;
+}
+
+CostReport::Cost CostAnalysis::get_target_cost(std::uint32_t target) const
+{
+	return (target & CompiledFsm::state_flag) != 0 ? CostReport::Cost{} : m_branch_costs[target];
+}
+
+}
+}
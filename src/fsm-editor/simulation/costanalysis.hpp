@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "compiledfsm.hpp"
+
+namespace fsme
+{
+namespace simulation
+{
+
+/**
+ * @brief Cost of stepping each state of a CompiledFsm, as found by CostAnalysis.
+ */
+struct CostReport
+{
+	struct Cost
+	{
+		/// @brief Cost of the inputs evaluated along the costliest path through the branches
+		double worst_case = 0.0;
+
+		/// @brief Cost of the inputs evaluated on average, each input holding half of the time
+		double average = 0.0;
+	};
+
+	/// @brief Cost of each state, by index
+	std::vector<Cost> states;
+};
+
+/**
+ * @brief Estimates how costly it is to step each state of a CompiledFsm, i.e. to evaluate the branches reached from its
+ * entry until a state is reached.
+ *
+ * @details The inputs of a condition are evaluated in turn until one fails, like the `and` of the Lua expression, each
+ * costing its weight. The worst case follows the costliest path, whether or not its conditions can hold together, so it
+ * is an upper bound. The average treats every evaluation as an independent coin toss, so it is an estimate whenever
+ * the same input is evaluated several times along a path.
+ *
+ * Branches shared by several paths or states are costed once, so this runs in time linear in the size of the graph.
+ */
+class CostAnalysis
+{
+public:
+	/**
+	 * @param input_costs Weight of each input of \p fsm, e.g. widgets::BoolExpressionOption::cost for the options.
+	 */
+	static CostReport analyze(const CompiledFsm& fsm, const std::vector<float>& input_costs);
+
+private:
+	CostAnalysis(const CompiledFsm& fsm, const std::vector<float>& input_costs);
+
+	/**
+	 * @brief Returns the cost of stepping from \p target, costing the branches it leads to first if they were not.
+	 */
+	CostReport::Cost cost_target(std::uint32_t target);
+
+	/**
+	 * @brief Costs the branch \p index, whose targets were costed already.
+	 */
+	void cost_branch(std::uint32_t index);
+
+	CostReport::Cost get_target_cost(std::uint32_t target) const;
+
+	const CompiledFsm& m_fsm;
+	const std::vector<float>& m_input_costs;
+
+	std::vector<CostReport::Cost> m_branch_costs;
+	std::vector<bool> m_costed_branches;
+
+	/// @brief Branches being costed, each one being on the stack once to push its targets, then once again to be
+	/// costed after them
+	std::vector<std::pair<std::uint32_t, bool>> m_stack;
+};
+
+}
+}
@@ -0,0 +1,221 @@
+#include "decisiondiagram.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace fsme
+{
+namespace simulation
+{
+
+constexpr std::size_t DecisionDiagram::max_nodes_per_branch;
+
+namespace
+{
+
+/// @brief Input of the states, which are tested after every input
+constexpr std::uint32_t past_inputs = 0xFFFFFFFF;
+
+}
+
+std::size_t DecisionDiagram::KeyHash::operator()(const Key& key) const
+{
+	std::uint64_t hash = (std::uint64_t(key.a) << 32 | key.b) * 0x9E3779B97F4A7C15ull;
+	hash ^= (hash >> 29) + std::uint64_t(key.c) * 0xBF58476D1CE4E5B9ull;
+	return std::size_t(hash ^ (hash >> 32));
+}
+
+DecisionDiagram::DecisionDiagram(const CompiledFsm& fsm, std::size_t input_count) :
+	m_fsm(fsm),
+	m_input_count(input_count),
+	m_branch_roots(fsm.branches.size(), 0),
+	m_built_branches(fsm.branches.size(), false),
+	m_visited_branches(fsm.branches.size(), false)
+{}
+
+bool DecisionDiagram::add_state(std::uint32_t state, std::uint32_t& root)
+{
+	const std::uint32_t entry = m_fsm.entries[state];
+
+	if ((entry & CompiledFsm::state_flag) != 0)
+	{
+		root = entry;
+		return true;
+	}
+
+	// Post-order walk of the branches that are not built yet, each branch being on the stack once to push the branches
+	// it leads to, then once again to be ordered after them
+	m_order.clear();
+	m_stack.clear();
+	m_stack.emplace_back(entry, false);
+
+	bool testable = true;
+
+	while (!m_stack.empty() && testable)
+	{
+		const std::uint32_t index = m_stack.back().first;
+		const CompiledFsm::Branch& branch = m_fsm.branches[index];
+
+		if (m_stack.back().second)
+		{
+			m_stack.pop_back();
+			m_order.push_back(index);
+			continue;
+		}
+
+		if (m_built_branches[index] || m_visited_branches[index])
+		{
+			m_stack.pop_back();
+			continue;
+		}
+
+		m_visited_branches[index] = true;
+		m_stack.back().second = true;
+
+		for (std::uint32_t i = 0; i < branch.input_count; ++i)
+		{
+			testable = testable && m_fsm.branch_inputs[branch.first_input + i] < m_input_count;
+		}
+
+		for (const std::uint32_t target : {branch.on_false, branch.on_true})
+		{
+			if ((target & CompiledFsm::state_flag) == 0)
+			{
+				m_stack.emplace_back(target, false);
+			}
+		}
+	}
+
+	for (const std::pair<std::uint32_t, bool>& pending : m_stack)
+	{
+		m_visited_branches[pending.first] = false;
+	}
+
+	for (const std::uint32_t index : m_order)
+	{
+		m_visited_branches[index] = false;
+	}
+
+	if (!testable)
+	{
+		return false;
+	}
+
+	m_node_budget = std::max<std::size_t>(m_order.size(), 1) * max_nodes_per_branch;
+	m_over_budget = false;
+
+	// Branches lead to branches laid out before them in post-order, so these are built already
+	for (const std::uint32_t index : m_order)
+	{
+		const CompiledFsm::Branch& branch = m_fsm.branches[index];
+		const std::uint32_t* inputs = m_fsm.branch_inputs.data() + branch.first_input;
+
+		const auto get_root = [this](std::uint32_t target) {
+			return (target & CompiledFsm::state_flag) != 0 ? target : m_branch_roots[target];
+		};
+
+		m_inputs.assign(inputs, inputs + branch.input_count);
+		std::sort(m_inputs.begin(), m_inputs.end());
+		m_inputs.erase(std::unique(m_inputs.begin(), m_inputs.end()), m_inputs.end());
+		m_conjunctions.clear();
+
+		const std::uint32_t branch_root = make_conjunction(0, get_root(branch.on_true), get_root(branch.on_false));
+
+		if (m_over_budget)
+		{
+			// The nodes added so far are left as they are, they are only emitted if other states lead to them
+			return false;
+		}
+
+		m_branch_roots[index] = branch_root;
+		m_built_branches[index] = true;
+	}
+
+	root = m_branch_roots[entry];
+	return true;
+}
+
+std::uint32_t DecisionDiagram::make_node(std::uint32_t input, std::uint32_t on_true, std::uint32_t on_false)
+{
+	if (on_true == on_false)
+	{
+		return on_true;
+	}
+
+	const Key key{input, on_true, on_false};
+	const auto found = m_unique_nodes.find(key);
+
+	if (found != m_unique_nodes.end())
+	{
+		return found->second;
+	}
+
+	if (m_node_budget == 0)
+	{
+		// Whatever is returned, the diagram of the state is left out
+		m_over_budget = true;
+		return on_true;
+	}
+
+	--m_node_budget;
+
+	const std::uint32_t node = std::uint32_t(m_nodes.size());
+	m_nodes.push_back({input, on_true, on_false});
+	m_unique_nodes.emplace(key, node);
+	return node;
+}
+
+std::uint32_t DecisionDiagram::make_conjunction(std::size_t first_input, std::uint32_t on_true, std::uint32_t on_false)
+{
+	if (first_input == m_inputs.size() || on_true == on_false || m_over_budget)
+	{
+		return on_true;
+	}
+
+	const Key key{std::uint32_t(first_input), on_true, on_false};
+	const auto found = m_conjunctions.find(key);
+
+	if (found != m_conjunctions.end())
+	{
+		return found->second;
+	}
+
+	// The lowest input tested by the condition or by either target comes first
+	const std::uint32_t input = std::min({m_inputs[first_input], get_input(on_true), get_input(on_false)});
+	const bool tested_by_condition = m_inputs[first_input] == input;
+
+	const std::size_t next_input = tested_by_condition ? first_input + 1 : first_input;
+
+	const std::uint32_t holding = make_conjunction(
+		next_input,
+		restrict(on_true, input, true),
+		restrict(on_false, input, true)
+	);
+
+	// The condition fails as soon as one of its inputs does
+	const std::uint32_t failing = tested_by_condition
+		? restrict(on_false, input, false)
+		: make_conjunction(first_input, restrict(on_true, input, false), restrict(on_false, input, false));
+
+	const std::uint32_t node = make_node(input, holding, failing);
+	m_conjunctions.emplace(key, node);
+	return node;
+}
+
+std::uint32_t DecisionDiagram::get_input(std::uint32_t target) const
+{
+	return (target & CompiledFsm::state_flag) != 0 ? past_inputs : m_nodes[target].input;
+}
+
+std::uint32_t DecisionDiagram::restrict(std::uint32_t target, std::uint32_t input, bool holds) const
+{
+	if (get_input(target) != input)
+	{
+		return target;
+	}
+
+	return holds ? m_nodes[target].on_true : m_nodes[target].on_false;
+}
+
+}
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "compiledfsm.hpp"
+
+namespace fsme
+{
+namespace simulation
+{
+
+/**
+ * @brief Reduced ordered decision diagram of the branches of the states of a CompiledFsm, in which each node tests a
+ * single input.
+ *
+ * @details The branches reached from the entry of a state, however long their chains, decide which state it moves to
+ * from the inputs they test. The diagram decides the same from each input at most once, testing inputs by increasing
+ * index, so that stepping a state tests at most as many inputs as its branches involve.
+ *
+ * Nodes are unique: no node has the same target both ways, and no two nodes test the same input with the same targets.
+ * Diagrams are thus shared by the states whose branches decide alike, however these branches are arranged.
+ *
+ * Some inputs cannot be tested on their own, e.g. plain Lua expressions that are only known as a whole, so states whose
+ * branches test them are left out, and so are states whose diagram would grow too large compared to their branches.
+ */
+class DecisionDiagram
+{
+public:
+	struct Node
+	{
+		std::uint32_t input;
+
+		/// @brief Targets when the input holds then when it does not, which are either nodes, or states as in
+		/// CompiledFsm::Branch
+		std::uint32_t on_true;
+		std::uint32_t on_false;
+	};
+
+	/// @brief Maximum number of nodes added for a state, per branch reached from its entry
+	static constexpr std::size_t max_nodes_per_branch = 4;
+
+	/**
+	 * @param input_count Number of inputs that can be tested on their own, which are the first ones, e.g. the options
+	 * of the autocomplete catalog, see visitors::FsmCompiler.
+	 */
+	DecisionDiagram(const CompiledFsm& fsm, std::size_t input_count);
+
+	/**
+	 * @brief Adds the diagram of the branches of \p state, unless they test inputs that cannot be tested on their own
+	 * or the diagram would grow too large.
+	 * @param root Set to the target the diagram starts from: a node, or a state if no input needs to be tested.
+	 * @return Whether the diagram was added.
+	 */
+	bool add_state(std::uint32_t state, std::uint32_t& root);
+
+	const std::vector<Node>& nodes() const { return m_nodes; }
+
+private:
+	/// @brief Key of a node in m_unique_nodes, or of a pending conjunction in m_conjunctions
+	struct Key
+	{
+		std::uint32_t a;
+		std::uint32_t b;
+		std::uint32_t c;
+
+		bool operator==(const Key& other) const { return a == other.a && b == other.b && c == other.c; }
+	};
+
+	struct KeyHash
+	{
+		std::size_t operator()(const Key& key) const;
+	};
+
+	/**
+	 * @brief Returns the node testing \p input with the given targets, adding it if there is none yet.
+	 */
+	std::uint32_t make_node(std::uint32_t input, std::uint32_t on_true, std::uint32_t on_false);
+
+	/**
+	 * @brief Returns the diagram that leads to \p on_true if the inputs of m_inputs from \p first_input on all hold, and
+	 * to \p on_false otherwise.
+	 * @details This recurses once per input of the condition and of the diagrams, which is bounded by the number of
+	 * inputs whatever the length of the chains of branches.
+	 */
+	std::uint32_t make_conjunction(std::size_t first_input, std::uint32_t on_true, std::uint32_t on_false);
+
+	/**
+	 * @brief Returns the input tested by \p target, or past every input if \p target is a state.
+	 */
+	std::uint32_t get_input(std::uint32_t target) const;
+
+	/**
+	 * @brief Returns the target \p target leads to once \p input is known to hold, or to fail.
+	 */
+	std::uint32_t restrict(std::uint32_t target, std::uint32_t input, bool holds) const;
+
+	const CompiledFsm& m_fsm;
+	std::size_t m_input_count;
+
+	std::vector<Node> m_nodes;
+	std::unordered_map<Key, std::uint32_t, KeyHash> m_unique_nodes;
+
+	/// @brief Diagram of each branch, once built
+	std::vector<std::uint32_t> m_branch_roots;
+	std::vector<bool> m_built_branches;
+
+	/// @brief Nodes the state being added may still add, and whether it needed more, in which case it is left out
+	std::size_t m_node_budget = 0;
+	bool m_over_budget = false;
+
+	/// @brief Sorted inputs of the condition being added, and the conjunctions built for it so far
+	std::vector<std::uint32_t> m_inputs;
+	std::unordered_map<Key, std::uint32_t, KeyHash> m_conjunctions;
+
+	/// @brief Branches reached from the entry of the state being added, in post-order, and the walk that finds them
+	std::vector<std::uint32_t> m_order;
+	std::vector<std::pair<std::uint32_t, bool>> m_stack;
+	std::vector<bool> m_visited_branches;
+};
+
+}
+}
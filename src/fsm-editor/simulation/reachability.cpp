@@ -0,0 +1,220 @@
+#include "reachability.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace fsme
+{
+namespace simulation
+{
+
+constexpr std::size_t ReachabilityAnalysis::default_max_contexts;
+
+std::vector<std::uint32_t> ReachabilityReport::find_unreachable_states(std::uint32_t initial_state) const
+{
+	std::vector<bool> reached(transitions.size(), false);
+	std::vector<std::uint32_t> pending;
+
+	if (initial_state < transitions.size())
+	{
+		reached[initial_state] = true;
+		pending.push_back(initial_state);
+	}
+
+	while (!pending.empty())
+	{
+		const std::uint32_t state = pending.back();
+		pending.pop_back();
+
+		for (const std::uint32_t next : transitions[state])
+		{
+			if (!reached[next])
+			{
+				reached[next] = true;
+				pending.push_back(next);
+			}
+		}
+	}
+
+	std::vector<std::uint32_t> unreachable;
+
+	for (std::uint32_t state = 0; state < reached.size(); ++state)
+	{
+		if (!reached[state])
+		{
+			unreachable.push_back(state);
+		}
+	}
+
+	return unreachable;
+}
+
+ReachabilityReport ReachabilityAnalysis::analyze(const CompiledFsm& fsm, std::size_t max_contexts)
+{
+	ReachabilityAnalysis analysis(fsm);
+	analysis.m_report.transitions.resize(fsm.state_count());
+
+	for (std::uint32_t state = 0; state < fsm.state_count(); ++state)
+	{
+		if (!analysis.explore_state(state, max_contexts))
+		{
+			// Transitions that were not found yet may exist, and logic not proven live yet may be live
+			ReachabilityReport incomplete;
+			incomplete.complete = false;
+			incomplete.context_count = analysis.m_report.context_count;
+			return incomplete;
+		}
+	}
+
+	ReachabilityReport& report = analysis.m_report;
+
+	for (std::vector<std::uint32_t>& targets : report.transitions)
+	{
+		std::sort(targets.begin(), targets.end());
+		targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+	}
+
+	for (std::uint32_t i = 0; i < fsm.branches.size(); ++i)
+	{
+		const BranchState& branch = analysis.m_branches[i];
+
+		if (!branch.reached)
+		{
+			report.dead_branches.push_back({i, ReachabilityReport::Finding::Unreachable, CompiledFsm::no_transition});
+		}
+		else if (!branch.true_taken)
+		{
+			const bool shadowed = fsm.branch_nodes[branch.cause] == fsm.branch_nodes[i];
+			const auto finding = shadowed ? ReachabilityReport::Finding::Shadowed : ReachabilityReport::Finding::NeverTrue;
+			report.dead_branches.push_back({i, finding, branch.cause});
+		}
+		else if (!branch.false_taken && fsm.branches[i].on_false != CompiledFsm::no_transition)
+		{
+			// Failing the last output of a CondNode leads nowhere, so an output that always holds there is harmless
+			report.dead_branches.push_back({i, ReachabilityReport::Finding::AlwaysTrue, CompiledFsm::no_transition});
+		}
+	}
+
+	return std::move(analysis.m_report);
+}
+
+ReachabilityAnalysis::ReachabilityAnalysis(const CompiledFsm& fsm) :
+	m_fsm(fsm),
+	m_word_count(fsm.input_word_count()),
+	m_conditions(fsm.branches.size() * m_word_count, 0),
+	m_branches(fsm.branches.size())
+{
+	for (std::size_t i = 0; i < fsm.branches.size(); ++i)
+	{
+		const CompiledFsm::Branch& branch = fsm.branches[i];
+		std::uint64_t* condition = m_conditions.data() + i * m_word_count;
+
+		for (std::uint32_t j = 0; j < branch.input_count; ++j)
+		{
+			const std::uint32_t input = fsm.branch_inputs[branch.first_input + j];
+			condition[input / 64] |= std::uint64_t(1) << (input % 64);
+		}
+	}
+}
+
+bool ReachabilityAnalysis::explore_state(std::uint32_t state, std::size_t max_contexts)
+{
+	const std::uint32_t entry = m_fsm.entries[state];
+
+	m_pending.clear();
+	m_pending.push_back({entry, std::vector<std::uint64_t>(m_word_count, 0), {}});
+
+	while (!m_pending.empty())
+	{
+		Context context = std::move(m_pending.back());
+		m_pending.pop_back();
+
+		if ((context.target & CompiledFsm::state_flag) != 0)
+		{
+			if (context.target != CompiledFsm::no_transition && (context.target & ~CompiledFsm::state_flag) != state)
+			{
+				m_report.transitions[state].push_back(context.target & ~CompiledFsm::state_flag);
+			}
+
+			continue;
+		}
+
+		if (++m_report.context_count > max_contexts)
+		{
+			return false;
+		}
+
+		const std::uint32_t index = context.target;
+		const CompiledFsm::Branch& branch = m_fsm.branches[index];
+		BranchState& branch_state = m_branches[index];
+		branch_state.reached = true;
+
+		// The false target is reachable unless the condition is implied by what already holds
+		if (!is_implied(index, context.holding))
+		{
+			branch_state.false_taken = true;
+
+			Context on_false{branch.on_false, context.holding, context.failed};
+			on_false.failed.push_back(index);
+			m_pending.push_back(std::move(on_false));
+		}
+
+		const std::uint64_t* condition = m_conditions.data() + std::size_t(index) * m_word_count;
+
+		for (std::size_t word = 0; word < m_word_count; ++word)
+		{
+			context.holding[word] |= condition[word];
+		}
+
+		const std::uint32_t contradiction = find_contradiction(context.holding, context.failed);
+
+		if (contradiction == CompiledFsm::no_transition)
+		{
+			branch_state.true_taken = true;
+
+			context.target = branch.on_true;
+			m_pending.push_back(std::move(context));
+		}
+		else if (branch_state.cause == CompiledFsm::no_transition)
+		{
+			branch_state.cause = contradiction;
+		}
+	}
+
+	return true;
+}
+
+std::uint32_t ReachabilityAnalysis::find_contradiction(
+	const std::vector<std::uint64_t>& holding,
+	const std::vector<std::uint32_t>& failed
+) const
+{
+	// From the last, so that the earlier outputs of the same CondNode are found first
+	for (auto it = failed.rbegin(); it != failed.rend(); ++it)
+	{
+		if (is_implied(*it, holding))
+		{
+			return *it;
+		}
+	}
+
+	return CompiledFsm::no_transition;
+}
+
+bool ReachabilityAnalysis::is_implied(std::uint32_t branch, const std::vector<std::uint64_t>& holding) const
+{
+	const std::uint64_t* condition = m_conditions.data() + std::size_t(branch) * m_word_count;
+
+	for (std::size_t word = 0; word < m_word_count; ++word)
+	{
+		if ((condition[word] & ~holding[word]) != 0)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+}
+}
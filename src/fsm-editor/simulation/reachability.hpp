@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "compiledfsm.hpp"
+
+namespace fsme
+{
+namespace simulation
+{
+
+/**
+ * @brief Dead logic found in a CompiledFsm by ReachabilityAnalysis.
+ */
+struct ReachabilityReport
+{
+	enum class Finding
+	{
+		/// @brief The branch is never evaluated, e.g. because every branch leading to it is dead
+		Unreachable,
+
+		/// @brief The condition never holds where the branch is evaluated, given the conditions evaluated before
+		NeverTrue,
+
+		/// @brief Like NeverTrue, because an earlier output of the same CondNode holds whenever this one does
+		Shadowed,
+
+		/// @brief The condition always holds where the branch is evaluated, so its false target is never reached
+		AlwaysTrue
+	};
+
+	struct DeadBranch
+	{
+		std::uint32_t branch;
+		Finding finding;
+
+		/// @brief For NeverTrue and Shadowed, a branch whose failed condition rules this one out
+		std::uint32_t cause;
+	};
+
+	/**
+	 * @brief Returns the states that cannot be reached from \p initial_state through transitions that can be taken,
+	 * sorted by index.
+	 */
+	std::vector<std::uint32_t> find_unreachable_states(std::uint32_t initial_state) const;
+
+	/// @brief Whether every path was explored. Otherwise, nothing is reported, as none of it could be proven dead.
+	bool complete = true;
+
+	/// @brief Number of (branch, path condition) pairs explored
+	std::size_t context_count = 0;
+
+	/// @brief Dead branches, sorted by branch
+	std::vector<DeadBranch> dead_branches;
+
+	/// @brief States that each state can transition to, sorted by index
+	std::vector<std::vector<std::uint32_t>> transitions;
+};
+
+/**
+ * @brief Finds the branches of a CompiledFsm that can never be taken one way or the other, and the transitions between
+ * states that can actually happen.
+ *
+ * @details Every input is treated as an independent boolean variable. Conditions are ANDs of inputs, so the condition
+ * of a path through the branches of a state is a set of inputs that must hold, along with conditions that must fail.
+ * Such a path condition is satisfiable exactly when none of the conditions that must fail only involves inputs that
+ * must hold: setting every other input to false then satisfies it. Path conditions are thus bitsets over the inputs,
+ * and checking a branch costs a few word operations per failed condition on the path.
+ *
+ * Branches shared by several paths are explored once per path, so the number of path conditions explored is bounded,
+ * past which the analysis gives up rather than report logic that may be live.
+ */
+class ReachabilityAnalysis
+{
+public:
+	/// @brief Default bound on the number of path conditions explored
+	static constexpr std::size_t default_max_contexts = std::size_t(1) << 22;
+
+	static ReachabilityReport analyze(const CompiledFsm& fsm, std::size_t max_contexts = default_max_contexts);
+
+private:
+	/// @brief Path condition reaching a target
+	struct Context
+	{
+		std::uint32_t target;
+
+		/// @brief Inputs that must hold, as CompiledFsm::input_word_count() words
+		std::vector<std::uint64_t> holding;
+
+		/// @brief Branches whose conditions must fail, in path order
+		std::vector<std::uint32_t> failed;
+	};
+
+	struct BranchState
+	{
+		bool reached = false;
+		bool true_taken = false;
+		bool false_taken = false;
+
+		/// @brief Failed branch that prevented the true target from being taken, the first time it was
+		std::uint32_t cause = CompiledFsm::no_transition;
+	};
+
+	explicit ReachabilityAnalysis(const CompiledFsm& fsm);
+
+	/**
+	 * @brief Explores the branches of \p state.
+	 * @return false if exploring them would exceed \p max_contexts overall.
+	 */
+	bool explore_state(std::uint32_t state, std::size_t max_contexts);
+
+	/**
+	 * @brief Returns the last branch of \p failed whose condition only involves inputs of \p holding, or
+	 * CompiledFsm::no_transition if there is none, i.e. if the path condition is satisfiable.
+	 */
+	std::uint32_t find_contradiction(const std::vector<std::uint64_t>& holding, const std::vector<std::uint32_t>& failed) const;
+
+	/**
+	 * @brief Returns whether the condition of \p branch only involves inputs of \p holding.
+	 */
+	bool is_implied(std::uint32_t branch, const std::vector<std::uint64_t>& holding) const;
+
+	const CompiledFsm& m_fsm;
+	std::size_t m_word_count;
+
+	/// @brief Inputs of the condition of each branch, as m_word_count words per branch
+	std::vector<std::uint64_t> m_conditions;
+
+	std::vector<BranchState> m_branches;
+	std::vector<Context> m_pending;
+	ReachabilityReport m_report;
+};
+
+}
+}
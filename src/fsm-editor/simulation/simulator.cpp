@@ -0,0 +1,45 @@
+#include "simulator.hpp"
+
+namespace fsme
+{
+namespace simulation
+{
+
+Simulator::Simulator(const CompiledFsm& fsm) :
+	m_fsm(&fsm)
+{}
+
+std::size_t Simulator::add_entity(std::uint32_t state)
+{
+	m_states.push_back(state);
+	m_inputs.resize(m_inputs.size() + m_fsm->input_word_count(), 0);
+	return m_states.size() - 1;
+}
+
+od::gsl::span<std::uint64_t> Simulator::get_inputs(std::size_t entity)
+{
+	std::uint64_t* inputs = m_inputs.data() + entity * m_fsm->input_word_count();
+	return od::gsl::span<std::uint64_t>(inputs, inputs + m_fsm->input_word_count());
+}
+
+std::size_t Simulator::tick()
+{
+	const CompiledFsm& fsm = *m_fsm;
+	const std::size_t word_count = fsm.input_word_count();
+	const std::uint64_t* inputs = m_inputs.data();
+
+	std::size_t transition_count = 0;
+
+	for (std::uint32_t& state : m_states)
+	{
+		const std::uint32_t next = fsm.next_state(state, inputs);
+		transition_count += next != state ? 1 : 0;
+		state = next;
+		inputs += word_count;
+	}
+
+	return transition_count;
+}
+
+}
+}
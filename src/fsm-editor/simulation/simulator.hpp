@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <onidev/core/span.h>
+
+#include "compiledfsm.hpp"
+
+namespace fsme
+{
+namespace simulation
+{
+
+/**
+ * @brief Steps entities through a CompiledFsm, each with a state and a value for every input of the FSM.
+ *
+ * @details The input bits of an entity (see CompiledFsm::input_word_count()) are stored entity after entity, so that an
+ * entity is stepped by reading a contiguous range of memory.
+ */
+class Simulator
+{
+public:
+	/**
+	 * @param fsm The FSM to step entities through, which must outlive the simulator.
+	 */
+	explicit Simulator(const CompiledFsm& fsm);
+
+	const CompiledFsm& get_fsm() const { return *m_fsm; }
+
+	/**
+	 * @brief Adds an entity in \p state, with all of its inputs false.
+	 * @return The index of the entity.
+	 */
+	std::size_t add_entity(std::uint32_t state);
+
+	std::size_t entity_count() const { return m_states.size(); }
+
+	std::uint32_t get_state(std::size_t entity) const;
+	void set_state(std::size_t entity, std::uint32_t state);
+
+	bool get_input(std::size_t entity, std::uint32_t input) const;
+	void set_input(std::size_t entity, std::uint32_t input, bool value);
+
+	/**
+	 * @brief Returns the words of input bits of \p entity, see CompiledFsm.
+	 */
+	od::gsl::span<std::uint64_t> get_inputs(std::size_t entity);
+
+	/**
+	 * @brief Steps every entity once, see CompiledFsm::next_state().
+	 * @return The number of entities whose state changed.
+	 */
+	std::size_t tick();
+
+private:
+	const CompiledFsm* m_fsm;
+
+	std::vector<std::uint32_t> m_states;
+	std::vector<std::uint64_t> m_inputs;
+};
+
+inline std::uint32_t Simulator::get_state(std::size_t entity) const
+{
+	return m_states[entity];
+}
+
+inline void Simulator::set_state(std::size_t entity, std::uint32_t state)
+{
+	m_states[entity] = state;
+}
+
+inline bool Simulator::get_input(std::size_t entity, std::uint32_t input) const
+{
+	return (m_inputs[entity * m_fsm->input_word_count() + input / 64] >> (input % 64) & 1) != 0;
+}
+
+inline void Simulator::set_input(std::size_t entity, std::uint32_t input, bool value)
+{
+	std::uint64_t& word = m_inputs[entity * m_fsm->input_word_count() + input / 64];
+	const std::uint64_t bit = std::uint64_t(1) << (input % 64);
+	word = value ? word | bit : word & ~bit;
+}
+
+}
+}
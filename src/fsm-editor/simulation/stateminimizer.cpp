@@ -0,0 +1,312 @@
+#include "stateminimizer.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace fsme
+{
+namespace simulation
+{
+
+namespace
+{
+
+/// @brief Shape reference of a leaf, leaves being told apart by the order they appear in, see get_shape_reference()
+constexpr std::uint32_t leaf_reference = 1;
+
+}
+
+StateMapping StateMinimizer::minimize(const CompiledFsm& fsm)
+{
+	StateMinimizer minimizer(fsm);
+	minimizer.find_shapes();
+	minimizer.find_predecessors();
+	minimizer.refine();
+
+	StateMapping mapping;
+	mapping.representatives.resize(fsm.state_count());
+	mapping.class_count = minimizer.m_blocks.size();
+
+	for (const std::vector<std::uint32_t>& block : minimizer.m_blocks)
+	{
+		const std::uint32_t representative = *std::min_element(block.begin(), block.end());
+
+		for (const std::uint32_t state : block)
+		{
+			mapping.representatives[state] = representative;
+		}
+	}
+
+	return mapping;
+}
+
+StateMinimizer::StateMinimizer(const CompiledFsm& fsm) :
+	m_fsm(fsm)
+{}
+
+void StateMinimizer::find_shapes()
+{
+	const std::size_t state_count = m_fsm.state_count();
+
+	m_leaf_begins.resize(state_count);
+	m_leaf_ends.resize(state_count);
+	m_state_blocks.resize(state_count);
+	m_first_state_by_entry.assign(m_fsm.branches.size(), CompiledFsm::no_transition);
+
+	for (std::uint32_t state = 0; state < state_count; ++state)
+	{
+		const std::uint32_t entry = m_fsm.entries[state];
+		const bool entry_is_branch = (entry & CompiledFsm::state_flag) == 0;
+
+		if (entry_is_branch && m_first_state_by_entry[entry] != CompiledFsm::no_transition)
+		{
+			const std::uint32_t first_state = m_first_state_by_entry[entry];
+
+			m_leaf_begins[state] = m_leaf_begins[first_state];
+			m_leaf_ends[state] = m_leaf_ends[first_state];
+			m_state_blocks[state] = m_state_blocks[first_state];
+			m_blocks[m_state_blocks[state]].push_back(state);
+			continue;
+		}
+
+		if (entry_is_branch)
+		{
+			m_first_state_by_entry[entry] = state;
+		}
+
+		m_leaf_begins[state] = std::uint32_t(m_leaves.size());
+		write_shape(entry);
+		m_leaf_ends[state] = std::uint32_t(m_leaves.size());
+
+		m_shape_key.assign(reinterpret_cast<const char*>(m_shape.data()), m_shape.size() * sizeof(std::uint32_t));
+
+		auto found = m_blocks_by_shape.find(m_shape_key);
+		if (found == m_blocks_by_shape.end())
+		{
+			found = m_blocks_by_shape.emplace(m_shape_key, std::uint32_t(m_blocks.size())).first;
+			m_blocks.emplace_back();
+		}
+
+		m_state_blocks[state] = found->second;
+		m_blocks[found->second].push_back(state);
+	}
+
+	m_blocks_by_shape.clear();
+}
+
+void StateMinimizer::write_shape(std::uint32_t entry)
+{
+	m_shape.clear();
+	m_shape_positions.clear();
+	m_shape_branches.clear();
+
+	m_shape.push_back(get_shape_reference(entry));
+
+	// Branches are written in the order they are first referred to, which only depends on the shape
+	for (std::size_t i = 0; i < m_shape_branches.size(); ++i)
+	{
+		const CompiledFsm::Branch& branch = m_fsm.branches[m_shape_branches[i]];
+		const std::uint32_t* inputs = m_fsm.branch_inputs.data() + branch.first_input;
+
+		m_shape.push_back(branch.input_count);
+		const std::size_t first_input = m_shape.size();
+		m_shape.insert(m_shape.end(), inputs, inputs + branch.input_count);
+
+		// Conditions are ANDs, so the order of their inputs does not matter
+		std::sort(m_shape.begin() + first_input, m_shape.end());
+
+		m_shape.push_back(get_shape_reference(branch.on_true));
+		m_shape.push_back(get_shape_reference(branch.on_false));
+	}
+}
+
+std::uint32_t StateMinimizer::get_shape_reference(std::uint32_t target)
+{
+	if ((target & CompiledFsm::state_flag) != 0)
+	{
+		m_leaves.push_back(target == CompiledFsm::no_transition ? target : target & ~CompiledFsm::state_flag);
+		return leaf_reference;
+	}
+
+	const auto inserted = m_shape_positions.emplace(target, std::uint32_t(m_shape_branches.size()));
+	if (inserted.second)
+	{
+		m_shape_branches.push_back(target);
+	}
+
+	// Even, so that it cannot be mistaken for a leaf
+	return (inserted.first->second + 1) * 2;
+}
+
+void StateMinimizer::find_predecessors()
+{
+	const std::size_t state_count = m_fsm.state_count();
+
+	// Counting sort of the (state, leaf) pairs by leaf, a branch that does not lead anywhere leading to its own state
+	m_predecessor_begins.assign(state_count + 1, 0);
+
+	for (std::uint32_t state = 0; state < state_count; ++state)
+	{
+		for (std::uint32_t i = m_leaf_begins[state]; i < m_leaf_ends[state]; ++i)
+		{
+			const std::uint32_t leaf = m_leaves[i];
+			++m_predecessor_begins[(leaf == CompiledFsm::no_transition ? state : leaf) + 1];
+		}
+	}
+
+	for (std::size_t state = 0; state < state_count; ++state)
+	{
+		m_predecessor_begins[state + 1] += m_predecessor_begins[state];
+	}
+
+	std::vector<std::uint32_t> cursors(m_predecessor_begins.begin(), m_predecessor_begins.end() - 1);
+	m_predecessors.resize(m_predecessor_begins.back());
+
+	for (std::uint32_t state = 0; state < state_count; ++state)
+	{
+		for (std::uint32_t i = m_leaf_begins[state]; i < m_leaf_ends[state]; ++i)
+		{
+			const std::uint32_t leaf = m_leaves[i];
+			m_predecessors[cursors[leaf == CompiledFsm::no_transition ? state : leaf]++] = state;
+		}
+	}
+}
+
+void StateMinimizer::refine()
+{
+	m_dirty.assign(m_blocks.size(), false);
+
+	for (std::uint32_t block = 0; block < m_blocks.size(); ++block)
+	{
+		mark_dirty(block);
+	}
+
+	while (!m_dirty_blocks.empty())
+	{
+		const std::uint32_t block = m_dirty_blocks.back();
+		m_dirty_blocks.pop_back();
+		m_dirty[block] = false;
+
+		split_block(block);
+	}
+}
+
+void StateMinimizer::split_block(std::uint32_t block)
+{
+	// The states are taken out of the block, as splitting it adds blocks
+	m_block_states.swap(m_blocks[block]);
+	m_blocks[block].clear();
+
+	// All of the states of a block have the same shape, hence as many leaves
+	const std::size_t state_count = m_block_states.size();
+	const std::size_t leaf_count = m_leaf_ends[m_block_states[0]] - m_leaf_begins[m_block_states[0]];
+
+	m_signatures.clear();
+
+	for (const std::uint32_t state : m_block_states)
+	{
+		for (std::uint32_t i = m_leaf_begins[state]; i < m_leaf_ends[state]; ++i)
+		{
+			m_signatures.push_back(get_leaf_block(state, m_leaves[i]));
+		}
+	}
+
+	const auto signature = [this, leaf_count](std::uint32_t i) { return m_signatures.begin() + i * leaf_count; };
+
+	m_order.resize(state_count);
+	for (std::uint32_t i = 0; i < state_count; ++i)
+	{
+		m_order[i] = i;
+	}
+
+	std::sort(m_order.begin(), m_order.end(), [&signature, leaf_count](std::uint32_t a, std::uint32_t b) {
+		return std::lexicographical_compare(
+			signature(a),
+			signature(a) + leaf_count,
+			signature(b),
+			signature(b) + leaf_count
+		);
+	});
+
+	// Runs of states with the same signature, the largest of which stays in the block
+	m_runs.clear();
+	std::size_t largest_run = 0;
+
+	for (std::size_t begin = 0; begin != state_count;)
+	{
+		const auto first = signature(m_order[begin]);
+		std::size_t end = begin + 1;
+
+		while (end != state_count && std::equal(first, first + leaf_count, signature(m_order[end])))
+		{
+			++end;
+		}
+
+		if (m_runs.empty() || end - begin > m_runs[largest_run].second - m_runs[largest_run].first)
+		{
+			largest_run = m_runs.size();
+		}
+
+		m_runs.emplace_back(begin, end);
+		begin = end;
+	}
+
+	for (std::size_t run = 0; run < m_runs.size(); ++run)
+	{
+		const std::uint32_t run_block = run == largest_run ? block : std::uint32_t(m_blocks.size());
+
+		if (run_block != block)
+		{
+			m_blocks.emplace_back();
+			m_dirty.push_back(false);
+		}
+
+		for (std::size_t i = m_runs[run].first; i < m_runs[run].second; ++i)
+		{
+			const std::uint32_t state = m_block_states[m_order[i]];
+			m_state_blocks[state] = run_block;
+			m_blocks[run_block].push_back(state);
+		}
+	}
+
+	if (m_runs.size() == 1)
+	{
+		return;
+	}
+
+	// The states that lead to the states that moved may not be equivalent anymore
+	for (std::size_t run = 0; run < m_runs.size(); ++run)
+	{
+		if (run == largest_run)
+		{
+			continue;
+		}
+
+		for (std::size_t i = m_runs[run].first; i < m_runs[run].second; ++i)
+		{
+			const std::uint32_t state = m_block_states[m_order[i]];
+
+			for (std::uint32_t j = m_predecessor_begins[state]; j < m_predecessor_begins[state + 1]; ++j)
+			{
+				mark_dirty(m_state_blocks[m_predecessors[j]]);
+			}
+		}
+	}
+}
+
+void StateMinimizer::mark_dirty(std::uint32_t block)
+{
+	if (!m_dirty[block] && m_blocks[block].size() > 1)
+	{
+		m_dirty[block] = true;
+		m_dirty_blocks.push_back(block);
+	}
+}
+
+std::uint32_t StateMinimizer::get_leaf_block(std::uint32_t state, std::uint32_t leaf) const
+{
+	return m_state_blocks[leaf == CompiledFsm::no_transition ? state : leaf];
+}
+
+}
+}
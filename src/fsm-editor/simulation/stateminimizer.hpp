@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "compiledfsm.hpp"
+
+namespace fsme
+{
+namespace simulation
+{
+
+/**
+ * @brief Equivalent states of a CompiledFsm found by StateMinimizer.
+ */
+struct StateMapping
+{
+	/// @brief Number of states merged into another one
+	std::size_t merged_count() const { return representatives.size() - class_count; }
+
+	/// @brief Representative of each state, which is the state of lowest index among the states equivalent to it, so
+	/// that the states that are kept are their own representative
+	std::vector<std::uint32_t> representatives;
+
+	/// @brief Number of classes of equivalent states, i.e. of states left once equivalent states are merged
+	std::size_t class_count = 0;
+};
+
+/**
+ * @brief Finds the states of a CompiledFsm that can be merged, i.e. whose branches have the same structure and lead to
+ * equivalent states.
+ *
+ * @details Two states are compared through their branches as laid out from their entries: the conditions must have the
+ * same inputs, in the same arrangement, and the states reached must be equivalent in turn. A branch that does not lead
+ * anywhere leads to the state itself. The branches of a state thus have a shape, which does not change, and leaves,
+ * which are states. States start out grouped by shape, then blocks are split by the blocks their leaves are in until
+ * no block splits anymore.
+ *
+ * As in Hopcroft's algorithm, the largest part of a split block keeps its number, so that only the states whose leaves
+ * are in the smaller parts have to be looked at again. Each state thus moves at most a logarithmic number of times.
+ *
+ * This is structural: states whose branches are arranged differently are kept apart, even when they always take the
+ * same transitions.
+ */
+class StateMinimizer
+{
+public:
+	static StateMapping minimize(const CompiledFsm& fsm);
+
+private:
+	explicit StateMinimizer(const CompiledFsm& fsm);
+
+	/**
+	 * @brief Sets the shape and the leaves of every state, and groups the states by shape.
+	 */
+	void find_shapes();
+
+	/**
+	 * @brief Writes the shape of the branches reached from \p entry to m_shape, and appends their leaves to m_leaves.
+	 */
+	void write_shape(std::uint32_t entry);
+
+	/**
+	 * @brief Returns the reference to \p target written to a shape, appending it to the leaves if it is a state.
+	 */
+	std::uint32_t get_shape_reference(std::uint32_t target);
+
+	void find_predecessors();
+
+	/**
+	 * @brief Splits the blocks whose states lead to states that moved, until none does.
+	 */
+	void refine();
+
+	/**
+	 * @brief Splits \p block by the blocks the leaves of its states are in.
+	 */
+	void split_block(std::uint32_t block);
+
+	void mark_dirty(std::uint32_t block);
+
+	/**
+	 * @brief Returns the block of \p leaf, a leaf of \p state.
+	 */
+	std::uint32_t get_leaf_block(std::uint32_t state, std::uint32_t leaf) const;
+
+	const CompiledFsm& m_fsm;
+
+	/// @brief Leaves of each state, as state indices or CompiledFsm::no_transition, and where they start in m_leaves
+	std::vector<std::uint32_t> m_leaves;
+	std::vector<std::uint32_t> m_leaf_begins;
+	std::vector<std::uint32_t> m_leaf_ends;
+
+	/// @brief State whose entry was each branch first, so that states sharing their entry share their shape and leaves
+	std::vector<std::uint32_t> m_first_state_by_entry;
+
+	/// @brief Position of the branches within the shape being written, and the branches left to write
+	std::unordered_map<std::uint32_t, std::uint32_t> m_shape_positions;
+	std::vector<std::uint32_t> m_shape_branches;
+
+	/// @brief Shape being written, and the same bytes as a key
+	std::vector<std::uint32_t> m_shape;
+	std::string m_shape_key;
+
+	/// @brief Block of each distinct shape
+	std::unordered_map<std::string, std::uint32_t> m_blocks_by_shape;
+
+	/// @brief States whose leaves include each state, the predecessors of state s being from m_predecessor_begins[s]
+	/// to m_predecessor_begins[s + 1]
+	std::vector<std::uint32_t> m_predecessors;
+	std::vector<std::uint32_t> m_predecessor_begins;
+
+	std::vector<std::uint32_t> m_state_blocks;
+	std::vector<std::vector<std::uint32_t>> m_blocks;
+
+	/// @brief Blocks to split again, and whether each block is among them
+	std::vector<std::uint32_t> m_dirty_blocks;
+	std::vector<bool> m_dirty;
+
+	/// @brief States of the block being split, the blocks of their leaves, which are as many for each of them as they
+	/// have the same shape, and the order of the states sorted by those blocks
+	std::vector<std::uint32_t> m_block_states;
+	std::vector<std::uint32_t> m_signatures;
+	std::vector<std::uint32_t> m_order;
+
+	/// @brief Ranges of m_order whose states have the same signature
+	std::vector<std::pair<std::size_t, std::size_t>> m_runs;
+};
+
+}
+}
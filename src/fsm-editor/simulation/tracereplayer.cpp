@@ -0,0 +1,281 @@
+#include "tracereplayer.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+#ifndef _WIN32
+#include <sys/types.h>
+#endif
+
+namespace fsme
+{
+namespace simulation
+{
+
+namespace
+{
+
+/// @brief Number of bytes read from a trace at once
+constexpr std::size_t read_chunk_size = 1 << 20;
+
+std::runtime_error make_file_error(const char* message, const std::string& path)
+{
+	return std::runtime_error(std::string(message) + " " + path + ": " + std::strerror(errno));
+}
+
+/**
+ * @brief Returns the size of \p file, which may exceed 2 GiB, or 0 if it cannot be queried.
+ */
+std::uint64_t get_file_size(std::FILE* file)
+{
+#ifdef _WIN32
+	const bool found = _fseeki64(file, 0, SEEK_END) == 0;
+	const __int64 size = found ? _ftelli64(file) : 0;
+	_fseeki64(file, 0, SEEK_SET);
+#else
+	const bool found = fseeko(file, 0, SEEK_END) == 0;
+	const off_t size = found ? ftello(file) : 0;
+	fseeko(file, 0, SEEK_SET);
+#endif
+
+	return size > 0 ? std::uint64_t(size) : 0;
+}
+
+/**
+ * @brief Parses the field starting at \p it as an unsigned integer, and moves \p it past the field and its tab.
+ * @return false if the field is empty or is not an unsigned integer.
+ */
+bool parse_field(const char*& it, const char* end, std::uint64_t& value)
+{
+	const char* field_end = std::find(it, end, '\t');
+
+	if (it == field_end)
+	{
+		return false;
+	}
+
+	value = 0;
+
+	for (; it != field_end; ++it)
+	{
+		if (*it < '0' || *it > '9' || value > (UINT64_MAX - std::uint64_t(*it - '0')) / 10)
+		{
+			return false;
+		}
+
+		value = value * 10 + std::uint64_t(*it - '0');
+	}
+
+	it = field_end != end ? field_end + 1 : end;
+	return true;
+}
+
+}
+
+TraceReplayer::TraceReplayer(const CompiledFsm& fsm, std::uint32_t initial_state) :
+	m_fsm(&fsm),
+	m_initial_state(initial_state),
+	m_inputs(fsm.input_word_count()),
+	m_entry_counts(fsm.state_count(), 0),
+	m_branch_counts(fsm.branches.size() * 2, 0)
+{
+	for (std::uint32_t i = 0; i < fsm.input_count(); ++i)
+	{
+		m_input_indices.emplace(fsm.input_names[i], i);
+	}
+}
+
+void TraceReplayer::replay(
+	const std::string& path,
+	const std::function<void(float)>& progress,
+	const std::atomic<bool>* cancelled
+)
+{
+	if (m_fsm->state_count() == 0)
+	{
+		throw std::runtime_error("The graph has no state to replay a trace from");
+	}
+
+	std::unique_ptr<std::FILE, int (*)(std::FILE*)> file(std::fopen(path.c_str(), "rb"), &std::fclose);
+
+	if (file == nullptr)
+	{
+		throw make_file_error("Failed to open", path);
+	}
+
+	const std::uint64_t file_size = progress ? get_file_size(file.get()) : 0;
+
+	// Lines are replayed as soon as they are complete, and the start of the last one is moved to the front
+	std::vector<char> buffer(read_chunk_size);
+	std::size_t buffered = 0;
+	std::uint64_t read_total = 0;
+	m_line_number = 0;
+
+	// Each trace has ticks of its own, e.g. a second recording starting back at tick 0
+	m_has_last_tick = false;
+
+	for (;;)
+	{
+		if (cancelled != nullptr && cancelled->load())
+		{
+			return;
+		}
+
+		if (buffered == buffer.size())
+		{
+			// A line longer than the buffer
+			buffer.resize(buffer.size() * 2);
+		}
+
+		const std::size_t read = std::fread(buffer.data() + buffered, 1, buffer.size() - buffered, file.get());
+
+		if (read == 0 && std::ferror(file.get()))
+		{
+			throw make_file_error("Failed to read", path);
+		}
+
+		read_total += read;
+		buffered += read;
+
+		const char* line = buffer.data();
+		const char* buffer_end = buffer.data() + buffered;
+
+		for (;;)
+		{
+			const char* line_end = std::find(line, buffer_end, '\n');
+
+			if (line_end == buffer_end && read != 0)
+			{
+				break;
+			}
+
+			replay_line(line, line_end);
+
+			if (line_end == buffer_end)
+			{
+				return;
+			}
+
+			line = line_end + 1;
+		}
+
+		buffered = std::size_t(buffer_end - line);
+		std::memmove(buffer.data(), line, buffered);
+
+		if (progress && file_size != 0)
+		{
+			progress(float(double(read_total) / double(file_size)));
+		}
+	}
+}
+
+std::vector<TraceReplayer::LinkCount> TraceReplayer::get_link_counts() const
+{
+	std::vector<LinkCount> counts;
+
+	for (std::size_t i = 0; i < m_entry_counts.size(); ++i)
+	{
+		if (m_entry_counts[i] != 0 && m_fsm->entry_links[i] != ed::LinkId())
+		{
+			counts.push_back({m_fsm->entry_links[i], m_fsm->state_nodes[i], m_entry_counts[i]});
+		}
+	}
+
+	for (std::size_t i = 0; i < m_branch_counts.size(); ++i)
+	{
+		if (m_branch_counts[i] != 0 && m_fsm->branch_links[i] != ed::LinkId())
+		{
+			counts.push_back({m_fsm->branch_links[i], m_fsm->branch_nodes[i / 2], m_branch_counts[i]});
+		}
+	}
+
+	return counts;
+}
+
+void TraceReplayer::replay_line(const char* begin, const char* end)
+{
+	++m_line_number;
+
+	if (begin != end && end[-1] == '\r')
+	{
+		--end;
+	}
+
+	if (begin == end)
+	{
+		return;
+	}
+
+	const CompiledFsm& fsm = *m_fsm;
+	const char* it = begin;
+
+	std::uint64_t tick;
+	std::uint64_t entity;
+
+	if (!parse_field(it, end, tick) || !parse_field(it, end, entity))
+	{
+		throw make_line_error("Expected a tick and an entity");
+	}
+
+	if (m_has_last_tick && tick < m_last_tick)
+	{
+		throw make_line_error("Ticks go backwards");
+	}
+
+	if (!m_has_last_tick || tick != m_last_tick)
+	{
+		++m_tick_count;
+		m_last_tick = tick;
+		m_has_last_tick = true;
+	}
+
+	std::fill(m_inputs.begin(), m_inputs.end(), 0);
+
+	while (it != end)
+	{
+		const char* name_end = std::find(it, end, '\t');
+		m_input_name.assign(it, name_end);
+
+		const auto input_it = m_input_indices.find(m_input_name);
+
+		if (input_it == m_input_indices.end())
+		{
+			throw make_line_error("Unknown input '" + m_input_name + "'");
+		}
+
+		m_inputs[input_it->second / 64] |= std::uint64_t(1) << (input_it->second % 64);
+		it = name_end != end ? name_end + 1 : end;
+	}
+
+	std::uint32_t& state = m_entity_states.emplace(entity, m_initial_state).first->second;
+
+	// Same walk as CompiledFsm::next_state(), counting the way each branch is taken
+	std::uint32_t target = fsm.entries[state];
+	++m_entry_counts[state];
+
+	while ((target & CompiledFsm::state_flag) == 0)
+	{
+		const CompiledFsm::Branch& branch = fsm.branches[target];
+		const bool holds = fsm.test(branch, m_inputs.data());
+
+		++m_branch_counts[2 * target + (holds ? 0 : 1)];
+		target = holds ? branch.on_true : branch.on_false;
+	}
+
+	const std::uint32_t next = target == CompiledFsm::no_transition ? state : target & ~CompiledFsm::state_flag;
+
+	m_transition_count += next != state ? 1 : 0;
+	state = next;
+	++m_step_count;
+}
+
+std::runtime_error TraceReplayer::make_line_error(const std::string& message) const
+{
+	return std::runtime_error(message + " on line " + std::to_string(m_line_number));
+}
+
+}
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../util/imgui.hpp"
+#include "compiledfsm.hpp"
+
+namespace fsme
+{
+namespace simulation
+{
+
+/**
+ * @brief Replays an input trace recorded in the game through a CompiledFsm, counting how often each link is taken.
+ *
+ * @details A trace is a text file with one line per step of an entity, in order of ticks:
+ *
+ *     <tick>\t<entity>[\t<input>...]
+ *
+ * where the tick and the entity are unsigned integers, and each input is the shorthand of an option, or the text of a
+ * plain Lua expression, that holds for the entity at that tick. All other inputs are false. Fields are separated by
+ * tabs, as shorthands may contain spaces, and empty lines are ignored.
+ * An entity starts in the initial state the first time it appears, then moves through the FSM one line at a time.
+ *
+ * The trace is read in chunks of fixed size, so that traces larger than memory can be replayed.
+ */
+class TraceReplayer
+{
+public:
+	/**
+	 * @param fsm The FSM to replay traces through, which must outlive the replayer.
+	 */
+	explicit TraceReplayer(const CompiledFsm& fsm, std::uint32_t initial_state = 0);
+
+	/**
+	 * @brief Replays the trace at \p path, on top of what was replayed so far.
+	 * @details Entities keep their state from one trace to the next, but ticks only need to be in order within each
+	 * trace, so that traces recorded separately can be replayed one after the other.
+	 * @param progress If set, called with the fraction of the file read so far.
+	 * @param cancelled If set, the replay stops early once it is true.
+	 * @throws std::runtime_error if the file cannot be read, or if a line is malformed or names an unknown input.
+	 */
+	void replay(
+		const std::string& path,
+		const std::function<void(float)>& progress = {},
+		const std::atomic<bool>* cancelled = nullptr
+	);
+
+	const CompiledFsm& get_fsm() const { return *m_fsm; }
+
+	std::uint64_t get_tick_count() const { return m_tick_count; }
+	std::uint64_t get_step_count() const { return m_step_count; }
+	std::uint64_t get_transition_count() const { return m_transition_count; }
+	std::size_t entity_count() const { return m_entity_states.size(); }
+
+	struct LinkCount
+	{
+		ed::LinkId link;
+
+		/// @brief State, IfNode or CondNode the link starts from
+		ed::NodeId node;
+
+		std::uint64_t count;
+	};
+
+	/**
+	 * @brief Returns the number of times each link was taken, for the links that were taken at least once.
+	 */
+	std::vector<LinkCount> get_link_counts() const;
+
+private:
+	/**
+	 * @brief Steps the entity of the line [\p begin, \p end), without its line break.
+	 */
+	void replay_line(const char* begin, const char* end);
+
+	std::runtime_error make_line_error(const std::string& message) const;
+
+	const CompiledFsm* m_fsm;
+	std::uint32_t m_initial_state;
+
+	/// @brief Index of each input by name, see CompiledFsm::input_names
+	std::unordered_map<std::string, std::uint32_t> m_input_indices;
+
+	/// @brief Current state of each entity by ID
+	std::unordered_map<std::uint64_t, std::uint32_t> m_entity_states;
+
+	/// @brief Input words of the line being replayed
+	std::vector<std::uint64_t> m_inputs;
+
+	/// @brief Input name being looked up, kept to reuse its memory
+	std::string m_input_name;
+
+	/// @brief Number of times the entry of each state was taken, see CompiledFsm::entry_links
+	std::vector<std::uint64_t> m_entry_counts;
+
+	/// @brief Number of times each branch was taken either way, see CompiledFsm::branch_links
+	std::vector<std::uint64_t> m_branch_counts;
+
+	std::uint64_t m_line_number = 0;
+
+	/// @brief Tick of the last line of the trace being replayed, if any line was replayed yet
+	std::uint64_t m_last_tick = 0;
+	bool m_has_last_tick = false;
+
+	std::uint64_t m_tick_count = 0;
+	std::uint64_t m_step_count = 0;
+	std::uint64_t m_transition_count = 0;
+};
+
+}
+}
@@ -0,0 +1,395 @@
+#include "undohistory.hpp"
+
+#include "editor.hpp"
+#include "visitors/journalreader.hpp"
+
+#include <cfloat>
+#include <stdexcept>
+#include <utility>
+
+namespace fsme
+{
+
+UndoHistory::UndoHistory(FsmEditor& editor) :
+	m_editor(&editor)
+{}
+
+void UndoHistory::track(od::gsl::span<const ed::NodeId> nodes)
+{
+	++m_track_count;
+
+	for (const ed::NodeId id : nodes)
+	{
+		const auto it = m_contents.find(id);
+
+		if (it != m_contents.end())
+		{
+			it->second.last_tracked = m_track_count;
+			continue;
+		}
+
+		Node* node = m_editor->get_node_by_id(id);
+
+		if (node != nullptr)
+		{
+			update_contents(*node, true);
+		}
+	}
+
+	for (auto it = m_contents.begin(); it != m_contents.end();)
+	{
+		if (it->second.last_tracked != m_track_count)
+		{
+			it = m_contents.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+void UndoHistory::commit_step()
+{
+	Step& step = m_current_step;
+
+	if (step.redo_records.empty())
+	{
+		return;
+	}
+
+	m_redo_steps.clear();
+
+	if (m_can_merge && step.only_edits_contents && !m_undo_steps.empty())
+	{
+		Step& last_step = m_undo_steps.back();
+
+		// Undoing restores the contents from before the first edit, and redoing restores the contents after the last
+		if (last_step.only_edits_contents && last_step.edited_node == step.edited_node)
+		{
+			last_step.redo_records = std::move(step.redo_records);
+			step = Step();
+			return;
+		}
+	}
+
+	m_undo_steps.push_back(std::move(step));
+	step = Step();
+	m_can_merge = true;
+
+	while (m_undo_steps.size() > m_step_limit)
+	{
+		m_undo_steps.pop_front();
+	}
+}
+
+void UndoHistory::undo()
+{
+	commit_step();
+
+	if (m_undo_steps.empty())
+	{
+		return;
+	}
+
+	Step step = std::move(m_undo_steps.back());
+	m_undo_steps.pop_back();
+
+	save_positions(step);
+
+	const std::size_t edit_count = step.undo_edits.size();
+
+	for (std::size_t i = edit_count; i-- > 0;)
+	{
+		const std::size_t begin = step.undo_edits[i];
+		const std::size_t end = i + 1 < edit_count ? step.undo_edits[i + 1] : step.undo_records.size();
+
+		if (begin != end)
+		{
+			apply({step.undo_records.data() + begin, step.undo_records.data() + end});
+		}
+	}
+
+	restore_positions(step);
+
+	m_redo_steps.push_back(std::move(step));
+	m_can_merge = false;
+}
+
+void UndoHistory::redo()
+{
+	if (!can_redo())
+	{
+		return;
+	}
+
+	Step step = std::move(m_redo_steps.back());
+	m_redo_steps.pop_back();
+
+	save_positions(step);
+	apply({step.redo_records.data(), step.redo_records.data() + step.redo_records.size()});
+	restore_positions(step);
+
+	m_undo_steps.push_back(std::move(step));
+	m_can_merge = false;
+}
+
+void UndoHistory::clear()
+{
+	m_current_step = Step();
+	m_undo_steps.clear();
+	m_redo_steps.clear();
+	m_can_merge = false;
+
+	m_contents.clear();
+	m_writer.discard_pending();
+}
+
+std::size_t UndoHistory::memory_usage() const
+{
+	std::size_t size = 0;
+
+	const auto add_step = [&](const Step& step) {
+		size += sizeof(Step)
+			+ step.undo_records.capacity()
+			+ step.undo_edits.capacity() * sizeof(std::uint32_t)
+			+ step.redo_records.capacity()
+			+ step.node_positions.capacity() * sizeof(step.node_positions[0]);
+	};
+
+	for (const Step& step : m_undo_steps)
+	{
+		add_step(step);
+	}
+
+	for (const Step& step : m_redo_steps)
+	{
+		add_step(step);
+	}
+
+	return size;
+}
+
+void UndoHistory::on_node_created(Node& node)
+{
+	// The node may get edited right away, e.g. when it is a duplicate
+	update_contents(node, true);
+
+	if (m_applying)
+	{
+		return;
+	}
+
+	// The node is only placed once created, so its position is looked up when the step is undone
+	m_current_step.node_positions.emplace_back(node.node_id(), ImVec2(FLT_MAX, FLT_MAX));
+
+	begin_edit();
+	m_writer.on_node_destroyed(node);
+	push_undo_records();
+
+	m_writer.on_node_created(node);
+	push_redo_records();
+}
+
+void UndoHistory::on_node_destroyed(Node& node)
+{
+	m_contents.erase(node.node_id());
+
+	if (m_applying)
+	{
+		return;
+	}
+
+	const FsmEditor::NodeLayout* layout = m_editor->m_state.layouts.find(node.node_id());
+	m_current_step.node_positions.emplace_back(
+		node.node_id(),
+		layout != nullptr ? layout->position : ImVec2(FLT_MAX, FLT_MAX)
+	);
+
+	// The links of the node were destroyed already, and are recreated by the edits that follow in undo order
+	begin_edit();
+	m_writer.on_node_created(node);
+	write_contents(node);
+	push_undo_records();
+
+	m_writer.on_node_destroyed(node);
+	push_redo_records();
+}
+
+void UndoHistory::on_pins_changed(Node& node, PinType side, od::gsl::span<const ed::PinId> previous_pins)
+{
+	// Contents may be stored per pin, e.g. for CondNode
+	update_contents(node, false);
+
+	if (m_applying)
+	{
+		return;
+	}
+
+	begin_edit();
+	m_writer.write_pins_changed(node, side, previous_pins);
+	push_undo_records();
+
+	m_writer.on_pins_changed(node, side, previous_pins);
+	push_redo_records();
+}
+
+void UndoHistory::on_link_created(ed::LinkId link, const PinPair& pins)
+{
+	if (m_applying)
+	{
+		return;
+	}
+
+	begin_edit();
+	m_writer.on_link_destroyed(link, pins);
+	push_undo_records();
+
+	m_writer.on_link_created(link, pins);
+	push_redo_records();
+}
+
+void UndoHistory::on_link_destroyed(ed::LinkId link, const PinPair& pins)
+{
+	if (m_applying)
+	{
+		return;
+	}
+
+	begin_edit();
+	m_writer.on_link_created(link, pins);
+	push_undo_records();
+
+	m_writer.on_link_destroyed(link, pins);
+	push_redo_records();
+}
+
+void UndoHistory::on_node_edited(Node& node)
+{
+	if (m_applying)
+	{
+		update_contents(node, false);
+		return;
+	}
+
+	Step& step = m_current_step;
+
+	if (step.redo_records.empty())
+	{
+		step.edited_node = node.node_id();
+	}
+	else if (step.edited_node != node.node_id())
+	{
+		step.only_edits_contents = false;
+	}
+
+	step.undo_edits.push_back(std::uint32_t(step.undo_records.size()));
+
+	// Without the previous contents, the edit cannot be undone, but it can still be redone
+	const auto previous = m_contents.find(node.node_id());
+	if (previous != m_contents.end())
+	{
+		const auto& record = previous->second.record;
+		step.undo_records.insert(step.undo_records.end(), record.begin(), record.end());
+	}
+
+	const auto& record = update_contents(node, true)->record;
+	step.redo_records.insert(step.redo_records.end(), record.begin(), record.end());
+}
+
+void UndoHistory::begin_edit()
+{
+	Step& step = m_current_step;
+
+	step.only_edits_contents = false;
+	step.undo_edits.push_back(std::uint32_t(step.undo_records.size()));
+}
+
+void UndoHistory::push_undo_records()
+{
+	m_writer.append_pending_to(m_current_step.undo_records);
+}
+
+void UndoHistory::push_redo_records()
+{
+	m_writer.append_pending_to(m_current_step.redo_records);
+}
+
+void UndoHistory::write_contents(Node& node)
+{
+	try
+	{
+		m_editor->load_node_payload(node.node_id());
+	}
+	catch (const std::runtime_error&)
+	{
+		// Malformed contents were left as is, so these are what gets restored
+	}
+
+	m_writer.on_node_edited(node);
+}
+
+UndoHistory::TrackedContents* UndoHistory::update_contents(Node& node, bool insert)
+{
+	auto it = m_contents.find(node.node_id());
+
+	if (it == m_contents.end())
+	{
+		if (!insert)
+		{
+			return nullptr;
+		}
+
+		it = m_contents.emplace(node.node_id(), TrackedContents{{}, m_track_count}).first;
+	}
+
+	it->second.record.clear();
+	write_contents(node);
+	m_writer.append_pending_to(it->second.record);
+
+	return &it->second;
+}
+
+void UndoHistory::apply(od::gsl::span<const char> records)
+{
+	m_applying = true;
+
+	try
+	{
+		visitors::JournalReader::apply_records(*m_editor, records);
+	}
+	catch (const std::runtime_error&)
+	{
+		m_applying = false;
+
+		// The graph is somewhere in between two steps, which the history cannot be applied to anymore
+		clear();
+		throw;
+	}
+
+	m_applying = false;
+}
+
+void UndoHistory::save_positions(Step& step)
+{
+	for (auto& p : step.node_positions)
+	{
+		if (const FsmEditor::NodeLayout* layout = m_editor->m_state.layouts.find(p.first))
+		{
+			p.second = layout->position;
+		}
+	}
+}
+
+void UndoHistory::restore_positions(const Step& step)
+{
+	for (const auto& p : step.node_positions)
+	{
+		if (p.second.x != FLT_MAX && m_editor->get_node_by_id(p.first) != nullptr)
+		{
+			m_editor->set_node_position(p.first, p.second);
+		}
+	}
+}
+
+}
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <onidev/core/span.h>
+
+#include "fwd.hpp"
+#include "editobserver.hpp"
+#include "util/idhash.hpp"
+#include "util/imgui.hpp"
+#include "visitors/journalwriter.hpp"
+
+namespace fsme
+{
+
+/**
+ * @brief Undo and redo history of the edits made to the graph.
+ *
+ * @details Rather than snapshots of the graph, each step stores the inverse of every edit it is made of, along with
+ * the edits themselves for redo, as autosave journal records (see visitors::JournalWriter). Memory and time per step
+ * are thus proportional to the size of the edits, regardless of the size of the graph.
+ *
+ * Node contents are edited in place by their widgets, and the observer is only notified afterwards: the contents a
+ * node had before an edit are captured ahead of time by track(), for the nodes that may be edited.
+ */
+class UndoHistory : public EditObserver
+{
+public:
+	explicit UndoHistory(FsmEditor& editor);
+
+	UndoHistory(const UndoHistory&) = delete;
+	UndoHistory& operator=(const UndoHistory&) = delete;
+
+	/**
+	 * @brief Captures the contents of \p nodes, so that their next edit can be undone, and forgets about the contents
+	 * of other nodes.
+	 * @details This should be called with the nodes that are editable, i.e. the selected nodes, before they are
+	 * rendered.
+	 */
+	void track(od::gsl::span<const ed::NodeId> nodes);
+
+	/**
+	 * @brief Turns the edits recorded since the last call into a single step, which clears the redo history.
+	 * @details Consecutive steps that only edit the contents of the same node, e.g. when typing, are merged.
+	 */
+	void commit_step();
+
+	bool can_undo() const;
+	bool can_redo() const;
+
+	/**
+	 * @brief Undoes the last step, committing pending edits first.
+	 * @throws std::runtime_error if the step cannot be applied to the graph, in which case the history is cleared.
+	 */
+	void undo();
+
+	/**
+	 * @brief Redoes the last undone step.
+	 * @throws std::runtime_error if the step cannot be applied to the graph, in which case the history is cleared.
+	 */
+	void redo();
+
+	void clear();
+
+	/**
+	 * @brief Sets how many steps can be undone at most. Older steps are forgotten.
+	 */
+	void set_step_limit(std::size_t step_limit);
+
+	/**
+	 * @brief Returns the memory used by the recorded steps, in bytes.
+	 */
+	std::size_t memory_usage() const;
+
+	void on_node_created(Node& node) override;
+	void on_node_destroyed(Node& node) override;
+	void on_pins_changed(Node& node, PinType side, od::gsl::span<const ed::PinId> previous_pins) override;
+	void on_link_created(ed::LinkId link, const PinPair& pins) override;
+	void on_link_destroyed(ed::LinkId link, const PinPair& pins) override;
+	void on_node_edited(Node& node) override;
+
+private:
+	struct Step
+	{
+		/// @brief Records undoing each edit, which are applied from the last edit to the first
+		std::vector<char> undo_records;
+
+		/// @brief Offset of the records undoing each edit within `undo_records`
+		std::vector<std::uint32_t> undo_edits;
+
+		/// @brief Records redoing the edits, in order
+		std::vector<char> redo_records;
+
+		/// @brief Last known position of each node the step creates or destroys, to move it back there when undoing or
+		/// redoing recreates it. Set to FLT_MAX when unknown.
+		std::vector<std::pair<ed::NodeId, ImVec2>> node_positions;
+
+		/// @brief Node whose contents were edited, if the step is only made of edits to the contents of that node
+		ed::NodeId edited_node;
+
+		/// @brief Whether `edited_node` is set
+		bool only_edits_contents = true;
+	};
+
+	struct TrackedContents
+	{
+		/// @brief Record that restores the contents
+		std::vector<char> record;
+
+		/// @brief Value of m_track_count when the node was last tracked
+		std::uint64_t last_tracked;
+	};
+
+	/**
+	 * @brief Starts recording an edit that is not an edit to the contents of a node.
+	 */
+	void begin_edit();
+
+	/**
+	 * @brief Moves the records written to m_writer to the undo records of the edit being recorded.
+	 */
+	void push_undo_records();
+
+	/**
+	 * @brief Moves the records written to m_writer to the redo records of the current step.
+	 */
+	void push_redo_records();
+
+	/**
+	 * @brief Writes the contents of \p node to m_writer, decoding them first if needed.
+	 */
+	void write_contents(Node& node);
+
+	/**
+	 * @brief Updates the contents of \p node in m_contents, and returns them, if it is tracked or \p insert is set.
+	 */
+	TrackedContents* update_contents(Node& node, bool insert);
+
+	void apply(od::gsl::span<const char> records);
+
+	/**
+	 * @brief Updates the positions stored in \p step with those of its nodes that exist, before it is undone or redone.
+	 */
+	void save_positions(Step& step);
+
+	/**
+	 * @brief Moves the nodes of \p step that exist back to their stored position, after it was undone or redone.
+	 */
+	void restore_positions(const Step& step);
+
+	FsmEditor* m_editor;
+
+	/// @brief Encodes records, which are moved to the steps right away
+	visitors::JournalWriter m_writer;
+
+	Step m_current_step;
+	std::deque<Step> m_undo_steps;
+	std::vector<Step> m_redo_steps;
+	std::size_t m_step_limit = 1000;
+
+	/// @brief Whether the current step may be merged into the last one, which is not the case right after an undo
+	bool m_can_merge = false;
+
+	/// @brief Last known contents of the tracked nodes
+	std::unordered_map<ed::NodeId, TrackedContents> m_contents;
+
+	/// @brief Number of calls to track(), to tell which nodes are no longer tracked
+	std::uint64_t m_track_count = 0;
+
+	/// @brief Whether a step is being applied, whose edits must not be recorded again
+	bool m_applying = false;
+};
+
+inline bool UndoHistory::can_undo() const
+{
+	return !m_undo_steps.empty() || !m_current_step.redo_records.empty();
+}
+
+inline bool UndoHistory::can_redo() const
+{
+	// Committing the pending edits clears the redo history
+	return !m_redo_steps.empty() && m_current_step.redo_records.empty();
+}
+
+inline void UndoHistory::set_step_limit(std::size_t step_limit)
+{
+	m_step_limit = step_limit;
+}
+
+}
@@ -0,0 +1,322 @@
+#include "backgroundsaver.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace fsme
+{
+namespace detail
+{
+
+namespace
+{
+
+/// @brief Share of the progress of a save taken by encoding, the remainder being taken by the file write
+const float encoding_progress_share = 0.5f;
+
+/// @brief Size of the chunks files are written in, which is how often the write progress is updated
+const std::size_t write_chunk_size = std::size_t(1) << 20;
+
+std::runtime_error make_file_error(const std::string& message, const std::string& path)
+{
+	return std::runtime_error(message + " '" + path + "': " + std::strerror(errno));
+}
+
+/**
+ * @brief Flushes \p file to disk, rather than only to the OS.
+ */
+bool sync_file(std::FILE* file)
+{
+	if (std::fflush(file) != 0)
+	{
+		return false;
+	}
+
+#ifdef _WIN32
+	return _commit(_fileno(file)) == 0;
+#else
+	return fsync(fileno(file)) == 0;
+#endif
+}
+
+/**
+ * @brief Replaces \p path with \p temporary_path in one step, so that \p path is never missing nor partially written.
+ */
+bool replace_file(const std::string& temporary_path, const std::string& path)
+{
+#ifdef _WIN32
+	// std::rename() does not replace existing files on Windows, and removing them first is not atomic
+	return MoveFileExA(
+		temporary_path.c_str(),
+		path.c_str(),
+		MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH
+	) != 0;
+#else
+	return std::rename(temporary_path.c_str(), path.c_str()) == 0;
+#endif
+}
+
+}
+
+BackgroundSaver::BackgroundSaver() = default;
+
+BackgroundSaver::~BackgroundSaver()
+{
+	if (!m_worker.joinable())
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+
+	m_job_available.notify_one();
+	m_worker.join();
+}
+
+void BackgroundSaver::save(std::string path, Encoder encoder, SavedCallback on_saved)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		Job job{JobKind::SAVE, std::move(path), ++m_last_save_index, std::move(encoder), std::move(on_saved), {}, false};
+
+		if (!m_jobs.empty() && m_jobs.back().kind == JobKind::SAVE && m_jobs.back().path == job.path)
+		{
+			m_jobs.back() = std::move(job);
+		}
+		else
+		{
+			m_jobs.push_back(std::move(job));
+		}
+
+		m_status.state = State::SAVING;
+		m_status.progress = 0.0f;
+		m_status.path = m_jobs.back().path;
+		m_status.error.clear();
+
+		start_worker();
+	}
+
+	m_job_available.notify_one();
+}
+
+void BackgroundSaver::append(std::string path, std::vector<char> bytes, bool truncate)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_jobs.push_back(Job{JobKind::APPEND, std::move(path), 0, {}, {}, std::move(bytes), truncate});
+
+		start_worker();
+	}
+
+	m_job_available.notify_one();
+}
+
+BackgroundSaver::Status BackgroundSaver::status() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_status;
+}
+
+void BackgroundSaver::wait() const
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_idle.wait(lock, [this] { return m_jobs.empty() && !m_busy; });
+}
+
+void BackgroundSaver::write_file(
+	const std::string& path,
+	const std::vector<char>& bytes,
+	const std::function<void(float)>& progress
+)
+{
+	const std::string temporary_path = path + ".tmp";
+
+	std::FILE* file = std::fopen(temporary_path.c_str(), "wb");
+
+	if (file == nullptr)
+	{
+		throw make_file_error("Failed to open", temporary_path);
+	}
+
+	const auto fail = [&](const char* message) {
+		const std::runtime_error error = make_file_error(message, temporary_path);
+		std::fclose(file);
+		std::remove(temporary_path.c_str());
+		throw error;
+	};
+
+	for (std::size_t offset = 0; offset < bytes.size(); offset += write_chunk_size)
+	{
+		const std::size_t size = std::min(write_chunk_size, bytes.size() - offset);
+
+		if (std::fwrite(bytes.data() + offset, 1, size, file) != size)
+		{
+			fail("Failed to write");
+		}
+
+		if (progress)
+		{
+			progress(float(offset + size) / float(bytes.size()));
+		}
+	}
+
+	// Otherwise, a crash shortly after the rename could leave an empty or partial file behind
+	if (!sync_file(file))
+	{
+		fail("Failed to write");
+	}
+
+	if (std::fclose(file) != 0)
+	{
+		const std::runtime_error error = make_file_error("Failed to write", temporary_path);
+		std::remove(temporary_path.c_str());
+		throw error;
+	}
+
+	if (!replace_file(temporary_path, path))
+	{
+		const std::runtime_error error = make_file_error("Failed to replace", path);
+		std::remove(temporary_path.c_str());
+		throw error;
+	}
+}
+
+void BackgroundSaver::start_worker()
+{
+	if (!m_worker.joinable())
+	{
+		m_worker = std::thread(&BackgroundSaver::run, this);
+	}
+}
+
+void BackgroundSaver::run()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	for (;;)
+	{
+		m_job_available.wait(lock, [this] { return !m_jobs.empty() || m_stopping; });
+
+		if (m_jobs.empty())
+		{
+			return;
+		}
+
+		Job job = std::move(m_jobs.front());
+		m_jobs.pop_front();
+		m_busy = true;
+
+		lock.unlock();
+		process(job);
+		lock.lock();
+
+		m_busy = false;
+
+		if (m_jobs.empty())
+		{
+			m_idle.notify_all();
+		}
+	}
+}
+
+void BackgroundSaver::process(Job& job)
+{
+	std::string error;
+
+	try
+	{
+		if (job.kind == JobKind::APPEND)
+		{
+			append_file(job.path, job.bytes, job.truncate);
+			return;
+		}
+
+		const std::vector<char> bytes = job.encoder([&](float progress) {
+			set_progress(job, progress * encoding_progress_share);
+		});
+
+		// Release whatever the encoder holds on to, e.g. a snapshot of the graph, before the write
+		job.encoder = nullptr;
+
+		write_file(job.path, bytes, [&](float progress) {
+			set_progress(job, encoding_progress_share + (1.0f - encoding_progress_share) * progress);
+		});
+
+		if (job.on_saved)
+		{
+			job.on_saved(bytes);
+		}
+	}
+	catch (const std::exception& e)
+	{
+		error = e.what();
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (job.kind == JobKind::APPEND)
+	{
+		m_status.state = State::FAILED;
+		m_status.path = job.path;
+		m_status.error = std::move(error);
+		return;
+	}
+
+	// A newer save was requested in the meantime, and its status takes precedence
+	if (job.save_index != m_last_save_index)
+	{
+		return;
+	}
+
+	m_status.state = error.empty() ? State::SUCCEEDED : State::FAILED;
+	m_status.progress = 1.0f;
+	m_status.path = job.path;
+	m_status.error = std::move(error);
+}
+
+void BackgroundSaver::set_progress(const Job& job, float progress)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (job.save_index == m_last_save_index)
+	{
+		m_status.progress = progress;
+	}
+}
+
+void BackgroundSaver::append_file(const std::string& path, const std::vector<char>& bytes, bool truncate)
+{
+	std::FILE* file = std::fopen(path.c_str(), truncate ? "wb" : "ab");
+
+	if (file == nullptr)
+	{
+		throw make_file_error("Failed to open", path);
+	}
+
+	const bool written = std::fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size() && sync_file(file);
+	const std::runtime_error error = make_file_error("Failed to write", path);
+
+	if (std::fclose(file) != 0 || !written)
+	{
+		throw error;
+	}
+}
+
+}
+}
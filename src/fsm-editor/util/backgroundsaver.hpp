@@ -0,0 +1,158 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fsme
+{
+namespace detail
+{
+
+/**
+ * @brief Encodes and writes files on a worker thread, so that saving does not stall the UI.
+ *
+ * @details Jobs are processed one at a time, in order. When a save is requested while the last queued job is a save
+ * of the same file that did not start yet, that save is superseded, as only the latest contents matter.
+ * Saved files are first written and flushed to disk next to their destination, then renamed over it, so that a failed
+ * save never leaves a truncated file behind.
+ * Any job still pending when the saver is destroyed gets completed first. The worker thread is only started along with
+ * the first job, so that savers that are never used, e.g. those of headless editors, cost nothing.
+ */
+class BackgroundSaver
+{
+public:
+	/**
+	 * @brief Produces the contents of a file. It is called on the worker thread, and may report its progress from 0
+	 * to 1 through its argument.
+	 */
+	using Encoder = std::function<std::vector<char>(const std::function<void(float)>&)>;
+
+	/**
+	 * @brief Called on the worker thread with the contents of a file once it was saved, before the next job starts.
+	 * It may throw to report the save as failed.
+	 */
+	using SavedCallback = std::function<void(const std::vector<char>&)>;
+
+	enum class State
+	{
+		IDLE,
+		SAVING,
+		SUCCEEDED,
+		FAILED
+	};
+
+	struct Status
+	{
+		State state = State::IDLE;
+
+		/// @brief Overall progress of the current save, from 0 to 1
+		float progress = 0.0f;
+
+		/// @brief Path of the current or last save
+		std::string path;
+
+		/// @brief Error message of the last save or append, if it failed
+		std::string error;
+	};
+
+	BackgroundSaver();
+	~BackgroundSaver();
+
+	BackgroundSaver(const BackgroundSaver&) = delete;
+	BackgroundSaver& operator=(const BackgroundSaver&) = delete;
+
+	/**
+	 * @brief Queues a save of the contents produced by \p encoder to \p path, and returns immediately.
+	 * @param on_saved If set, called once the file was saved successfully.
+	 */
+	void save(std::string path, Encoder encoder, SavedCallback on_saved = {});
+
+	/**
+	 * @brief Queues appending \p bytes to the file at \p path, which is created if needed, and returns immediately.
+	 * @details The file is flushed to disk after each append. Appends are not reported by status() unless they fail.
+	 * @param truncate Whether to truncate the file first.
+	 */
+	void append(std::string path, std::vector<char> bytes, bool truncate = false);
+
+	/**
+	 * @brief Returns the status of the current save, or of the last one if none is in progress.
+	 */
+	Status status() const;
+
+	/**
+	 * @brief Blocks until all queued jobs are complete.
+	 */
+	void wait() const;
+
+	/**
+	 * @brief Writes \p bytes to \p path through a temporary file, which is flushed to disk then renamed over \p path.
+	 * @param progress If set, called with the fraction of the bytes written so far.
+	 * @throws std::runtime_error if the file cannot be written.
+	 */
+	static void write_file(
+		const std::string& path,
+		const std::vector<char>& bytes,
+		const std::function<void(float)>& progress = {}
+	);
+
+private:
+	enum class JobKind
+	{
+		SAVE,
+		APPEND
+	};
+
+	struct Job
+	{
+		JobKind kind;
+		std::string path;
+
+		/// @brief Identifies a save, so that a superseded save does not report its status
+		std::uint64_t save_index;
+
+		Encoder encoder;
+		SavedCallback on_saved;
+
+		std::vector<char> bytes;
+		bool truncate;
+	};
+
+	/**
+	 * @brief Starts the worker thread unless it runs already. m_mutex must be held.
+	 */
+	void start_worker();
+
+	void run();
+	void process(Job& job);
+	void set_progress(const Job& job, float progress);
+
+	static void append_file(const std::string& path, const std::vector<char>& bytes, bool truncate);
+
+	mutable std::mutex m_mutex;
+
+	/// @brief Notified when a job is queued or the saver is destroyed
+	std::condition_variable m_job_available;
+
+	/// @brief Notified when the worker runs out of jobs
+	mutable std::condition_variable m_idle;
+
+	std::deque<Job> m_jobs;
+	bool m_busy = false;
+	bool m_stopping = false;
+
+	/// @brief Index of the last save requested, whose status is the one reported
+	std::uint64_t m_last_save_index = 0;
+
+	Status m_status;
+
+	std::thread m_worker;
+};
+
+}
+}
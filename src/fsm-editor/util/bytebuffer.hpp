@@ -0,0 +1,198 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include <onidev/core/span.h>
+
+namespace fsme
+{
+namespace detail
+{
+
+/**
+ * @brief Maps signed integers to unsigned ones so that values close to zero have small encodings, e.g. as varints.
+ */
+inline std::uint64_t zigzag_encode(std::int64_t value)
+{
+	return (std::uint64_t(value) << 1) ^ std::uint64_t(value >> 63);
+}
+
+inline std::int64_t zigzag_decode(std::uint64_t value)
+{
+	return std::int64_t(value >> 1) ^ -std::int64_t(value & 1);
+}
+
+/**
+ * @brief Growable contiguous byte buffer to serialize into, which is meant to be written out in one go.
+ */
+class ByteWriter
+{
+public:
+	void write(const void* data, std::size_t size)
+	{
+		const std::size_t offset = m_bytes.size();
+		m_bytes.resize(offset + size);
+
+		if (size != 0)
+		{
+			std::memcpy(m_bytes.data() + offset, data, size);
+		}
+	}
+
+	template<class T>
+	void write_memcpy(const T& value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable types can be memcpy'd");
+		write(&value, sizeof(value));
+	}
+
+	/**
+	 * @brief Writes \p value as a little-endian base 128 varint, i.e. 7 bits per byte and the high bit set on all but
+	 * the last byte.
+	 */
+	void write_varint(std::uint64_t value)
+	{
+		while (value >= 0x80)
+		{
+			m_bytes.push_back(char(std::uint8_t(value) | 0x80));
+			value >>= 7;
+		}
+
+		m_bytes.push_back(char(std::uint8_t(value)));
+	}
+
+	/**
+	 * @brief Overwrites already written bytes at \p offset, e.g. to patch a size known only after writing.
+	 */
+	template<class T>
+	void overwrite_memcpy(std::size_t offset, const T& value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable types can be memcpy'd");
+
+		if (offset + sizeof(value) > m_bytes.size())
+		{
+			throw std::out_of_range("ByteWriter: overwrite past the end of the buffer");
+		}
+
+		std::memcpy(m_bytes.data() + offset, &value, sizeof(value));
+	}
+
+	void reserve(std::size_t size)
+	{
+		m_bytes.reserve(size);
+	}
+
+	std::size_t size() const { return m_bytes.size(); }
+	const char* data() const { return m_bytes.data(); }
+
+	std::vector<char>& bytes() { return m_bytes; }
+	const std::vector<char>& bytes() const { return m_bytes; }
+
+private:
+	std::vector<char> m_bytes;
+};
+
+/**
+ * @brief Cursor over a contiguous span of bytes to deserialize from.
+ * @details All reads are bounds-checked and throw std::runtime_error rather than reading past the end of the span.
+ */
+class ByteReader
+{
+public:
+	explicit ByteReader(od::gsl::span<const char> bytes) :
+		m_bytes(bytes),
+		m_position(0)
+	{}
+
+	void read(void* data, std::size_t size)
+	{
+		const char* source = take(size);
+
+		if (size != 0)
+		{
+			std::memcpy(data, source, size);
+		}
+	}
+
+	template<class T>
+	T read_memcpy()
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable types can be memcpy'd");
+
+		T ret;
+		read(&ret, sizeof(ret));
+		return ret;
+	}
+
+	/**
+	 * @brief Reads a varint written by ByteWriter::write_varint().
+	 */
+	std::uint64_t read_varint()
+	{
+		std::uint64_t value = 0;
+
+		for (unsigned shift = 0; shift < 64; shift += 7)
+		{
+			const std::uint8_t byte = std::uint8_t(*take(1));
+			value |= std::uint64_t(byte & 0x7F) << shift;
+
+			if ((byte & 0x80) == 0)
+			{
+				return value;
+			}
+		}
+
+		throw std::runtime_error("Failed to deserialize: Malformed variable-length integer");
+	}
+
+	/**
+	 * @brief Returns a view over the next \p size bytes and skips past them, without copying.
+	 */
+	od::gsl::span<const char> read_span(std::size_t size)
+	{
+		const char* first = take(size);
+		return {first, first + size};
+	}
+
+	void skip(std::size_t size)
+	{
+		take(size);
+	}
+
+	void seek(std::size_t position)
+	{
+		if (position > std::size_t(m_bytes.size()))
+		{
+			throw std::runtime_error("Failed to deserialize: Seeking past the end of the data");
+		}
+
+		m_position = position;
+	}
+
+	std::size_t position() const { return m_position; }
+	std::size_t remaining() const { return std::size_t(m_bytes.size()) - m_position; }
+
+private:
+	const char* take(std::size_t size)
+	{
+		if (size > remaining())
+		{
+			throw std::runtime_error("Failed to deserialize: Unexpected end of data");
+		}
+
+		const char* ret = m_bytes.data() + m_position;
+		m_position += size;
+		return ret;
+	}
+
+	od::gsl::span<const char> m_bytes;
+	std::size_t m_position;
+};
+
+}
+}
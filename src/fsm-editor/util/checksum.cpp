@@ -0,0 +1,49 @@
+#include "checksum.hpp"
+
+#include <array>
+
+namespace fsme
+{
+namespace detail
+{
+
+namespace
+{
+
+std::array<std::uint32_t, 256> make_crc32_table()
+{
+	std::array<std::uint32_t, 256> table;
+
+	for (std::uint32_t i = 0; i < 256; ++i)
+	{
+		std::uint32_t value = i;
+
+		for (int bit = 0; bit < 8; ++bit)
+		{
+			value = (value & 1) ? (value >> 1) ^ 0xEDB88320 : (value >> 1);
+		}
+
+		table[i] = value;
+	}
+
+	return table;
+}
+
+}
+
+std::uint32_t crc32(od::gsl::span<const char> bytes)
+{
+	static const std::array<std::uint32_t, 256> table = make_crc32_table();
+
+	std::uint32_t crc = 0xFFFFFFFF;
+
+	for (const char byte : bytes)
+	{
+		crc = table[(crc ^ std::uint8_t(byte)) & 0xFF] ^ (crc >> 8);
+	}
+
+	return crc ^ 0xFFFFFFFF;
+}
+
+}
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+
+#include <onidev/core/span.h>
+
+namespace fsme
+{
+namespace detail
+{
+
+/**
+ * @brief Computes the CRC-32 (IEEE 802.3 polynomial) of \p bytes.
+ */
+std::uint32_t crc32(od::gsl::span<const char> bytes);
+
+}
+}
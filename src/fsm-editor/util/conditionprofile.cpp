@@ -0,0 +1,89 @@
+#include "conditionprofile.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace fsme
+{
+namespace detail
+{
+
+ConditionProfile ConditionProfile::load(const std::string& path)
+{
+	std::ifstream file(path);
+
+	if (!file)
+	{
+		throw std::runtime_error("Failed to open " + path + ": " + std::strerror(errno));
+	}
+
+	ConditionProfile profile;
+	std::string line;
+	std::size_t line_number = 0;
+
+	while (std::getline(file, line))
+	{
+		++line_number;
+
+		std::istringstream fields(line);
+		std::uint64_t id;
+		std::uint64_t evaluations;
+		std::uint64_t holds;
+		std::string rest;
+
+		if (!(fields >> id))
+		{
+			// Blank lines are skipped, but not lines that do not start with an ID
+			if (line.find_first_not_of(" \t\r") == std::string::npos)
+			{
+				continue;
+			}
+
+			throw std::runtime_error("Expected a condition ID on line " + std::to_string(line_number));
+		}
+
+		// Streams would read negative counts as huge ones
+		const bool negative = line.find('-') != std::string::npos;
+
+		if (!(fields >> evaluations >> holds) || (fields >> rest) || id > UINT32_MAX || negative)
+		{
+			throw std::runtime_error(
+				"Expected a condition ID, an evaluation count and a count of times it held on line "
+				+ std::to_string(line_number)
+			);
+		}
+
+		if (holds > evaluations)
+		{
+			throw std::runtime_error("A condition holds more often than it is evaluated on line " + std::to_string(line_number));
+		}
+
+		profile.add(std::uint32_t(id), evaluations, holds);
+	}
+
+	if (file.bad())
+	{
+		throw std::runtime_error("Failed to read " + path + ": " + std::strerror(errno));
+	}
+
+	return profile;
+}
+
+void ConditionProfile::add(std::uint32_t id, std::uint64_t evaluations, std::uint64_t holds)
+{
+	Counts& counts = m_counts[id];
+	counts.evaluations += evaluations;
+	counts.holds += holds;
+}
+
+const ConditionProfile::Counts* ConditionProfile::find(std::uint32_t id) const
+{
+	const auto found = m_counts.find(id);
+	return found != m_counts.end() ? &found->second : nullptr;
+}
+
+}
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+namespace fsme
+{
+namespace detail
+{
+
+/**
+ * @brief How often each condition of an exported graph was evaluated and held, e.g. as recorded by a debug build of the
+ * game.
+ *
+ * @details Profiles are text files with one `<id> <evaluations> <holds>` line per condition, `<id>` being the ID of an
+ * `expr` line of a Centauri export made without a profile, see visitors::CentauriSerializer. Fields are separated by
+ * spaces or tabs. Lines for the same ID add up, so that profiles of several sessions can simply be concatenated.
+ */
+class ConditionProfile
+{
+public:
+	struct Counts
+	{
+		std::uint64_t evaluations = 0;
+		std::uint64_t holds = 0;
+	};
+
+	/**
+	 * @throws std::runtime_error if the file cannot be read, or if a line is malformed.
+	 */
+	static ConditionProfile load(const std::string& path);
+
+	/**
+	 * @brief Counts \p evaluations of the condition \p id, of which it held \p holds times.
+	 */
+	void add(std::uint32_t id, std::uint64_t evaluations, std::uint64_t holds);
+
+	/**
+	 * @brief Returns the counts of the condition \p id, or nullptr if it was never evaluated.
+	 */
+	const Counts* find(std::uint32_t id) const;
+
+	bool empty() const { return m_counts.empty(); }
+
+private:
+	std::unordered_map<std::uint32_t, Counts> m_counts;
+};
+
+}
+}
@@ -0,0 +1,123 @@
+#include "directory.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+namespace fsme
+{
+namespace detail
+{
+
+namespace
+{
+
+bool ends_with(const std::string& name, const std::string& suffix)
+{
+	return name.size() >= suffix.size() && std::equal(suffix.rbegin(), suffix.rend(), name.rbegin());
+}
+
+std::string join_path(const std::string& directory, const std::string& name)
+{
+	if (directory.empty() || directory.back() == '/' || directory.back() == '\\')
+	{
+		return directory + name;
+	}
+
+	return directory + '/' + name;
+}
+
+}
+
+#ifdef _WIN32
+
+bool is_directory(const std::string& path)
+{
+	const DWORD attributes = GetFileAttributesA(path.c_str());
+	return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+}
+
+std::vector<std::string> list_files(const std::string& directory, const std::string& extension)
+{
+	WIN32_FIND_DATAA entry;
+	const HANDLE find = FindFirstFileA(join_path(directory, "*").c_str(), &entry);
+
+	if (find == INVALID_HANDLE_VALUE)
+	{
+		throw std::runtime_error("Failed to read directory: " + directory);
+	}
+
+	std::vector<std::string> paths;
+
+	do
+	{
+		const std::string name = entry.cFileName;
+
+		if ((entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0 && ends_with(name, extension))
+		{
+			paths.push_back(join_path(directory, name));
+		}
+	} while (FindNextFileA(find, &entry));
+
+	FindClose(find);
+
+	std::sort(paths.begin(), paths.end());
+	return paths;
+}
+
+#else
+
+bool is_directory(const std::string& path)
+{
+	struct stat info;
+	return stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+std::vector<std::string> list_files(const std::string& directory, const std::string& extension)
+{
+	DIR* dir = opendir(directory.c_str());
+
+	if (dir == nullptr)
+	{
+		throw std::runtime_error("Failed to read directory: " + directory);
+	}
+
+	std::vector<std::string> paths;
+
+	while (const dirent* entry = readdir(dir))
+	{
+		const std::string name = entry->d_name;
+
+		if (!ends_with(name, extension))
+		{
+			continue;
+		}
+
+		// d_type is not filled in by every file system, so the type is always checked through stat()
+		std::string path = join_path(directory, name);
+		struct stat info;
+
+		if (stat(path.c_str(), &info) == 0 && S_ISREG(info.st_mode))
+		{
+			paths.push_back(std::move(path));
+		}
+	}
+
+	closedir(dir);
+
+	std::sort(paths.begin(), paths.end());
+	return paths;
+}
+
+#endif
+
+}
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace fsme
+{
+namespace detail
+{
+
+/**
+ * @brief Returns whether \p path names an existing directory.
+ */
+bool is_directory(const std::string& path);
+
+/**
+ * @brief Returns the paths of the regular files directly within \p directory whose name ends with \p extension, sorted
+ * by name.
+ * @throws std::runtime_error if the directory cannot be read.
+ */
+std::vector<std::string> list_files(const std::string& directory, const std::string& extension);
+
+}
+}
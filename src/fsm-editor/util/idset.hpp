@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "slotmap.hpp"
+
+namespace fsme
+{
+namespace detail
+{
+
+/**
+ * @brief Set of generational IDs with constant-time membership tests.
+ *
+ * @details The full ID of each member is stamped in an array indexed by its slot index, so that a lookup is a single
+ * array access and a stale ID sharing the slot index of a member is not found.
+ * Clearing only resets the stamps of the current members, so rebuilding the set every frame costs time proportional
+ * to the number of members rather than to the number of IDs ever allocated.
+ *
+ * @tparam Key An ID type that is explicitly convertible to and from an integer, e.g. ed::NodeId.
+ */
+template<class Key>
+class IdSet
+{
+public:
+	using const_iterator = typename std::vector<Key>::const_iterator;
+
+	void insert(Key key)
+	{
+		const std::uint32_t index = id_index(raw(key));
+
+		if (index >= m_stamps.size())
+		{
+			m_stamps.resize(std::size_t(index) + 1, 0);
+		}
+
+		if (m_stamps[index] != raw(key))
+		{
+			m_stamps[index] = raw(key);
+			m_keys.push_back(key);
+		}
+	}
+
+	bool contains(Key key) const
+	{
+		const std::uint32_t index = id_index(raw(key));
+		return index < m_stamps.size() && m_stamps[index] == raw(key) && raw(key) != 0;
+	}
+
+	void clear()
+	{
+		for (const Key key : m_keys)
+		{
+			m_stamps[id_index(raw(key))] = 0;
+		}
+
+		m_keys.clear();
+	}
+
+	std::size_t size() const { return m_keys.size(); }
+	bool empty() const { return m_keys.empty(); }
+
+	const_iterator begin() const { return m_keys.begin(); }
+	const_iterator end() const { return m_keys.end(); }
+
+private:
+	static std::uint64_t raw(Key key)
+	{
+		return std::uint64_t(std::uintptr_t(key));
+	}
+
+	std::vector<std::uint64_t> m_stamps;
+	std::vector<Key> m_keys;
+};
+
+}
+}
@@ -16,6 +16,33 @@ namespace detail
  */
 void imgui_set_default_keyboard_focus();
 
+/**
+ * @brief Makes a node editor context current for the lifetime of the object, then restores the previous one.
+ *        This is needed to query or place nodes outside of FsmEditor::render(), e.g. when loading.
+ *        The current context is global to the process, so this is only done on the UI thread: editors used on other
+ *        threads are headless, see FsmEditor::Mode.
+ */
+class ScopedEditorContext
+{
+public:
+	explicit ScopedEditorContext(ed::EditorContext* context) :
+		m_previous(ed::GetCurrentEditor())
+	{
+		ed::SetCurrentEditor(context);
+	}
+
+	~ScopedEditorContext()
+	{
+		ed::SetCurrentEditor(m_previous);
+	}
+
+	ScopedEditorContext(const ScopedEditorContext&) = delete;
+	ScopedEditorContext& operator=(const ScopedEditorContext&) = delete;
+
+private:
+	ed::EditorContext* m_previous;
+};
+
 }
 
 }
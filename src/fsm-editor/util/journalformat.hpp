@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace fsme
+{
+namespace journal_format
+{
+
+/**
+ * @brief Header of autosave journals, which is followed by a 16-bit version number.
+ *
+ * @details A journal is laid out as follows:
+ * - `magic_header`, `version` and 16 bits of padding;
+ * - the CRC-32 and the 64-bit size of the native file the journal applies on top of, so that a journal left behind
+ *   by an earlier version of that file is ignored;
+ * - records, back to back. Each record is made of its 32-bit size, the CRC-32 of its contents, then its contents:
+ *   a RecordType and its fields.
+ *
+ * Record fields are varints (see detail::ByteWriter::write_varint()), and strings are stored as their size followed
+ * by their characters. Records are only ever appended, so a crash may leave a torn record at the end of the journal:
+ * replaying stops at the first incomplete or corrupt record.
+ */
+const std::uint32_t magic_header = 0xCCAAFFF0;
+
+const std::uint16_t version = 0x0001;
+
+/// @brief Size of the journal header, before the first record
+const std::size_t header_size = 20;
+
+/// @brief Size of the size and checksum of a record, before its contents
+const std::size_t record_header_size = 8;
+
+enum class RecordType : std::uint8_t
+{
+	/// @brief Node type, node ID, then the input and output pin IDs
+	NODE_CREATED = 0x01,
+
+	/// @brief Node ID
+	NODE_DESTROYED = 0x02,
+
+	/// @brief Node ID, side (0 for inputs, 1 for outputs), then the new pin IDs of that side
+	PINS_CHANGED = 0x03,
+
+	/// @brief Link ID, source and destination pin IDs
+	LINK_CREATED = 0x04,
+
+	/// @brief Link ID
+	LINK_DESTROYED = 0x05,
+
+	/// @brief Node ID, then the name of a StateNode, the expression of an IfNode, or the output pin ID and expression
+	/// of each output of a CondNode. Expressions are made of their input type, Lua text and option shorthands.
+	NODE_EDITED = 0x06
+};
+
+}
+}
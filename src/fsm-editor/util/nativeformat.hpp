@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <type_traits>
 
 namespace fsme
 {
@@ -14,13 +15,69 @@ enum class NodeType : std::uint8_t
 	COND  = 0x02
 };
 
+/**
+ * @brief Header of version 1 files, which have no version field and store their chunks back to back.
+ */
 const std::uint32_t magic_header = 0xCCAAFFEE;
-const std::uint16_t version = 0x0001;
+
+/**
+ * @brief Header of version 2 files onwards, which is followed by a 16-bit version number.
+ */
+const std::uint32_t versioned_magic_header = 0xCCAAFFEF;
+
+const std::uint16_t version_1 = 0x0001;
+const std::uint16_t version_2 = 0x0002;
+const std::uint16_t version_3 = 0x0003;
+
+/// @brief The version written by NativeSerializer
+const std::uint16_t version = version_3;
 
 // Chunk headers
 const std::uint32_t pins_magic = 0x01C0FFEE;
 const std::uint32_t links_magic = 0x02C0FFEE;
 const std::uint32_t nodes_magic = 0x03C0FFEE;
+const std::uint32_t payloads_magic = 0x04C0FFEE;
+const std::uint32_t strings_magic = 0x05C0FFEE;
+const std::uint32_t layout_magic = 0x06C0FFEE;
+
+/**
+ * @brief Entry of the section table of version 2 files, which locates a chunk within the file.
+ *
+ * @details Version 2 files are laid out as follows:
+ * - `versioned_magic_header`, `version`, a 16-bit section count and the 64-bit ID high water mark;
+ * - the section table, made of one SectionEntry per section;
+ * - the sections themselves, in no particular order. Sections with an unknown magic are ignored.
+ *
+ * The nodes section only holds the type, ID, pins and payload size of nodes. The contents of nodes, such as state
+ * names and expressions, are stored back to back in the payloads section, in the same order as the nodes section, so
+ * that they can be decoded lazily.
+ *
+ * Version 3 files have the same layout, but a compact encoding:
+ * - all counts and sizes are varints (see detail::ByteWriter::write_varint());
+ * - IDs are zigzag varints of the difference with the previous ID of the same kind, and nodes are sorted by ID;
+ * - there are no pins nor links sections. Links are stored once, along with the output pin they start from within
+ *   the nodes section, and pins are rebuilt from the nodes and links;
+ * - strings (state names, Lua expressions and option shorthands) are stored once in the strings section, and referred
+ *   to by index from node payloads.
+ *
+ * Version 3 files may also have a layout section, which holds the position and size of each node that was laid out
+ * in the node editor, as delta-coded node IDs followed by four floats.
+ */
+struct SectionEntry
+{
+	std::uint32_t magic;
+
+	/// @brief CRC-32 of the section, see detail::crc32()
+	std::uint32_t checksum;
+
+	/// @brief Offset of the section from the start of the file
+	std::uint64_t offset;
+
+	std::uint64_t size;
+};
+
+static_assert(sizeof(SectionEntry) == 24, "SectionEntry must not contain padding");
+static_assert(std::is_trivially_copyable<SectionEntry>::value, "SectionEntry must be trivially copyable");
 
 }
 }
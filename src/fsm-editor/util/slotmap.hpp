@@ -0,0 +1,316 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace fsme
+{
+namespace detail
+{
+
+static_assert(sizeof(std::uintptr_t) >= sizeof(std::uint64_t), "Generational IDs require 64-bit identifiers");
+
+/**
+ * @brief Returns the slot index part of a generational ID (its lower 32 bits).
+ */
+inline std::uint32_t id_index(std::uint64_t id)
+{
+	return std::uint32_t(id & 0xFFFFFFFF);
+}
+
+/**
+ * @brief Returns the generation part of a generational ID (its upper 32 bits).
+ */
+inline std::uint32_t id_generation(std::uint64_t id)
+{
+	return std::uint32_t(id >> 32);
+}
+
+/**
+ * @brief Builds a generational ID out of a slot index and a generation.
+ */
+inline std::uint64_t make_id(std::uint32_t index, std::uint32_t generation)
+{
+	return (std::uint64_t(generation) << 32) | index;
+}
+
+/**
+ * @brief Allocator of generational IDs.
+ *
+ * @details Slot indices are recycled once released, but the generation of a slot is bumped on release, so that an ID
+ * is never handed out twice. The slot index 0 is never allocated, so that 0 remains usable as an invalid ID.
+ */
+class IdPool
+{
+public:
+	IdPool() :
+		m_generations(1, 0),
+		m_free_positions(1, 0)
+	{}
+
+	std::uint64_t allocate()
+	{
+		if (!m_free.empty())
+		{
+			const std::uint32_t index = m_free.back();
+			m_free.pop_back();
+			m_free_positions[index] = 0;
+			return make_id(index, m_generations[index]);
+		}
+
+		return allocate_unrecycled();
+	}
+
+	/**
+	 * @brief Allocates an ID in a slot that was never used before, rather than recycling a released slot.
+	 */
+	std::uint64_t allocate_unrecycled()
+	{
+		m_generations.push_back(0);
+		m_free_positions.push_back(0);
+		return make_id(std::uint32_t(m_generations.size() - 1), 0);
+	}
+
+	/**
+	 * @brief Releases \p id so its slot can be recycled. Stale or unknown IDs are ignored.
+	 */
+	void release(std::uint64_t id)
+	{
+		const std::uint32_t index = id_index(id);
+
+		if (index == 0 || index >= m_generations.size() || m_generations[index] != id_generation(id))
+		{
+			return;
+		}
+
+		++m_generations[index];
+		m_free.push_back(index);
+		m_free_positions[index] = std::uint32_t(m_free.size());
+	}
+
+	/**
+	 * @brief Resets the pool so that all of the slots in `[1, high_water]` are considered allocated.
+	 * @details This is used when loading a graph, where only the highest slot index is known.
+	 */
+	void reset(std::uint32_t high_water)
+	{
+		m_generations.assign(std::size_t(high_water) + 1, 0);
+		m_free_positions.assign(std::size_t(high_water) + 1, 0);
+		m_free.clear();
+	}
+
+	/**
+	 * @brief Marks \p id as allocated, e.g. when replaying the creation of an entity whose ID is known already.
+	 * @details Slots skipped over to reach \p id are considered allocated, as in reset(). This runs in constant time.
+	 * @return Whether \p id itself was allocated already, in which case something else may be using it.
+	 */
+	bool claim(std::uint64_t id)
+	{
+		const std::uint32_t index = id_index(id);
+		bool allocated = false;
+
+		if (index >= m_generations.size())
+		{
+			m_generations.resize(std::size_t(index) + 1, 0);
+			m_free_positions.resize(std::size_t(index) + 1, 0);
+		}
+		else if (m_free_positions[index] != 0)
+		{
+			// Swap and pop, as the order of the free list does not matter
+			const std::uint32_t position = m_free_positions[index] - 1;
+			m_free[position] = m_free.back();
+			m_free_positions[m_free[position]] = position + 1;
+			m_free.pop_back();
+			m_free_positions[index] = 0;
+		}
+		else
+		{
+			allocated = m_generations[index] == id_generation(id);
+		}
+
+		m_generations[index] = id_generation(id);
+		return allocated;
+	}
+
+	/**
+	 * @brief Returns the highest slot index that was ever allocated.
+	 */
+	std::uint32_t high_water() const
+	{
+		return std::uint32_t(m_generations.size() - 1);
+	}
+
+private:
+	std::vector<std::uint32_t> m_generations;
+
+	/// @brief Released slots, which allocate() recycles from the back
+	std::vector<std::uint32_t> m_free;
+
+	/// @brief Position of each slot within m_free plus one, or 0 if the slot is not free, so that claim() takes slots out
+	/// of m_free in constant time
+	std::vector<std::uint32_t> m_free_positions;
+};
+
+/**
+ * @brief Associative container over generational IDs with contiguous storage.
+ *
+ * @details Elements are stored densely as (key, value) pairs, and a sparse array indexed by the slot index of the key
+ * points into the dense array. Lookups are thus a couple of array accesses, and the key stored in the dense array is
+ * compared to the looked up key, so that stale IDs with an outdated generation are not found.
+ * Erasure moves the last element into the erased spot: pointers and iterators to elements are invalidated by any
+ * insertion or erasure.
+ *
+ * @tparam Key An ID type that is explicitly convertible to and from an integer, e.g. ed::NodeId.
+ */
+template<class Key, class T>
+class SlotMap
+{
+public:
+	using value_type = std::pair<Key, T>;
+	using iterator = typename std::vector<value_type>::iterator;
+	using const_iterator = typename std::vector<value_type>::const_iterator;
+
+	/**
+	 * @brief Inserts a new element for \p key, which must not be present already.
+	 */
+	template<class... Args>
+	T& emplace(Key key, Args&&... args)
+	{
+		const std::uint32_t index = id_index(raw(key));
+
+		if (index >= m_sparse.size())
+		{
+			m_sparse.resize(std::size_t(index) + 1, npos);
+		}
+
+		if (m_sparse[index] != npos)
+		{
+			throw std::logic_error("SlotMap: slot is already occupied");
+		}
+
+		m_sparse[index] = std::uint32_t(m_dense.size());
+		m_dense.emplace_back(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+		return m_dense.back().second;
+	}
+
+	/**
+	 * @brief Erases the element for \p key, if any.
+	 * @details The erased value is destroyed only once the container is consistent again, so that destructors may
+	 * safely look up other elements of the container.
+	 * @return Whether an element was erased.
+	 */
+	bool erase(Key key)
+	{
+		const std::uint32_t dense_index = find_dense_index(key);
+
+		if (dense_index == npos)
+		{
+			return false;
+		}
+
+		// Destroyed when going out of scope
+		T erased = std::move(m_dense[dense_index].second);
+		(void)erased;
+
+		if (dense_index != m_dense.size() - 1)
+		{
+			m_dense[dense_index] = std::move(m_dense.back());
+			m_sparse[id_index(raw(m_dense[dense_index].first))] = dense_index;
+		}
+
+		m_dense.pop_back();
+		m_sparse[id_index(raw(key))] = npos;
+
+		return true;
+	}
+
+	T* find(Key key)
+	{
+		const std::uint32_t dense_index = find_dense_index(key);
+		return dense_index != npos ? &m_dense[dense_index].second : nullptr;
+	}
+
+	const T* find(Key key) const
+	{
+		const std::uint32_t dense_index = find_dense_index(key);
+		return dense_index != npos ? &m_dense[dense_index].second : nullptr;
+	}
+
+	T& at(Key key)
+	{
+		T* value = find(key);
+
+		if (value == nullptr)
+		{
+			throw std::out_of_range("SlotMap: key not found");
+		}
+
+		return *value;
+	}
+
+	bool contains(Key key) const
+	{
+		return find_dense_index(key) != npos;
+	}
+
+	void reserve(std::size_t count)
+	{
+		m_dense.reserve(count);
+	}
+
+	void clear()
+	{
+		m_sparse.clear();
+		m_dense.clear();
+	}
+
+	std::size_t size() const { return m_dense.size(); }
+	bool empty() const { return m_dense.empty(); }
+
+	iterator begin() { return m_dense.begin(); }
+	iterator end() { return m_dense.end(); }
+	const_iterator begin() const { return m_dense.begin(); }
+	const_iterator end() const { return m_dense.end(); }
+
+private:
+	static constexpr std::uint32_t npos = std::numeric_limits<std::uint32_t>::max();
+
+	static std::uint64_t raw(Key key)
+	{
+		return std::uint64_t(std::uintptr_t(key));
+	}
+
+	std::uint32_t find_dense_index(Key key) const
+	{
+		const std::uint32_t index = id_index(raw(key));
+
+		if (index >= m_sparse.size())
+		{
+			return npos;
+		}
+
+		const std::uint32_t dense_index = m_sparse[index];
+
+		if (dense_index == npos || raw(m_dense[dense_index].first) != raw(key))
+		{
+			return npos;
+		}
+
+		return dense_index;
+	}
+
+	std::vector<std::uint32_t> m_sparse;
+	std::vector<value_type> m_dense;
+};
+
+template<class Key, class T>
+constexpr std::uint32_t SlotMap<Key, T>::npos;
+
+}
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <onidev/core/span.h>
+
+namespace fsme
+{
+namespace detail
+{
+
+/**
+ * @brief Growable contiguous text buffer to format into, which is meant to be written out in one go.
+ *
+ * @details Unlike std::ostream, integers are formatted without going through locales, and nothing is allocated once the
+ * buffer is large enough: clear() keeps the capacity, so a writer reused for several outputs stops allocating after the
+ * largest one.
+ */
+class TextWriter
+{
+public:
+	void write(const char* data, std::size_t size)
+	{
+		m_text.insert(m_text.end(), data, data + size);
+	}
+
+	void write(od::gsl::span<const char> text)
+	{
+		write(text.data(), std::size_t(text.size()));
+	}
+
+	void write(const std::string& text)
+	{
+		write(text.data(), text.size());
+	}
+
+	/**
+	 * @brief Writes the characters of \p text up to its null terminator.
+	 */
+	void write_c_string(const char* text)
+	{
+		write(text, std::strlen(text));
+	}
+
+	void write(char c)
+	{
+		m_text.push_back(c);
+	}
+
+	/**
+	 * @brief Writes \p value in decimal.
+	 */
+	void write_uint(std::uint64_t value)
+	{
+		char digits[20];
+		char* first = digits + sizeof(digits);
+
+		do
+		{
+			*--first = char('0' + value % 10);
+			value /= 10;
+		} while (value != 0);
+
+		write(first, std::size_t(digits + sizeof(digits) - first));
+	}
+
+	void reserve(std::size_t size)
+	{
+		m_text.reserve(size);
+	}
+
+	/**
+	 * @brief Empties the buffer, keeping its capacity.
+	 */
+	void clear()
+	{
+		m_text.clear();
+	}
+
+	/**
+	 * @brief Writes the contents of the buffer to \p output with a single call.
+	 */
+	void flush_to(std::ostream& output) const
+	{
+		output.write(m_text.data(), std::streamsize(m_text.size()));
+	}
+
+	std::size_t size() const { return m_text.size(); }
+	const char* data() const { return m_text.data(); }
+
+	std::vector<char>& text() { return m_text; }
+	const std::vector<char>& text() const { return m_text; }
+
+private:
+	std::vector<char> m_text;
+};
+
+}
+}
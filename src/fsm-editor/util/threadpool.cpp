@@ -0,0 +1,91 @@
+#include "threadpool.hpp"
+
+#include <algorithm>
+
+namespace fsme
+{
+namespace detail
+{
+
+ThreadPool::ThreadPool(std::size_t thread_count)
+{
+	if (thread_count == 0)
+	{
+		// hardware_concurrency() may return 0 when it cannot tell
+		thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+
+	m_workers.reserve(thread_count);
+
+	for (std::size_t i = 0; i < thread_count; ++i)
+	{
+		m_workers.emplace_back(&ThreadPool::run, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+
+	m_task_available.notify_all();
+
+	for (std::thread& worker : m_workers)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::submit(Task task)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_tasks.push_back(std::move(task));
+	}
+
+	m_task_available.notify_one();
+}
+
+void ThreadPool::wait() const
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_idle.wait(lock, [this] { return m_tasks.empty() && m_busy == 0; });
+}
+
+void ThreadPool::run()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	for (;;)
+	{
+		m_task_available.wait(lock, [this] { return !m_tasks.empty() || m_stopping; });
+
+		if (m_tasks.empty())
+		{
+			return;
+		}
+
+		Task task = std::move(m_tasks.front());
+		m_tasks.pop_front();
+		++m_busy;
+
+		lock.unlock();
+		task();
+
+		// Release whatever the task holds on to before reporting it as complete
+		task = nullptr;
+		lock.lock();
+
+		--m_busy;
+
+		if (m_tasks.empty() && m_busy == 0)
+		{
+			m_idle.notify_all();
+		}
+	}
+}
+
+}
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace fsme
+{
+namespace detail
+{
+
+/**
+ * @brief Fixed set of worker threads that run tasks in the order they were submitted.
+ *
+ * @details Tasks must not throw, as there is nobody to report exceptions to: they should catch and report their own
+ * errors. Any task still pending when the pool is destroyed gets completed first.
+ */
+class ThreadPool
+{
+public:
+	using Task = std::function<void()>;
+
+	/**
+	 * @param thread_count Number of worker threads, or 0 for as many as the hardware can run concurrently.
+	 */
+	explicit ThreadPool(std::size_t thread_count = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	/**
+	 * @brief Queues \p task to be run on a worker thread, and returns immediately.
+	 */
+	void submit(Task task);
+
+	/**
+	 * @brief Blocks until all submitted tasks are complete.
+	 */
+	void wait() const;
+
+	std::size_t thread_count() const;
+
+private:
+	void run();
+
+	mutable std::mutex m_mutex;
+
+	/// @brief Notified when a task is submitted or the pool is destroyed
+	std::condition_variable m_task_available;
+
+	/// @brief Notified when the workers run out of tasks
+	mutable std::condition_variable m_idle;
+
+	std::deque<Task> m_tasks;
+
+	/// @brief Number of tasks being run
+	std::size_t m_busy = 0;
+
+	bool m_stopping = false;
+
+	std::vector<std::thread> m_workers;
+};
+
+inline std::size_t ThreadPool::thread_count() const
+{
+	return m_workers.size();
+}
+
+}
+}
@@ -0,0 +1,264 @@
+#include "topologicalorder.hpp"
+
+#include <algorithm>
+
+namespace fsme
+{
+namespace detail
+{
+
+void IncrementalTopologicalOrder::add_edge(ed::NodeId from, ed::NodeId to)
+{
+	create_vertex_if_missing(from);
+	create_vertex_if_missing(to);
+
+	Vertex& from_vertex = m_vertices.at(from);
+	Vertex& to_vertex = m_vertices.at(to);
+
+	from_vertex.successors.push_back(to);
+	to_vertex.predecessors.push_back(from);
+
+	if (m_has_cycle || from_vertex.order < to_vertex.order)
+	{
+		return;
+	}
+
+	// The edge goes backwards in the order: the nodes reachable from `to` that come before `from` need to be moved
+	// after the nodes that reach `from` and that come after `to`.
+	const std::int64_t lower_bound = to_vertex.order;
+	const std::int64_t upper_bound = from_vertex.order;
+
+	if (!search_forward(to, from, upper_bound))
+	{
+		m_has_cycle = true;
+		return;
+	}
+
+	search_backward(from, lower_bound);
+	reorder();
+}
+
+void IncrementalTopologicalOrder::remove_edge(ed::NodeId from, ed::NodeId to)
+{
+	Vertex* from_vertex = m_vertices.find(from);
+	Vertex* to_vertex = m_vertices.find(to);
+
+	if (from_vertex == nullptr || to_vertex == nullptr)
+	{
+		return;
+	}
+
+	const auto successor_it = std::find(from_vertex->successors.begin(), from_vertex->successors.end(), to);
+	if (successor_it == from_vertex->successors.end())
+	{
+		return;
+	}
+
+	from_vertex->successors.erase(successor_it);
+	to_vertex->predecessors.erase(std::find(to_vertex->predecessors.begin(), to_vertex->predecessors.end(), from));
+
+	destroy_vertex_if_isolated(from);
+	destroy_vertex_if_isolated(to);
+}
+
+bool IncrementalTopologicalOrder::reaches(ed::NodeId from, ed::NodeId to) const
+{
+	if (from == to)
+	{
+		return true;
+	}
+
+	const Vertex* from_vertex = m_vertices.find(from);
+	const Vertex* to_vertex = m_vertices.find(to);
+
+	if (from_vertex == nullptr || to_vertex == nullptr)
+	{
+		return false;
+	}
+
+	if (!m_has_cycle && from_vertex->order > to_vertex->order)
+	{
+		return false;
+	}
+
+	const std::uint32_t stamp = new_stamp();
+
+	m_stack.clear();
+	m_stack.push_back(from);
+	from_vertex->stamp = stamp;
+
+	while (!m_stack.empty())
+	{
+		const Vertex& vertex = *m_vertices.find(m_stack.back());
+		m_stack.pop_back();
+
+		for (const ed::NodeId successor : vertex.successors)
+		{
+			if (successor == to)
+			{
+				return true;
+			}
+
+			const Vertex& successor_vertex = *m_vertices.find(successor);
+
+			// Nodes that come after the target in the order cannot reach it
+			if (successor_vertex.stamp == stamp || (!m_has_cycle && successor_vertex.order > to_vertex->order))
+			{
+				continue;
+			}
+
+			successor_vertex.stamp = stamp;
+			m_stack.push_back(successor);
+		}
+	}
+
+	return false;
+}
+
+void IncrementalTopologicalOrder::clear()
+{
+	m_vertices.clear();
+	m_next_order = 0;
+	m_has_cycle = false;
+}
+
+void IncrementalTopologicalOrder::create_vertex_if_missing(ed::NodeId id)
+{
+	if (!m_vertices.contains(id))
+	{
+		// Appending a vertex without edges at the end of the order keeps it valid
+		m_vertices.emplace(id).order = m_next_order++;
+	}
+}
+
+void IncrementalTopologicalOrder::destroy_vertex_if_isolated(ed::NodeId id)
+{
+	// Both ends of a self-loop are the same vertex, which may be destroyed already
+	const Vertex* vertex = m_vertices.find(id);
+
+	if (vertex != nullptr && vertex->successors.empty() && vertex->predecessors.empty())
+	{
+		m_vertices.erase(id);
+	}
+}
+
+std::uint32_t IncrementalTopologicalOrder::new_stamp() const
+{
+	if (++m_last_stamp == 0)
+	{
+		// Stamps wrapped around: forget about old searches so that no vertex is wrongly considered visited
+		for (const auto& p : m_vertices)
+		{
+			p.second.stamp = 0;
+		}
+
+		m_last_stamp = 1;
+	}
+
+	return m_last_stamp;
+}
+
+bool IncrementalTopologicalOrder::search_forward(ed::NodeId start, ed::NodeId target, std::int64_t upper_bound)
+{
+	const std::uint32_t stamp = new_stamp();
+
+	m_forward.clear();
+	m_stack.clear();
+
+	m_stack.push_back(start);
+	m_vertices.at(start).stamp = stamp;
+
+	while (!m_stack.empty())
+	{
+		const ed::NodeId id = m_stack.back();
+		m_stack.pop_back();
+		m_forward.push_back(id);
+
+		for (const ed::NodeId successor : m_vertices.at(id).successors)
+		{
+			if (successor == target)
+			{
+				return false;
+			}
+
+			const Vertex& successor_vertex = m_vertices.at(successor);
+
+			if (successor_vertex.stamp != stamp && successor_vertex.order < upper_bound)
+			{
+				successor_vertex.stamp = stamp;
+				m_stack.push_back(successor);
+			}
+		}
+	}
+
+	return true;
+}
+
+void IncrementalTopologicalOrder::search_backward(ed::NodeId start, std::int64_t lower_bound)
+{
+	const std::uint32_t stamp = new_stamp();
+
+	m_backward.clear();
+	m_stack.clear();
+
+	m_stack.push_back(start);
+	m_vertices.at(start).stamp = stamp;
+
+	while (!m_stack.empty())
+	{
+		const ed::NodeId id = m_stack.back();
+		m_stack.pop_back();
+		m_backward.push_back(id);
+
+		for (const ed::NodeId predecessor : m_vertices.at(id).predecessors)
+		{
+			const Vertex& predecessor_vertex = m_vertices.at(predecessor);
+
+			if (predecessor_vertex.stamp != stamp && predecessor_vertex.order > lower_bound)
+			{
+				predecessor_vertex.stamp = stamp;
+				m_stack.push_back(predecessor);
+			}
+		}
+	}
+}
+
+void IncrementalTopologicalOrder::reorder()
+{
+	const auto by_order = [this](ed::NodeId a, ed::NodeId b) {
+		return m_vertices.at(a).order < m_vertices.at(b).order;
+	};
+
+	std::sort(m_backward.begin(), m_backward.end(), by_order);
+	std::sort(m_forward.begin(), m_forward.end(), by_order);
+
+	// Reuse the order slots of the affected vertices, giving the first ones to the vertices that reach `from`
+	m_orders.clear();
+
+	for (const ed::NodeId id : m_backward)
+	{
+		m_orders.push_back(m_vertices.at(id).order);
+	}
+
+	for (const ed::NodeId id : m_forward)
+	{
+		m_orders.push_back(m_vertices.at(id).order);
+	}
+
+	std::sort(m_orders.begin(), m_orders.end());
+
+	std::size_t i = 0;
+
+	for (const ed::NodeId id : m_backward)
+	{
+		m_vertices.at(id).order = m_orders[i++];
+	}
+
+	for (const ed::NodeId id : m_forward)
+	{
+		m_vertices.at(id).order = m_orders[i++];
+	}
+}
+
+}
+}
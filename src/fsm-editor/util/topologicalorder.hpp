@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "imgui.hpp"
+#include "slotmap.hpp"
+
+namespace fsme
+{
+namespace detail
+{
+
+/**
+ * @brief Directed acyclic graph over node IDs that maintains a topological order as edges are inserted and removed.
+ *
+ * @details The order is maintained using the dynamic topological sort algorithm of Pearce and Kelly: inserting an edge
+ * that already agrees with the order is constant time, and otherwise only the nodes between both ends of the edge in
+ * the order get visited and reordered. Removing an edge never invalidates the order.
+ *
+ * The order allows answering reachability queries quickly: a node can only reach nodes that come after it, so
+ * searches are pruned to the nodes between both ends of the query, and most negative queries need no search at all.
+ *
+ * Vertices are created along with their first edge and destroyed along with their last.
+ */
+class IncrementalTopologicalOrder
+{
+public:
+	void add_edge(ed::NodeId from, ed::NodeId to);
+
+	/**
+	 * @brief Removes one edge between \p from and \p to, if any.
+	 */
+	void remove_edge(ed::NodeId from, ed::NodeId to);
+
+	/**
+	 * @brief Returns whether there is a path from \p from to \p to. Nodes always reach themselves.
+	 * @details Searches reuse internal buffers, so this does not allocate once these are large enough.
+	 */
+	bool reaches(ed::NodeId from, ed::NodeId to) const;
+
+	void clear();
+
+	std::size_t vertex_count() const;
+
+private:
+	struct Vertex
+	{
+		std::int64_t order = 0;
+		std::vector<ed::NodeId> successors;
+		std::vector<ed::NodeId> predecessors;
+
+		/// @brief Marks the vertex as visited by the search that uses the same stamp
+		mutable std::uint32_t stamp = 0;
+	};
+
+	void create_vertex_if_missing(ed::NodeId id);
+	void destroy_vertex_if_isolated(ed::NodeId id);
+
+	std::uint32_t new_stamp() const;
+
+	bool search_forward(ed::NodeId start, ed::NodeId target, std::int64_t upper_bound);
+	void search_backward(ed::NodeId start, std::int64_t lower_bound);
+	void reorder();
+
+	SlotMap<ed::NodeId, Vertex> m_vertices;
+	std::int64_t m_next_order = 0;
+
+	/**
+	 * @brief Whether a cycle was ever inserted, in which case the order is not maintained anymore and reachability
+	 * queries fall back to unpruned searches.
+	 */
+	bool m_has_cycle = false;
+
+	mutable std::uint32_t m_last_stamp = 0;
+	mutable std::vector<ed::NodeId> m_stack;
+
+	std::vector<ed::NodeId> m_forward, m_backward;
+	std::vector<std::int64_t> m_orders;
+};
+
+inline std::size_t IncrementalTopologicalOrder::vertex_count() const
+{
+	return m_vertices.size();
+}
+
+}
+}
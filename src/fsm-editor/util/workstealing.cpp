@@ -0,0 +1,93 @@
+#include "workstealing.hpp"
+
+namespace fsme
+{
+namespace detail
+{
+
+namespace
+{
+
+std::uint64_t make_bounds(std::uint32_t begin, std::uint32_t end)
+{
+	return (std::uint64_t(end) << 32) | begin;
+}
+
+std::uint32_t get_begin(std::uint64_t bounds)
+{
+	return std::uint32_t(bounds & 0xFFFFFFFF);
+}
+
+std::uint32_t get_end(std::uint64_t bounds)
+{
+	return std::uint32_t(bounds >> 32);
+}
+
+}
+
+WorkStealingRanges::WorkStealingRanges(std::size_t worker_count, std::size_t item_count) :
+	m_worker_count(worker_count != 0 ? worker_count : 1),
+	m_ranges(new Range[m_worker_count])
+{
+	for (std::size_t i = 0; i < m_worker_count; ++i)
+	{
+		const std::uint32_t begin = std::uint32_t(item_count * i / m_worker_count);
+		const std::uint32_t end = std::uint32_t(item_count * (i + 1) / m_worker_count);
+		m_ranges[i].bounds.store(make_bounds(begin, end), std::memory_order_relaxed);
+	}
+}
+
+bool WorkStealingRanges::next(std::size_t worker, std::size_t& item)
+{
+	return take_own(worker, item) || steal(worker, item);
+}
+
+bool WorkStealingRanges::take_own(std::size_t worker, std::size_t& item)
+{
+	std::atomic<std::uint64_t>& range = m_ranges[worker].bounds;
+	std::uint64_t bounds = range.load(std::memory_order_acquire);
+
+	while (get_begin(bounds) < get_end(bounds))
+	{
+		const std::uint32_t begin = get_begin(bounds);
+
+		if (range.compare_exchange_weak(bounds, make_bounds(begin + 1, get_end(bounds)), std::memory_order_acq_rel))
+		{
+			item = begin;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool WorkStealingRanges::steal(std::size_t worker, std::size_t& item)
+{
+	for (std::size_t i = 1; i < m_worker_count; ++i)
+	{
+		std::atomic<std::uint64_t>& victim = m_ranges[(worker + i) % m_worker_count].bounds;
+		std::uint64_t bounds = victim.load(std::memory_order_acquire);
+
+		while (get_begin(bounds) < get_end(bounds))
+		{
+			const std::uint32_t begin = get_begin(bounds);
+			const std::uint32_t end = get_end(bounds);
+
+			// The thief takes the back half, rounded up so that a single item left can be stolen too
+			const std::uint32_t middle = begin + (end - begin) / 2;
+
+			if (victim.compare_exchange_weak(bounds, make_bounds(begin, middle), std::memory_order_acq_rel))
+			{
+				// Only the owner takes from its range, and thieves skip it while it is empty, as it is now
+				m_ranges[worker].bounds.store(make_bounds(middle + 1, end), std::memory_order_release);
+				item = middle;
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace fsme
+{
+namespace detail
+{
+
+/**
+ * @brief Hands out the items of a range of indices to a fixed number of workers, which steal from each other once
+ * they run out of items of their own.
+ *
+ * @details The range is split evenly between the workers up front. A worker takes items from the front of its own
+ * range, and once that is empty, takes the back half of the range of another worker. Ranges are single atomic words,
+ * so neither taking nor stealing locks anything.
+ * Items are only ever moved from one worker to another, so a worker that finds every range empty can stop: the items
+ * left are being run by the workers that took them.
+ */
+class WorkStealingRanges
+{
+public:
+	/**
+	 * @param item_count Number of items, which must fit in 32 bits.
+	 */
+	WorkStealingRanges(std::size_t worker_count, std::size_t item_count);
+
+	WorkStealingRanges(const WorkStealingRanges&) = delete;
+	WorkStealingRanges& operator=(const WorkStealingRanges&) = delete;
+
+	/**
+	 * @brief Takes the next item for \p worker, stealing from other workers if needed.
+	 * @return false once there is no item left to take.
+	 */
+	bool next(std::size_t worker, std::size_t& item);
+
+	std::size_t worker_count() const { return m_worker_count; }
+
+private:
+	/// @brief Range of a worker, with its first item in the lower 32 bits and its end in the upper 32 bits
+	struct Range
+	{
+		std::atomic<std::uint64_t> bounds;
+
+		/// @brief Keeps the ranges of different workers on different cache lines, without needing aligned new
+		char padding[64 - sizeof(std::atomic<std::uint64_t>)];
+	};
+
+	bool take_own(std::size_t worker, std::size_t& item);
+	bool steal(std::size_t worker, std::size_t& item);
+
+	std::size_t m_worker_count;
+
+	/// @brief One range per worker
+	std::unique_ptr<Range[]> m_ranges;
+};
+
+}
+}
@@ -2,8 +2,15 @@
 
 #include "../editor.hpp"
 #include "../nodes/nodes.hpp"
+#include "../simulation/stateminimizer.hpp"
 #include "../widgets/boolexprinput.hpp"
 #include "../util/idhash.hpp"
+#include "fsmcompiler.hpp"
+#include "nodekindfinder.hpp"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
 
 namespace fsme
 {
@@ -12,20 +19,178 @@ namespace visitors
 
 bool CentauriSerializer::serialize(std::ostream& output, Node& node)
 {
+	detail::TextWriter text;
+	const bool serialized = serialize(text, node);
+	text.flush_to(output);
+	return serialized;
+}
+
+std::size_t CentauriSerializer::serialize_states(std::ostream& output, FsmEditor& editor)
+{
+	detail::TextWriter text;
+	const std::size_t state_count = serialize_states(text, editor);
+	text.flush_to(output);
+	return state_count;
+}
+
+std::size_t CentauriSerializer::serialize_graph(
+	std::ostream& output,
+	FsmEditor& editor,
+	const CentauriGraphOptions& options)
+{
+	detail::TextWriter text;
+	const std::size_t state_count = serialize_graph(text, editor, options);
+	text.flush_to(output);
+	return state_count;
+}
+
+bool CentauriSerializer::serialize(detail::TextWriter& output, Node& node)
+{
+	// The export walks through nodes that may never have been shown
+	node.editor().load_all_node_payloads();
+
 	CentauriSerializer serializer(output);
-	node.accept(serializer);
+	serializer.m_pending_nodes.push_back(&node);
+	serializer.visit_pending();
 	return serializer.m_visited_root;
 }
 
+std::size_t CentauriSerializer::serialize_states(detail::TextWriter& output, FsmEditor& editor)
+{
+	editor.load_all_node_payloads();
+
+	const std::vector<nodes::StateNode*> states = get_states(editor);
+	CentauriSerializer serializer(output);
+
+	for (nodes::StateNode* state : states)
+	{
+		// Each state is serialized on its own, as done by serialize(), but reusing the memory of the serializer
+		serializer.m_visited_nodes.clear();
+		serializer.m_visited_root = false;
+
+		serializer.emit_root(*state);
+		serializer.m_pending_nodes.push_back(state);
+		serializer.visit_pending();
+	}
+
+	return states.size();
+}
+
+std::size_t CentauriSerializer::serialize_graph(
+	detail::TextWriter& output,
+	FsmEditor& editor,
+	const CentauriGraphOptions& options,
+	detail::TextWriter* merge_report)
+{
+	editor.load_all_node_payloads();
+
+	const std::vector<nodes::StateNode*> states = get_states(editor);
+	CentauriSerializer serializer(output, true);
+
+	simulation::CompiledFsm fsm;
+	if (options.merge_equivalent_states || options.flatten_conditions)
+	{
+		fsm = FsmCompiler::compile(editor);
+	}
+
+	// First, as the keys of identical branches refer to the states that are emitted
+	if (options.merge_equivalent_states)
+	{
+		serializer.find_equivalent_states(fsm, merge_report);
+	}
+
+	if (options.flatten_conditions)
+	{
+		serializer.flatten_conditions(fsm, editor);
+	}
+
+	// Before identical branches, which must not include the nodes of If chains being reordered
+	if (options.profile != nullptr)
+	{
+		serializer.m_condition_order.find_orders(editor, *options.profile);
+	}
+
+	if (options.share_identical_branches)
+	{
+		serializer.find_identical_branches(states);
+	}
+
+	for (nodes::StateNode* state : states)
+	{
+		if (serializer.m_merged_states.contains(state->node_id()))
+		{
+			continue;
+		}
+
+		const std::uint32_t id = std::uintptr_t(state->node_id());
+		serializer.emit_state(*state);
+
+		if (const std::uint32_t* root = serializer.m_diagram_roots.find(state->node_id()))
+		{
+			if (*root != simulation::CompiledFsm::no_transition)
+			{
+				serializer.emit_entry(id, serializer.get_diagram_target_id(*root));
+				serializer.emit_diagram(*root);
+			}
+
+			continue;
+		}
+
+		for (const ed::PinId output_pin : state->outputs())
+		{
+			const std::uint32_t entry = serializer.get_node_id_for_pin(editor, output_pin);
+
+			if (entry != std::uint32_t(-1))
+			{
+				serializer.emit_entry(id, entry);
+			}
+		}
+
+		serializer.visit_outputs(*state);
+		serializer.visit_pending();
+	}
+
+	return states.size() - serializer.m_merged_states.size();
+}
+
 void CentauriSerializer::visit(nodes::CondNode& node)
 {
-	if (!m_visited_root && !mark_visited(node))
+	if (visit_representative(node) || !enter_conditional(node))
 	{
 		return;
 	}
 
 	const auto& editor = node.editor();
 
+	if (const std::vector<std::uint32_t>* order = m_condition_order.find_output_order(node.node_id()))
+	{
+		// Each output keeps the ID it is emitted with in order, but the first one tested goes by the ID of the node,
+		// which is the one the node is entered through
+		const auto get_id = [&](std::size_t position) -> std::uint32_t {
+			if (position == 0)
+			{
+				return std::uintptr_t(node.node_id());
+			}
+
+			return node.get_expression(node.outputs()[(*order)[position]]).get_id();
+		};
+
+		for (std::size_t position = 0; position < order->size(); ++position)
+		{
+			const ed::PinId& pin = node.outputs()[(*order)[position]];
+
+			emit_branch(
+				get_id(position),
+				node.get_expression(pin),
+				get_node_id_for_pin(editor, pin),
+				position + 1 < order->size() ? get_id(position + 1) : -1
+			);
+		}
+
+		visit_outputs(node);
+		return;
+	}
+
 	auto id = node.node_id();
 	for (long i = 0; i < node.outputs().size(); ++i)
 	{
@@ -37,7 +202,7 @@ void CentauriSerializer::visit(nodes::CondNode& node)
 
 		emit_branch(
 			std::uintptr_t(id),
-			expr.as_lua_expression(),
+			expr,
 			get_node_id_for_pin(editor, pin),
 			next_expr_id
 		);
@@ -50,8 +215,14 @@ void CentauriSerializer::visit(nodes::CondNode& node)
 
 void CentauriSerializer::visit(nodes::IfNode& node)
 {
-	if (!m_visited_root && !mark_visited(node))
+	if (visit_representative(node) || !enter_conditional(node))
+	{
+		return;
+	}
+
+	if (const ConditionOrderer::Chain* chain = m_condition_order.find_chain(node.node_id()))
 	{
+		emit_chain(*chain);
 		return;
 	}
 
@@ -59,7 +230,7 @@ void CentauriSerializer::visit(nodes::IfNode& node)
 
 	emit_branch(
 		std::uintptr_t(node.node_id()),
-		node.get_expression().as_lua_expression(),
+		node.get_expression(),
 		get_node_id_for_pin(editor, node.outputs()[0]),
 		get_node_id_for_pin(editor, node.outputs()[1])
 	);
@@ -69,6 +240,12 @@ void CentauriSerializer::visit(nodes::IfNode& node)
 
 void CentauriSerializer::visit(nodes::StateNode& node)
 {
+	// All of the states were emitted already
+	if (m_whole_graph)
+	{
+		return;
+	}
+
 	if (!mark_visited(node))
 	{
 		return;
@@ -81,20 +258,312 @@ void CentauriSerializer::visit(nodes::StateNode& node)
 	}
 	else
 	{
-		emit_state(std::uintptr_t(node.node_id()), node.get_name_input().get_text());
+		emit_state(node);
 	}
 }
 
-CentauriSerializer::CentauriSerializer(std::ostream& output) :
+CentauriSerializer::CentauriSerializer(detail::TextWriter& output, bool whole_graph) :
 	m_visited_root(false),
+	m_whole_graph(whole_graph),
 	m_out(&output)
 {}
 
-bool CentauriSerializer::mark_visited(const Node& node)
+std::vector<nodes::StateNode*> CentauriSerializer::get_states(FsmEditor& editor)
 {
-	const bool was_visited = m_visited_nodes.find(node.node_id()) != m_visited_nodes.end();
+	std::vector<nodes::StateNode*> states;
+	for (auto& p : editor.m_state.nodes)
+	{
+		if (NodeKindFinder::find(*p.second) == NodeKind::State)
+		{
+			states.push_back(static_cast<nodes::StateNode*>(p.second.get()));
+		}
+	}
+
+	// Nodes are not stored in any particular order, while the output should only depend on the graph
+	std::sort(states.begin(), states.end(), [](const nodes::StateNode* a, const nodes::StateNode* b) {
+		return std::uintptr_t(a->node_id()) < std::uintptr_t(b->node_id());
+	});
+
+	return states;
+}
+
+void CentauriSerializer::find_identical_branches(const std::vector<nodes::StateNode*>& states)
+{
+	// Post-order walk, each node being on the stack once to queue the nodes it leads to, then once again to be keyed
+	// after all of them were. m_visited_nodes holds the nodes entered so far, and is cleared for the emission.
+	std::vector<std::pair<Node*, bool>> stack;
+
+	if (!states.empty())
+	{
+		// Conditional nodes get a key each, and have an expression per output
+		const std::size_t node_count = states.front()->editor().m_state.nodes.size();
+		m_representatives_by_key.reserve(node_count);
+		m_expression_ids.reserve(node_count);
+	}
+
+	const auto push_outputs = [&stack](Node& node) {
+		const std::size_t first_pushed = stack.size();
+
+		for (const ed::PinId& output : node.outputs())
+		{
+			for (const auto& link : node.editor().get_pin_info(output)->links)
+			{
+				stack.emplace_back(node.editor().get_node_by_pin_id(link.pins.to), false);
+			}
+		}
+
+		std::reverse(stack.begin() + first_pushed, stack.end());
+	};
 
-	if (was_visited)
+	for (nodes::StateNode* state : states)
+	{
+		push_outputs(*state);
+
+		while (!stack.empty())
+		{
+			Node& node = *stack.back().first;
+			const bool outputs_done = stack.back().second;
+
+			if (outputs_done)
+			{
+				stack.pop_back();
+
+				// The IDs of the nodes of a reordered If chain are relabeled by emit_chain(), so no other node may be
+				// redirected to them
+				if (m_condition_order.is_in_chain(node.node_id()))
+				{
+					continue;
+				}
+
+				write_branch_key(node);
+
+				// Looked up first, as emplacing would copy the key even when it is already there
+				auto found = m_representatives_by_key.find(m_key);
+				if (found == m_representatives_by_key.end())
+				{
+					found = m_representatives_by_key.emplace(m_key, &node).first;
+				}
+
+				// Nodes on a cycle were made their own representative when the cycle was found
+				Node* const representative = found->second;
+				if (!m_representatives.contains(node.node_id()))
+				{
+					m_representatives.emplace(node.node_id(), representative);
+				}
+
+				continue;
+			}
+
+			if (!NodeKindFinder::is_conditional(node) || m_representatives.contains(node.node_id()))
+			{
+				stack.pop_back();
+				continue;
+			}
+
+			// The nodes of a reordered If chain are emitted together from its first node, so none of them can stand
+			// for another node, nor be replaced by one
+			if (m_condition_order.is_in_chain(node.node_id()))
+			{
+				m_representatives.emplace(node.node_id(), &node);
+			}
+
+			if (m_visited_nodes.contains(node.node_id()))
+			{
+				// Reached again while its own outputs are being keyed: the nodes on the cycle cannot be keyed after
+				// the nodes they lead to, so this one is kept as is, and the others get keys that include its ID
+				stack.pop_back();
+				m_representatives.emplace(node.node_id(), &node);
+				continue;
+			}
+
+			m_visited_nodes.insert(node.node_id());
+			stack.back().second = true;
+			push_outputs(node);
+		}
+	}
+
+	m_visited_nodes.clear();
+}
+
+void CentauriSerializer::find_equivalent_states(const simulation::CompiledFsm& fsm, detail::TextWriter* report)
+{
+	const simulation::StateMapping mapping = simulation::StateMinimizer::minimize(fsm);
+
+	for (std::uint32_t state = 0; state < fsm.state_count(); ++state)
+	{
+		const std::uint32_t representative = mapping.representatives[state];
+		if (representative == state)
+		{
+			continue;
+		}
+
+		m_merged_states.emplace(fsm.state_nodes[state], fsm.state_nodes[representative]);
+
+		if (report != nullptr)
+		{
+			report->write_uint(std::uint32_t(std::uintptr_t(fsm.state_nodes[state])));
+			report->write(" merged ", 8);
+			report->write_uint(std::uint32_t(std::uintptr_t(fsm.state_nodes[representative])));
+			report->write(' ');
+			report->write_c_string(fsm.state_names[state].c_str());
+			report->write('\n');
+		}
+	}
+}
+
+void CentauriSerializer::flatten_conditions(const simulation::CompiledFsm& fsm, FsmEditor& editor)
+{
+	// Options are the first inputs, the other ones being plain Lua expressions, see FsmCompiler
+	const widgets::BoolExpressionAutocomplete* autocomplete = editor.get_autocomplete_provider();
+	const std::size_t option_count = autocomplete != nullptr ? autocomplete->option_count() : 0;
+
+	m_fsm = &fsm;
+	m_diagram = std::make_unique<simulation::DecisionDiagram>(fsm, option_count);
+	m_first_diagram_id = editor.m_state.ids.high_water() + 1;
+
+	m_input_expressions.resize(option_count);
+	for (std::uint32_t i = 0; i < option_count; ++i)
+	{
+		m_input_expressions[i] = &autocomplete->get_option(i).lua_expression;
+	}
+
+	for (std::uint32_t state = 0; state < fsm.state_count(); ++state)
+	{
+		std::uint32_t root;
+		if (!m_merged_states.contains(fsm.state_nodes[state]) && m_diagram->add_state(state, root))
+		{
+			m_diagram_roots.emplace(fsm.state_nodes[state], root);
+		}
+	}
+
+	m_emitted_diagram_nodes.assign(m_diagram->nodes().size(), false);
+}
+
+void CentauriSerializer::emit_diagram(std::uint32_t root)
+{
+	const std::vector<simulation::DecisionDiagram::Node>& nodes = m_diagram->nodes();
+	std::vector<std::uint32_t>& pending = m_pending_diagram_nodes;
+
+	pending.push_back(root);
+
+	while (!pending.empty())
+	{
+		const std::uint32_t index = pending.back();
+		pending.pop_back();
+
+		if ((index & simulation::CompiledFsm::state_flag) != 0 || m_emitted_diagram_nodes[index])
+		{
+			continue;
+		}
+
+		m_emitted_diagram_nodes[index] = true;
+
+		const simulation::DecisionDiagram::Node& node = nodes[index];
+		emit_test(
+			m_first_diagram_id + index,
+			*m_input_expressions[node.input],
+			get_diagram_target_id(node.on_true),
+			get_diagram_target_id(node.on_false)
+		);
+
+		// Depth-first, the true target first, like the branches of the graph
+		pending.push_back(node.on_false);
+		pending.push_back(node.on_true);
+	}
+}
+
+std::uint32_t CentauriSerializer::get_diagram_target_id(std::uint32_t target) const
+{
+	if (target == simulation::CompiledFsm::no_transition)
+	{
+		return -1;
+	}
+
+	if ((target & simulation::CompiledFsm::state_flag) == 0)
+	{
+		return m_first_diagram_id + target;
+	}
+
+	const ed::NodeId state = m_fsm->state_nodes[target & ~simulation::CompiledFsm::state_flag];
+	const ed::NodeId* merged_state = m_merged_states.find(state);
+	return std::uintptr_t(merged_state != nullptr ? *merged_state : state);
+}
+
+void CentauriSerializer::write_branch_key(Node& node)
+{
+	const auto& editor = node.editor();
+	m_key.clear();
+
+	// The key holds the branches as they would be emitted, with the IDs of the node itself left out: a single CondNode
+	// output and an IfNode with no false branch are emitted alike, so they get the same key
+	if (NodeKindFinder::find(node) == NodeKind::If)
+	{
+		auto& if_node = static_cast<nodes::IfNode&>(node);
+
+		m_key.push_back(1);
+		m_key.push_back(intern_expression(if_node.get_expression()));
+		m_key.push_back(get_node_id_for_pin(editor, node.outputs()[0]));
+		m_key.push_back(get_node_id_for_pin(editor, node.outputs()[1]));
+		return;
+	}
+
+	auto& cond_node = static_cast<nodes::CondNode&>(node);
+
+	m_key.push_back(std::uint32_t(node.outputs().size()));
+
+	for (const ed::PinId& pin : node.outputs())
+	{
+		m_key.push_back(intern_expression(cond_node.get_expression(pin)));
+		m_key.push_back(get_node_id_for_pin(editor, pin));
+	}
+
+	m_key.push_back(std::uint32_t(-1));
+}
+
+std::uint32_t CentauriSerializer::intern_expression(const widgets::BoolExpressionInput& expression)
+{
+	m_expression_text.clear();
+	expression.write_lua_expression(m_expression_text);
+	m_expression_string.assign(m_expression_text.data(), m_expression_text.size());
+
+	// Looked up first, as emplacing would copy the text even when it is already there
+	auto found = m_expression_ids.find(m_expression_string);
+	if (found == m_expression_ids.end())
+	{
+		found = m_expression_ids.emplace(m_expression_string, std::uint32_t(m_expression_ids.size())).first;
+	}
+
+	return found->second;
+}
+
+std::size_t CentauriSerializer::BranchKeyHash::operator()(const BranchKey& key) const
+{
+	std::uint64_t hash = key.size();
+
+	for (std::uint32_t word : key)
+	{
+		hash = (hash ^ word) * 0x9E3779B97F4A7C15ull;
+		hash ^= hash >> 29;
+	}
+
+	return std::size_t(hash ^ (hash >> 32));
+}
+
+bool CentauriSerializer::visit_representative(Node& node)
+{
+	Node* const* representative = m_representatives.find(node.node_id());
+	if (representative == nullptr || *representative == &node)
+	{
+		return false;
+	}
+
+	m_pending_nodes.push_back(*representative);
+	return true;
+}
+
+bool CentauriSerializer::mark_visited(const Node& node)
+{
+	if (m_visited_nodes.contains(node.node_id()))
 	{
 		return false;
 	}
@@ -103,25 +572,140 @@ bool CentauriSerializer::mark_visited(const Node& node)
 	return true;
 }
 
+bool CentauriSerializer::enter_conditional(const Node& node)
+{
+	// When exporting a single state, branches are emitted again each time they are reached
+	if (m_visited_root && !m_whole_graph)
+	{
+		return true;
+	}
+
+	return mark_visited(node);
+}
+
 void CentauriSerializer::visit_outputs(Node& node)
 {
+	const std::size_t first_pending = m_pending_nodes.size();
+
 	for (const ed::PinId& output : node.outputs())
 	{
-		for (const auto& link : node.editor().get_pin_info(output)->links)
+		queue_links(node, output);
+	}
+
+	// Visit the nodes in the order they are linked in, like a recursive walk would
+	std::reverse(m_pending_nodes.begin() + first_pending, m_pending_nodes.end());
+}
+
+void CentauriSerializer::queue_links(const Node& node, ed::PinId output)
+{
+	for (const auto& link : node.editor().get_pin_info(output)->links)
+	{
+		m_pending_nodes.push_back(node.editor().get_node_by_pin_id(link.pins.to));
+	}
+}
+
+void CentauriSerializer::emit_chain(const ConditionOrderer::Chain& chain)
+{
+	const auto& editor = chain.nodes.front()->editor();
+	const nodes::IfNode& last = *chain.nodes.back();
+
+	// Positions keep the IDs of the nodes, the first one being the one the chain is entered through, and the last one
+	// falls through to where the last node of the chain did
+	for (std::size_t position = 0; position < chain.nodes.size(); ++position)
+	{
+		nodes::IfNode& node = *chain.nodes[chain.order[position]];
+
+		emit_branch(
+			std::uintptr_t(chain.nodes[position]->node_id()),
+			node.get_expression(),
+			get_node_id_for_pin(editor, node.outputs()[0]),
+			position + 1 < chain.nodes.size()
+				? std::uintptr_t(chain.nodes[position + 1]->node_id())
+				: get_node_id_for_pin(editor, last.outputs()[1])
+		);
+
+		// The first node was marked by enter_conditional()
+		if (position != 0)
 		{
-			node.editor().get_node_by_pin_id(link.pins.to)->accept(*this);
+			mark_visited(*chain.nodes[position]);
 		}
 	}
+
+	const std::size_t first_pending = m_pending_nodes.size();
+
+	for (const std::uint32_t index : chain.order)
+	{
+		queue_links(*chain.nodes[index], chain.nodes[index]->outputs()[0]);
+	}
+
+	queue_links(last, last.outputs()[1]);
+	std::reverse(m_pending_nodes.begin() + first_pending, m_pending_nodes.end());
+}
+
+void CentauriSerializer::visit_pending()
+{
+	while (!m_pending_nodes.empty())
+	{
+		Node* node = m_pending_nodes.back();
+		m_pending_nodes.pop_back();
+		node->accept(*this);
+	}
+}
+
+void CentauriSerializer::emit_root(const nodes::StateNode& node)
+{
+	m_out->write_uint(std::uint32_t(std::uintptr_t(node.node_id())));
+	m_out->write(" root ", 6);
+	m_out->write_c_string(node.get_name_input().get_buffer().data());
+	m_out->write('\n');
+}
+
+void CentauriSerializer::emit_state(const nodes::StateNode& node)
+{
+	m_out->write_uint(std::uint32_t(std::uintptr_t(node.node_id())));
+	m_out->write(" state ", 7);
+	m_out->write_c_string(node.get_name_input().get_buffer().data());
+	m_out->write('\n');
 }
 
-void CentauriSerializer::emit_state(uint32_t id, const std::string& name)
+void CentauriSerializer::emit_entry(uint32_t id, uint32_t entry)
 {
-	*m_out << id << " state " << name << '\n';
+	m_out->write_uint(id);
+	m_out->write(" entry ", 7);
+	m_out->write_uint(entry);
+	m_out->write('\n');
 }
 
-void CentauriSerializer::emit_branch(uint32_t id, const std::string& lua_expression, uint32_t on_true, uint32_t on_false)
+void CentauriSerializer::emit_test(
+	uint32_t id,
+	const std::string& lua_expression,
+	uint32_t on_true,
+	uint32_t on_false)
 {
-	*m_out << id << " expr " << lua_expression << ' ' << on_true << ' ' << on_false << '\n';
+	m_out->write_uint(id);
+	m_out->write(" expr ", 6);
+	m_out->write(lua_expression);
+	m_out->write(' ');
+	m_out->write_uint(on_true);
+	m_out->write(' ');
+	m_out->write_uint(on_false);
+	m_out->write('\n');
+}
+
+void CentauriSerializer::emit_branch(
+	uint32_t id,
+	const widgets::BoolExpressionInput& expression,
+	uint32_t on_true,
+	uint32_t on_false)
+{
+	m_out->write_uint(id);
+	m_out->write(" expr ", 6);
+	expression.write_lua_expression(*m_out);
+	m_out->write(' ');
+	m_out->write_uint(on_true);
+	m_out->write(' ');
+	m_out->write_uint(on_false);
+	m_out->write('\n');
 }
 
 std::uint32_t CentauriSerializer::get_node_id_for_pin(const FsmEditor& editor, ed::PinId pin)
@@ -144,7 +728,17 @@ std::uint32_t CentauriSerializer::get_node_id_for_pin(const FsmEditor& editor, e
 
 	const PinPair& pair = pin_info->links[0].pins;
 
-	return std::uintptr_t(editor.get_node_by_pin_id(pin != pair.from ? pair.from : pair.to)->node_id());
+	// Only the ID of the node is needed, which the pin knows about without looking up the node itself
+	const ed::NodeId node_id = editor.get_pin_info(pin != pair.from ? pair.from : pair.to)->node_id;
+
+	const ed::NodeId* merged_state = m_merged_states.find(node_id);
+	if (merged_state != nullptr)
+	{
+		return std::uintptr_t(*merged_state);
+	}
+
+	Node* const* representative = m_representatives.find(node_id);
+	return std::uintptr_t(representative != nullptr ? (*representative)->node_id() : node_id);
 }
 
 }
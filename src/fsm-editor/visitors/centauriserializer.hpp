@@ -1,19 +1,61 @@
 #pragma once
 
 #include "../fwd.hpp"
+#include "../simulation/decisiondiagram.hpp"
+#include "../util/conditionprofile.hpp"
 #include "../visitor.hpp"
-#include "../util/idhash.hpp"
+#include "../util/idset.hpp"
+#include "../util/imgui.hpp"
+#include "../util/slotmap.hpp"
+#include "../util/textwriter.hpp"
+#include "conditionorderer.hpp"
 
+#include <memory>
 #include <ostream>
-#include <unordered_set>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace fsme
 {
 namespace visitors
 {
 
+/**
+ * @brief How CentauriSerializer::serialize_graph() lays out the graph.
+ */
+struct CentauriGraphOptions
+{
+	/// @brief Whether conditional nodes that are structurally identical, i.e. which have the same expressions and lead
+	/// to the same nodes once identical nodes are merged, are emitted only once. The other copies are then referred to
+	/// by the ID of the one that is emitted.
+	bool share_identical_branches = true;
+
+	/// @brief Whether states that are equivalent, as found by simulation::StateMinimizer, are emitted only once. The
+	/// other states are then left out, along with the branches only they reach, and transitions to them are emitted as
+	/// transitions to the one that is emitted.
+	bool merge_equivalent_states = false;
+
+	/// @brief Whether the branches of each state are emitted as a simulation::DecisionDiagram, whose `expr` lines each
+	/// test a single option of the autocomplete catalog, so that the options are tested at most once per step.
+	/// States whose conditions include plain Lua expressions, or whose diagram would grow too large, are emitted as
+	/// they would otherwise be.
+	bool flatten_conditions = false;
+
+	/// @brief If not null, how often each condition held, by which the outputs of CondNode nodes and the nodes of If
+	/// chains are reordered where this does not change which target is taken, see ConditionOrderer. The outputs
+	/// keep the IDs they were emitted with, except for the first output emitted, which goes by the ID of the node.
+	const detail::ConditionProfile* profile = nullptr;
+};
+
 /**
  * @brief Visitor to help serialize the FSM into the centauri FSM graph format.
+ *
+ * @details Nodes are walked depth-first through an explicit worklist rather than through recursion, so that long chains
+ * of conditions cannot overflow the stack.
+ * Output is formatted into a detail::TextWriter, which can be reused from one export to the next so that exporting
+ * does not allocate. The overloads that take a std::ostream format into a buffer of their own, then write it out with
+ * a single call.
  */
 class CentauriSerializer : public NodeVisitor
 {
@@ -24,27 +66,193 @@ public:
 	 * @param node An input node. If this is not a state node, serialization won't happen.
 	 * @return true if serialization could occur, i.e. if node was indeed a StateNode.
 	 */
+	[[nodiscard]] static bool serialize(detail::TextWriter& output, Node& node);
 	[[nodiscard]] static bool serialize(std::ostream& output, Node& node);
 
+	/**
+	 * @brief Serializes every StateNode of the graph in turn, by increasing ID, as done by serialize().
+	 * @details The serialization of each state is preceded by a `<id> root <name>` line, so that the states can be told
+	 * apart.
+	 * @return The number of states serialized.
+	 */
+	static std::size_t serialize_states(detail::TextWriter& output, FsmEditor& editor);
+	static std::size_t serialize_states(std::ostream& output, FsmEditor& editor);
+
+	/**
+	 * @brief Serializes the whole graph in a single pass, emitting every state and every branch exactly once, in time
+	 * linear in the size of the graph.
+	 * @details States are emitted by increasing ID, each as a `<id> state <name>` line, followed by a
+	 * `<id> entry <node>` line when its output is linked, then by the branches reached from it that were not emitted
+	 * yet. Branches that cannot be reached from any state are left out.
+	 * Nodes of decision diagrams, see CentauriGraphOptions::flatten_conditions, get IDs past those of the graph.
+	 * @param merge_report If not null and states are merged, receives a `<id> merged <id> <name>` line for each state
+	 * left out, giving the ID of the state emitted in its place.
+	 * @return The number of states serialized.
+	 * @throws std::runtime_error if states are to be merged or conditions flattened and the graph cannot be compiled,
+	 * see visitors::FsmCompiler::compile().
+	 */
+	static std::size_t serialize_graph(
+		detail::TextWriter& output,
+		FsmEditor& editor,
+		const CentauriGraphOptions& options = {},
+		detail::TextWriter* merge_report = nullptr
+	);
+	static std::size_t serialize_graph(std::ostream& output, FsmEditor& editor, const CentauriGraphOptions& options = {});
+
 	void visit(nodes::CondNode& node) override;
 	void visit(nodes::IfNode& node) override;
 	void visit(nodes::StateNode& node) override;
 
 private:
-	CentauriSerializer(std::ostream& output);
+	CentauriSerializer(detail::TextWriter& output, bool whole_graph = false);
+
+	/**
+	 * @brief Returns the state nodes of \p editor, sorted by ID.
+	 */
+	static std::vector<nodes::StateNode*> get_states(FsmEditor& editor);
+
+	/**
+	 * @brief Finds the conditional nodes reachable from \p states that are identical to another one, and which of the
+	 * copies stands for all of them.
+	 * @details Nodes are hash-consed bottom-up: the key of a node is built from its interned expressions and from the IDs
+	 * of the representatives of the nodes it leads to, so that identical subtrees of any depth end up with the same key.
+	 * Nodes that are part of a cycle of conditional nodes are conservatively kept as their own representative.
+	 */
+	void find_identical_branches(const std::vector<nodes::StateNode*>& states);
+
+	/**
+	 * @brief Finds the states of \p fsm that are equivalent to another one, and which of them stands for all of them,
+	 * writing the states left out to \p report if it is not null.
+	 */
+	void find_equivalent_states(const simulation::CompiledFsm& fsm, detail::TextWriter* report);
+
+	/**
+	 * @brief Builds the decision diagrams of the states of \p fsm that are emitted, for those that can be flattened.
+	 */
+	void flatten_conditions(const simulation::CompiledFsm& fsm, FsmEditor& editor);
+
+	/**
+	 * @brief Emits the nodes of the decision diagram reached from \p root that were not emitted yet.
+	 */
+	void emit_diagram(std::uint32_t root);
+
+	/**
+	 * @brief Returns the ID to emit for \p target, a target of a decision diagram.
+	 */
+	std::uint32_t get_diagram_target_id(std::uint32_t target) const;
+
+	/**
+	 * @brief Writes the structural key of the conditional node \p node to m_key.
+	 */
+	void write_branch_key(Node& node);
+
+	/**
+	 * @brief Returns the ID of the text of \p expression, the same for every expression with the same Lua text.
+	 */
+	std::uint32_t intern_expression(const widgets::BoolExpressionInput& expression);
+
+	/**
+	 * @brief Queues the representative of \p node instead of \p node, if it is not its own representative.
+	 * @return Whether \p node was replaced by its representative.
+	 */
+	bool visit_representative(Node& node);
 
 	bool mark_visited(const Node& node);
 
+	/**
+	 * @brief Returns whether the branches of a conditional node should be emitted, i.e. whether they were not already.
+	 */
+	bool enter_conditional(const Node& node);
+
+	/**
+	 * @brief Queues the nodes linked to the outputs of \p node, to be visited before the nodes queued so far.
+	 */
 	void visit_outputs(Node& node);
 
-	void emit_state(std::uint32_t id, const std::string& name);
-	void emit_branch(std::uint32_t id, const std::string& lua_expression, std::uint32_t on_true, std::uint32_t on_false);
+	/**
+	 * @brief Pushes the nodes linked to \p output, an output of \p node, to m_pending_nodes.
+	 */
+	void queue_links(const Node& node, ed::PinId output);
+
+	/**
+	 * @brief Emits the nodes of \p chain in the order found for them, then queues the nodes they lead to.
+	 */
+	void emit_chain(const ConditionOrderer::Chain& chain);
+
+	/**
+	 * @brief Visits queued nodes until there are none left.
+	 */
+	void visit_pending();
 
+	void emit_root(const nodes::StateNode& node);
+	void emit_state(const nodes::StateNode& node);
+	void emit_entry(std::uint32_t id, std::uint32_t entry);
+	void emit_test(std::uint32_t id, const std::string& lua_expression, std::uint32_t on_true, std::uint32_t on_false);
+	void emit_branch(
+		std::uint32_t id,
+		const widgets::BoolExpressionInput& expression,
+		std::uint32_t on_true,
+		std::uint32_t on_false
+	);
+
+	/**
+	 * @brief Returns the ID to emit for the node linked to \p pin, i.e. the ID of its representative or of the state it
+	 * was merged into if it has one, or -1 if \p pin is not linked.
+	 */
 	std::uint32_t get_node_id_for_pin(const FsmEditor& editor, ed::PinId pin);
 
-	std::unordered_set<ed::NodeId> m_visited_nodes;
+	detail::IdSet<ed::NodeId> m_visited_nodes;
+
+	/// @brief Copy of each conditional node that is emitted in its place, see find_identical_branches()
+	detail::SlotMap<ed::NodeId, Node*> m_representatives;
+
+	/// @brief State emitted in place of each state left out, see find_equivalent_states()
+	detail::SlotMap<ed::NodeId, ed::NodeId> m_merged_states;
+
+	/// @brief Decision diagrams of the flattened states, see flatten_conditions()
+	std::unique_ptr<simulation::DecisionDiagram> m_diagram;
+	detail::SlotMap<ed::NodeId, std::uint32_t> m_diagram_roots;
+	std::vector<bool> m_emitted_diagram_nodes;
+	std::vector<std::uint32_t> m_pending_diagram_nodes;
+
+	/// @brief Compiled graph the diagrams refer to, the Lua expression of each of its inputs, and the ID of the first
+	/// diagram node
+	const simulation::CompiledFsm* m_fsm = nullptr;
+	std::vector<const std::string*> m_input_expressions;
+	std::uint32_t m_first_diagram_id = 0;
+
+	/// @brief Order in which to emit conditions, see CentauriGraphOptions::profile
+	ConditionOrderer m_condition_order;
+
+	/// @brief Structural key of a conditional node: its output count, the interned expression and the target ID of each
+	/// output, then -1
+	using BranchKey = std::vector<std::uint32_t>;
+
+	struct BranchKeyHash
+	{
+		std::size_t operator()(const BranchKey& key) const;
+	};
+
+	/// @brief Representative of each distinct conditional node, by structural key
+	std::unordered_map<BranchKey, Node*, BranchKeyHash> m_representatives_by_key;
+
+	/// @brief Key of the last node passed to write_branch_key(), reused from one node to the next
+	BranchKey m_key;
+
+	/// @brief ID of each distinct Lua expression, see intern_expression(), and the buffers its text is written to
+	std::unordered_map<std::string, std::uint32_t> m_expression_ids;
+	detail::TextWriter m_expression_text;
+	std::string m_expression_string;
+
+	/// @brief Nodes left to visit, the next one at the back
+	std::vector<Node*> m_pending_nodes;
+
 	bool m_visited_root;
-	std::ostream* m_out;
+
+	/// @brief Whether states are emitted up front, rather than when reached, see serialize_graph()
+	bool m_whole_graph;
+
+	detail::TextWriter* m_out;
 };
 
 }
@@ -0,0 +1,276 @@
+#include "conditionorderer.hpp"
+
+#include "../editor.hpp"
+#include "../nodes/nodes.hpp"
+#include "../util/idset.hpp"
+#include "../widgets/boolexprinput.hpp"
+#include "nodekindfinder.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+namespace fsme
+{
+namespace visitors
+{
+
+namespace
+{
+
+/**
+ * @brief Returns the ID of the node linked to \p pin, or -1 if it is not linked.
+ */
+std::uint32_t get_linked_node(const FsmEditor& editor, ed::PinId pin)
+{
+	const PinInfo* pin_info = editor.get_pin_info(pin);
+
+	if (pin_info == nullptr || pin_info->links.empty())
+	{
+		return -1;
+	}
+
+	return std::uintptr_t(editor.get_pin_info(pin_info->links[0].pins.to)->node_id);
+}
+
+}
+
+void ConditionOrderer::find_orders(FsmEditor& editor, const detail::ConditionProfile& profile)
+{
+	m_editor = &editor;
+	m_output_orders.clear();
+	m_chains.clear();
+	m_chain_nodes.clear();
+
+	// Nodes linked from the false output of another IfNode are found first, so that chains are only walked from their
+	// first node
+	detail::IdSet<ed::NodeId> chained_nodes;
+
+	for (auto& p : editor.m_state.nodes)
+	{
+		if (NodeKindFinder::find(*p.second) == NodeKind::If)
+		{
+			if (nodes::IfNode* next = get_next_in_chain(static_cast<nodes::IfNode&>(*p.second)))
+			{
+				chained_nodes.insert(next->node_id());
+			}
+		}
+	}
+
+	for (auto& p : editor.m_state.nodes)
+	{
+		Node& node = *p.second;
+
+		switch (NodeKindFinder::find(node))
+		{
+		case NodeKind::Cond:
+			find_output_order(static_cast<nodes::CondNode&>(node), profile);
+			break;
+
+		case NodeKind::If:
+			if (!chained_nodes.contains(node.node_id()))
+			{
+				find_chain_order(static_cast<nodes::IfNode&>(node), profile);
+			}
+			break;
+
+		default:
+			break;
+		}
+	}
+}
+
+const std::vector<std::uint32_t>* ConditionOrderer::find_output_order(ed::NodeId node) const
+{
+	return m_output_orders.find(node);
+}
+
+const ConditionOrderer::Chain* ConditionOrderer::find_chain(ed::NodeId node) const
+{
+	return m_chains.find(node);
+}
+
+void ConditionOrderer::find_output_order(nodes::CondNode& node, const detail::ConditionProfile& profile)
+{
+	m_conditions.clear();
+
+	for (long i = 0; i < node.outputs().size(); ++i)
+	{
+		const ed::PinId pin = node.outputs()[i];
+		widgets::BoolExpressionInput& expression = node.get_expression(pin);
+
+		// As emitted by CentauriSerializer, the first output goes by the ID of the node
+		const std::uint32_t id = i == 0 ? std::uintptr_t(node.node_id()) : expression.get_id();
+		add_condition(expression, get_linked_node(*m_editor, pin), id, profile);
+	}
+
+	if (order_conditions())
+	{
+		m_output_orders.emplace(node.node_id(), m_order);
+	}
+}
+
+void ConditionOrderer::find_chain_order(nodes::IfNode& head, const detail::ConditionProfile& profile)
+{
+	Chain chain;
+
+	for (nodes::IfNode* node = &head; node != nullptr; node = get_next_in_chain(*node))
+	{
+		chain.nodes.push_back(node);
+	}
+
+	if (chain.nodes.size() < 2)
+	{
+		return;
+	}
+
+	m_conditions.clear();
+
+	for (nodes::IfNode* node : chain.nodes)
+	{
+		const std::uint32_t target = get_linked_node(*m_editor, node->outputs()[0]);
+		add_condition(node->get_expression(), target, std::uint32_t(std::uintptr_t(node->node_id())), profile);
+	}
+
+	if (!order_conditions())
+	{
+		return;
+	}
+
+	chain.order = m_order;
+
+	for (nodes::IfNode* node : chain.nodes)
+	{
+		m_chain_nodes.emplace(node->node_id(), head.node_id());
+	}
+
+	m_chains.emplace(head.node_id(), std::move(chain));
+}
+
+nodes::IfNode* ConditionOrderer::get_next_in_chain(nodes::IfNode& node) const
+{
+	const PinInfo* pin_info = m_editor->get_pin_info(node.outputs()[1]);
+
+	if (pin_info == nullptr || pin_info->links.size() != 1)
+	{
+		return nullptr;
+	}
+
+	Node* next = m_editor->get_node_by_pin_id(pin_info->links[0].pins.to);
+
+	if (next == &node || NodeKindFinder::find(*next) != NodeKind::If)
+	{
+		return nullptr;
+	}
+
+	// Moving the condition of a node that is also linked from elsewhere would change what it decides there
+	const PinInfo* input_info = m_editor->get_pin_info(next->inputs()[0]);
+	return input_info->links.size() == 1 ? static_cast<nodes::IfNode*>(next) : nullptr;
+}
+
+bool ConditionOrderer::order_conditions()
+{
+	m_order.resize(m_conditions.size());
+	for (std::uint32_t i = 0; i < m_order.size(); ++i)
+	{
+		m_order[i] = i;
+	}
+
+	bool changed = false;
+
+	// Each swap puts a pair of conditions in the right order, so this ends after a quadratic number of swaps at worst
+	for (bool swapped = true; swapped;)
+	{
+		swapped = false;
+
+		for (std::size_t position = 0; position + 1 < m_order.size(); ++position)
+		{
+			const Condition& first = m_conditions[m_order[position]];
+			const Condition& second = m_conditions[m_order[position + 1]];
+
+			// Compares the number of times each condition held per cost, without dividing by costs that may be 0
+			const bool better = double(second.holds) * first.cost > double(first.holds) * second.cost;
+
+			if (better && can_swap(position))
+			{
+				std::swap(m_order[position], m_order[position + 1]);
+				swapped = true;
+				changed = true;
+			}
+		}
+	}
+
+	return changed;
+}
+
+bool ConditionOrderer::can_swap(std::size_t position)
+{
+	const Condition& first = m_conditions[m_order[position]];
+	const Condition& second = m_conditions[m_order[position + 1]];
+
+	if (first.target == second.target)
+	{
+		return true;
+	}
+
+	// Inputs that hold when both conditions do
+	m_inputs.clear();
+	std::set_union(
+		first.inputs.begin(),
+		first.inputs.end(),
+		second.inputs.begin(),
+		second.inputs.end(),
+		std::back_inserter(m_inputs)
+	);
+
+	for (std::size_t i = 0; i < position; ++i)
+	{
+		const std::vector<std::string>& earlier = m_conditions[m_order[i]].inputs;
+
+		if (std::includes(m_inputs.begin(), m_inputs.end(), earlier.begin(), earlier.end()))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void ConditionOrderer::add_condition(
+	widgets::BoolExpressionInput& expression,
+	std::uint32_t target,
+	std::uint32_t id,
+	const detail::ConditionProfile& profile)
+{
+	Condition condition;
+	condition.target = target;
+	condition.cost = 0.0;
+
+	const detail::ConditionProfile::Counts* counts = profile.find(id);
+	condition.holds = counts != nullptr ? counts->holds : 0;
+
+	switch (expression.get_input_type())
+	{
+	case widgets::ExpressionInputType::PlainLuaExpression:
+		// Only known as a whole, like FsmCompiler does
+		condition.inputs.emplace_back(expression.get_raw_lua_input().text_buffer.data());
+		condition.cost = 1.0;
+		break;
+
+	case widgets::ExpressionInputType::SimpleExpression:
+		for (const widgets::BoolExpressionOption* option : expression.get_raw_simple_expression_input().options)
+		{
+			condition.inputs.push_back(option->lua_expression);
+			condition.cost += option->cost;
+		}
+		break;
+	}
+
+	std::sort(condition.inputs.begin(), condition.inputs.end());
+	condition.inputs.erase(std::unique(condition.inputs.begin(), condition.inputs.end()), condition.inputs.end());
+
+	m_conditions.push_back(std::move(condition));
+}
+
+}
+}
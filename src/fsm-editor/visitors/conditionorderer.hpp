@@ -0,0 +1,132 @@
+#pragma once
+
+#include "../fwd.hpp"
+#include "../util/conditionprofile.hpp"
+#include "../util/imgui.hpp"
+#include "../util/slotmap.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace fsme
+{
+namespace visitors
+{
+
+/**
+ * @brief Finds the order in which to test the outputs of each CondNode, and the IfNode nodes of each If chain, so that
+ * the conditions that hold most often and cost the least are tested first, according to a detail::ConditionProfile.
+ *
+ * @details An If chain is a sequence of IfNode nodes, each linked from the false output of the previous one and from
+ * nowhere else. Like the outputs of a CondNode, its conditions are tested in turn until one holds.
+ *
+ * Conditions are only moved where this provably does not change which target is taken. Neighboring conditions can be
+ * swapped when they lead to the same node, or when they cannot both hold once the conditions tested before them
+ * failed. Conditions being ANDs of inputs that are otherwise independent, the latter is the case exactly when an
+ * earlier condition only involves inputs of the two conditions, and would thus have held already. As conditions are
+ * only checked against those of the same node, this holds however the node is reached.
+ *
+ * Conditions are ordered by decreasing number of times they held per cost of the inputs they test, see
+ * widgets::BoolExpressionOption::cost, by swapping neighbors as long as this is allowed and improves the order.
+ */
+class ConditionOrderer
+{
+public:
+	/**
+	 * @brief Conditions tested in turn, as found in the graph.
+	 */
+	struct Chain
+	{
+		/// @brief Nodes of an If chain, the first one being the one linked from elsewhere
+		std::vector<nodes::IfNode*> nodes;
+
+		/// @brief Index within #nodes, or within the outputs of a CondNode, of the condition to test at each position
+		std::vector<std::uint32_t> order;
+	};
+
+	/**
+	 * @brief Finds the order of the conditions of every CondNode and If chain of \p editor, keeping those whose order
+	 * changes.
+	 */
+	void find_orders(FsmEditor& editor, const detail::ConditionProfile& profile);
+
+	/**
+	 * @brief Returns the order of the outputs of \p node, or nullptr if they are tested in order.
+	 */
+	const std::vector<std::uint32_t>* find_output_order(ed::NodeId node) const;
+
+	/**
+	 * @brief Returns the If chain starting at \p node, or nullptr if there is none, or if its order does not change.
+	 */
+	const Chain* find_chain(ed::NodeId node) const;
+
+	/**
+	 * @brief Returns whether \p node is part of an If chain whose order changes.
+	 */
+	bool is_in_chain(ed::NodeId node) const { return m_chain_nodes.contains(node); }
+
+	/**
+	 * @brief Returns the number of CondNode nodes and If chains whose order changes.
+	 */
+	std::size_t reordered_count() const { return m_output_orders.size() + m_chains.size(); }
+
+private:
+	struct Condition
+	{
+		/// @brief Lua expressions of the inputs that must all hold, sorted
+		std::vector<std::string> inputs;
+
+		/// @brief Node linked to when the condition holds, or -1 if none is
+		std::uint32_t target;
+
+		std::uint64_t holds;
+		double cost;
+	};
+
+	void find_output_order(nodes::CondNode& node, const detail::ConditionProfile& profile);
+	void find_chain_order(nodes::IfNode& head, const detail::ConditionProfile& profile);
+
+	/**
+	 * @brief Returns the IfNode linked from the false output of \p node that is linked from nowhere else, if any.
+	 */
+	nodes::IfNode* get_next_in_chain(nodes::IfNode& node) const;
+
+	/**
+	 * @brief Sets m_order to the order in which to test m_conditions.
+	 * @return Whether it differs from the order they are in.
+	 */
+	bool order_conditions();
+
+	/**
+	 * @brief Returns whether the conditions at positions \p position and \p position + 1 of m_order can be swapped.
+	 */
+	bool can_swap(std::size_t position);
+
+	/**
+	 * @brief Appends the condition of \p expression, leading to \p target and counted in \p profile as \p id.
+	 */
+	void add_condition(
+		widgets::BoolExpressionInput& expression,
+		std::uint32_t target,
+		std::uint32_t id,
+		const detail::ConditionProfile& profile
+	);
+
+	FsmEditor* m_editor = nullptr;
+
+	detail::SlotMap<ed::NodeId, std::vector<std::uint32_t>> m_output_orders;
+	detail::SlotMap<ed::NodeId, Chain> m_chains;
+
+	/// @brief Node each node of a reordered If chain starts at
+	detail::SlotMap<ed::NodeId, ed::NodeId> m_chain_nodes;
+
+	/// @brief Conditions being ordered, and the order found for them
+	std::vector<Condition> m_conditions;
+	std::vector<std::uint32_t> m_order;
+	std::vector<std::string> m_inputs;
+};
+
+}
+}
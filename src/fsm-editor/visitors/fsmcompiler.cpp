@@ -0,0 +1,331 @@
+#include "fsmcompiler.hpp"
+
+#include "../editor.hpp"
+#include "../widgets/boolexprinput.hpp"
+#include "nativedeserializer.hpp"
+
+#include <initializer_list>
+#include <stdexcept>
+
+namespace fsme
+{
+namespace visitors
+{
+
+using simulation::CompiledFsm;
+
+namespace
+{
+
+/// @brief Target of the nodes that were not reached yet, see FsmCompiler::m_targets
+constexpr std::uint32_t unreached = 0xFFFFFFFE;
+
+}
+
+CompiledFsm FsmCompiler::compile(GraphSnapshot snapshot, const widgets::BoolExpressionAutocomplete* autocomplete)
+{
+	// Conditions and state names are needed for nodes that may never have been shown
+	NativeDeserializer::load_payloads(snapshot);
+
+	CompiledFsm fsm;
+	FsmCompiler compiler(snapshot, autocomplete, fsm);
+
+	if (autocomplete != nullptr)
+	{
+		for (std::uint32_t i = 0; i < autocomplete->option_count(); ++i)
+		{
+			const std::string& shorthand = autocomplete->get_option(i).shorthand;
+			fsm.input_names.push_back(shorthand);
+			compiler.m_option_inputs.emplace(shorthand, i);
+		}
+	}
+
+	const auto& nodes = snapshot.nodes;
+
+	// Nodes of the snapshot are sorted by ID, and states are numbered up front, so that links to states do not need to
+	// look them up
+	for (std::uint32_t i = 0; i < nodes.size(); ++i)
+	{
+		const GraphSnapshot::Node& node = nodes[i];
+
+		for (std::uint32_t j = 0; j < node.input_count; ++j)
+		{
+			compiler.m_input_nodes.emplace(ed::PinId(std::uintptr_t(snapshot.inputs[node.first_input + j])), i);
+		}
+
+		if (node.type == native_format::NodeType::STATE)
+		{
+			const auto name = snapshot.get_text(node.name);
+
+			compiler.m_targets[i] = CompiledFsm::state_flag | std::uint32_t(fsm.state_nodes.size());
+			fsm.state_nodes.push_back(ed::NodeId(std::uintptr_t(node.id)));
+			fsm.state_names.emplace_back(name.begin(), name.end());
+		}
+	}
+
+	for (std::uint32_t i = 0; i < nodes.size(); ++i)
+	{
+		const GraphSnapshot::Node& state = nodes[i];
+
+		if (state.type != native_format::NodeType::STATE)
+		{
+			continue;
+		}
+
+		if (state.output_count == 0)
+		{
+			fsm.entries.push_back(CompiledFsm::no_transition);
+			fsm.entry_links.push_back(ed::LinkId());
+		}
+		else
+		{
+			const GraphSnapshot::Output& output = snapshot.outputs[state.first_output];
+			fsm.entries.push_back(compiler.get_target(output));
+			fsm.entry_links.push_back(compiler.get_link(output));
+		}
+
+		while (!compiler.m_pending_nodes.empty())
+		{
+			const std::uint32_t node_index = compiler.m_pending_nodes.back();
+			compiler.m_pending_nodes.pop_back();
+			compiler.compile_node(node_index);
+		}
+	}
+
+	compiler.check_no_loop();
+	compiler.compile_masks();
+
+	return fsm;
+}
+
+CompiledFsm FsmCompiler::compile(FsmEditor& editor)
+{
+	return compile(NativeSerializer::snapshot(editor), editor.get_autocomplete_provider());
+}
+
+FsmCompiler::FsmCompiler(
+	const GraphSnapshot& snapshot,
+	const widgets::BoolExpressionAutocomplete* autocomplete,
+	CompiledFsm& fsm
+) :
+	m_snapshot(snapshot),
+	m_fsm(fsm),
+	m_targets(snapshot.nodes.size(), unreached)
+{
+	m_input_nodes.reserve(snapshot.inputs.size());
+
+	if (autocomplete != nullptr)
+	{
+		m_option_inputs.reserve(autocomplete->option_count());
+	}
+}
+
+void FsmCompiler::compile_node(std::uint32_t node_index)
+{
+	const GraphSnapshot::Node& node = m_snapshot.nodes[node_index];
+	const std::uint32_t first_branch = m_targets[node_index];
+
+	if (node.type == native_format::NodeType::IF)
+	{
+		const GraphSnapshot::Output& on_true_output = m_snapshot.outputs[node.first_output];
+		const GraphSnapshot::Output& on_false_output = m_snapshot.outputs[node.first_output + 1];
+
+		compile_condition(first_branch, m_snapshot.expressions[node.first_expression]);
+
+		const std::uint32_t on_true = get_target(on_true_output);
+		const std::uint32_t on_false = get_target(on_false_output);
+		m_fsm.branches[first_branch].on_true = on_true;
+		m_fsm.branches[first_branch].on_false = on_false;
+		m_fsm.branch_links[2 * first_branch] = get_link(on_true_output);
+		m_fsm.branch_links[2 * first_branch + 1] = get_link(on_false_output);
+		return;
+	}
+
+	// A CondNode, which has one expression per output
+	for (std::uint32_t i = 0; i < node.output_count; ++i)
+	{
+		const GraphSnapshot::Output& output = m_snapshot.outputs[node.first_output + i];
+		const std::uint32_t index = first_branch + i;
+
+		compile_condition(index, m_snapshot.expressions[node.first_expression + i]);
+
+		// Reaching a new node appends its branches, which invalidates references to branches
+		const std::uint32_t on_true = get_target(output);
+		m_fsm.branches[index].on_true = on_true;
+		m_fsm.branches[index].on_false = i + 1 < node.output_count ? index + 1 : CompiledFsm::no_transition;
+		m_fsm.branch_links[2 * index] = get_link(output);
+	}
+}
+
+std::uint32_t FsmCompiler::get_target(const GraphSnapshot::Output& output)
+{
+	if (output.link_count == 0)
+	{
+		return CompiledFsm::no_transition;
+	}
+
+	if (output.link_count > 1)
+	{
+		throw std::runtime_error("An output is linked to more than one node");
+	}
+
+	const GraphSnapshot::Link& link = m_snapshot.links[output.first_link];
+	const std::uint32_t* node_index = m_input_nodes.find(ed::PinId(std::uintptr_t(link.to)));
+
+	if (node_index == nullptr)
+	{
+		throw std::runtime_error("A link leads to an unknown pin");
+	}
+
+	if (m_targets[*node_index] != unreached)
+	{
+		return m_targets[*node_index];
+	}
+
+	const GraphSnapshot::Node& node = m_snapshot.nodes[*node_index];
+	const ed::NodeId id(std::uintptr_t(node.id));
+	const std::size_t branch_count = node.type == native_format::NodeType::IF ? 1 : node.output_count;
+
+	// A CondNode without outputs never transitions
+	std::uint32_t target = CompiledFsm::no_transition;
+
+	if (branch_count != 0)
+	{
+		target = std::uint32_t(m_fsm.branches.size());
+		m_fsm.branches.resize(m_fsm.branches.size() + branch_count);
+		m_fsm.branch_nodes.resize(m_fsm.branch_nodes.size() + branch_count, id);
+		m_fsm.branch_links.resize(m_fsm.branch_links.size() + 2 * branch_count);
+		m_pending_nodes.push_back(*node_index);
+	}
+
+	m_targets[*node_index] = target;
+	return target;
+}
+
+ed::LinkId FsmCompiler::get_link(const GraphSnapshot::Output& output) const
+{
+	return output.link_count != 0 ? ed::LinkId(std::uintptr_t(m_snapshot.links[output.first_link].id)) : ed::LinkId();
+}
+
+void FsmCompiler::compile_condition(std::uint32_t index, const GraphSnapshot::Expression& expression)
+{
+	const std::uint32_t first_input = std::uint32_t(m_fsm.branch_inputs.size());
+
+	switch (widgets::ExpressionInputType(expression.input_type))
+	{
+	case widgets::ExpressionInputType::PlainLuaExpression:
+	{
+		m_fsm.branch_inputs.push_back(get_lua_input(expression.lua_expression));
+		break;
+	}
+
+	case widgets::ExpressionInputType::SimpleExpression:
+	{
+		for (std::uint32_t i = 0; i < expression.option_count; ++i)
+		{
+			const auto shorthand = m_snapshot.get_text(m_snapshot.option_shorthands[expression.first_option + i]);
+			const auto it = m_option_inputs.find(std::string(shorthand.begin(), shorthand.end()));
+
+			if (it != m_option_inputs.end())
+			{
+				m_fsm.branch_inputs.push_back(it->second);
+			}
+		}
+
+		break;
+	}
+	}
+
+	m_fsm.branches[index].first_input = first_input;
+	m_fsm.branches[index].input_count = std::uint32_t(m_fsm.branch_inputs.size()) - first_input;
+}
+
+std::uint32_t FsmCompiler::get_lua_input(GraphSnapshot::Text lua_expression)
+{
+	const auto chars = m_snapshot.get_text(lua_expression);
+	const auto inserted = m_lua_inputs.emplace(std::string(chars.begin(), chars.end()), std::uint32_t(m_fsm.input_names.size()));
+
+	if (inserted.second)
+	{
+		m_fsm.input_names.push_back(inserted.first->first);
+	}
+
+	return inserted.first->second;
+}
+
+void FsmCompiler::compile_masks()
+{
+	for (CompiledFsm::Branch& branch : m_fsm.branches)
+	{
+		branch.word = 0;
+		branch.condition = {0, 0};
+
+		for (std::uint32_t i = 0; i < branch.input_count; ++i)
+		{
+			const std::uint32_t input = m_fsm.branch_inputs[branch.first_input + i];
+
+			if (i != 0 && input / 64 != branch.word)
+			{
+				branch.word = CompiledFsm::several_words;
+				break;
+			}
+
+			branch.word = input / 64;
+			branch.condition.mask |= std::uint64_t(1) << (input % 64);
+		}
+
+		// Inputs are only ever required to be true
+		branch.condition.expected = branch.condition.mask;
+	}
+}
+
+void FsmCompiler::check_no_loop() const
+{
+	// Kahn's algorithm: branches are only ever reached from earlier ones when there is no loop
+	std::vector<std::uint32_t> in_degrees(m_fsm.branches.size(), 0);
+
+	for (const CompiledFsm::Branch& branch : m_fsm.branches)
+	{
+		for (const std::uint32_t target : {branch.on_true, branch.on_false})
+		{
+			if ((target & CompiledFsm::state_flag) == 0)
+			{
+				++in_degrees[target];
+			}
+		}
+	}
+
+	std::vector<std::uint32_t> ready;
+	for (std::uint32_t i = 0; i < in_degrees.size(); ++i)
+	{
+		if (in_degrees[i] == 0)
+		{
+			ready.push_back(i);
+		}
+	}
+
+	std::size_t ordered_count = 0;
+
+	while (!ready.empty())
+	{
+		const CompiledFsm::Branch& branch = m_fsm.branches[ready.back()];
+		ready.pop_back();
+		++ordered_count;
+
+		for (const std::uint32_t target : {branch.on_true, branch.on_false})
+		{
+			if ((target & CompiledFsm::state_flag) == 0 && --in_degrees[target] == 0)
+			{
+				ready.push_back(target);
+			}
+		}
+	}
+
+	if (ordered_count != m_fsm.branches.size())
+	{
+		throw std::runtime_error("Conditional logic contains a loop");
+	}
+}
+
+}
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "../fwd.hpp"
+#include "../simulation/compiledfsm.hpp"
+#include "../util/imgui.hpp"
+#include "../util/slotmap.hpp"
+#include "nativeserializer.hpp"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace fsme
+{
+namespace visitors
+{
+
+/**
+ * @brief Compiles the FSM graph into a simulation::CompiledFsm.
+ *
+ * @details Graphs are compiled from a GraphSnapshot, which does not refer to the editor, so that compiling can run on
+ * any thread while the graph keeps being edited.
+ * Like CentauriSerializer, nodes are walked through an explicit worklist rather than through recursion, so that long
+ * chains of conditions cannot overflow the stack. Each node is compiled once, however many links lead to it.
+ * The options of the autocomplete catalog are all inputs, whether they are used or not, so that input indices are the
+ * same for every graph edited with the same catalog. Options are found by their shorthand, and shorthands that the
+ * catalog does not know are ignored, like when a file is loaded.
+ */
+class FsmCompiler
+{
+public:
+	/**
+	 * @brief Compiles \p snapshot, decoding the node contents it left encoded first. States are numbered by increasing
+	 * ID.
+	 * @param autocomplete Catalog whose options are the first inputs, or nullptr if there is none.
+	 * @throws std::runtime_error if an output is linked to several nodes, if conditional logic contains a loop, or if
+	 * node contents are malformed.
+	 */
+	static simulation::CompiledFsm compile(GraphSnapshot snapshot, const widgets::BoolExpressionAutocomplete* autocomplete);
+
+	/**
+	 * @brief Compiles the whole graph of \p editor, with its autocomplete catalog.
+	 * @see compile(GraphSnapshot, const widgets::BoolExpressionAutocomplete*)
+	 */
+	static simulation::CompiledFsm compile(FsmEditor& editor);
+
+private:
+	FsmCompiler(
+		const GraphSnapshot& snapshot,
+		const widgets::BoolExpressionAutocomplete* autocomplete,
+		simulation::CompiledFsm& fsm
+	);
+
+	/**
+	 * @brief Compiles the branches of the IfNode or CondNode at \p node_index within the snapshot.
+	 */
+	void compile_node(std::uint32_t node_index);
+
+	/**
+	 * @brief Returns the target that \p output leads to, queuing the node it is linked to if it was not yet.
+	 */
+	std::uint32_t get_target(const GraphSnapshot::Output& output);
+
+	/**
+	 * @brief Returns the link from \p output, or 0 if it is not linked.
+	 */
+	ed::LinkId get_link(const GraphSnapshot::Output& output) const;
+
+	/**
+	 * @brief Sets the condition of the branch at \p index from \p expression.
+	 */
+	void compile_condition(std::uint32_t index, const GraphSnapshot::Expression& expression);
+
+	std::uint32_t get_lua_input(GraphSnapshot::Text lua_expression);
+
+	/**
+	 * @brief Sets the word and condition mask of every branch from its inputs, once all of the inputs are known.
+	 */
+	void compile_masks();
+
+	/**
+	 * @throws std::runtime_error if a branch can be reached again from itself.
+	 */
+	void check_no_loop() const;
+
+	const GraphSnapshot& m_snapshot;
+	simulation::CompiledFsm& m_fsm;
+
+	/// @brief Index within the snapshot of the node of each input pin, to follow links
+	detail::SlotMap<ed::PinId, std::uint32_t> m_input_nodes;
+
+	/// @brief Target of each node of the snapshot, i.e. its state or its first branch, for the nodes reached so far
+	std::vector<std::uint32_t> m_targets;
+
+	/// @brief Nodes reached whose branches were not compiled yet, the next one at the back
+	std::vector<std::uint32_t> m_pending_nodes;
+
+	/// @brief Input of each option of the autocomplete catalog, by shorthand
+	std::unordered_map<std::string, std::uint32_t> m_option_inputs;
+
+	std::unordered_map<std::string, std::uint32_t> m_lua_inputs;
+};
+
+}
+}
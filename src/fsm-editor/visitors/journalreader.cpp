@@ -0,0 +1,478 @@
+#include "journalreader.hpp"
+#include "nativedeserializer.hpp"
+#include "nativeserializer.hpp"
+
+#include "../editor.hpp"
+#include "../nodes/nodes.hpp"
+#include "../widgets/boolexprinput.hpp"
+#include "../util/checksum.hpp"
+#include "../util/slotmap.hpp"
+
+namespace fsme
+{
+namespace visitors
+{
+
+namespace
+{
+
+const char no_data = 0;
+
+/**
+ * @brief Reads the next record of \p in into \p record, or returns false if it is incomplete or corrupt.
+ */
+bool read_record(detail::ByteReader& in, od::gsl::span<const char>& record)
+{
+	if (in.remaining() < journal_format::record_header_size)
+	{
+		return false;
+	}
+
+	const auto size = in.read_memcpy<std::uint32_t>();
+	const auto checksum = in.read_memcpy<std::uint32_t>();
+
+	if (size == 0 || size > in.remaining())
+	{
+		return false;
+	}
+
+	record = in.read_span(size);
+	return detail::crc32(record) == checksum;
+}
+
+/**
+ * @brief Gives a new ID to the expressions whose ID is one of a sorted list of IDs, see FsmEditor::new_expression_id().
+ */
+class ExpressionIdReallocator : public NodeVisitor
+{
+public:
+	ExpressionIdReallocator(FsmEditor& editor, const std::vector<std::uint64_t>& ids) :
+		m_editor(&editor),
+		m_ids(&ids)
+	{}
+
+	void visit(nodes::CondNode& node) override
+	{
+		for (const ed::PinId output : node.outputs())
+		{
+			reallocate(node.get_expression(output));
+		}
+	}
+
+	void visit(nodes::IfNode& node) override
+	{
+		reallocate(node.get_expression());
+	}
+
+	void visit(nodes::StateNode&) override {}
+
+private:
+	void reallocate(widgets::BoolExpressionInput& expression)
+	{
+		if (std::binary_search(m_ids->begin(), m_ids->end(), std::uint64_t(expression.get_id())))
+		{
+			expression.set_id(m_editor->new_expression_id());
+		}
+	}
+
+	FsmEditor* m_editor;
+	const std::vector<std::uint64_t>* m_ids;
+};
+
+}
+
+bool JournalReader::applies_to(od::gsl::span<const char> journal, od::gsl::span<const char> base_file)
+{
+	if (std::size_t(journal.size()) < journal_format::header_size)
+	{
+		return false;
+	}
+
+	detail::ByteReader in(journal);
+
+	if (in.read_memcpy<std::uint32_t>() != journal_format::magic_header)
+	{
+		return false;
+	}
+
+	in.skip(2 * sizeof(std::uint16_t));
+
+	const auto checksum = in.read_memcpy<std::uint32_t>();
+	const auto size = in.read_memcpy<std::uint64_t>();
+
+	return size == std::uint64_t(base_file.size()) && checksum == detail::crc32(base_file);
+}
+
+std::size_t JournalReader::replay(FsmEditor& editor, od::gsl::span<const char> journal)
+{
+	detail::ByteReader in(journal);
+
+	if (
+		std::size_t(journal.size()) < journal_format::header_size
+		|| in.read_memcpy<std::uint32_t>() != journal_format::magic_header
+		|| in.read_memcpy<std::uint16_t>() != journal_format::version
+	)
+	{
+		throw std::runtime_error("Failed to replay journal: Not an autosave journal, or an unsupported version");
+	}
+
+	in.seek(journal_format::header_size);
+
+	JournalReader reader(editor);
+	std::size_t replayed_size = journal_format::header_size;
+	od::gsl::span<const char> record{&no_data, &no_data};
+
+	// A crash may leave a torn record behind, which is the end of the journal as far as we are concerned
+	while (read_record(in, record))
+	{
+		reader.apply(record);
+		replayed_size = std::size_t(journal.size()) - in.remaining();
+	}
+
+	reader.reallocate_expression_ids();
+
+	return replayed_size;
+}
+
+void JournalReader::apply_records(FsmEditor& editor, od::gsl::span<const char> records)
+{
+	detail::ByteReader in(records);
+	JournalReader reader(editor);
+	od::gsl::span<const char> record{&no_data, &no_data};
+
+	while (in.remaining() != 0)
+	{
+		if (!read_record(in, record))
+		{
+			throw std::runtime_error("Failed to apply journal records: Incomplete or corrupt record");
+		}
+
+		reader.apply(record);
+	}
+}
+
+void JournalReader::visit(nodes::CondNode& node)
+{
+	const std::size_t count = read_count();
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		const ed::PinId output = read_id();
+
+		if (node.output_pin_index(output) != -1)
+		{
+			read(node.get_expression(output));
+		}
+		else
+		{
+			// The output was destroyed by a later edit in the meantime: skip past its expression
+			widgets::BoolExpressionInput discarded(0);
+			read(discarded);
+		}
+	}
+}
+
+void JournalReader::visit(nodes::IfNode& node)
+{
+	read(node.get_expression());
+}
+
+void JournalReader::visit(nodes::StateNode& node)
+{
+	read_char_array(node.get_name_input().get_buffer());
+}
+
+JournalReader::JournalReader(FsmEditor& editor) :
+	m_editor(&editor),
+	m_in({&no_data, &no_data})
+{}
+
+void JournalReader::apply(od::gsl::span<const char> record)
+{
+	using journal_format::RecordType;
+
+	m_in = detail::ByteReader(record);
+
+	switch (m_in.read_memcpy<RecordType>())
+	{
+	case RecordType::NODE_CREATED:
+		read_node_created();
+		break;
+
+	case RecordType::NODE_DESTROYED:
+		m_editor->destroy_node(get_node(read_id()).node_id());
+		break;
+
+	case RecordType::PINS_CHANGED:
+		read_pins_changed();
+		break;
+
+	case RecordType::LINK_CREATED:
+		read_link_created();
+		break;
+
+	case RecordType::LINK_DESTROYED:
+	{
+		const ed::LinkId link = read_id();
+
+		if (m_editor->get_link_info(link) == nullptr)
+		{
+			throw std::runtime_error("Failed to replay journal: Destroying a link that does not exist");
+		}
+
+		m_editor->destroy_link(link);
+		break;
+	}
+
+	case RecordType::NODE_EDITED:
+	{
+		Node& node = get_node(read_id());
+
+		// The edit replaces the contents of the file, which must not be decoded over it later on
+		m_editor->load_node_payload(node.node_id());
+		node.accept(*this);
+		m_editor->notify_node_edited(node);
+		break;
+	}
+
+	default:
+		throw std::runtime_error("Failed to replay journal: Unknown record type");
+	}
+}
+
+void JournalReader::claim(std::uint64_t id)
+{
+	if (m_editor->m_state.ids.claim(id))
+	{
+		m_claimed_allocated_ids.push_back(id);
+	}
+}
+
+void JournalReader::reallocate_expression_ids()
+{
+	// Entities are checked not to exist before they are claimed, so only expressions may be using these IDs
+	if (m_claimed_allocated_ids.empty())
+	{
+		return;
+	}
+
+	std::sort(m_claimed_allocated_ids.begin(), m_claimed_allocated_ids.end());
+
+	ExpressionIdReallocator reallocator(*m_editor, m_claimed_allocated_ids);
+
+	for (auto& p : m_editor->m_state.nodes)
+	{
+		p.second->accept(reallocator);
+	}
+
+	m_claimed_allocated_ids.clear();
+}
+
+void JournalReader::read_node_created()
+{
+	auto& state = m_editor->m_state;
+
+	const auto node_type = m_in.read_memcpy<native_format::NodeType>();
+	const ed::NodeId node_id = read_id();
+
+	if (state.nodes.contains(node_id))
+	{
+		throw std::runtime_error("Failed to replay journal: Creating a node that already exists");
+	}
+
+	claim(std::uintptr_t(node_id));
+	auto node = make_node_from_type(node_id, node_type);
+
+	// The node created its default pins when constructed, but the journal knows which IDs they had (see
+	// NativeDeserializer for the same issue)
+	node->resize_pins(node->m_inputs, 0);
+	node->resize_pins(node->m_outputs, 0);
+
+	const auto read_pins = [&](std::vector<ed::PinId>& pins) {
+		const std::size_t count = read_count();
+
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			const ed::PinId pin = read_id();
+
+			if (state.pins.contains(pin))
+			{
+				throw std::runtime_error("Failed to replay journal: Creating a pin that already exists");
+			}
+
+			claim(std::uintptr_t(pin));
+			state.pins.emplace(pin, PinInfo{node_id, {}});
+			pins.push_back(pin);
+		}
+	};
+
+	read_pins(node->m_inputs);
+	read_pins(node->m_outputs);
+
+	Node& created_node = *node;
+	state.nodes.emplace(node_id, std::move(node));
+	m_editor->notify_node_created(created_node);
+}
+
+void JournalReader::read_pins_changed()
+{
+	auto& state = m_editor->m_state;
+
+	Node& node = get_node(read_id());
+	const auto side = m_in.read_memcpy<std::uint8_t>();
+
+	// The contents of a CondNode are stored per output, so they must be decoded before its outputs change
+	m_editor->load_node_payload(node.node_id());
+
+	if (side > 1)
+	{
+		throw std::runtime_error("Failed to replay journal: Invalid pin side");
+	}
+
+	auto& pins = side == 1 ? node.m_outputs : node.m_inputs;
+	const std::vector<ed::PinId> previous_pins = pins;
+
+	std::vector<ed::PinId> new_pins(read_count());
+	for (auto& pin : new_pins)
+	{
+		pin = read_id();
+	}
+
+	for (const ed::PinId pin : pins)
+	{
+		if (std::find(new_pins.begin(), new_pins.end(), pin) == new_pins.end())
+		{
+			m_editor->destroy_pin(pin);
+		}
+	}
+
+	for (const ed::PinId pin : new_pins)
+	{
+		if (std::find(pins.begin(), pins.end(), pin) != pins.end())
+		{
+			continue;
+		}
+
+		if (state.pins.contains(pin))
+		{
+			throw std::runtime_error("Failed to replay journal: Creating a pin that already exists");
+		}
+
+		claim(std::uintptr_t(pin));
+		state.pins.emplace(pin, PinInfo{node.node_id(), {}});
+	}
+
+	pins = std::move(new_pins);
+	m_editor->notify_pins_changed(node, side == 1 ? PinType::Output : PinType::Input, previous_pins);
+}
+
+void JournalReader::read_link_created()
+{
+	const ed::LinkId link = read_id();
+
+	PinPair pins;
+	pins.from = read_id();
+	pins.to = read_id();
+
+	if (m_editor->get_link_info(link) != nullptr)
+	{
+		throw std::runtime_error("Failed to replay journal: Creating a link that already exists");
+	}
+
+	if (m_editor->get_pin_info(pins.from) == nullptr || m_editor->get_pin_info(pins.to) == nullptr)
+	{
+		throw std::runtime_error("Failed to replay journal: Creating a link between pins that do not exist");
+	}
+
+	claim(std::uintptr_t(link));
+	m_editor->insert_link(link, pins);
+	m_editor->notify_link_created(link, pins);
+}
+
+std::uint64_t JournalReader::read_id()
+{
+	return m_in.read_varint();
+}
+
+std::size_t JournalReader::read_count()
+{
+	const std::uint64_t count = m_in.read_varint();
+
+	// All elements take at least one byte
+	if (count > m_in.remaining())
+	{
+		throw std::runtime_error("Failed to replay journal: Element count exceeds the size of the record");
+	}
+
+	return std::size_t(count);
+}
+
+od::gsl::span<const char> JournalReader::read_string()
+{
+	const std::uint64_t size = m_in.read_varint();
+
+	if (size > m_in.remaining())
+	{
+		throw std::runtime_error("Failed to replay journal: Unexpected end of record");
+	}
+
+	return m_in.read_span(std::size_t(size));
+}
+
+void JournalReader::read(widgets::BoolExpressionInput& expression)
+{
+	const auto input_type = m_in.read_memcpy<std::uint8_t>();
+
+	if (input_type > std::uint8_t(widgets::ExpressionInputType::SimpleExpression))
+	{
+		throw std::runtime_error("Failed to replay journal: Invalid expression input type");
+	}
+
+	expression.set_input_type(widgets::ExpressionInputType(input_type));
+	read_char_array(expression.get_raw_lua_input().text_buffer);
+
+	auto& options = expression.get_raw_simple_expression_input().options;
+	options.clear();
+
+	const std::size_t count = read_count();
+	auto* autocomplete = m_editor->get_autocomplete_provider();
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		// Always consume the shorthand, even when it cannot be resolved
+		const auto shorthand = read_string();
+		auto* option = autocomplete != nullptr ? autocomplete->find_by_shorthand(shorthand) : nullptr;
+
+		if (option != nullptr)
+		{
+			options.insert(option);
+		}
+	}
+}
+
+Node& JournalReader::get_node(ed::NodeId id)
+{
+	Node* node = m_editor->get_node_by_id(id);
+
+	if (node == nullptr)
+	{
+		throw std::runtime_error("Failed to replay journal: Referring to a node that does not exist");
+	}
+
+	return *node;
+}
+
+std::unique_ptr<Node> JournalReader::make_node_from_type(ed::NodeId id, native_format::NodeType node_type)
+{
+	switch (node_type)
+	{
+	case native_format::NodeType::STATE: return std::make_unique<nodes::StateNode>(*m_editor, id);
+	case native_format::NodeType::COND: return std::make_unique<nodes::CondNode>(*m_editor, id);
+	case native_format::NodeType::IF: return std::make_unique<nodes::IfNode>(*m_editor, id);
+	}
+
+	throw std::runtime_error("Failed to replay journal: Incorrect node type");
+}
+
+}
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "../fwd.hpp"
+#include "../visitor.hpp"
+#include "../util/bytebuffer.hpp"
+#include "../util/imgui.hpp"
+#include "../util/journalformat.hpp"
+#include "../util/nativeformat.hpp"
+
+#include <onidev/core/span.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace fsme
+{
+namespace visitors
+{
+
+/**
+ * @brief Replays the records of an autosave journal on top of a graph, e.g. to recover from a crash.
+ * @details Records carry the IDs of the entities they create, so that later records can refer to them: the replayed
+ * graph ends up with the same IDs as the graph the journal was written from, and these IDs are claimed from the ID
+ * allocator (see detail::IdPool::claim()) so that they are not handed out again. Expressions get their IDs as nodes
+ * are constructed, which may not happen in the same order as when the journal was written, so expressions whose ID
+ * gets claimed by a record are given a new one once the journal is replayed.
+ * Applying records notifies the observers of the editor like any other edit, see EditObserver.
+ * @see JournalWriter
+ */
+class JournalReader : public NodeVisitor
+{
+public:
+	/**
+	 * @brief Returns whether \p journal was written on top of the native file \p base_file.
+	 */
+	static bool applies_to(od::gsl::span<const char> journal, od::gsl::span<const char> base_file);
+
+	/**
+	 * @brief Replays all of the records of \p journal on top of the graph of \p editor, which should hold the native
+	 * file the journal applies to.
+	 * @details Replaying stops at the first incomplete or corrupt record, which may be left behind by a crash.
+	 * @return The size of the part of \p journal that was replayed, which is where new records should be appended.
+	 * @throws std::runtime_error if the journal is not a journal, or if a valid record cannot be applied to the graph.
+	 * The graph may then be partially replayed.
+	 */
+	static std::size_t replay(FsmEditor& editor, od::gsl::span<const char> journal);
+
+	/**
+	 * @brief Applies \p records, as written by a JournalWriter but without a journal header, e.g. to undo an edit.
+	 * @throws std::runtime_error if a record is incomplete, corrupt, or cannot be applied to the graph.
+	 */
+	static void apply_records(FsmEditor& editor, od::gsl::span<const char> records);
+
+	void visit(nodes::CondNode& node) override;
+	void visit(nodes::IfNode& node) override;
+	void visit(nodes::StateNode& node) override;
+
+private:
+	explicit JournalReader(FsmEditor& editor);
+
+	void apply(od::gsl::span<const char> record);
+
+	/**
+	 * @brief Claims \p id from the ID allocator, remembering it if it was allocated already, see
+	 * reallocate_expression_ids().
+	 */
+	void claim(std::uint64_t id);
+
+	/**
+	 * @brief Gives a new ID to the expressions whose ID was claimed by a record.
+	 */
+	void reallocate_expression_ids();
+
+	void read_node_created();
+	void read_pins_changed();
+	void read_link_created();
+
+	std::uint64_t read_id();
+
+	/**
+	 * @brief Reads an element count, checking that it does not exceed the remaining size of the record.
+	 */
+	std::size_t read_count();
+
+	od::gsl::span<const char> read_string();
+
+	/**
+	 * @brief Reads a string into a null-terminated character array.
+	 */
+	template<class T>
+	void read_char_array(T& container)
+	{
+		const auto text = read_string();
+
+		if (std::size_t(text.size()) >= container.size())
+		{
+			throw std::runtime_error("Failed to replay journal: String is too long");
+		}
+
+		std::copy(text.begin(), text.end(), container.begin());
+		container[std::size_t(text.size())] = '\0';
+	}
+
+	void read(widgets::BoolExpressionInput& expression);
+
+	Node& get_node(ed::NodeId id);
+
+	std::unique_ptr<Node> make_node_from_type(ed::NodeId id, native_format::NodeType node_type);
+
+	FsmEditor* m_editor;
+	detail::ByteReader m_in;
+
+	/// @brief IDs claimed by records that were allocated already, which expressions may be using
+	std::vector<std::uint64_t> m_claimed_allocated_ids;
+};
+
+}
+}
@@ -0,0 +1,188 @@
+#include "journalwriter.hpp"
+
+#include "../editor.hpp"
+#include "../nodes/nodes.hpp"
+#include "../widgets/boolexprinput.hpp"
+#include "../util/checksum.hpp"
+#include "../util/nativeformat.hpp"
+#include "nodekindfinder.hpp"
+
+#include <cstring>
+#include <utility>
+
+namespace fsme
+{
+namespace visitors
+{
+
+std::vector<char> JournalWriter::make_header(od::gsl::span<const char> base_file)
+{
+	detail::ByteWriter out;
+	out.write_memcpy(journal_format::magic_header);
+	out.write_memcpy(journal_format::version);
+	out.write_memcpy(std::uint16_t(0));
+	out.write_memcpy(detail::crc32(base_file));
+	out.write_memcpy(std::uint64_t(base_file.size()));
+	return std::move(out.bytes());
+}
+
+std::vector<char> JournalWriter::take_pending()
+{
+	std::vector<char> ret;
+	std::swap(ret, m_out.bytes());
+	return ret;
+}
+
+void JournalWriter::append_pending_to(std::vector<char>& out)
+{
+	out.insert(out.end(), m_out.data(), m_out.data() + m_out.size());
+	m_out.bytes().clear();
+}
+
+void JournalWriter::discard_pending()
+{
+	m_out.bytes().clear();
+}
+
+void JournalWriter::on_node_created(Node& node)
+{
+	native_format::NodeType type = native_format::NodeType::STATE;
+
+	switch (NodeKindFinder::find(node))
+	{
+	case NodeKind::State: type = native_format::NodeType::STATE; break;
+	case NodeKind::If: type = native_format::NodeType::IF; break;
+	case NodeKind::Cond: type = native_format::NodeType::COND; break;
+	}
+
+	begin_record(journal_format::RecordType::NODE_CREATED);
+	m_out.write_memcpy(type);
+	write_id(std::uintptr_t(node.node_id()));
+	write_pins(node.inputs());
+	write_pins(node.outputs());
+	end_record();
+}
+
+void JournalWriter::on_node_destroyed(Node& node)
+{
+	begin_record(journal_format::RecordType::NODE_DESTROYED);
+	write_id(std::uintptr_t(node.node_id()));
+	end_record();
+}
+
+void JournalWriter::on_pins_changed(Node& node, PinType side, od::gsl::span<const ed::PinId>)
+{
+	write_pins_changed(node, side, side == PinType::Output ? node.outputs() : node.inputs());
+}
+
+void JournalWriter::write_pins_changed(Node& node, PinType side, od::gsl::span<const ed::PinId> pins)
+{
+	begin_record(journal_format::RecordType::PINS_CHANGED);
+	write_id(std::uintptr_t(node.node_id()));
+	m_out.write_memcpy(std::uint8_t(side == PinType::Output ? 1 : 0));
+	write_pins(pins);
+	end_record();
+}
+
+void JournalWriter::on_link_created(ed::LinkId link, const PinPair& pins)
+{
+	begin_record(journal_format::RecordType::LINK_CREATED);
+	write_id(std::uintptr_t(link));
+	write_id(std::uintptr_t(pins.from));
+	write_id(std::uintptr_t(pins.to));
+	end_record();
+}
+
+void JournalWriter::on_link_destroyed(ed::LinkId link, const PinPair&)
+{
+	begin_record(journal_format::RecordType::LINK_DESTROYED);
+	write_id(std::uintptr_t(link));
+	end_record();
+}
+
+void JournalWriter::on_node_edited(Node& node)
+{
+	begin_record(journal_format::RecordType::NODE_EDITED);
+	write_id(std::uintptr_t(node.node_id()));
+	node.accept(*this);
+	end_record();
+}
+
+void JournalWriter::visit(nodes::CondNode& node)
+{
+	m_out.write_varint(node.outputs().size());
+
+	for (const auto& output : node.outputs())
+	{
+		write_id(std::uintptr_t(output));
+		write(node.get_expression(output));
+	}
+}
+
+void JournalWriter::visit(nodes::IfNode& node)
+{
+	write(node.get_expression());
+}
+
+void JournalWriter::visit(nodes::StateNode& node)
+{
+	const auto& buffer = node.get_name_input().get_buffer();
+	write_string(buffer.data(), std::strlen(buffer.data()));
+}
+
+void JournalWriter::begin_record(journal_format::RecordType type)
+{
+	m_record_begin = m_out.size();
+
+	m_out.write_memcpy(std::uint32_t(0));
+	m_out.write_memcpy(std::uint32_t(0));
+	m_out.write_memcpy(type);
+}
+
+void JournalWriter::end_record()
+{
+	const std::size_t contents_begin = m_record_begin + journal_format::record_header_size;
+	const od::gsl::span<const char> contents{m_out.data() + contents_begin, m_out.data() + m_out.size()};
+
+	m_out.overwrite_memcpy(m_record_begin, std::uint32_t(contents.size()));
+	m_out.overwrite_memcpy(m_record_begin + sizeof(std::uint32_t), detail::crc32(contents));
+}
+
+void JournalWriter::write_id(std::uint64_t id)
+{
+	m_out.write_varint(id);
+}
+
+void JournalWriter::write_pins(od::gsl::span<const ed::PinId> pins)
+{
+	m_out.write_varint(pins.size());
+
+	for (const ed::PinId pin : pins)
+	{
+		write_id(std::uintptr_t(pin));
+	}
+}
+
+void JournalWriter::write_string(const char* text, std::size_t size)
+{
+	m_out.write_varint(size);
+	m_out.write(text, size);
+}
+
+void JournalWriter::write(widgets::BoolExpressionInput& expression)
+{
+	const char* lua_expression = expression.get_raw_lua_input().text_buffer.data();
+	const auto& options = expression.get_raw_simple_expression_input().options;
+
+	m_out.write_memcpy(std::uint8_t(expression.get_input_type()));
+	write_string(lua_expression, std::strlen(lua_expression));
+
+	m_out.write_varint(options.size());
+	for (const widgets::BoolExpressionOption* option : options)
+	{
+		write_string(option->shorthand.data(), option->shorthand.size());
+	}
+}
+
+}
+}
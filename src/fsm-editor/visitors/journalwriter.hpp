@@ -0,0 +1,91 @@
+#pragma once
+
+#include "../fwd.hpp"
+#include "../visitor.hpp"
+#include "../editobserver.hpp"
+#include "../util/bytebuffer.hpp"
+#include "../util/journalformat.hpp"
+
+#include <onidev/core/span.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace fsme
+{
+namespace visitors
+{
+
+/**
+ * @brief Records edits to the graph as autosave journal records, see journal_format::magic_header for their layout.
+ * @details Records are buffered in memory until taken with take_pending(), so that observing an edit never touches
+ * the disk.
+ * @see JournalReader
+ */
+class JournalWriter : public NodeVisitor, public EditObserver
+{
+public:
+	/**
+	 * @brief Returns the header of a journal that applies on top of the native file \p base_file.
+	 */
+	static std::vector<char> make_header(od::gsl::span<const char> base_file);
+
+	/**
+	 * @brief Returns the records written since the last call, and forgets about them.
+	 */
+	std::vector<char> take_pending();
+
+	/**
+	 * @brief Appends the records written since the last call to take_pending() to \p out, and forgets about them.
+	 * @details Unlike take_pending(), this keeps the capacity of the internal buffer.
+	 */
+	void append_pending_to(std::vector<char>& out);
+
+	/**
+	 * @brief Forgets about the records written since the last call to take_pending().
+	 */
+	void discard_pending();
+
+	/**
+	 * @brief Writes a record setting the pins of one side of \p node to \p pins.
+	 */
+	void write_pins_changed(Node& node, PinType side, od::gsl::span<const ed::PinId> pins);
+
+	std::size_t pending_size() const;
+
+	void on_node_created(Node& node) override;
+	void on_node_destroyed(Node& node) override;
+	void on_pins_changed(Node& node, PinType side, od::gsl::span<const ed::PinId> previous_pins) override;
+	void on_link_created(ed::LinkId link, const PinPair& pins) override;
+	void on_link_destroyed(ed::LinkId link, const PinPair& pins) override;
+	void on_node_edited(Node& node) override;
+
+	void visit(nodes::CondNode& node) override;
+	void visit(nodes::IfNode& node) override;
+	void visit(nodes::StateNode& node) override;
+
+private:
+	/**
+	 * @brief Starts a record, whose size and checksum are filled in by end_record().
+	 */
+	void begin_record(journal_format::RecordType type);
+	void end_record();
+
+	void write_id(std::uint64_t id);
+	void write_pins(od::gsl::span<const ed::PinId> pins);
+	void write_string(const char* text, std::size_t size);
+	void write(widgets::BoolExpressionInput& expression);
+
+	detail::ByteWriter m_out;
+
+	/// @brief Offset of the record being written within m_out
+	std::size_t m_record_begin = 0;
+};
+
+inline std::size_t JournalWriter::pending_size() const
+{
+	return m_out.size();
+}
+
+}
+}
@@ -2,7 +2,8 @@
 
 #include "../nodes/nodes.hpp"
 #include "../editor.hpp"
-#include "predvisitor.hpp"
+
+#include <algorithm>
 
 namespace fsme
 {
@@ -119,9 +120,9 @@ void LinkVerifier::check_prevent_conditional_loop(Node& a_node)
 
 	if (a_node.pin_type(m_a) == PinType::Output)
 	{
-		Node& b_node = *editor.get_node_by_pin_id(m_b);
+		const Node& b_node = *editor.get_node_by_pin_id(m_b);
 
-		if (NodePredecessorFinder::find_in_cond_tree(a_node, b_node))
+		if (editor.is_predecessor_in_cond_tree(b_node.node_id(), a_node.node_id()))
 		{
 			m_feasibility = LinkFeasibility::CANNOT_LINK_TO_PREDECESSOR;
 		}
@@ -3,6 +3,14 @@
 #include "../editor.hpp"
 #include "../nodes/nodes.hpp"
 #include "../widgets/boolexprinput.hpp"
+#include "../util/checksum.hpp"
+
+#include <cmath>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
 
 // This place is not a place of honor.
 // No highly esteemed deed is commemorated here.
@@ -17,71 +25,511 @@ namespace visitors
 {
 
 void NativeDeserializer::deserialize(FsmEditor& editor, std::istream& input)
+{
+	auto bytes = std::make_shared<std::vector<char>>();
+
+	// Size the buffer up front when the stream is seekable, so that it is read with a single call
+	const auto start = input.tellg();
+	if (start != std::istream::pos_type(-1) && input.seekg(0, std::ios::end))
+	{
+		bytes->resize(std::size_t(input.tellg() - start));
+		input.seekg(start);
+		input.read(bytes->data(), bytes->size());
+		bytes->resize(std::size_t(input.gcount()));
+	}
+	else
+	{
+		input.clear();
+		bytes->assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+	}
+
+	deserialize_shared(editor, *bytes, bytes);
+}
+
+void NativeDeserializer::deserialize_file(FsmEditor& editor, const std::string& path)
+{
+	std::ifstream input(path, std::ios::binary);
+	if (!input)
+	{
+		throw std::runtime_error("Failed to open file: " + path);
+	}
+
+	deserialize(editor, input);
+}
+
+void NativeDeserializer::deserialize(FsmEditor& editor, od::gsl::span<const char> input)
+{
+	deserialize_shared(editor, input, nullptr);
+}
+
+void NativeDeserializer::load_payload(Node& node, od::gsl::span<const char> payload)
+{
+	const auto& pending = node.editor().m_state.pending_payloads;
+
+	NativeDeserializer deserializer(node.editor(), payload);
+	deserializer.m_version = pending.version;
+	deserializer.m_strings = &pending.strings;
+
+	node.accept(deserializer);
+}
+
+void NativeDeserializer::load_payloads(GraphSnapshot& snapshot)
+{
+	auto& pending = snapshot.pending_payloads;
+
+	if (pending.storage == nullptr)
+	{
+		return;
+	}
+
+	for (auto& node : snapshot.nodes)
+	{
+		if (node.payload.empty())
+		{
+			continue;
+		}
+
+		NativeDeserializer deserializer(node.payload);
+		deserializer.m_version = pending.version;
+		deserializer.m_strings = &pending.strings;
+
+		deserializer.read_payload(snapshot, node);
+		node.payload = {nullptr, 0};
+	}
+
+	// Release the loaded file once everything was decoded
+	pending.storage.reset();
+	pending.strings.clear();
+}
+
+void NativeDeserializer::deserialize_shared(
+	FsmEditor& editor,
+	od::gsl::span<const char> input,
+	std::shared_ptr<const void> storage
+)
 {
 	NativeDeserializer deserializer(editor, input);
 
-	editor.clear();
-	auto& state = editor.m_state;
+	// Reject inputs that are not native files before discarding the current graph
+	const auto magic = deserializer.read_memcpy<std::uint32_t>();
 
-	deserializer.expect_magic(native_format::magic_header);
+	if (magic == native_format::versioned_magic_header)
+	{
+		deserializer.m_version = deserializer.read_memcpy<std::uint16_t>();
 
-	state.last_allocated_id = deserializer.read_memcpy<std::uint64_t>();
+		if (deserializer.m_version != native_format::version_2 && deserializer.m_version != native_format::version_3)
+		{
+			throw std::runtime_error("Failed to deserialize: Unsupported version " + std::to_string(deserializer.m_version));
+		}
 
-	deserializer.expect_magic(native_format::pins_magic);
-	deserializer.read_container(state.pins, [&] {
-		ed::PinId pin_id = deserializer.read_memcpy<std::uint64_t>();
+		// Node contents are decoded after this returns, so they must outlive the input when the caller does not own it
+		if (storage == nullptr)
+		{
+			auto copy = std::make_shared<std::vector<char>>(input.begin(), input.end());
+			input = od::gsl::span<const char>(copy->data(), copy->data() + copy->size());
+			deserializer.m_in = detail::ByteReader(input);
+			deserializer.m_in.seek(sizeof(magic) + sizeof(deserializer.m_version));
+			storage = std::move(copy);
+		}
+	}
+	else if (magic != native_format::magic_header)
+	{
+		throw std::runtime_error("Unexpected magic value obtained");
+	}
 
-		PinInfo pin;
+	try
+	{
+		switch (deserializer.m_version)
+		{
+		case native_format::version_1: deserializer.read_v1(); break;
+		case native_format::version_2: deserializer.read_v2(input); break;
+		default: deserializer.read_v3(input); break;
+		}
 
-		deserializer.read_container(pin.links, [&] {
-			LinkInfo link;
-			link.id = deserializer.read_memcpy<std::uint64_t>();
-			link.pins.from = deserializer.read_memcpy<std::uint64_t>();
-			link.pins.to = deserializer.read_memcpy<std::uint64_t>();
-			pin.links.emplace_back(link);
-		});
+		deserializer.check_links();
+	}
+	catch (const std::runtime_error&)
+	{
+		// Do not leave a partially loaded graph behind
+		if (deserializer.m_cleared_editor)
+		{
+			editor.clear();
+		}
+
+		throw;
+	}
+
+	editor.m_state.pending_payloads.storage = std::move(storage);
+	editor.rebuild_cond_tree_index();
+}
 
-		pin.node_id = deserializer.read_memcpy<std::uint64_t>();
-		state.pins.emplace(std::make_pair(pin_id, pin));
+void NativeDeserializer::read_v1()
+{
+	const auto id_high_water = read_memcpy<std::uint64_t>();
+	m_id_high_water = id_high_water;
+
+	m_editor->clear();
+	m_cleared_editor = true;
+	m_editor->m_state.ids.reset(std::uint32_t(id_high_water));
+
+	expect_magic(native_format::pins_magic);
+	read_pins();
+
+	expect_magic(native_format::links_magic);
+	read_links();
+
+	expect_magic(native_format::nodes_magic);
+	read_container(m_editor->m_state.nodes, sizeof(native_format::NodeType) + 3 * sizeof(std::uint64_t), [&] {
+		Node& node = read_node();
+		node.accept(*this);
 	});
+}
 
-	deserializer.expect_magic(native_format::links_magic);
-	deserializer.read_container(state.links, [&] {
-		ed::LinkId link_id = deserializer.read_memcpy<std::uint64_t>();
+void NativeDeserializer::read_v2(od::gsl::span<const char> input)
+{
+	const auto section_count = read_memcpy<std::uint16_t>();
+	const auto id_high_water = read_memcpy<std::uint64_t>();
+	m_id_high_water = id_high_water;
 
-		PinPair pins;
-		pins.from = deserializer.read_memcpy<std::uint64_t>();
-		pins.to = deserializer.read_memcpy<std::uint64_t>();
+	// Validate all sections before discarding the current graph
+	const auto sections = read_section_table(input, section_count);
+	const auto pins = find_section(sections, native_format::pins_magic);
+	const auto links = find_section(sections, native_format::links_magic);
+	const auto nodes = find_section(sections, native_format::nodes_magic);
+	const auto payloads = find_section(sections, native_format::payloads_magic);
 
-		state.links.emplace(std::make_pair(link_id, pins));
+	m_editor->clear();
+	m_cleared_editor = true;
+
+	auto& state = m_editor->m_state;
+	state.ids.reset(std::uint32_t(id_high_water));
+	state.pending_payloads.version = m_version;
+
+	m_in = detail::ByteReader(pins);
+	read_pins();
+
+	m_in = detail::ByteReader(links);
+	read_links();
+
+	m_in = detail::ByteReader(nodes);
+	detail::ByteReader payload_reader(payloads);
+
+	read_container(state.nodes, sizeof(native_format::NodeType) + 4 * sizeof(std::uint64_t), [&] {
+		Node& node = read_node();
+		read_pending_payload(node, read_memcpy<std::uint64_t>(), payload_reader);
 	});
+}
+
+void NativeDeserializer::read_v3(od::gsl::span<const char> input)
+{
+	const auto section_count = read_memcpy<std::uint16_t>();
+	const auto id_high_water = read_memcpy<std::uint64_t>();
+	m_id_high_water = id_high_water;
 
-	deserializer.expect_magic(native_format::nodes_magic);
-	deserializer.read_container(state.nodes, [&] {
-		const auto node_type = deserializer.read_memcpy<native_format::NodeType>();
-		ed::NodeId node_id = deserializer.read_memcpy<std::uint64_t>();
+	// Validate all sections before discarding the current graph
+	const auto sections = read_section_table(input, section_count);
+	const auto nodes = find_section(sections, native_format::nodes_magic);
+	const auto strings = find_section(sections, native_format::strings_magic);
+	const auto payloads = find_section(sections, native_format::payloads_magic);
 
-		auto node = deserializer.make_node_from_type(node_id, node_type);
+	m_editor->clear();
+	m_cleared_editor = true;
 
-		// HACK: the node may have created pins when constructed, but we're hard loading them in the native format
-		//       this needs to be known by the node implementations or it might break things; this is not a problem here
+	auto& state = m_editor->m_state;
+	state.ids.reset(std::uint32_t(id_high_water));
+	state.pending_payloads.version = m_version;
+
+	m_in = detail::ByteReader(strings);
+	read_container(state.pending_payloads.strings, 1, [&] {
+		const auto size = m_in.read_varint();
+
+		if (size > m_in.remaining())
+		{
+			throw std::runtime_error("Failed to deserialize: Unexpected end of data");
+		}
+
+		state.pending_payloads.strings.push_back(m_in.read_span(std::size_t(size)));
+	});
+
+	m_in = detail::ByteReader(nodes);
+	detail::ByteReader payload_reader(payloads);
+
+	// Links can only be inserted once the pins they target are known, i.e. once all nodes are read
+	std::vector<LinkInfo> links;
+	std::uint64_t previous_id = 0;
+	std::uint64_t previous_link_id = 0;
+
+	// Type, ID, input and output counts, and payload size
+	const std::size_t min_node_size = sizeof(native_format::NodeType) + 4;
+
+	read_container(state.nodes, min_node_size, [&] {
+		const auto node_type = read_memcpy<native_format::NodeType>();
+		const ed::NodeId node_id = read_id(previous_id);
+
+		auto node = make_node_from_type(node_id, node_type);
+
+		// HACK: see read_node()
 		node->resize_pins(node->m_inputs, 0);
 		node->resize_pins(node->m_outputs, 0);
 
-		deserializer.read_container(node->m_inputs, [&] {
-			node->m_inputs.emplace_back(deserializer.read_memcpy<std::uint64_t>());
+		read_container(node->m_inputs, 1, [&] {
+			const ed::PinId pin = read_id(previous_id);
+			emplace_unique(state.pins, pin, PinInfo{node_id, {}});
+			node->m_inputs.push_back(pin);
 		});
 
-		deserializer.read_container(node->m_outputs, [&] {
-			node->m_outputs.emplace_back(deserializer.read_memcpy<std::uint64_t>());
+		read_container(node->m_outputs, 2, [&] {
+			const ed::PinId pin = read_id(previous_id);
+			emplace_unique(state.pins, pin, PinInfo{node_id, {}});
+			node->m_outputs.push_back(pin);
+
+			read_container(links, 2, [&] {
+				LinkInfo link;
+				link.id = read_id(previous_link_id);
+
+				std::uint64_t previous_pin = std::uintptr_t(pin);
+				link.pins.from = pin;
+				link.pins.to = read_id(previous_pin);
+
+				links.push_back(link);
+			});
 		});
 
-		node->accept(deserializer);
+		Node& inserted = **emplace_unique(state.nodes, node_id, std::move(node));
+		read_pending_payload(inserted, m_in.read_varint(), payload_reader);
+	});
+
+	for (const LinkInfo& link : links)
+	{
+		PinInfo* to = state.pins.find(link.pins.to);
+
+		if (to == nullptr)
+		{
+			throw std::runtime_error("Failed to deserialize: Link to an unknown pin");
+		}
+
+		emplace_unique(state.links, link.id, FsmEditor::StoredLink{link.pins, 0, 0});
+		to->links.push_back(link);
+		state.pins.at(link.pins.from).links.push_back(link);
+	}
+
+	// The layout is optional, e.g. for files written by tools that do not lay nodes out, and headless editors never
+	// show it
+	for (const auto& section : sections)
+	{
+		if (section.first == native_format::layout_magic && !m_editor->is_headless())
+		{
+			m_in = detail::ByteReader(section.second);
+			read_layout();
+		}
+	}
+}
+
+void NativeDeserializer::read_layout()
+{
+	const detail::ScopedEditorContext context(m_editor->m_context);
+
+	auto& state = m_editor->m_state;
+	std::uint64_t previous_id = 0;
+
+	read_container(state.nodes, 1 + 4 * sizeof(float), [&] {
+		const ed::NodeId node_id = read_id(previous_id);
+
+		const float x = read_memcpy<float>();
+		const float y = read_memcpy<float>();
+		const float width = read_memcpy<float>();
+		const float height = read_memcpy<float>();
+
+		// Layout is not worth failing the whole load over, so entries of unknown nodes are skipped
+		if (!state.nodes.contains(node_id) || !std::isfinite(x) || !std::isfinite(y))
+		{
+			return;
+		}
 
-		state.nodes.emplace(std::make_pair(node_id, std::move(node)));
+		ed::SetNodePosition(node_id, ImVec2(x, y));
+
+		// The size is only known once the node is rendered, but lazy loading needs it to tell whether it is visible
+		auto& layout = m_editor->get_node_layout(node_id);
+		layout.position = ImVec2(x, y);
+
+		if (std::isfinite(width) && std::isfinite(height))
+		{
+			layout.size = ImVec2(width, height);
+		}
 	});
 }
 
+void NativeDeserializer::check_links()
+{
+	auto& state = m_editor->m_state;
+
+	for (const auto& p : state.links)
+	{
+		if (!state.pins.contains(p.second.pins.from) || !state.pins.contains(p.second.pins.to))
+		{
+			throw std::runtime_error("Failed to deserialize: Link to an unknown pin");
+		}
+	}
+
+	// Version 1 and 2 files list the links of pins separately from links, so both must agree
+	std::size_t listed_link_count = 0;
+
+	for (const auto& p : state.pins)
+	{
+		const auto& pin_links = p.second.links;
+
+		for (std::size_t i = 0; i < pin_links.size(); ++i)
+		{
+			FsmEditor::StoredLink* link = state.links.find(pin_links[i].id);
+
+			if (link == nullptr || !(link->pins == pin_links[i].pins)
+				|| (p.first != link->pins.from && p.first != link->pins.to))
+			{
+				throw std::runtime_error("Failed to deserialize: Pin with an unknown link");
+			}
+
+			(p.first == link->pins.from ? link->from_position : link->to_position) = std::uint32_t(i);
+		}
+
+		listed_link_count += pin_links.size();
+	}
+
+	if (listed_link_count != 2 * state.links.size())
+	{
+		throw std::runtime_error("Failed to deserialize: Link missing from its pins");
+	}
+}
+
+std::vector<std::pair<std::uint32_t, od::gsl::span<const char>>> NativeDeserializer::read_section_table(
+	od::gsl::span<const char> input,
+	std::size_t section_count
+)
+{
+	if (section_count > m_in.remaining() / sizeof(native_format::SectionEntry))
+	{
+		throw std::runtime_error("Failed to deserialize: Section table exceeds the size of the data");
+	}
+
+	std::vector<std::pair<std::uint32_t, od::gsl::span<const char>>> sections;
+
+	for (std::size_t i = 0; i < section_count; ++i)
+	{
+		const auto entry = read_memcpy<native_format::SectionEntry>();
+
+		if (entry.offset > std::uint64_t(input.size()) || entry.size > std::uint64_t(input.size()) - entry.offset)
+		{
+			throw std::runtime_error("Failed to deserialize: Section exceeds the size of the data");
+		}
+
+		const od::gsl::span<const char> section(
+			input.data() + std::size_t(entry.offset),
+			input.data() + std::size_t(entry.offset + entry.size)
+		);
+
+		if (detail::crc32(section) != entry.checksum)
+		{
+			throw std::runtime_error("Failed to deserialize: Section checksum mismatch");
+		}
+
+		sections.emplace_back(entry.magic, section);
+	}
+
+	return sections;
+}
+
+od::gsl::span<const char> NativeDeserializer::find_section(
+	const std::vector<std::pair<std::uint32_t, od::gsl::span<const char>>>& sections,
+	std::uint32_t magic
+)
+{
+	// Sections from later revisions of the format are skipped
+	for (const auto& section : sections)
+	{
+		if (section.first == magic)
+		{
+			return section.second;
+		}
+	}
+
+	throw std::runtime_error("Failed to deserialize: Missing section");
+}
+
+void NativeDeserializer::read_pending_payload(const Node& node, std::uint64_t size, detail::ByteReader& payloads)
+{
+	if (size > payloads.remaining())
+	{
+		throw std::runtime_error("Failed to deserialize: Node payload exceeds the payloads section");
+	}
+
+	m_editor->m_state.pending_payloads.nodes.emplace(node.node_id(), payloads.read_span(std::size_t(size)));
+}
+
+std::uint64_t NativeDeserializer::read_id(std::uint64_t& previous)
+{
+	previous += std::uint64_t(detail::zigzag_decode(m_in.read_varint()));
+	return previous;
+}
+
+void NativeDeserializer::read_pins()
+{
+	auto& state = m_editor->m_state;
+
+	read_container(state.pins, 3 * sizeof(std::uint64_t), [&] {
+		ed::PinId pin_id = read_memcpy<std::uint64_t>();
+
+		PinInfo pin;
+
+		read_container(pin.links, 3 * sizeof(std::uint64_t), [&] {
+			LinkInfo link;
+			link.id = read_memcpy<std::uint64_t>();
+			link.pins.from = read_memcpy<std::uint64_t>();
+			link.pins.to = read_memcpy<std::uint64_t>();
+			pin.links.emplace_back(link);
+		});
+
+		pin.node_id = read_memcpy<std::uint64_t>();
+		emplace_unique(state.pins, pin_id, pin);
+	});
+}
+
+void NativeDeserializer::read_links()
+{
+	auto& state = m_editor->m_state;
+
+	read_container(state.links, 3 * sizeof(std::uint64_t), [&] {
+		ed::LinkId link_id = read_memcpy<std::uint64_t>();
+
+		PinPair pins;
+		pins.from = read_memcpy<std::uint64_t>();
+		pins.to = read_memcpy<std::uint64_t>();
+
+		emplace_unique(state.links, link_id, FsmEditor::StoredLink{pins, 0, 0});
+	});
+}
+
+Node& NativeDeserializer::read_node()
+{
+	const auto node_type = read_memcpy<native_format::NodeType>();
+	ed::NodeId node_id = read_memcpy<std::uint64_t>();
+
+	auto node = make_node_from_type(node_id, node_type);
+
+	// HACK: the node may have created pins when constructed, but we're hard loading them in the native format
+	//       this needs to be known by the node implementations or it might break things; this is not a problem here
+	node->resize_pins(node->m_inputs, 0);
+	node->resize_pins(node->m_outputs, 0);
+
+	read_container(node->m_inputs, sizeof(std::uint64_t), [&] {
+		node->m_inputs.emplace_back(read_memcpy<std::uint64_t>());
+	});
+
+	read_container(node->m_outputs, sizeof(std::uint64_t), [&] {
+		node->m_outputs.emplace_back(read_memcpy<std::uint64_t>());
+	});
+
+	return **emplace_unique(m_editor->m_state.nodes, node_id, std::move(node));
+}
+
 void NativeDeserializer::visit(nodes::CondNode& node)
 {
 	for (const auto& output : node.outputs())
@@ -97,21 +545,31 @@ void NativeDeserializer::visit(nodes::IfNode& node)
 
 void NativeDeserializer::visit(nodes::StateNode& node)
 {
-	read_char_array(node.get_name_input().get_buffer());
+	read_char_array(node.get_name_input().get_buffer(), read_text());
 }
 
-NativeDeserializer::NativeDeserializer(FsmEditor& editor, std::istream& input) :
+NativeDeserializer::NativeDeserializer(FsmEditor& editor, od::gsl::span<const char> input) :
 	m_editor(&editor),
-	m_in(&input)
+	m_in(input)
+{}
+
+NativeDeserializer::NativeDeserializer(od::gsl::span<const char> input) :
+	m_editor(nullptr),
+	m_in(input)
 {}
 
 void NativeDeserializer::read(widgets::BoolExpressionInput& expression)
 {
 	expression.set_input_type(widgets::ExpressionInputType(read_memcpy<std::uint8_t>()));
-	read_char_array(expression.get_raw_lua_input().text_buffer);
+	read_char_array(expression.get_raw_lua_input().text_buffer, read_text());
 
 	auto& options = expression.get_raw_simple_expression_input().options;
-	read_container(options, [&] {
+	const std::size_t min_option_size = m_version >= native_format::version_3 ? 1 : sizeof(std::uint64_t);
+
+	read_container(options, min_option_size, [&] {
+		// Always consume the shorthand, even when it cannot be resolved
+		const auto shorthand = read_text();
+
 		auto* autocomplete = m_editor->get_autocomplete_provider();
 
 		if (autocomplete == nullptr)
@@ -119,7 +577,7 @@ void NativeDeserializer::read(widgets::BoolExpressionInput& expression)
 			return;
 		}
 
-		auto* option = autocomplete->find_by_shorthand(read_string());
+		auto* option = autocomplete->find_by_shorthand(shorthand);
 
 		if (option != nullptr)
 		{
@@ -128,6 +586,44 @@ void NativeDeserializer::read(widgets::BoolExpressionInput& expression)
 	});
 }
 
+void NativeDeserializer::read_payload(GraphSnapshot& snapshot, GraphSnapshot::Node& node)
+{
+	// Same layout as what visit() decodes into the nodes themselves
+	std::uint32_t expression_count = 0;
+
+	switch (node.type)
+	{
+	case native_format::NodeType::STATE: node.name = snapshot.append_text(read_text()); break;
+	case native_format::NodeType::COND: expression_count = node.output_count; break;
+	case native_format::NodeType::IF: expression_count = 1; break;
+	}
+
+	node.first_expression = std::uint32_t(snapshot.expressions.size());
+	node.expression_count = expression_count;
+
+	for (std::uint32_t i = 0; i < expression_count; ++i)
+	{
+		read_expression(snapshot);
+	}
+}
+
+void NativeDeserializer::read_expression(GraphSnapshot& snapshot)
+{
+	GraphSnapshot::Expression expression;
+	expression.input_type = read_memcpy<std::uint8_t>();
+	expression.lua_expression = snapshot.append_text(read_text());
+	expression.first_option = std::uint32_t(snapshot.option_shorthands.size());
+
+	const std::size_t min_option_size = m_version >= native_format::version_3 ? 1 : sizeof(std::uint64_t);
+
+	read_container(snapshot.option_shorthands, min_option_size, [&] {
+		snapshot.option_shorthands.push_back(snapshot.append_text(read_text()));
+	});
+
+	expression.option_count = std::uint32_t(snapshot.option_shorthands.size() - expression.first_option);
+	snapshot.expressions.push_back(expression);
+}
+
 void NativeDeserializer::expect_magic(std::uint32_t magic)
 {
 	const auto obtained = read_memcpy<std::uint32_t>();
@@ -137,12 +633,42 @@ void NativeDeserializer::expect_magic(std::uint32_t magic)
 	}
 }
 
-std::string NativeDeserializer::read_string()
+std::size_t NativeDeserializer::read_element_count(std::size_t min_element_size)
+{
+	const auto element_count = m_version >= native_format::version_3
+		? m_in.read_varint()
+		: read_memcpy<std::uint64_t>();
+
+	if (min_element_size != 0 && element_count > m_in.remaining() / min_element_size)
+	{
+		throw std::runtime_error("Failed to deserialize: Element count exceeds the size of the data");
+	}
+
+	return std::size_t(element_count);
+}
+
+od::gsl::span<const char> NativeDeserializer::read_text()
 {
+	if (m_version >= native_format::version_3)
+	{
+		const auto index = m_in.read_varint();
+
+		if (m_strings == nullptr || index >= m_strings->size())
+		{
+			throw std::runtime_error("Failed to deserialize: String index out of range");
+		}
+
+		return (*m_strings)[std::size_t(index)];
+	}
+
 	const auto size = read_memcpy<std::uint64_t>();
-	std::string ret(size, '\0');
-	m_in->read(&ret[0], size);
-	return ret;
+
+	if (size > m_in.remaining())
+	{
+		throw std::runtime_error("Failed to deserialize: Unexpected end of data");
+	}
+
+	return m_in.read_span(std::size_t(size));
 }
 
 std::unique_ptr<Node> NativeDeserializer::make_node_from_type(ed::NodeId id, native_format::NodeType node_type)
@@ -2,13 +2,18 @@
 
 #include "../fwd.hpp"
 #include "../visitor.hpp"
+#include "nativeserializer.hpp"
+#include "../util/bytebuffer.hpp"
 #include "../util/nativeformat.hpp"
 #include "../util/imgui.hpp"
+#include "../util/slotmap.hpp"
 
 #include <algorithm>
 #include <istream>
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace fsme
 {
@@ -22,47 +27,175 @@ namespace visitors
 class NativeDeserializer : public NodeVisitor
 {
 public:
+	/**
+	 * @brief Deserializes a graph from a contiguous buffer, replacing the graph of \p editor.
+	 * @details Versions 1, 2 and 3 are supported. The node contents of version 2 and 3 files are copied aside, along
+	 * with the strings section of version 3 files, to be decoded later on, see FsmEditor::load_node_payload().
+	 * @throws std::runtime_error if the data is malformed or truncated. No byte outside of \p input is ever read.
+	 */
+	static void deserialize(FsmEditor& editor, od::gsl::span<const char> input);
+
+	/**
+	 * @brief Reads all of \p input in one go, then deserializes it.
+	 * @see deserialize(FsmEditor&, od::gsl::span<const char>)
+	 */
 	static void deserialize(FsmEditor& editor, std::istream& input);
 
+	/**
+	 * @brief Reads the file at \p path and deserializes it.
+	 * @throws std::runtime_error if the file cannot be opened.
+	 * @see deserialize(FsmEditor&, od::gsl::span<const char>)
+	 */
+	static void deserialize_file(FsmEditor& editor, const std::string& path);
+
+	/**
+	 * @brief Decodes the contents of a node that were left out by a lazy load, see FsmEditor::load_node_payload().
+	 */
+	static void load_payload(Node& node, od::gsl::span<const char> payload);
+
+	/**
+	 * @brief Decodes the node contents that \p snapshot copied without decoding, see GraphSnapshot::Node::payload.
+	 * @details Unlike load_payload(), this does not need the editor, so that it can run on any thread. Shorthands are
+	 * kept as they are, whether the autocomplete provider knows them or not.
+	 * @throws std::runtime_error if the contents are malformed.
+	 */
+	static void load_payloads(GraphSnapshot& snapshot);
+
 	void visit(nodes::CondNode& node) override;
 	void visit(nodes::IfNode& node) override;
 	void visit(nodes::StateNode& node) override;
 
 private:
-	NativeDeserializer(FsmEditor& editor, std::istream& input);
+	NativeDeserializer(FsmEditor& editor, od::gsl::span<const char> input);
+
+	/**
+	 * @brief Makes a deserializer that does not refer to any editor, which can only decode payloads into a snapshot.
+	 */
+	explicit NativeDeserializer(od::gsl::span<const char> input);
+
+	/**
+	 * @brief Deserializes \p input, which is kept alive by \p storage if not null.
+	 * @details Version 1 files are decoded entirely. Starting with version 2, node contents are only decoded on
+	 * demand, and thus keep referring to the input: if \p storage is null, these are copied first.
+	 */
+	static void deserialize_shared(
+		FsmEditor& editor,
+		od::gsl::span<const char> input,
+		std::shared_ptr<const void> storage
+	);
+
+	void read_v1();
+	void read_v2(od::gsl::span<const char> input);
+	void read_v3(od::gsl::span<const char> input);
+
+	/**
+	 * @brief Reads the section table of version 2 files onwards, and validates the bounds and checksums of sections.
+	 * @return The magic and contents of each section.
+	 */
+	std::vector<std::pair<std::uint32_t, od::gsl::span<const char>>> read_section_table(
+		od::gsl::span<const char> input,
+		std::size_t section_count
+	);
+
+	static od::gsl::span<const char> find_section(
+		const std::vector<std::pair<std::uint32_t, od::gsl::span<const char>>>& sections,
+		std::uint32_t magic
+	);
+
+	/**
+	 * @brief Reads the layout section, placing nodes within the node editor.
+	 */
+	void read_layout();
+
+	/**
+	 * @brief Sets the next \p size bytes of \p payloads aside as the contents of \p node, to be decoded later on.
+	 */
+	void read_pending_payload(const Node& node, std::uint64_t size, detail::ByteReader& payloads);
+
+	/**
+	 * @brief Reads an ID stored as the difference with \p previous, then updates \p previous.
+	 */
+	std::uint64_t read_id(std::uint64_t& previous);
+
+	/**
+	 * @brief Inserts an element for \p key, rejecting duplicate IDs and IDs above the high water mark as malformed data.
+	 */
+	template<class Key, class T, class Value>
+	T* emplace_unique(detail::SlotMap<Key, T>& map, Key key, Value&& value)
+	{
+		if (detail::id_index(std::uintptr_t(key)) > m_id_high_water)
+		{
+			throw std::runtime_error("Failed to deserialize: ID above the high water mark");
+		}
+
+		if (map.contains(key))
+		{
+			throw std::runtime_error("Failed to deserialize: Duplicate ID");
+		}
+
+		return &map.emplace(key, std::forward<Value>(value));
+	}
+
+	/**
+	 * @brief Checks that all links refer to existing pins and are listed by both of them, which the rest of the editor
+	 * relies on, then records the position of each link within the link lists of its pins.
+	 */
+	void check_links();
+
+	void read_pins();
+	void read_links();
+
+	/**
+	 * @brief Reads the type, ID and pins of a node, and inserts it into the graph.
+	 */
+	Node& read_node();
 
 	void read(widgets::BoolExpressionInput& expression);
 
+	/**
+	 * @brief Decodes the payload of \p node, appending its contents to \p snapshot.
+	 */
+	void read_payload(GraphSnapshot& snapshot, GraphSnapshot::Node& node);
+
+	void read_expression(GraphSnapshot& snapshot);
+
 	void expect_magic(std::uint32_t magic);
 
 	template<class T>
 	T read_memcpy()
 	{
-		T ret;
-		m_in->read(reinterpret_cast<char*>(&ret), sizeof(ret));
-		return ret;
+		return m_in.read_memcpy<T>();
 	}
 
 	template<class T>
-	void read_char_array(T& container)
+	void read_char_array(T& container, od::gsl::span<const char> text)
 	{
-		std::size_t size = read_memcpy<std::uint64_t>();
 		std::fill(container.begin(), container.end(), '\0');
 
-		if (container.size() < size)
+		if (container.size() < std::size_t(text.size()))
 		{
 			throw std::runtime_error("Failed to deserialize: Serialized buffer size is larger than expected");
 		}
 
-		m_in->read(container.data(), size);
+		std::copy(text.begin(), text.end(), container.begin());
 	}
 
-	std::string read_string();
+	/**
+	 * @brief Returns a view over a string of the input without copying it, which is either length-prefixed or, starting
+	 * with version 3, a reference to the strings section.
+	 */
+	od::gsl::span<const char> read_text();
+
+	/**
+	 * @brief Reads an element count, and checks that the remaining input can hold that many elements at least
+	 * \p min_element_size bytes large, so that corrupted counts are rejected before looping over them.
+	 */
+	std::size_t read_element_count(std::size_t min_element_size);
 
 	template<class T, class Func>
-	void read_container(T& container, const Func& element_writer)
+	void read_container(T& container, std::size_t min_element_size, const Func& element_writer)
 	{
-		const std::size_t element_count = read_memcpy<std::uint64_t>();
+		const std::size_t element_count = read_element_count(min_element_size);
 
 		for (std::size_t i = 0; i < element_count; ++i)
 		{
@@ -73,7 +206,16 @@ private:
 	std::unique_ptr<Node> make_node_from_type(ed::NodeId id, native_format::NodeType node_type);
 
 	FsmEditor* m_editor;
-	std::istream* m_in;
+	detail::ByteReader m_in;
+
+	std::uint16_t m_version = native_format::version_1;
+	std::uint64_t m_id_high_water = 0;
+
+	/// @brief Whether the graph of the editor was discarded already, so that a failure leaves it partially loaded
+	bool m_cleared_editor = false;
+
+	/// @brief Contents of the strings section of version 3 files onwards
+	const std::vector<od::gsl::span<const char>>* m_strings = nullptr;
 };
 
 }
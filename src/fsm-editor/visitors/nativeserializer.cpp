@@ -1,106 +1,401 @@
 #include "nativeserializer.hpp"
 
+#include "nativedeserializer.hpp"
 #include "../editor.hpp"
 #include "../nodes/nodes.hpp"
 #include "../widgets/boolexprinput.hpp"
+#include "../util/checksum.hpp"
+
+#include <algorithm>
+#include <cstring>
 
 namespace fsme
 {
 namespace visitors
 {
 
-void NativeSerializer::serialize(FsmEditor& editor, std::ostream& output)
+GraphSnapshot NativeSerializer::snapshot(FsmEditor& editor)
 {
-	NativeSerializer serializer(output);
+	NativeSerializer serializer(editor);
 
 	auto& state = editor.m_state;
 
-	serializer.write_memcpy(native_format::magic_header);
+	serializer.m_snapshot.id_high_water = state.ids.high_water();
+	serializer.m_snapshot.nodes.reserve(state.nodes.size());
+	serializer.m_snapshot.inputs.reserve(state.pins.size());
+	serializer.m_snapshot.outputs.reserve(state.pins.size());
+	serializer.m_snapshot.links.reserve(state.links.size());
 
-	serializer.write_memcpy(std::uint64_t(state.last_allocated_id));
+	for (auto& p : state.nodes)
+	{
+		p.second->accept(serializer);
 
-	serializer.write_memcpy(native_format::pins_magic);
-	serializer.write_container(state.pins, [&](const auto& p) {
-		const ed::PinId& pin_id = p.first;
-		const PinInfo& pin = p.second;
+		auto& node = serializer.m_snapshot.nodes.back();
+		const FsmEditor::NodeLayout* layout = state.layouts.find(p.first);
+		node.has_layout = layout != nullptr;
 
-		serializer.write_memcpy(std::uint64_t(pin_id));
-		serializer.write_container(pin.links, [&](const LinkInfo& link) {
-			serializer.write_memcpy(std::uint64_t(link.id));
-			serializer.write_memcpy(std::uint64_t(link.pins.from));
-			serializer.write_memcpy(std::uint64_t(link.pins.to));
-		});
-		serializer.write_memcpy(std::uint64_t(pin.node_id));
-	});
+		if (node.has_layout)
+		{
+			node.position = layout->position;
+			node.size = layout->size;
+		}
+	}
+
+	// Payloads keep pointing into the loaded file, which the snapshot keeps alive along with the editor
+	const auto& pending = state.pending_payloads;
+	if (!pending.nodes.empty())
+	{
+		serializer.m_snapshot.pending_payloads.storage = pending.storage;
+		serializer.m_snapshot.pending_payloads.version = pending.version;
+		serializer.m_snapshot.pending_payloads.strings = pending.strings;
+	}
 
-	serializer.write_memcpy(native_format::links_magic);
-	serializer.write_container(state.links, [&](const auto& p) {
-		const ed::LinkId& link_id = p.first;
-		const PinPair& pins = p.second;
+	// Sorting nodes keeps the differences between consecutive IDs small
+	std::sort(
+		serializer.m_snapshot.nodes.begin(),
+		serializer.m_snapshot.nodes.end(),
+		[](const GraphSnapshot::Node& a, const GraphSnapshot::Node& b) {
+			return a.id < b.id;
+		}
+	);
 
-		serializer.write_memcpy(std::uint64_t(link_id));
-		serializer.write_memcpy(std::uint64_t(pins.from));
-		serializer.write_memcpy(std::uint64_t(pins.to));
-	});
+	return std::move(serializer.m_snapshot);
+}
 
-	serializer.write_memcpy(native_format::nodes_magic);
-	serializer.write_container(state.nodes, [&](const auto& p) {
-		p.second->accept(serializer);
-	});
+std::vector<char> NativeSerializer::serialize(const GraphSnapshot& snapshot, const std::function<void(float)>& progress)
+{
+	if (snapshot.pending_payloads.storage != nullptr)
+	{
+		return serialize(GraphSnapshot(snapshot), progress);
+	}
+
+	return Encoder(snapshot).encode(progress);
+}
+
+std::vector<char> NativeSerializer::serialize(GraphSnapshot&& snapshot, const std::function<void(float)>& progress)
+{
+	NativeDeserializer::load_payloads(snapshot);
+	return Encoder(snapshot).encode(progress);
+}
+
+std::vector<char> NativeSerializer::serialize(FsmEditor& editor)
+{
+	return serialize(snapshot(editor));
+}
+
+void NativeSerializer::serialize(FsmEditor& editor, std::ostream& output)
+{
+	const std::vector<char> bytes = serialize(editor);
+	output.write(bytes.data(), bytes.size());
 }
 
 void NativeSerializer::visit(nodes::CondNode& node)
 {
-	write_memcpy(native_format::NodeType::COND);
-	write(node);
+	if (snapshot_pending_node(node, native_format::NodeType::COND))
+	{
+		return;
+	}
+
+	auto& snapshot = snapshot_node(node, native_format::NodeType::COND);
 
 	for (const auto& output : node.outputs())
 	{
-		write(node.get_expression(output));
+		snapshot_expression(node.get_expression(output));
 	}
+
+	snapshot.expression_count = std::uint32_t(m_snapshot.expressions.size() - snapshot.first_expression);
 }
 
 void NativeSerializer::visit(nodes::IfNode& node)
 {
-	write_memcpy(native_format::NodeType::IF);
-	write(node);
-	write(node.get_expression());
+	if (snapshot_pending_node(node, native_format::NodeType::IF))
+	{
+		return;
+	}
+
+	auto& snapshot = snapshot_node(node, native_format::NodeType::IF);
+
+	snapshot_expression(node.get_expression());
+	snapshot.expression_count = 1;
 }
 
 void NativeSerializer::visit(nodes::StateNode& node)
 {
-	write_memcpy(native_format::NodeType::STATE);
-	write(node);
-	write_string(node.get_name_input().get_text());
+	if (snapshot_pending_node(node, native_format::NodeType::STATE))
+	{
+		return;
+	}
+
+	const std::string& name = node.get_name_input().get_text();
+	const GraphSnapshot::Text text = snapshot_text(name.data(), name.size());
+
+	snapshot_node(node, native_format::NodeType::STATE).name = text;
 }
 
-NativeSerializer::NativeSerializer(std::ostream& output) :
-	m_out(&output)
+NativeSerializer::NativeSerializer(FsmEditor& editor) :
+	m_editor(&editor)
 {}
 
-void NativeSerializer::write(const Node& node)
+GraphSnapshot::Node& NativeSerializer::snapshot_node(const Node& node, native_format::NodeType type)
 {
-	write_memcpy(std::uint64_t(node.node_id()));
+	GraphSnapshot::Node snapshot{};
+	snapshot.type = type;
+	snapshot.id = std::uintptr_t(node.node_id());
+
+	snapshot.first_input = std::uint32_t(m_snapshot.inputs.size());
+	snapshot.input_count = std::uint32_t(node.m_inputs.size());
+	for (ed::PinId input : node.m_inputs)
+	{
+		m_snapshot.inputs.push_back(std::uintptr_t(input));
+	}
+
+	snapshot.first_output = std::uint32_t(m_snapshot.outputs.size());
+	snapshot.output_count = std::uint32_t(node.m_outputs.size());
+	for (ed::PinId output : node.m_outputs)
+	{
+		GraphSnapshot::Output output_snapshot{std::uintptr_t(output), std::uint32_t(m_snapshot.links.size()), 0};
+
+		if (const PinInfo* pin = m_editor->get_pin_info(output))
+		{
+			output_snapshot.link_count = std::uint32_t(pin->links.size());
+			for (const LinkInfo& link : pin->links)
+			{
+				m_snapshot.links.push_back({std::uintptr_t(link.id), std::uintptr_t(link.pins.to)});
+			}
+		}
+
+		m_snapshot.outputs.push_back(output_snapshot);
+	}
+
+	snapshot.first_expression = std::uint32_t(m_snapshot.expressions.size());
+
+	m_snapshot.nodes.push_back(snapshot);
+	return m_snapshot.nodes.back();
+}
 
-	write_container(node.m_inputs, [&](ed::PinId input) {
-		write_memcpy(std::uint64_t(input));
+bool NativeSerializer::snapshot_pending_node(const Node& node, native_format::NodeType type)
+{
+	const auto* payload = m_editor->m_state.pending_payloads.nodes.find(node.node_id());
+
+	if (payload == nullptr)
+	{
+		return false;
+	}
+
+	snapshot_node(node, type).payload = *payload;
+	return true;
+}
+
+void NativeSerializer::snapshot_expression(widgets::BoolExpressionInput& expression)
+{
+	const char* lua_expression = expression.get_raw_lua_input().text_buffer.data();
+	const auto& options = expression.get_raw_simple_expression_input().options;
+
+	GraphSnapshot::Expression snapshot;
+	snapshot.input_type = std::uint8_t(expression.get_input_type());
+	snapshot.lua_expression = snapshot_text(lua_expression, std::strlen(lua_expression));
+	snapshot.first_option = std::uint32_t(m_snapshot.option_shorthands.size());
+	snapshot.option_count = std::uint32_t(options.size());
+
+	for (const widgets::BoolExpressionOption* option : options)
+	{
+		m_snapshot.option_shorthands.push_back(snapshot_text(option->shorthand.data(), option->shorthand.size()));
+	}
+
+	m_snapshot.expressions.push_back(snapshot);
+}
+
+GraphSnapshot::Text NativeSerializer::snapshot_text(const char* text, std::size_t size)
+{
+	return m_snapshot.append_text({text, text + size});
+}
+
+NativeSerializer::Encoder::Encoder(const GraphSnapshot& snapshot) :
+	m_snapshot(&snapshot)
+{}
+
+std::vector<char> NativeSerializer::Encoder::encode(const std::function<void(float)>& progress)
+{
+	const auto report_progress = [&](float fraction) {
+		if (progress)
+		{
+			progress(fraction);
+		}
+	};
+
+	const std::uint32_t section_magics[] = {
+		native_format::nodes_magic,
+		native_format::strings_magic,
+		native_format::payloads_magic,
+		native_format::layout_magic
+	};
+	const std::size_t section_count = sizeof(section_magics) / sizeof(section_magics[0]);
+
+	m_out.write_memcpy(native_format::versioned_magic_header);
+	m_out.write_memcpy(native_format::version);
+	m_out.write_memcpy(std::uint16_t(section_count));
+	m_out.write_memcpy(m_snapshot->id_high_water);
+
+	// The section table gets filled in once all sections are written
+	const std::size_t section_table_offset = m_out.size();
+	for (std::size_t i = 0; i < section_count; ++i)
+	{
+		m_out.write_memcpy(native_format::SectionEntry{});
+	}
+
+	std::size_t section_index = 0;
+	const auto write_section = [&](const auto& section_writer) {
+		native_format::SectionEntry entry;
+		entry.magic = section_magics[section_index];
+		entry.offset = m_out.size();
+
+		section_writer();
+
+		entry.size = m_out.size() - entry.offset;
+		entry.checksum = detail::crc32({m_out.data() + entry.offset, m_out.data() + m_out.size()});
+
+		m_out.overwrite_memcpy(section_table_offset + section_index * sizeof(entry), entry);
+		++section_index;
+	};
+
+	const auto& nodes = m_snapshot->nodes;
+
+	write_section([&] {
+		m_out.write_varint(nodes.size());
+
+		// Nodes make up most of the work, so progress is only reported while writing them
+		const std::size_t progress_interval = std::max<std::size_t>(nodes.size() / 64, 1);
+
+		for (std::size_t i = 0; i < nodes.size(); ++i)
+		{
+			if (i % progress_interval == 0)
+			{
+				report_progress(float(i) / float(nodes.size()));
+			}
+
+			write_node(nodes[i]);
+		}
 	});
 
-	write_container(node.m_outputs, [&](ed::PinId output) {
-		write_memcpy(std::uint64_t(output));
+	write_section([&] {
+		m_out.write_varint(m_strings.size());
+
+		for (const std::string* text : m_strings)
+		{
+			m_out.write_varint(text->size());
+			m_out.write(text->data(), text->size());
+		}
 	});
+
+	write_section([&] {
+		m_out.write(m_payloads.data(), m_payloads.size());
+	});
+
+	write_section([&] {
+		write_layout();
+	});
+
+	report_progress(1.0f);
+
+	return std::move(m_out.bytes());
+}
+
+void NativeSerializer::Encoder::write_node(const GraphSnapshot::Node& node)
+{
+	const std::size_t payload_begin = m_payloads.size();
+
+	if (node.type == native_format::NodeType::STATE)
+	{
+		write_string_ref(node.name);
+	}
+
+	for (std::uint32_t i = 0; i < node.expression_count; ++i)
+	{
+		write_expression(m_snapshot->expressions[node.first_expression + i]);
+	}
+
+	m_out.write_memcpy(node.type);
+	write_id(m_out, node.id, m_previous_node_or_pin_id);
+
+	m_out.write_varint(node.input_count);
+	for (std::uint32_t i = 0; i < node.input_count; ++i)
+	{
+		write_id(m_out, m_snapshot->inputs[node.first_input + i], m_previous_node_or_pin_id);
+	}
+
+	// Links are only written along with the output pin they start from
+	m_out.write_varint(node.output_count);
+	for (std::uint32_t i = 0; i < node.output_count; ++i)
+	{
+		const auto& output = m_snapshot->outputs[node.first_output + i];
+		write_id(m_out, output.pin, m_previous_node_or_pin_id);
+
+		m_out.write_varint(output.link_count);
+		for (std::uint32_t j = 0; j < output.link_count; ++j)
+		{
+			const auto& link = m_snapshot->links[output.first_link + j];
+			write_id(m_out, link.id, m_previous_link_id);
+
+			std::uint64_t from = output.pin;
+			write_id(m_out, link.to, from);
+		}
+	}
+
+	m_out.write_varint(m_payloads.size() - payload_begin);
 }
 
-void NativeSerializer::write(widgets::BoolExpressionInput& expression)
+void NativeSerializer::Encoder::write_expression(const GraphSnapshot::Expression& expression)
 {
-	write_memcpy(std::uint8_t(expression.get_input_type()));
-	write_string(std::string(expression.get_raw_lua_input().text_buffer.data()));
-	write_container(
-		expression.get_raw_simple_expression_input().options,
-		[this](const widgets::BoolExpressionOption* option) {
-			write_string(option->shorthand);
+	m_payloads.write_memcpy(expression.input_type);
+	write_string_ref(expression.lua_expression);
+
+	m_payloads.write_varint(expression.option_count);
+	for (std::uint32_t i = 0; i < expression.option_count; ++i)
+	{
+		write_string_ref(m_snapshot->option_shorthands[expression.first_option + i]);
+	}
+}
+
+void NativeSerializer::Encoder::write_layout()
+{
+	const auto& nodes = m_snapshot->nodes;
+
+	m_out.write_varint(std::count_if(nodes.begin(), nodes.end(), [](const GraphSnapshot::Node& node) {
+		return node.has_layout;
+	}));
+
+	std::uint64_t previous_id = 0;
+
+	for (const auto& node : nodes)
+	{
+		if (node.has_layout)
+		{
+			write_id(m_out, node.id, previous_id);
+			m_out.write_memcpy(node.position.x);
+			m_out.write_memcpy(node.position.y);
+			m_out.write_memcpy(node.size.x);
+			m_out.write_memcpy(node.size.y);
 		}
-	);
+	}
+}
+
+void NativeSerializer::Encoder::write_id(detail::ByteWriter& out, std::uint64_t id, std::uint64_t& previous)
+{
+	out.write_varint(detail::zigzag_encode(std::int64_t(id - previous)));
+	previous = id;
+}
+
+void NativeSerializer::Encoder::write_string_ref(GraphSnapshot::Text text)
+{
+	const auto chars = m_snapshot->get_text(text);
+	const auto p = m_string_indices.emplace(std::string(chars.begin(), chars.end()), std::uint32_t(m_strings.size()));
+
+	if (p.second)
+	{
+		m_strings.push_back(&p.first->first);
+	}
+
+	m_payloads.write_varint(p.first->second);
 }
 
 }
@@ -2,23 +2,177 @@
 
 #include "../fwd.hpp"
 #include "../visitor.hpp"
+#include "../util/bytebuffer.hpp"
+#include "../util/imgui.hpp"
 #include "../util/nativeformat.hpp"
 
+#include <onidev/core/span.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace fsme
 {
 namespace visitors
 {
 
+/**
+ * @brief Immutable flattened copy of a graph, holding everything needed to write it in the native format.
+ * @details A snapshot does not refer to the editor, so it can be serialized on another thread while the graph keeps
+ * being edited. To keep taking a snapshot cheap, everything is stored in a few flat arrays, which nodes refer to by
+ * ranges of indices, rather than through per-node allocations.
+ * The contents of nodes that the editor did not decode yet are copied as they are encoded, and only decoded along with
+ * the rest of the serialization, see NativeDeserializer::load_payloads().
+ * @see NativeSerializer::snapshot()
+ */
+struct GraphSnapshot
+{
+	/// @brief Range of characters within `text`
+	struct Text
+	{
+		std::uint32_t offset;
+		std::uint32_t size;
+	};
+
+	struct Expression
+	{
+		std::uint8_t input_type;
+		Text lua_expression;
+
+		/// @brief Range of the shorthands of the options of the simple expression within `option_shorthands`
+		std::uint32_t first_option;
+		std::uint32_t option_count;
+	};
+
+	struct Link
+	{
+		std::uint64_t id;
+		std::uint64_t to;
+	};
+
+	struct Output
+	{
+		std::uint64_t pin;
+
+		/// @brief Range of the links starting from this output within `links`
+		std::uint32_t first_link;
+		std::uint32_t link_count;
+	};
+
+	struct Node
+	{
+		native_format::NodeType type;
+		std::uint64_t id;
+
+		/// @brief Range of the input pins of the node within `inputs`
+		std::uint32_t first_input;
+		std::uint32_t input_count;
+
+		/// @brief Range of the outputs of the node within `outputs`
+		std::uint32_t first_output;
+		std::uint32_t output_count;
+
+		/// @brief Encoded contents of a node that the editor did not decode yet, see `pending_payloads`. The name and
+		/// expressions of such a node are left empty until decoded.
+		od::gsl::span<const char> payload{nullptr, 0};
+
+		/// @brief Name of a StateNode
+		Text name;
+
+		/// @brief Range of the expression of an IfNode, or the expression of each output of a CondNode, within
+		/// `expressions`
+		std::uint32_t first_expression;
+		std::uint32_t expression_count;
+
+		/// @brief Whether the node was placed within the node editor, i.e. whether position and size are meaningful
+		bool has_layout;
+		ImVec2 position;
+		ImVec2 size;
+	};
+
+	od::gsl::span<const char> get_text(Text range) const
+	{
+		return {text.data() + range.offset, text.data() + range.offset + range.size};
+	}
+
+	Text append_text(od::gsl::span<const char> chars)
+	{
+		const Text range{std::uint32_t(text.size()), std::uint32_t(chars.size())};
+		text.insert(text.end(), chars.begin(), chars.end());
+		return range;
+	}
+
+	std::uint64_t id_high_water = 0;
+
+	/// @brief All of the nodes of the graph, sorted by ID
+	std::vector<Node> nodes;
+
+	std::vector<std::uint64_t> inputs;
+	std::vector<Output> outputs;
+	std::vector<Link> links;
+	std::vector<Expression> expressions;
+	std::vector<Text> option_shorthands;
+
+	/// @brief Characters of all of the strings of the graph, back to back
+	std::vector<char> text;
+
+	/**
+	 * @brief What the payloads of nodes refer to, copied from the editor, see FsmEditor::load_node_payload().
+	 * @details `storage` is only set while some node has a payload left to decode.
+	 */
+	struct
+	{
+		std::shared_ptr<const void> storage;
+		std::uint16_t version = 0;
+		std::vector<od::gsl::span<const char>> strings;
+	} pending_payloads;
+};
+
 /**
  * @brief Visitor to help serialize the FSM into the native editor format.
+ * @details The latest version of the format is always written, see native_format::SectionEntry for its layout.
+ * Serializing happens in two steps: the graph is first copied to a GraphSnapshot, which is then encoded. Only the
+ * first step needs the editor, so that the second one can run on another thread.
  * @see CentauriSerializer
  * @see NativeDeserializer
  */
 class NativeSerializer : public NodeVisitor
 {
 public:
+	/**
+	 * @brief Copies the graph to a snapshot, which can then be serialized independently of the editor.
+	 * @details The contents of nodes that were not loaded yet are copied without decoding them, see
+	 * GraphSnapshot::Node::payload.
+	 */
+	static GraphSnapshot snapshot(FsmEditor& editor);
+
+	/**
+	 * @brief Serializes a snapshot to a contiguous buffer. This may be called from any thread.
+	 * @details Node contents left encoded in \p snapshot are decoded first, on a copy of it.
+	 * @param progress If set, called from time to time with the fraction of the work done so far.
+	 * @throws std::runtime_error if node contents left encoded are malformed.
+	 */
+	static std::vector<char> serialize(const GraphSnapshot& snapshot, const std::function<void(float)>& progress = {});
+
+	/**
+	 * @brief Serializes a snapshot to a contiguous buffer, decoding the node contents left encoded in place.
+	 * @see serialize(const GraphSnapshot&, const std::function<void(float)>&)
+	 */
+	static std::vector<char> serialize(GraphSnapshot&& snapshot, const std::function<void(float)>& progress = {});
+
+	/**
+	 * @brief Serializes the graph to a contiguous buffer.
+	 */
+	static std::vector<char> serialize(FsmEditor& editor);
+
+	/**
+	 * @brief Serializes the graph to \p output, which is written to in one go.
+	 */
 	static void serialize(FsmEditor& editor, std::ostream& output);
 
 	void visit(nodes::CondNode& node) override;
@@ -26,36 +180,77 @@ public:
 	void visit(nodes::StateNode& node) override;
 
 private:
-	NativeSerializer(std::ostream& output);
+	explicit NativeSerializer(FsmEditor& editor);
 
-	void write(const Node& node);
-	void write(widgets::BoolExpressionInput& expression);
+	/**
+	 * @brief Appends a snapshot of the type, ID, pins and outgoing links of \p node.
+	 */
+	GraphSnapshot::Node& snapshot_node(const Node& node, native_format::NodeType type);
 
-	template<class T>
-	void write_memcpy(const T& value)
-	{
-		m_out->write(reinterpret_cast<const char*>(&value), sizeof(value));
-	}
+	/**
+	 * @brief Appends a snapshot of \p node and its encoded contents if these were not decoded yet.
+	 * @return Whether the contents of \p node were still encoded.
+	 */
+	bool snapshot_pending_node(const Node& node, native_format::NodeType type);
 
-	template<class T>
-	void write_string(const T& container)
-	{
-		write_memcpy(std::uint64_t(container.size()));
-		m_out->write(container.data(), container.size());
-	}
+	void snapshot_expression(widgets::BoolExpressionInput& expression);
+
+	GraphSnapshot::Text snapshot_text(const char* text, std::size_t size);
 
-	template<class T, class Func>
-	void write_container(const T& container, const Func& element_serializer)
+	/**
+	 * @brief Writes a GraphSnapshot in the native format, without any access to the editor.
+	 */
+	class Encoder
 	{
-		write_memcpy(std::uint64_t(container.size()));
+	public:
+		explicit Encoder(const GraphSnapshot& snapshot);
 
-		for (const auto& elem : container)
-		{
-			element_serializer(elem);
-		}
-	}
+		std::vector<char> encode(const std::function<void(float)>& progress);
+
+	private:
+		/**
+		 * @brief Writes the topology of \p node and its outgoing links to the nodes section, and its contents to the
+		 * payloads section.
+		 */
+		void write_node(const GraphSnapshot::Node& node);
+
+		void write_expression(const GraphSnapshot::Expression& expression);
+
+		/**
+		 * @brief Writes the layout section, i.e. the position and size of nodes within the node editor.
+		 */
+		void write_layout();
+
+		/**
+		 * @brief Writes \p id to \p out as the difference with \p previous, then updates \p previous.
+		 */
+		static void write_id(detail::ByteWriter& out, std::uint64_t id, std::uint64_t& previous);
+
+		/**
+		 * @brief Writes a reference to \p text within the strings section to the payloads section, adding it to the
+		 * strings section if needed.
+		 */
+		void write_string_ref(GraphSnapshot::Text text);
+
+		const GraphSnapshot* m_snapshot;
+
+		detail::ByteWriter m_out;
+
+		/// @brief Contents of the payloads section, which is written after all of the nodes
+		detail::ByteWriter m_payloads;
+
+		/// @brief Index of each string within the strings section
+		std::unordered_map<std::string, std::uint32_t> m_string_indices;
+
+		/// @brief Strings of the strings section in order, which point to the keys of m_string_indices
+		std::vector<const std::string*> m_strings;
+
+		std::uint64_t m_previous_node_or_pin_id = 0;
+		std::uint64_t m_previous_link_id = 0;
+	};
 
-	std::ostream* m_out;
+	FsmEditor* m_editor;
+	GraphSnapshot m_snapshot;
 };
 
 }
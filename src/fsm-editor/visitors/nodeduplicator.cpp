@@ -21,6 +21,8 @@ void NodeDuplicator::visit(nodes::CondNode& node)
 	{
 		clone.get_expression(clone.outputs()[i]) = node.get_expression(node.outputs()[i]);
 	}
+
+	editor.notify_node_edited(clone);
 }
 
 void NodeDuplicator::visit(nodes::IfNode& node)
@@ -30,6 +32,7 @@ void NodeDuplicator::visit(nodes::IfNode& node)
 	auto& clone = editor.make_node<nodes::IfNode>();
 	setup_generic_clone(node, clone);
 	clone.get_expression() = node.get_expression();
+	editor.notify_node_edited(clone);
 }
 
 void NodeDuplicator::visit(nodes::StateNode& node)
@@ -39,6 +42,7 @@ void NodeDuplicator::visit(nodes::StateNode& node)
 	auto& clone = editor.make_node<nodes::StateNode>();
 	setup_generic_clone(node, clone);
 	clone.get_name_input().set_text(node.get_name_input().get_text() + " (new)");
+	editor.notify_node_edited(clone);
 }
 
 void NodeDuplicator::setup_generic_clone(Node& original, Node& clone)
@@ -54,7 +58,7 @@ void NodeDuplicator::place_node_under(Node& bottom, Node& top)
 
 	const ImVec2 bottom_position(top_position.x, top_position.y + top_size.y + 8);
 
-	ed::SetNodePosition(bottom.node_id(), bottom_position);
+	bottom.editor().set_node_position(bottom.node_id(), bottom_position);
 }
 
 }
@@ -0,0 +1,38 @@
+#include "nodekindfinder.hpp"
+
+#include "../node.hpp"
+
+namespace fsme
+{
+namespace visitors
+{
+
+NodeKind NodeKindFinder::find(Node& node)
+{
+	NodeKindFinder finder;
+	node.accept(finder);
+	return finder.m_kind;
+}
+
+bool NodeKindFinder::is_conditional(Node& node)
+{
+	return find(node) != NodeKind::State;
+}
+
+void NodeKindFinder::visit(nodes::CondNode&)
+{
+	m_kind = NodeKind::Cond;
+}
+
+void NodeKindFinder::visit(nodes::IfNode&)
+{
+	m_kind = NodeKind::If;
+}
+
+void NodeKindFinder::visit(nodes::StateNode&)
+{
+	m_kind = NodeKind::State;
+}
+
+}
+}
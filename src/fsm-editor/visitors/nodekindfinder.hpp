@@ -0,0 +1,45 @@
+#pragma once
+
+#include "../fwd.hpp"
+#include "../visitor.hpp"
+
+namespace fsme
+{
+namespace visitors
+{
+
+/**
+ * @brief The concrete type of a node.
+ */
+enum class NodeKind
+{
+	State, ///< nodes::StateNode
+	If,    ///< nodes::IfNode
+	Cond   ///< nodes::CondNode
+};
+
+/**
+ * @brief Visitor to determine the concrete type of a node.
+ */
+class NodeKindFinder : public NodeVisitor
+{
+public:
+	static NodeKind find(Node& node);
+
+	/**
+	 * @brief Returns whether \p node is part of conditional logic, i.e. is an IfNode or a CondNode.
+	 */
+	static bool is_conditional(Node& node);
+
+	void visit(nodes::CondNode& node) override;
+	void visit(nodes::IfNode& node) override;
+	void visit(nodes::StateNode& node) override;
+
+private:
+	NodeKindFinder() = default;
+
+	NodeKind m_kind = NodeKind::State;
+};
+
+}
+}
@@ -5,7 +5,7 @@
 #include "../visitors/centauriserializer.hpp"
 #include "../visitors/nodeduplicator.hpp"
 
-#include <sstream>
+#include <cstdio>
 
 namespace fsme
 {
@@ -37,10 +37,10 @@ void NodeMenuRenderer::visit(nodes::StateNode& node)
 
 	if (ImGui::Button("Export into Centauri format"))
 	{
-		std::ostringstream ss;
-		if (CentauriSerializer::serialize(ss, node))
+		detail::TextWriter text;
+		if (CentauriSerializer::serialize(text, node))
 		{
-			fputs(ss.str().c_str(), stdout);
+			fwrite(text.data(), 1, text.size(), stdout);
 		}
 	}
 }
@@ -58,22 +58,15 @@ void NodeMenuRenderer::render_generic_buttons(Node& node)
 	ImGui::SameLine();
 	if (ImGui::Button("Erase links"))
 	{
-		for (const auto& input : node.inputs())
-		{
-			editor.destroy_links_involving(input);
-		}
-
-		for (const auto& output : node.outputs())
-		{
-			editor.destroy_links_involving(output);
-		}
-
+		editor.destroy_links_involving(node);
 		ImGui::CloseCurrentPopup();
 	}
 
 	ImGui::SameLine();
 	if (ImGui::Button("Duplicate"))
 	{
+		editor.load_node_payload(node.node_id());
+
 		NodeDuplicator duplicator;
 		node.accept(duplicator);
 		ImGui::CloseCurrentPopup();
@@ -10,8 +10,9 @@ namespace visitors
 
 void NodeRenderer::visit(nodes::CondNode& node)
 {
-	const auto& editor = node.editor();
+	auto& editor = node.editor();
 	const bool editable = editor.is_node_selected(node.node_id());
+	bool edited = false;
 
 	ed::PushStyleColor(ed::StyleColor_NodeBg, ImVec4(0.5, 0.0, 1.0, 0.4));
 	ed::PushStyleColor(ed::StyleColor_NodeBorder, ImVec4(0.5, 0.0, 1.0, 1.0));
@@ -61,7 +62,7 @@ void NodeRenderer::visit(nodes::CondNode& node)
 		}
 
 		condition.set_autocomplete_provider(editor.get_autocomplete_provider());
-		condition.input_render(editable);
+		edited |= condition.input_render(editable);
 
 		ImGui::SameLine();
 		ed::BeginPin(output, ed::PinKind::Output);
@@ -82,7 +83,7 @@ void NodeRenderer::visit(nodes::CondNode& node)
 
 	ImGui::EndGroup();
 
-	ed::EndNode();
+	end_node(node);
 	ed::PopStyleColor(2);
 
 	for (const auto& output : node.outputs())
@@ -90,14 +91,19 @@ void NodeRenderer::visit(nodes::CondNode& node)
 		auto& condition = node.get_expression(output);
 
 		ImGui::PushID(&condition);
-		condition.popup_render();
+		edited |= condition.popup_render();
 		ImGui::PopID();
 	}
+
+	if (edited)
+	{
+		editor.notify_node_edited(node);
+	}
 }
 
 void NodeRenderer::visit(nodes::IfNode& node)
 {
-	const auto& editor = node.editor();
+	auto& editor = node.editor();
 	const bool editable = editor.is_node_selected(node.node_id());
 
 	ed::PushStyleColor(ed::StyleColor_NodeBg, ImVec4(0.5, 0.0, 1.0, 0.4));
@@ -116,8 +122,8 @@ void NodeRenderer::visit(nodes::IfNode& node)
 	auto& cond = node.get_expression();
 
 	cond.set_autocomplete_provider(editor.get_autocomplete_provider());
-	cond.input_render(editable);
-	cond.popup_render();
+	const bool input_edited = cond.input_render(editable);
+	const bool popup_edited = cond.popup_render();
 
 	ImGui::SameLine();
 	ImGui::BeginGroup();
@@ -133,18 +139,33 @@ void NodeRenderer::visit(nodes::IfNode& node)
 
 	ImGui::EndGroup();
 
-	ed::EndNode();
+	end_node(node);
 	ed::PopStyleVar(1);
 	ed::PopStyleColor(2);
+
+	if (input_edited || popup_edited)
+	{
+		editor.notify_node_edited(node);
+	}
 }
 
 void NodeRenderer::visit(nodes::StateNode& node)
 {
-	const auto& editor = node.editor();
+	auto& editor = node.editor();
 	const bool editable = editor.is_node_selected(node.node_id());
 
-	ed::PushStyleColor(ed::StyleColor_NodeBg, ImVec4(0.2, 0.6, 0.8, 0.4));
-	ed::PushStyleColor(ed::StyleColor_NodeBorder, ImVec4(0.2, 0.6, 0.8, 1.0));
+	// States whose conditions are costly to evaluate stand out, see widgets::CostPanel
+	if (editor.get_cost_panel().is_costly(node.node_id()))
+	{
+		ed::PushStyleColor(ed::StyleColor_NodeBg, ImVec4(0.8, 0.3, 0.2, 0.4));
+		ed::PushStyleColor(ed::StyleColor_NodeBorder, ImVec4(1.0, 0.3, 0.2, 1.0));
+	}
+	else
+	{
+		ed::PushStyleColor(ed::StyleColor_NodeBg, ImVec4(0.2, 0.6, 0.8, 0.4));
+		ed::PushStyleColor(ed::StyleColor_NodeBorder, ImVec4(0.2, 0.6, 0.8, 1.0));
+	}
+
 	ed::PushStyleVar(ed::StyleVar_NodeRounding, 2.0f);
 	ed::BeginNode(node.node_id());
 
@@ -166,7 +187,7 @@ void NodeRenderer::visit(nodes::StateNode& node)
 		ImGui::SetNextItemWidth(100.0f);
 		detail::imgui_set_default_keyboard_focus();
 	}
-	node.get_name_input().render(editable);
+	const bool edited = node.get_name_input().render(editable);
 
 	ImGui::EndGroup();
 	ImGui::SameLine();
@@ -181,9 +202,22 @@ void NodeRenderer::visit(nodes::StateNode& node)
 
 	ImGui::EndGroup();
 
-	ed::EndNode();
+	end_node(node);
 	ed::PopStyleVar(1);
 	ed::PopStyleColor(2);
+
+	if (edited)
+	{
+		editor.notify_node_edited(node);
+	}
+}
+
+void NodeRenderer::end_node(Node& node)
+{
+	ed::EndNode();
+
+	// The node is the last item submitted, and the node editor submits items in canvas coordinates
+	node.editor().update_node_layout(node.node_id(), ImGui::GetItemRectMin(), ImGui::GetItemRectSize());
 }
 
 }
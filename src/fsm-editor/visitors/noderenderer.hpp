@@ -1,5 +1,6 @@
 #pragma once
 
+#include "../fwd.hpp"
 #include "../visitor.hpp"
 
 namespace fsme
@@ -16,6 +17,12 @@ public:
 	void visit(nodes::CondNode& node) override;
 	void visit(nodes::IfNode& node) override;
 	void visit(nodes::StateNode& node) override;
+
+private:
+	/**
+	 * @brief Ends rendering \p node, recording where it was rendered, see FsmEditor::update_node_layout().
+	 */
+	void end_node(Node& node);
 };
 
 }
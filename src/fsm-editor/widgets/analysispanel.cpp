@@ -0,0 +1,252 @@
+#include "analysispanel.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+namespace fsme
+{
+namespace widgets
+{
+
+AnalysisPanel::~AnalysisPanel()
+{
+	if (m_analysis.valid())
+	{
+		m_analysis.wait();
+	}
+}
+
+void AnalysisPanel::render(FsmEditor& editor, GraphCompilation& compilation)
+{
+	ImGui::PushID(this);
+
+	finish_analysis();
+
+	const bool open = render_header("Dead logic", editor, compilation);
+
+	if (is_active(open))
+	{
+		const std::shared_ptr<const GraphCompilation::Result>& compiled = compilation.get_result();
+
+		if (!m_analysis.valid() && compiled != nullptr && (m_result == nullptr || m_result->compiled != compiled))
+		{
+			start_analysis(compiled);
+		}
+	}
+
+	if (open)
+	{
+		const bool up_to_date =
+			compilation.is_up_to_date() && m_result != nullptr && m_result->compiled == compilation.get_result();
+
+		render_controls(editor, compilation, m_analysis.valid(), up_to_date);
+
+		if (m_result != nullptr)
+		{
+			if (!up_to_date)
+			{
+				ImGui::TextWrapped("The graph was edited since it was analyzed.");
+			}
+
+			render_result();
+		}
+	}
+
+	ImGui::PopID();
+}
+
+void AnalysisPanel::reset()
+{
+	if (m_analysis.valid())
+	{
+		m_analysis.wait();
+		m_analysis = {};
+	}
+
+	m_result.reset();
+	m_unreachable_states.clear();
+	m_initial_state = 0;
+	m_node_to_show = {};
+}
+
+void AnalysisPanel::start_analysis(std::shared_ptr<const GraphCompilation::Result> compiled)
+{
+	std::unique_ptr<Result> result = std::make_unique<Result>();
+	result->compiled = std::move(compiled);
+
+	if (!result->compiled->error.empty())
+	{
+		// Nothing to analyze until the graph is edited again
+		std::promise<std::unique_ptr<Result>> failed;
+		failed.set_value(std::move(result));
+		m_analysis = failed.get_future();
+		return;
+	}
+
+	m_analysis = std::async(std::launch::async, [result = std::move(result)]() mutable {
+		result->report = simulation::ReachabilityAnalysis::analyze(result->compiled->fsm);
+		return std::move(result);
+	});
+}
+
+void AnalysisPanel::finish_analysis()
+{
+	if (!m_analysis.valid() || m_analysis.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+	{
+		return;
+	}
+
+	m_result = m_analysis.get();
+
+	if (m_initial_state >= m_result->compiled->fsm.state_count())
+	{
+		m_initial_state = 0;
+	}
+
+	m_unreachable_states = m_result->report.find_unreachable_states(m_initial_state);
+}
+
+void AnalysisPanel::render_result()
+{
+	const simulation::ReachabilityReport& report = m_result->report;
+
+	if (!m_result->compiled->error.empty())
+	{
+		ImGui::TextWrapped("Failed to compile: %s", m_result->compiled->error.c_str());
+		return;
+	}
+
+	if (!report.complete)
+	{
+		ImGui::TextWrapped("Gave up after exploring %d paths, the conditions share too many nodes.", int(report.context_count));
+		return;
+	}
+
+	if (m_result->compiled->fsm.state_count() != 0)
+	{
+		render_unreachable_states();
+	}
+
+	render_dead_branches();
+}
+
+void AnalysisPanel::render_unreachable_states()
+{
+	const simulation::CompiledFsm& fsm = m_result->compiled->fsm;
+
+	ImGui::Separator();
+	ImGui::Text("Initial state");
+
+	ImGui::SetNextItemWidth(ImGui::GetContentRegionAvailWidth());
+	if (ImGui::BeginCombo("##initial", fsm.state_names[m_initial_state].c_str()))
+	{
+		for (std::uint32_t i = 0; i < fsm.state_count(); ++i)
+		{
+			ImGui::PushID(int(i));
+
+			if (ImGui::Selectable(fsm.state_names[i].c_str(), i == m_initial_state))
+			{
+				m_initial_state = i;
+				m_unreachable_states = m_result->report.find_unreachable_states(i);
+			}
+
+			ImGui::PopID();
+		}
+
+		ImGui::EndCombo();
+	}
+
+	ImGui::Text("%d unreachable states", int(m_unreachable_states.size()));
+
+	const std::size_t shown_count = std::min(m_unreachable_states.size(), max_shown_entries);
+
+	for (std::size_t i = 0; i < shown_count; ++i)
+	{
+		const std::uint32_t state = m_unreachable_states[i];
+
+		ImGui::PushID(int(state));
+
+		if (ImGui::Selectable(fsm.state_names[state].c_str()))
+		{
+			m_node_to_show = fsm.state_nodes[state];
+		}
+
+		ImGui::PopID();
+	}
+}
+
+void AnalysisPanel::render_dead_branches()
+{
+	using Finding = simulation::ReachabilityReport::Finding;
+
+	const simulation::CompiledFsm& fsm = m_result->compiled->fsm;
+	const std::vector<simulation::ReachabilityReport::DeadBranch>& dead_branches = m_result->report.dead_branches;
+
+	ImGui::Separator();
+	ImGui::Text("%d dead branches", int(dead_branches.size()));
+
+	const std::size_t shown_count = std::min(dead_branches.size(), max_shown_entries);
+
+	for (std::size_t i = 0; i < shown_count; ++i)
+	{
+		const simulation::ReachabilityReport::DeadBranch& dead_branch = dead_branches[i];
+		std::string label = describe_branch(dead_branch.branch);
+
+		switch (dead_branch.finding)
+		{
+		case Finding::Unreachable:
+			label += " is never evaluated";
+			break;
+		case Finding::NeverTrue:
+			label += " never holds after " + describe_branch(dead_branch.cause) + " failed";
+			break;
+		case Finding::Shadowed:
+			label += " is shadowed by " + describe_branch(dead_branch.cause);
+			break;
+		case Finding::AlwaysTrue:
+			label += " always holds";
+			break;
+		}
+
+		ImGui::PushID(int(i));
+
+		if (ImGui::Selectable(label.c_str()))
+		{
+			m_node_to_show = fsm.branch_nodes[dead_branch.branch];
+		}
+
+		ImGui::PopID();
+	}
+}
+
+std::string AnalysisPanel::describe_branch(std::uint32_t branch) const
+{
+	const simulation::CompiledFsm& fsm = m_result->compiled->fsm;
+	const ed::NodeId node = fsm.branch_nodes[branch];
+
+	// The branches of a node are contiguous, see simulation::CompiledFsm
+	std::uint32_t first = branch;
+	while (first != 0 && fsm.branch_nodes[first - 1] == node)
+	{
+		--first;
+	}
+
+	std::uint32_t last = branch;
+	while (last + 1 < fsm.branch_nodes.size() && fsm.branch_nodes[last + 1] == node)
+	{
+		++last;
+	}
+
+	std::string description = "node " + std::to_string(std::uint32_t(std::uintptr_t(node)));
+
+	if (first != last)
+	{
+		description += " output " + std::to_string(branch - first + 1);
+	}
+
+	return description;
+}
+
+}
+}
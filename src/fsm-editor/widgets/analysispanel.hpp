@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../fwd.hpp"
+#include "../simulation/reachability.hpp"
+#include "../util/imgui.hpp"
+#include "compiledgraphpanel.hpp"
+#include "graphcompilation.hpp"
+
+namespace fsme
+{
+namespace widgets
+{
+
+/**
+ * @brief Panel listing the dead logic of the graph: unreachable states, and branches that can never be taken one way or
+ * the other, see simulation::ReachabilityAnalysis.
+ *
+ * @details The graph compiled by GraphCompilation is analyzed on a worker thread, once per compilation, see
+ * CompiledGraphPanel for when that happens.
+ */
+class AnalysisPanel : public CompiledGraphPanel
+{
+public:
+	~AnalysisPanel();
+
+	void render(FsmEditor& editor, GraphCompilation& compilation);
+
+	/**
+	 * @brief Forgets about the results, e.g. once the graph was cleared.
+	 */
+	void reset();
+
+private:
+	struct Result
+	{
+		/// @brief Graph that was analyzed, which gives meaning to the indices of the report
+		std::shared_ptr<const GraphCompilation::Result> compiled;
+		simulation::ReachabilityReport report;
+	};
+
+	void start_analysis(std::shared_ptr<const GraphCompilation::Result> compiled);
+
+	/**
+	 * @brief Keeps the result of the analysis once it is done.
+	 */
+	void finish_analysis();
+
+	void render_result();
+	void render_unreachable_states();
+	void render_dead_branches();
+
+	/**
+	 * @brief Returns a short description of \p branch, naming its node and its output for CondNode nodes.
+	 */
+	std::string describe_branch(std::uint32_t branch) const;
+
+	/// @brief Analysis running on a worker thread, if any
+	std::future<std::unique_ptr<Result>> m_analysis;
+
+	/// @brief Result of the last analysis, or nullptr if there was none
+	std::unique_ptr<Result> m_result;
+
+	/// @brief Initial state of the unreachable states, and the states that cannot be reached from it
+	std::uint32_t m_initial_state = 0;
+	std::vector<std::uint32_t> m_unreachable_states;
+};
+
+}
+}
@@ -4,6 +4,7 @@
 
 #include "imgui_internal.h" // YOLO: needed for the SelectableDontClosePopup flag
 
+#include <algorithm>
 #include <fstream>
 
 namespace fsme
@@ -15,8 +16,10 @@ BoolExpressionInput::BoolExpressionInput(std::size_t id) :
 	m_id(id)
 {}
 
-void BoolExpressionInput::input_render(bool editable)
+bool BoolExpressionInput::input_render(bool editable)
 {
+	bool edited = false;
+
 	switch (m_input_type)
 	{
 	case ExpressionInputType::PlainLuaExpression:
@@ -32,12 +35,13 @@ void BoolExpressionInput::input_render(bool editable)
 		if (ImGui::Button("Lua"))
 		{
 			m_input_type = ExpressionInputType::SimpleExpression;
+			edited = true;
 		}
 
 		ImGui::SameLine();
 		ImGui::SetNextItemWidth(120.0f);
 		detail::imgui_set_default_keyboard_focus();
-		ImGui::InputText("", m_lua_input.text_buffer.data(), m_lua_input.text_buffer.size());
+		edited |= ImGui::InputText("", m_lua_input.text_buffer.data(), m_lua_input.text_buffer.size());
 		break;
 	}
 
@@ -54,6 +58,7 @@ void BoolExpressionInput::input_render(bool editable)
 		if (ImGui::Button("Simple"))
 		{
 			m_input_type = ExpressionInputType::PlainLuaExpression;
+			edited = true;
 		}
 
 		ImGui::SameLine();
@@ -73,11 +78,14 @@ void BoolExpressionInput::input_render(bool editable)
 		break;
 	}
 	}
+
+	return edited;
 }
 
-void BoolExpressionInput::popup_render()
+bool BoolExpressionInput::popup_render()
 {
 	const bool is_in_node_editor = !ed::IsSuspended();
+	bool edited = false;
 
 	if (is_in_node_editor)
 	{
@@ -107,6 +115,7 @@ void BoolExpressionInput::popup_render()
 				if (ImGui::MenuItem(option.shorthand.c_str(), nullptr, true))
 				{
 					option_it = m_expr_input.options.erase(option_it);
+					edited = true;
 				}
 				else
 				{
@@ -142,6 +151,8 @@ void BoolExpressionInput::popup_render()
 				{
 					m_expr_input.options.insert(chosen_option);
 				}
+
+				edited = true;
 			}
 
 			break;
@@ -156,30 +167,36 @@ void BoolExpressionInput::popup_render()
 	{
 		ed::Resume();
 	}
+
+	return edited;
 }
 
 std::string BoolExpressionInput::as_lua_expression() const
+{
+	detail::TextWriter output;
+	write_lua_expression(output);
+	return std::string(output.data(), output.size());
+}
+
+void BoolExpressionInput::write_lua_expression(detail::TextWriter& output) const
 {
 	if (m_input_type == ExpressionInputType::PlainLuaExpression)
 	{
-		return m_lua_input.text_buffer.data();
+		output.write_c_string(m_lua_input.text_buffer.data());
+		return;
 	}
 
-	std::string ret;
-
 	std::size_t shown = 0;
 	for (const auto* option : m_expr_input.options)
 	{
 		++shown;
 
-		ret += option->lua_expression;
+		output.write(option->lua_expression);
 		if (shown != m_expr_input.options.size())
 		{
-			ret += " and ";
+			output.write(" and ", 5);
 		}
 	}
-
-	return ret;
 }
 
 const BoolExpressionOption* BoolExpressionAutocomplete::render(FilterOptions options)
@@ -208,12 +225,19 @@ const BoolExpressionOption* BoolExpressionAutocomplete::render(FilterOptions opt
 
 BoolExpressionOption* BoolExpressionAutocomplete::find_by_shorthand(const std::string& shorthand)
 {
+	return find_by_shorthand(od::gsl::span<const char>(shorthand.data(), shorthand.data() + shorthand.size()));
+}
+
+BoolExpressionOption* BoolExpressionAutocomplete::find_by_shorthand(od::gsl::span<const char> shorthand)
+{
+	const std::size_t size = std::size_t(shorthand.size());
+
 	// TODO: this is O(n) and it would not need to be with associative containers or cache
 	for (auto& category : m_categories)
 	{
 		for (auto& option : category.second.options)
 		{
-			if (option.shorthand == shorthand)
+			if (option.shorthand.size() == size && std::equal(shorthand.begin(), shorthand.end(), option.shorthand.begin()))
 			{
 				return &option;
 			}
@@ -223,6 +247,20 @@ BoolExpressionOption* BoolExpressionAutocomplete::find_by_shorthand(const std::s
 	return nullptr;
 }
 
+void add_centauri_options(BoolExpressionAutocomplete& autocomplete)
+{
+	// Costs count the Lua operations of each expression: a key check looks up self.inputs, its check method and the
+	// key, then calls into the engine, which weighs about as much as these lookups, whereas a flag is a single lookup
+	const float key_check_cost = 4.0f;
+	const float flag_cost = 1.0f;
+
+	autocomplete.add_option("Keys", {"space", "self.inputs:check(InputKey.Space)", key_check_cost});
+	autocomplete.add_option("Keys", {"lmb", "self.inputs:check(InputKey.MouseLeft)", key_check_cost});
+	autocomplete.add_option("Keys", {"down", "self.inputs:check(InputKey.Down)", key_check_cost});
+
+	autocomplete.add_option("Collision", {"on ground", "self.on_ground", flag_cost});
+}
+
 std::string SimpleExpressionInput::text_preview() const
 {
 	std::string ret;
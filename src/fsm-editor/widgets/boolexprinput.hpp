@@ -1,12 +1,18 @@
 #pragma once
 
 #include <array>
+#include <cstdint>
+#include <deque>
 #include <set>
 #include <string>
 #include <unordered_map>
 #include <vector>
 #include <istream>
 
+#include <onidev/core/span.h>
+
+#include "../util/textwriter.hpp"
+
 namespace fsme
 {
 namespace widgets
@@ -17,6 +23,13 @@ struct BoolExpressionOption
 	std::string shorthand;
 	std::string lua_expression;
 
+	/// @brief Relative cost of evaluating the option in the game, e.g. 1 for reading a flag, set along with the
+	/// catalog. Plain Lua expressions weigh 1, see simulation::CostAnalysis.
+	float cost = 1.0f;
+
+	/// @brief Dense index of the option within its BoolExpressionAutocomplete, assigned when the option is added
+	std::uint32_t index = 0;
+
 	const char* get_main_text() const
 	{
 		return !shorthand.empty() ? shorthand.c_str() : lua_expression.c_str();
@@ -30,7 +43,8 @@ struct BoolExpressionOption
 
 struct BoolExpressionCategory
 {
-	std::vector<BoolExpressionOption> options;
+	/// @brief Options of the category, which are never moved once added, as they are referred to by address
+	std::deque<BoolExpressionOption> options;
 };
 
 class BoolExpressionAutocomplete
@@ -46,13 +60,52 @@ class BoolExpressionAutocomplete
 
 	BoolExpressionOption* find_by_shorthand(const std::string& shorthand);
 
+	/**
+	 * @brief Looks up an option by shorthand without requiring an owning string, e.g. straight out of a file buffer.
+	 */
+	BoolExpressionOption* find_by_shorthand(od::gsl::span<const char> shorthand);
+
+	/**
+	 * @brief Returns the number of options, whose indices range from 0 to this number excluded.
+	 */
+	std::size_t option_count() const;
+
+	/**
+	 * @brief Returns the option whose BoolExpressionOption::index is \p index.
+	 */
+	const BoolExpressionOption& get_option(std::uint32_t index) const;
+
 	private:
 	std::unordered_map<std::string, BoolExpressionCategory> m_categories;
+
+	/// @brief Options of all categories, by index
+	std::vector<const BoolExpressionOption*> m_options;
 };
 
+/**
+ * @brief Adds the options that the game understands to \p autocomplete.
+ * @details Files refer to the options of simple expressions by shorthand, so anything that loads files must use the
+ *          same options, e.g. the editor and the batch exporter.
+ */
+void add_centauri_options(BoolExpressionAutocomplete& autocomplete);
+
 inline void BoolExpressionAutocomplete::add_option(const std::string& category, BoolExpressionOption&& option)
 {
-	m_categories[category].options.emplace_back(std::move(option));
+	auto& options = m_categories[category].options;
+
+	option.index = std::uint32_t(m_options.size());
+	options.emplace_back(std::move(option));
+	m_options.push_back(&options.back());
+}
+
+inline std::size_t BoolExpressionAutocomplete::option_count() const
+{
+	return m_options.size();
+}
+
+inline const BoolExpressionOption& BoolExpressionAutocomplete::get_option(std::uint32_t index) const
+{
+	return *m_options[index];
 }
 
 enum class ExpressionInputType
@@ -80,11 +133,23 @@ public:
 
 	void set_autocomplete_provider(BoolExpressionAutocomplete* autocomplete_provider);
 
-	void input_render(bool editable);
-	void popup_render();
+	/**
+	 * @return Whether the expression was edited.
+	 */
+	bool input_render(bool editable);
+
+	/**
+	 * @return Whether the expression was edited.
+	 */
+	bool popup_render();
 
 	std::string as_lua_expression() const;
 
+	/**
+	 * @brief Writes the Lua expression to \p output, like as_lua_expression() but without building a string.
+	 */
+	void write_lua_expression(detail::TextWriter& output) const;
+
 	ExpressionInputType get_input_type() const { return m_input_type; }
 	void set_input_type(ExpressionInputType type) { m_input_type = type; }
 
@@ -93,6 +158,11 @@ public:
 
 	std::size_t get_id() const;
 
+	/**
+	 * @brief Changes the ID of the expression, e.g. when it collides with another ID, see FsmEditor::new_expression_id().
+	 */
+	void set_id(std::size_t id);
+
 private:
 	BoolExpressionAutocomplete* m_autocomplete_provider = nullptr;
 
@@ -113,5 +183,10 @@ inline std::size_t BoolExpressionInput::get_id() const
 	return m_id;
 }
 
+inline void BoolExpressionInput::set_id(std::size_t id)
+{
+	m_id = id;
+}
+
 }
 }
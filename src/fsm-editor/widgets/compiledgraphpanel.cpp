@@ -0,0 +1,37 @@
+#include "compiledgraphpanel.hpp"
+
+namespace fsme
+{
+namespace widgets
+{
+
+constexpr std::size_t CompiledGraphPanel::max_shown_entries;
+
+bool CompiledGraphPanel::render_header(const char* label, FsmEditor& editor, GraphCompilation& compilation)
+{
+	const bool open = ImGui::CollapsingHeader(label);
+
+	if (is_active(open))
+	{
+		compilation.compile_when_settled(editor);
+	}
+
+	return open;
+}
+
+void CompiledGraphPanel::render_controls(FsmEditor& editor, GraphCompilation& compilation, bool busy, bool up_to_date)
+{
+	ImGui::Checkbox("Keep up to date", &m_keep_up_to_date);
+
+	if (busy || compilation.is_compiling())
+	{
+		ImGui::Text("Analyzing...");
+	}
+	else if (!up_to_date && ImGui::Button("Analyze"))
+	{
+		compilation.compile(editor);
+	}
+}
+
+}
+}
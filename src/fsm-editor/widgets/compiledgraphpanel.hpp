@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+
+#include "../fwd.hpp"
+#include "../util/imgui.hpp"
+#include "graphcompilation.hpp"
+
+namespace fsme
+{
+namespace widgets
+{
+
+/**
+ * @brief Base of the sidebar panels that inspect the graph compiled by GraphCompilation, e.g. AnalysisPanel.
+ *
+ * @details Panels only ask for the graph to be compiled while they are open, unless the user asks to keep them up to
+ * date regardless, as compiling decodes the contents of every node. Entries of the panels may be clicked to show
+ * their node in the canvas, see take_node_to_show().
+ */
+class CompiledGraphPanel
+{
+public:
+	/**
+	 * @brief Returns the node that the canvas was asked to show since the last call, if any, then forgets about it.
+	 */
+	ed::NodeId take_node_to_show();
+
+protected:
+	/// @brief Number of entries shown per list, so that large or broken graphs do not flood the panel
+	static constexpr std::size_t max_shown_entries = 100;
+
+	/**
+	 * @brief Renders the collapsing header of the panel, and asks for the graph to be compiled once edits have
+	 * settled if the panel is open or kept up to date.
+	 * @return Whether the panel is open.
+	 */
+	bool render_header(const char* label, FsmEditor& editor, GraphCompilation& compilation);
+
+	/**
+	 * @brief Renders the "Keep up to date" checkbox, then tells that the panel is \p busy, or offers to compile the
+	 * graph right away if the results of the panel are not \p up_to_date.
+	 */
+	void render_controls(FsmEditor& editor, GraphCompilation& compilation, bool busy, bool up_to_date);
+
+	/**
+	 * @brief Returns whether the panel should process the compiled graph, i.e. whether it is open or kept up to date.
+	 */
+	bool is_active(bool open) const;
+
+	bool m_keep_up_to_date = false;
+
+	ed::NodeId m_node_to_show;
+};
+
+inline ed::NodeId CompiledGraphPanel::take_node_to_show()
+{
+	const ed::NodeId node = m_node_to_show;
+	m_node_to_show = {};
+	return node;
+}
+
+inline bool CompiledGraphPanel::is_active(bool open) const
+{
+	return open || m_keep_up_to_date;
+}
+
+}
+}
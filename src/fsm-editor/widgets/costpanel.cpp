@@ -0,0 +1,171 @@
+#include "costpanel.hpp"
+
+#include "../editor.hpp"
+#include "boolexprinput.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdio>
+
+namespace fsme
+{
+namespace widgets
+{
+
+void CostPanel::render(FsmEditor& editor, GraphCompilation& compilation)
+{
+	ImGui::PushID(this);
+
+	const bool open = render_header("Cost", editor, compilation);
+
+	if (is_active(open) && compilation.get_result() != nullptr && compilation.get_result() != m_compiled)
+	{
+		analyze(editor, compilation.get_result());
+	}
+
+	if (open)
+	{
+		const bool up_to_date = compilation.is_up_to_date() && m_compiled == compilation.get_result();
+
+		render_controls(editor, compilation, false, up_to_date);
+
+		if (m_compiled != nullptr)
+		{
+			if (!up_to_date)
+			{
+				ImGui::TextWrapped("The graph was edited since it was costed.");
+			}
+
+			render_result();
+		}
+	}
+
+	ImGui::PopID();
+}
+
+void CostPanel::reset()
+{
+	m_compiled.reset();
+	m_report = {};
+	m_sorted_states.clear();
+	m_node_to_show = {};
+}
+
+bool CostPanel::is_costly(ed::NodeId state) const
+{
+	if (!m_highlight || m_compiled == nullptr)
+	{
+		return false;
+	}
+
+	const std::vector<ed::NodeId>& state_nodes = m_compiled->fsm.state_nodes;
+
+	// State nodes are sorted by ID, see simulation::CompiledFsm
+	const auto found = std::lower_bound(
+		state_nodes.begin(),
+		state_nodes.end(),
+		state,
+		[](ed::NodeId a, ed::NodeId b) { return std::uintptr_t(a) < std::uintptr_t(b); }
+	);
+
+	if (found == state_nodes.end() || *found != state)
+	{
+		return false;
+	}
+
+	return m_report.states[found - state_nodes.begin()].worst_case >= m_threshold;
+}
+
+void CostPanel::analyze(FsmEditor& editor, std::shared_ptr<const GraphCompilation::Result> compiled)
+{
+	m_compiled = std::move(compiled);
+	m_report = {};
+	m_sorted_states.clear();
+
+	// Nothing to cost until the graph is edited again
+	if (!m_compiled->error.empty())
+	{
+		return;
+	}
+
+	const simulation::CompiledFsm& fsm = m_compiled->fsm;
+
+	// Options are the first inputs, the other ones being plain Lua expressions, see visitors::FsmCompiler
+	const BoolExpressionAutocomplete* autocomplete = editor.get_autocomplete_provider();
+	const std::size_t option_count = autocomplete != nullptr ? autocomplete->option_count() : 0;
+
+	std::vector<float> input_costs(fsm.input_count(), 1.0f);
+	for (std::uint32_t i = 0; i < option_count; ++i)
+	{
+		input_costs[i] = autocomplete->get_option(i).cost;
+	}
+
+	m_report = simulation::CostAnalysis::analyze(fsm, input_costs);
+
+	m_sorted_states.resize(fsm.state_count());
+	for (std::uint32_t i = 0; i < m_sorted_states.size(); ++i)
+	{
+		m_sorted_states[i] = i;
+	}
+
+	std::stable_sort(m_sorted_states.begin(), m_sorted_states.end(), [this](std::uint32_t a, std::uint32_t b) {
+		const simulation::CostReport::Cost& cost_a = m_report.states[a];
+		const simulation::CostReport::Cost& cost_b = m_report.states[b];
+
+		if (cost_a.worst_case != cost_b.worst_case)
+		{
+			return cost_a.worst_case > cost_b.worst_case;
+		}
+
+		return cost_a.average > cost_b.average;
+	});
+}
+
+void CostPanel::render_result()
+{
+	const simulation::CompiledFsm& fsm = m_compiled->fsm;
+
+	if (!m_compiled->error.empty())
+	{
+		ImGui::TextWrapped("Failed to compile: %s", m_compiled->error.c_str());
+		return;
+	}
+
+	ImGui::Separator();
+	ImGui::Checkbox("Highlight costly states", &m_highlight);
+
+	ImGui::SetNextItemWidth(ImGui::GetContentRegionAvailWidth());
+	ImGui::DragFloat("##threshold", &m_threshold, 0.1f, 0.0f, FLT_MAX, "Worst case from %.1f");
+
+	const std::size_t costly_count = std::count_if(
+		m_report.states.begin(),
+		m_report.states.end(),
+		[this](const simulation::CostReport::Cost& cost) { return cost.worst_case >= m_threshold; }
+	);
+
+	ImGui::Text("%d costly states", int(costly_count));
+	ImGui::TextDisabled("Worst case, average, state");
+
+	const std::size_t shown_count = std::min(m_sorted_states.size(), max_shown_entries);
+
+	for (std::size_t i = 0; i < shown_count; ++i)
+	{
+		const std::uint32_t state = m_sorted_states[i];
+		const simulation::CostReport::Cost& cost = m_report.states[state];
+
+		ImGui::PushID(int(state));
+
+		char costs[64];
+		std::snprintf(costs, sizeof(costs), "%.1f  %.2f  ", cost.worst_case, cost.average);
+
+		if (ImGui::Selectable((costs + fsm.state_names[state]).c_str()))
+		{
+			m_node_to_show = fsm.state_nodes[state];
+		}
+
+		ImGui::PopID();
+	}
+}
+
+}
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "../fwd.hpp"
+#include "../simulation/costanalysis.hpp"
+#include "../util/imgui.hpp"
+#include "compiledgraphpanel.hpp"
+#include "graphcompilation.hpp"
+
+namespace fsme
+{
+namespace widgets
+{
+
+/**
+ * @brief Panel listing the states of the graph by how costly they are to step, see simulation::CostAnalysis, where
+ * each option weighs its BoolExpressionOption::cost.
+ *
+ * @details The graph compiled by GraphCompilation is costed once per compilation, which takes time linear in its size,
+ * see CompiledGraphPanel for when that happens. States whose worst case reaches a threshold are highlighted in the
+ * canvas, see is_costly().
+ */
+class CostPanel : public CompiledGraphPanel
+{
+public:
+	void render(FsmEditor& editor, GraphCompilation& compilation);
+
+	/**
+	 * @brief Forgets about the results, e.g. once the graph was cleared.
+	 */
+	void reset();
+
+	/**
+	 * @brief Returns whether the worst case of \p state reached the threshold when the graph was last costed, or false
+	 * if costly states are not highlighted.
+	 */
+	bool is_costly(ed::NodeId state) const;
+
+private:
+	void analyze(FsmEditor& editor, std::shared_ptr<const GraphCompilation::Result> compiled);
+
+	void render_result();
+
+	bool m_highlight = true;
+
+	/// @brief Worst case from which states are highlighted
+	float m_threshold = 10.0f;
+
+	/// @brief Graph that was costed, which gives meaning to the indices of the report, or nullptr if none was
+	std::shared_ptr<const GraphCompilation::Result> m_compiled;
+	simulation::CostReport m_report;
+
+	/// @brief States by decreasing worst case, then by decreasing average
+	std::vector<std::uint32_t> m_sorted_states;
+};
+
+}
+}
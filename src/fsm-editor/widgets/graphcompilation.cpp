@@ -0,0 +1,133 @@
+#include "graphcompilation.hpp"
+
+#include "../editor.hpp"
+#include "../visitors/fsmcompiler.hpp"
+#include "../visitors/nativeserializer.hpp"
+
+#include <chrono>
+#include <stdexcept>
+#include <utility>
+
+namespace fsme
+{
+namespace widgets
+{
+
+namespace
+{
+
+/// @brief Seconds without edits after which compile_when_settled() compiles the graph
+constexpr double settle_delay = 1.0;
+
+}
+
+GraphCompilation::~GraphCompilation()
+{
+	if (m_compilation.valid())
+	{
+		m_compilation.wait();
+	}
+}
+
+void GraphCompilation::update()
+{
+	if (m_compilation.valid() && m_compilation.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+	{
+		m_result = m_compilation.get();
+	}
+
+	if (m_seen_revision != m_revision)
+	{
+		m_seen_revision = m_revision;
+		m_seen_time = ImGui::GetTime();
+	}
+}
+
+void GraphCompilation::compile(FsmEditor& editor)
+{
+	// A revision edited during the compilation gets compiled once the compilation is done
+	if (is_compiling() || is_up_to_date())
+	{
+		return;
+	}
+
+	const std::uint64_t revision = m_revision;
+	const BoolExpressionAutocomplete* autocomplete = editor.get_autocomplete_provider();
+
+	// Node contents that were not decoded yet are decoded by the worker, along with compiling
+	auto snapshot = visitors::NativeSerializer::snapshot(editor);
+
+	m_compilation = std::async(std::launch::async, [revision, autocomplete, snapshot = std::move(snapshot)]() mutable {
+		auto result = std::make_shared<Result>();
+		result->revision = revision;
+
+		try
+		{
+			result->fsm = visitors::FsmCompiler::compile(std::move(snapshot), autocomplete);
+		}
+		catch (const std::runtime_error& e)
+		{
+			result->error = e.what();
+		}
+
+		return std::shared_ptr<const Result>(std::move(result));
+	});
+}
+
+void GraphCompilation::compile_when_settled(FsmEditor& editor)
+{
+	if (ImGui::GetTime() - m_seen_time >= settle_delay)
+	{
+		compile(editor);
+	}
+}
+
+void GraphCompilation::reset()
+{
+	if (m_compilation.valid())
+	{
+		m_compilation.wait();
+		m_compilation = {};
+	}
+
+	m_result.reset();
+	mark_edited();
+}
+
+void GraphCompilation::on_node_created(Node&)
+{
+	mark_edited();
+}
+
+void GraphCompilation::on_node_destroyed(Node&)
+{
+	mark_edited();
+}
+
+void GraphCompilation::on_pins_changed(Node&, PinType, od::gsl::span<const ed::PinId>)
+{
+	mark_edited();
+}
+
+void GraphCompilation::on_link_created(ed::LinkId, const PinPair&)
+{
+	mark_edited();
+}
+
+void GraphCompilation::on_link_destroyed(ed::LinkId, const PinPair&)
+{
+	mark_edited();
+}
+
+void GraphCompilation::on_node_edited(Node&)
+{
+	mark_edited();
+}
+
+void GraphCompilation::mark_edited()
+{
+	++m_revision;
+}
+
+}
+}
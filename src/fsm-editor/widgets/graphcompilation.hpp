@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+
+#include "../editobserver.hpp"
+#include "../fwd.hpp"
+#include "../simulation/compiledfsm.hpp"
+
+namespace fsme
+{
+namespace widgets
+{
+
+/**
+ * @brief Compiles the graph for the panels that inspect it, once per revision of the graph, off the UI thread.
+ *
+ * @details Edits are counted through EditObserver to tell revisions apart. Compiling a revision takes a snapshot of
+ * the graph on the UI thread (see visitors::NativeSerializer::snapshot()), which a worker thread then compiles, see
+ * visitors::FsmCompiler. Panels share the compiled graph, so that a revision is compiled once however many panels
+ * look at it, and nothing is compiled unless a panel asks for it.
+ */
+class GraphCompilation : public EditObserver
+{
+public:
+	struct Result
+	{
+		/// @brief Revision of the graph that was compiled
+		std::uint64_t revision = 0;
+
+		simulation::CompiledFsm fsm;
+
+		/// @brief Why the graph could not be compiled, if it could not
+		std::string error;
+	};
+
+	~GraphCompilation() override;
+
+	/**
+	 * @brief Keeps the result of the compilation once it is done, and tracks how long ago the graph was last edited.
+	 * @details This is called once per frame, before the panels render.
+	 */
+	void update();
+
+	/**
+	 * @brief Starts compiling the current revision of the graph, unless it is compiled or being compiled already.
+	 */
+	void compile(FsmEditor& editor);
+
+	/**
+	 * @brief Calls compile() once edits have settled for a moment, so that the graph is not compiled for each
+	 * keystroke.
+	 */
+	void compile_when_settled(FsmEditor& editor);
+
+	/**
+	 * @brief Forgets about the result, e.g. once the graph was cleared.
+	 */
+	void reset();
+
+	bool is_compiling() const;
+
+	/**
+	 * @brief Returns the current revision of the graph, which Result::revision tells apart from.
+	 */
+	std::uint64_t get_revision() const;
+
+	/**
+	 * @brief Returns whether the result is that of the current revision of the graph.
+	 */
+	bool is_up_to_date() const;
+
+	/**
+	 * @brief Returns the result of the last compilation, or nullptr if there was none.
+	 * @details Results are never modified once done, so that they can be kept and read from any thread.
+	 */
+	const std::shared_ptr<const Result>& get_result() const;
+
+	void on_node_created(Node& node) override;
+	void on_node_destroyed(Node& node) override;
+	void on_pins_changed(Node& node, PinType side, od::gsl::span<const ed::PinId> previous_pins) override;
+	void on_link_created(ed::LinkId link, const PinPair& pins) override;
+	void on_link_destroyed(ed::LinkId link, const PinPair& pins) override;
+	void on_node_edited(Node& node) override;
+
+private:
+	void mark_edited();
+
+	/// @brief Number of edits made to the graph so far
+	std::uint64_t m_revision = 1;
+
+	/// @brief Revision seen by the last update(), and when it was first seen
+	std::uint64_t m_seen_revision = 0;
+	double m_seen_time = 0.0;
+
+	/// @brief Compilation running on a worker thread, if any
+	std::future<std::shared_ptr<const Result>> m_compilation;
+
+	std::shared_ptr<const Result> m_result;
+};
+
+inline bool GraphCompilation::is_compiling() const
+{
+	return m_compilation.valid();
+}
+
+inline std::uint64_t GraphCompilation::get_revision() const
+{
+	return m_revision;
+}
+
+inline bool GraphCompilation::is_up_to_date() const
+{
+	return m_result != nullptr && m_result->revision == m_revision;
+}
+
+inline const std::shared_ptr<const GraphCompilation::Result>& GraphCompilation::get_result() const
+{
+	return m_result;
+}
+
+}
+}
@@ -0,0 +1,555 @@
+#include "simulatorpanel.hpp"
+
+#include "../simulation/batchsimulator.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace fsme
+{
+namespace widgets
+{
+
+SimulatorPanel::SimulatorPanel()
+{
+	m_trace_path.set_hint("Trace file");
+}
+
+SimulatorPanel::~SimulatorPanel()
+{
+	cancel_batch();
+	cancel_replay();
+}
+
+void SimulatorPanel::render(FsmEditor& editor, GraphCompilation& compilation)
+{
+	ImGui::PushID(this);
+
+	finish_batch();
+	finish_replay();
+
+	if (ImGui::Button(m_simulator != nullptr ? "Recompile" : "Simulate"))
+	{
+		m_compile_requested = true;
+	}
+
+	if (m_compile_requested)
+	{
+		// Edits made during a compilation get compiled once it is done
+		if (compilation.is_up_to_date())
+		{
+			m_compile_requested = false;
+			adopt(*compilation.get_result());
+		}
+		else
+		{
+			compilation.compile(editor);
+			ImGui::TextUnformatted("Compiling...");
+		}
+	}
+
+	if (!m_error.empty())
+	{
+		ImGui::TextWrapped("Failed to compile: %s", m_error.c_str());
+	}
+
+	if (m_simulator != nullptr)
+	{
+		if (m_revision != compilation.get_revision())
+		{
+			ImGui::TextWrapped("The graph was edited since it was compiled.");
+		}
+
+		render_simulation();
+	}
+
+	ImGui::PopID();
+}
+
+void SimulatorPanel::reset()
+{
+	cancel_batch();
+	m_batch_result = {};
+
+	cancel_replay();
+	m_replay_result = {};
+	m_replay_error.clear();
+	m_link_heat.clear();
+
+	m_simulator.reset();
+	m_fsm = {};
+	m_error.clear();
+	m_revision = 0;
+	m_compile_requested = false;
+	m_running = false;
+	m_tick_count = 0;
+	m_transition_count = 0;
+	m_node_to_show = {};
+}
+
+ed::NodeId SimulatorPanel::take_node_to_show()
+{
+	const ed::NodeId node = m_node_to_show;
+	m_node_to_show = {};
+	return node;
+}
+
+float SimulatorPanel::get_link_heat(ed::LinkId link) const
+{
+	const float* heat = m_show_heat ? m_link_heat.find(link) : nullptr;
+	return heat != nullptr ? *heat : 0.0f;
+}
+
+void SimulatorPanel::adopt(const GraphCompilation::Result& result)
+{
+	// The entity keeps its state and inputs across compilations, as far as they still exist
+	std::string state_name;
+	std::vector<std::pair<std::string, bool>> inputs;
+
+	if (m_simulator != nullptr && m_fsm.state_count() != 0)
+	{
+		state_name = m_fsm.state_names[m_simulator->get_state(0)];
+
+		for (std::uint32_t i = 0; i < m_fsm.input_count(); ++i)
+		{
+			inputs.emplace_back(m_fsm.input_names[i], m_simulator->get_input(0, i));
+		}
+	}
+
+	reset();
+	m_revision = result.revision;
+
+	if (!result.error.empty())
+	{
+		m_error = result.error;
+		return;
+	}
+
+	m_fsm = result.fsm;
+	m_simulator = std::make_unique<simulation::Simulator>(m_fsm);
+
+	if (m_fsm.state_count() == 0)
+	{
+		return;
+	}
+
+	const auto state_it = std::find(m_fsm.state_names.begin(), m_fsm.state_names.end(), state_name);
+	m_simulator->add_entity(state_it != m_fsm.state_names.end() ? std::uint32_t(state_it - m_fsm.state_names.begin()) : 0);
+
+	for (const auto& input : inputs)
+	{
+		const auto input_it = std::find(m_fsm.input_names.begin(), m_fsm.input_names.end(), input.first);
+
+		if (input_it != m_fsm.input_names.end())
+		{
+			m_simulator->set_input(0, std::uint32_t(input_it - m_fsm.input_names.begin()), input.second);
+		}
+	}
+}
+
+void SimulatorPanel::render_simulation()
+{
+	ImGui::Text("%d states, %d branches", int(m_fsm.state_count()), int(m_fsm.branches.size()));
+
+	if (m_simulator->entity_count() == 0)
+	{
+		return;
+	}
+
+	ImGui::Separator();
+
+	std::uint32_t state = m_simulator->get_state(0);
+
+	ImGui::SetNextItemWidth(ImGui::GetContentRegionAvailWidth());
+	if (ImGui::BeginCombo("##state", m_fsm.state_names[state].c_str()))
+	{
+		for (std::uint32_t i = 0; i < m_fsm.state_count(); ++i)
+		{
+			ImGui::PushID(int(i));
+
+			if (ImGui::Selectable(m_fsm.state_names[i].c_str(), i == state))
+			{
+				m_simulator->set_state(0, i);
+				state = i;
+			}
+
+			ImGui::PopID();
+		}
+
+		ImGui::EndCombo();
+	}
+
+	if (ImGui::Button("Show"))
+	{
+		m_node_to_show = m_fsm.state_nodes[state];
+	}
+
+	ImGui::SameLine();
+
+	if (ImGui::Button("Step") || m_running)
+	{
+		m_transition_count += m_simulator->tick();
+		++m_tick_count;
+	}
+
+	ImGui::SameLine();
+	ImGui::Checkbox("Run", &m_running);
+
+	ImGui::Text("%d ticks, %d transitions", int(m_tick_count), int(m_transition_count));
+
+	ImGui::Separator();
+	ImGui::Text("Inputs");
+
+	for (std::uint32_t i = 0; i < m_fsm.input_count(); ++i)
+	{
+		bool value = m_simulator->get_input(0, i);
+
+		ImGui::PushID(int(i));
+
+		if (ImGui::Checkbox(m_fsm.input_names[i].c_str(), &value))
+		{
+			m_simulator->set_input(0, i, value);
+		}
+
+		ImGui::PopID();
+	}
+
+	render_batch();
+	render_replay();
+}
+
+void SimulatorPanel::render_batch()
+{
+	if (!ImGui::CollapsingHeader("Many entities"))
+	{
+		return;
+	}
+
+	ImGui::InputInt("Entities", &m_batch_entity_count);
+	ImGui::InputInt("Ticks", &m_batch_tick_count);
+	m_batch_entity_count = std::max(m_batch_entity_count, 1);
+	m_batch_tick_count = std::max(m_batch_tick_count, 1);
+
+	if (m_batch.valid())
+	{
+		ImGui::ProgressBar(m_batch_progress.load(), ImVec2(-1.0f, 0.0f));
+
+		if (ImGui::Button("Cancel"))
+		{
+			cancel_batch();
+		}
+
+		return;
+	}
+
+	if (ImGui::Button("Run from this state"))
+	{
+		start_batch();
+		return;
+	}
+
+	const BatchResult& result = m_batch_result;
+
+	if (result.entity_tick_count == 0)
+	{
+		return;
+	}
+
+	ImGui::Text("%.2f M entity ticks/s", double(result.entity_tick_count) / result.seconds / 1e6);
+	ImGui::Text("%.2f M transitions/s", double(result.transition_count) / result.seconds / 1e6);
+
+	ImGui::PlotHistogram(
+		"##occupancy",
+		result.occupancy.data(),
+		int(result.occupancy.size()),
+		0,
+		"Occupancy",
+		0.0f,
+		FLT_MAX,
+		ImVec2(ImGui::GetContentRegionAvailWidth(), 80.0f)
+	);
+
+	// The busiest states, which a click shows on the canvas
+	const std::size_t shown_count = std::min<std::size_t>(result.states.size(), 10);
+
+	for (std::size_t i = 0; i < shown_count; ++i)
+	{
+		const std::uint32_t state = result.states[i];
+
+		ImGui::PushID(int(state));
+
+		if (ImGui::Selectable(m_fsm.state_names[state].c_str()))
+		{
+			m_node_to_show = m_fsm.state_nodes[state];
+		}
+
+		ImGui::SameLine(ImGui::GetContentRegionAvailWidth() - 40.0f);
+		ImGui::Text("%5.1f%%", result.occupancy[state] * 100.0f);
+
+		ImGui::PopID();
+	}
+}
+
+void SimulatorPanel::start_batch()
+{
+	cancel_batch();
+	m_batch_result = {};
+	m_batch_cancelled = false;
+	m_batch_progress = 0.0f;
+
+	// The run works on a copy of the graph, as it may be compiled again in the meantime
+	const auto fsm = std::make_shared<const simulation::CompiledFsm>(m_fsm);
+	const std::uint32_t initial_state = m_simulator->get_state(0);
+	const std::size_t entity_count = std::size_t(m_batch_entity_count);
+	const int tick_count = m_batch_tick_count;
+
+	m_batch = std::async(std::launch::async, [this, fsm, initial_state, entity_count, tick_count] {
+		simulation::BatchSimulator simulator(*fsm);
+		simulator.reset(entity_count, initial_state);
+
+		// Each input is true for half of the entities, drawn again before every tick
+		std::mt19937_64 rng(1234);
+		std::chrono::steady_clock::duration duration{};
+
+		for (int i = 0; i < tick_count && !m_batch_cancelled; ++i)
+		{
+			for (std::size_t word = 0; word < fsm->input_word_count(); ++word)
+			{
+				for (std::uint64_t& bits : simulator.get_input_words(word))
+				{
+					bits = rng();
+				}
+			}
+
+			const auto start = std::chrono::steady_clock::now();
+			simulator.tick();
+			duration += std::chrono::steady_clock::now() - start;
+
+			m_batch_progress = float(i + 1) / float(tick_count);
+		}
+
+		BatchResult result;
+
+		if (simulator.get_tick_count() == 0)
+		{
+			return result;
+		}
+
+		result.seconds = std::max(std::chrono::duration<double>(duration).count(), 1e-9);
+		result.entity_tick_count = std::uint64_t(entity_count) * simulator.get_tick_count();
+		result.transition_count = simulator.get_transition_count();
+
+		const std::vector<std::uint64_t>& occupancy = simulator.get_occupancy();
+
+		for (std::uint32_t state = 0; state < occupancy.size(); ++state)
+		{
+			result.occupancy.push_back(float(double(occupancy[state]) / double(result.entity_tick_count)));
+			result.states.push_back(state);
+		}
+
+		std::stable_sort(result.states.begin(), result.states.end(), [&](std::uint32_t lhs, std::uint32_t rhs) {
+			return occupancy[lhs] > occupancy[rhs];
+		});
+
+		return result;
+	});
+}
+
+void SimulatorPanel::finish_batch()
+{
+	if (m_batch.valid() && m_batch.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+	{
+		m_batch_result = m_batch.get();
+	}
+}
+
+void SimulatorPanel::cancel_batch()
+{
+	if (m_batch.valid())
+	{
+		m_batch_cancelled = true;
+		m_batch.get();
+	}
+}
+
+void SimulatorPanel::render_replay()
+{
+	if (!ImGui::CollapsingHeader("Trace replay"))
+	{
+		return;
+	}
+
+	ImGui::PushID("trace");
+	ImGui::SetNextItemWidth(ImGui::GetContentRegionAvailWidth());
+	m_trace_path.render(!m_replay.valid());
+	ImGui::PopID();
+
+	if (m_replay.valid())
+	{
+		ImGui::ProgressBar(m_replay_progress.load(), ImVec2(-1.0f, 0.0f));
+
+		if (ImGui::Button("Cancel"))
+		{
+			cancel_replay();
+		}
+
+		return;
+	}
+
+	if (ImGui::Button("Replay from this state"))
+	{
+		start_replay();
+		return;
+	}
+
+	if (!m_replay_error.empty())
+	{
+		ImGui::TextWrapped("Failed to replay: %s", m_replay_error.c_str());
+	}
+
+	if (m_replay_result.step_count == 0)
+	{
+		return;
+	}
+
+	ImGui::Text(
+		"%llu steps of %d entities over %llu ticks",
+		static_cast<unsigned long long>(m_replay_result.step_count),
+		int(m_replay_result.entity_count),
+		static_cast<unsigned long long>(m_replay_result.tick_count)
+	);
+	ImGui::Text("%llu transitions", static_cast<unsigned long long>(m_replay_result.transition_count));
+	ImGui::Checkbox("Heat map", &m_show_heat);
+
+	// The hottest links, whose source node a click shows on the canvas
+	const std::size_t shown_count = std::min<std::size_t>(m_replay_result.link_counts.size(), 10);
+
+	for (std::size_t i = 0; i < shown_count; ++i)
+	{
+		const simulation::TraceReplayer::LinkCount& link_count = m_replay_result.link_counts[i];
+
+		const auto state_it = std::lower_bound(
+			m_fsm.state_nodes.begin(),
+			m_fsm.state_nodes.end(),
+			link_count.node,
+			[](ed::NodeId a, ed::NodeId b) { return std::uintptr_t(a) < std::uintptr_t(b); }
+		);
+
+		std::string source;
+
+		if (state_it != m_fsm.state_nodes.end() && *state_it == link_count.node)
+		{
+			source = m_fsm.state_names[std::size_t(state_it - m_fsm.state_nodes.begin())];
+		}
+		else
+		{
+			source = "node " + std::to_string(std::uint32_t(std::uintptr_t(link_count.node)));
+		}
+
+		ImGui::PushID(int(i));
+
+		if (ImGui::Selectable(source.c_str()))
+		{
+			m_node_to_show = link_count.node;
+		}
+
+		ImGui::SameLine(ImGui::GetContentRegionAvailWidth() - 60.0f);
+		ImGui::Text("%llu", static_cast<unsigned long long>(link_count.count));
+
+		ImGui::PopID();
+	}
+}
+
+void SimulatorPanel::start_replay()
+{
+	cancel_replay();
+	m_replay_result = {};
+	m_replay_error.clear();
+	m_link_heat.clear();
+	m_replay_cancelled = false;
+	m_replay_progress = 0.0f;
+
+	// The replay works on a copy of the graph, as it may be compiled again in the meantime
+	const auto fsm = std::make_shared<const simulation::CompiledFsm>(m_fsm);
+	const std::uint32_t initial_state = m_simulator->get_state(0);
+
+	m_replay = std::async(std::launch::async, [this, fsm, initial_state, path = m_trace_path.get_text()] {
+		simulation::TraceReplayer replayer(*fsm, initial_state);
+		replayer.replay(path, [this](float progress) { m_replay_progress = progress; }, &m_replay_cancelled);
+
+		ReplayResult result;
+		result.tick_count = replayer.get_tick_count();
+		result.step_count = replayer.get_step_count();
+		result.transition_count = replayer.get_transition_count();
+		result.entity_count = replayer.entity_count();
+		result.link_counts = replayer.get_link_counts();
+
+		std::sort(
+			result.link_counts.begin(),
+			result.link_counts.end(),
+			[](const simulation::TraceReplayer::LinkCount& a, const simulation::TraceReplayer::LinkCount& b) {
+				return a.count > b.count;
+			}
+		);
+
+		return result;
+	});
+}
+
+void SimulatorPanel::finish_replay()
+{
+	if (!m_replay.valid() || m_replay.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+	{
+		return;
+	}
+
+	try
+	{
+		m_replay_result = m_replay.get();
+	}
+	catch (const std::exception& e)
+	{
+		m_replay_error = e.what();
+		return;
+	}
+
+	if (m_replay_result.link_counts.empty())
+	{
+		return;
+	}
+
+	// Counts span orders of magnitude, which a logarithmic scale keeps apart
+	const double max_count = std::log1p(double(m_replay_result.link_counts.front().count));
+
+	for (const simulation::TraceReplayer::LinkCount& link_count : m_replay_result.link_counts)
+	{
+		m_link_heat.emplace(link_count.link, float(std::log1p(double(link_count.count)) / max_count));
+	}
+}
+
+void SimulatorPanel::cancel_replay()
+{
+	if (!m_replay.valid())
+	{
+		return;
+	}
+
+	m_replay_cancelled = true;
+
+	try
+	{
+		m_replay.get();
+	}
+	catch (const std::exception&)
+	{
+		// Nobody is waiting for the results anymore
+	}
+}
+
+}
+}
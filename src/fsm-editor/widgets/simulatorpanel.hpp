@@ -0,0 +1,178 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../fwd.hpp"
+#include "../simulation/compiledfsm.hpp"
+#include "../simulation/simulator.hpp"
+#include "../simulation/tracereplayer.hpp"
+#include "../util/imgui.hpp"
+#include "../util/slotmap.hpp"
+#include "graphcompilation.hpp"
+#include "stringinput.hpp"
+
+namespace fsme
+{
+namespace widgets
+{
+
+/**
+ * @brief Panel to step a single entity through the graph, setting its inputs by hand, to test the logic of an FSM
+ * without launching the game.
+ *
+ * @details The graph is only simulated on request, compiled off the UI thread by the GraphCompilation that the other
+ * panels share. Edits made to the graph afterwards are reported, but the simulation keeps running on the graph as it
+ * was compiled until it is compiled again.
+ *
+ * Many entities can also be run at once from the state of the single entity, with random inputs, on a worker thread, to
+ * see how much time they spend in each state and how many transitions per second the compiled graph sustains, see
+ * simulation::BatchSimulator.
+ *
+ * Input traces recorded in the game can be replayed through the compiled graph on a worker thread, see
+ * simulation::TraceReplayer, and the number of times each link was taken shows as a heat map on the canvas.
+ */
+class SimulatorPanel
+{
+public:
+	SimulatorPanel();
+	~SimulatorPanel();
+
+	void render(FsmEditor& editor, GraphCompilation& compilation);
+
+	/**
+	 * @brief Forgets about the compiled graph, e.g. once the graph was cleared.
+	 */
+	void reset();
+
+	/**
+	 * @brief Returns the node that the canvas was asked to show since the last call, if any, then forgets about it.
+	 */
+	ed::NodeId take_node_to_show();
+
+	/**
+	 * @brief Returns how often \p link was taken by the last replayed trace, from 0 to 1 relative to the link taken
+	 * most, or 0 if the heat map is hidden.
+	 */
+	float get_link_heat(ed::LinkId link) const;
+
+private:
+	/**
+	 * @brief Simulates the graph compiled by \p result, keeping the state and inputs of the entity.
+	 */
+	void adopt(const GraphCompilation::Result& result);
+
+	void render_simulation();
+	void render_batch();
+
+	/**
+	 * @brief Starts running #m_batch_entity_count entities for #m_batch_tick_count ticks on a worker thread.
+	 */
+	void start_batch();
+
+	/**
+	 * @brief Keeps the results of the batch run once it is done.
+	 */
+	void finish_batch();
+
+	/**
+	 * @brief Stops the batch run in progress, if any, and waits for its worker thread.
+	 */
+	void cancel_batch();
+
+	void render_replay();
+	void start_replay();
+
+	/**
+	 * @brief Keeps the results of the replay once it is done, or its error if it failed.
+	 */
+	void finish_replay();
+
+	/**
+	 * @brief Stops the replay in progress, if any, and waits for its worker thread.
+	 */
+	void cancel_replay();
+
+	struct BatchResult
+	{
+		/// @brief Seconds spent ticking, which leaves out drawing the random inputs
+		double seconds = 0.0;
+
+		std::uint64_t entity_tick_count = 0;
+		std::uint64_t transition_count = 0;
+
+		/// @brief Share of the entity ticks spent in each state
+		std::vector<float> occupancy;
+
+		/// @brief States by decreasing occupancy
+		std::vector<std::uint32_t> states;
+	};
+
+	struct ReplayResult
+	{
+		std::uint64_t tick_count = 0;
+		std::uint64_t step_count = 0;
+		std::uint64_t transition_count = 0;
+		std::size_t entity_count = 0;
+
+		/// @brief Links taken, the most taken first
+		std::vector<simulation::TraceReplayer::LinkCount> link_counts;
+	};
+
+	/// @brief Stepping the entity needs a simulator, which refers to this
+	simulation::CompiledFsm m_fsm;
+
+	/// @brief Simulator of the single entity, or nullptr if the graph is not compiled
+	std::unique_ptr<simulation::Simulator> m_simulator;
+
+	/// @brief Why the last compilation failed, if it did
+	std::string m_error;
+
+	/// @brief Revision of the graph being simulated
+	std::uint64_t m_revision = 0;
+
+	/// @brief Whether the graph is to be simulated once compiled
+	bool m_compile_requested = false;
+
+	/// @brief Whether the entity is stepped once per frame
+	bool m_running = false;
+
+	std::size_t m_tick_count = 0;
+	std::size_t m_transition_count = 0;
+
+	ed::NodeId m_node_to_show;
+
+	int m_batch_entity_count = 10000;
+	int m_batch_tick_count = 100;
+
+	/// @brief Batch run going on a worker thread, if any
+	std::future<BatchResult> m_batch;
+	std::atomic<bool> m_batch_cancelled{false};
+	std::atomic<float> m_batch_progress{0.0f};
+
+	/// @brief Results of the last batch run, whose entity tick count is 0 if there was none since the graph was compiled
+	BatchResult m_batch_result;
+
+	StringInput m_trace_path;
+
+	/// @brief Replay running on a worker thread, if any
+	std::future<ReplayResult> m_replay;
+	std::atomic<bool> m_replay_cancelled{false};
+	std::atomic<float> m_replay_progress{0.0f};
+
+	ReplayResult m_replay_result;
+	std::string m_replay_error;
+
+	bool m_show_heat = true;
+
+	/// @brief Heat of each link taken by the last replay, see get_link_heat()
+	detail::SlotMap<ed::LinkId, float> m_link_heat;
+};
+
+}
+}
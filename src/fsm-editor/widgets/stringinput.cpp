@@ -11,22 +11,23 @@ StringInput::StringInput() :
 	m_buffer{0}
 {}
 
-void StringInput::render(bool editable)
+bool StringInput::render(bool editable)
 {
 	if (editable)
 	{
 		if (!m_hint.empty())
 		{
-			ImGui::InputTextWithHint("", m_hint.c_str(), m_buffer.data(), m_buffer.size());
+			return ImGui::InputTextWithHint("", m_hint.c_str(), m_buffer.data(), m_buffer.size());
 		}
 		else
 		{
-			ImGui::InputText("", m_buffer.data(), m_buffer.size());
+			return ImGui::InputText("", m_buffer.data(), m_buffer.size());
 		}
 	}
 	else
 	{
 		ImGui::Text("%s", m_buffer.data());
+		return false;
 	}
 }
 
@@ -15,12 +15,16 @@ public:
 
 	StringInput();
 
-	void render(bool editable = true);
+	/**
+	 * @return Whether the text was edited.
+	 */
+	bool render(bool editable = true);
 
 	void set_text(const std::string& value);
 	std::string get_text() const;
 
 	Buffer& get_buffer();
+	const Buffer& get_buffer() const;
 
 	void set_hint(std::string value);
 
@@ -34,5 +38,10 @@ inline StringInput::Buffer& StringInput::get_buffer()
 	return m_buffer;
 }
 
+inline const StringInput::Buffer& StringInput::get_buffer() const
+{
+	return m_buffer;
+}
+
 }
 }
@@ -44,17 +44,10 @@ int main()
 	io.Fonts->AddFontFromFileTTF("CascadiaCode-Bold.ttf", 16.f);
 	ImGui::SFML::UpdateFontTexture();
 
-	fsme::FsmEditor editor(window);
+	fsme::FsmEditor editor;
 
 	fsme::widgets::BoolExpressionAutocomplete autocomplete;
-
-	{
-		autocomplete.add_option("Keys", {"space", "self.inputs:check(InputKey.Space)"});
-		autocomplete.add_option("Keys", {"lmb", "self.inputs:check(InputKey.MouseLeft)"});
-		autocomplete.add_option("Keys", {"down", "self.inputs:check(InputKey.Down)"});
-
-		autocomplete.add_option("Collision", {"on ground", "self.on_ground"});
-	}
+	fsme::widgets::add_centauri_options(autocomplete);
 
 	editor.set_autocomplete_provider(&autocomplete);
 
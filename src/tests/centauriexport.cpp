@@ -0,0 +1,247 @@
+#include "benchmarks/graphgen.hpp"
+
+#include "fsm-editor/util/conditionprofile.hpp"
+#include "fsm-editor/util/textwriter.hpp"
+#include "fsm-editor/visitors/centauriserializer.hpp"
+#include "fsm-editor/visitors/fsmcompiler.hpp"
+
+#include <cstdio>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * @file centauriexport.cpp
+ * @brief Checks that whole-graph Centauri exports take the same transitions as the graph they come from, by
+ * interpreting the export for every combination of inputs.
+ */
+
+using namespace fsme;
+
+namespace
+{
+
+/// @brief Number of options of the catalog, all of which are tried both ways
+constexpr std::size_t option_count = 3;
+
+/**
+ * @brief Centauri export read back, each `expr` line testing an AND of options.
+ */
+struct Export
+{
+	struct Test
+	{
+		std::vector<std::uint32_t> options;
+		std::uint32_t on_true;
+		std::uint32_t on_false;
+	};
+
+	std::map<std::uint32_t, std::uint32_t> entries;
+	std::map<std::uint32_t, Test> tests;
+	std::vector<std::uint32_t> states;
+};
+
+Export parse_export(const std::string& text, const widgets::BoolExpressionAutocomplete& autocomplete)
+{
+	std::map<std::string, std::uint32_t> options;
+	for (std::uint32_t i = 0; i < autocomplete.option_count(); ++i)
+	{
+		options[autocomplete.get_option(i).lua_expression] = i;
+	}
+
+	Export parsed;
+	std::istringstream lines(text);
+	std::string line;
+
+	while (std::getline(lines, line))
+	{
+		std::istringstream fields(line);
+		std::uint32_t id;
+		std::string kind;
+		fields >> id >> kind;
+
+		if (kind == "state")
+		{
+			parsed.states.push_back(id);
+		}
+		else if (kind == "entry")
+		{
+			fields >> parsed.entries[id];
+		}
+		else
+		{
+			// The targets are the last two fields, and the options of the expression are joined by " and "
+			const std::size_t false_begin = line.rfind(' ');
+			const std::size_t true_begin = line.rfind(' ', false_begin - 1);
+			const std::size_t expression_begin = line.find(' ', line.find(' ') + 1) + 1;
+			const std::string expression = line.substr(expression_begin, true_begin - expression_begin);
+
+			Export::Test& test = parsed.tests[id];
+			test.on_true = std::uint32_t(std::stoul(line.substr(true_begin + 1, false_begin - true_begin - 1)));
+			test.on_false = std::uint32_t(std::stoul(line.substr(false_begin + 1)));
+
+			for (std::size_t begin = 0;;)
+			{
+				const std::size_t end = expression.find(" and ", begin);
+				test.options.push_back(options.at(expression.substr(begin, end - begin)));
+
+				if (end == std::string::npos)
+				{
+					break;
+				}
+
+				begin = end + 5;
+			}
+		}
+	}
+
+	return parsed;
+}
+
+/**
+ * @brief Returns the number of states and inputs for which the export steps to another state than \p fsm does.
+ */
+std::size_t count_mismatches(const Export& parsed, const simulation::CompiledFsm& fsm)
+{
+	std::map<std::uint32_t, std::uint32_t> state_indices;
+	for (std::uint32_t i = 0; i < fsm.state_count(); ++i)
+	{
+		state_indices[std::uint32_t(std::uintptr_t(fsm.state_nodes[i]))] = i;
+	}
+
+	std::size_t mismatches = 0;
+
+	for (const std::uint32_t state_id : parsed.states)
+	{
+		const std::uint32_t state = state_indices.at(state_id);
+
+		for (std::uint64_t inputs = 0; inputs < (std::uint64_t(1) << option_count); ++inputs)
+		{
+			const auto entry = parsed.entries.find(state_id);
+			std::uint32_t target = entry != parsed.entries.end() ? entry->second : std::uint32_t(-1);
+
+			while (target != std::uint32_t(-1) && state_indices.count(target) == 0)
+			{
+				const Export::Test& test = parsed.tests.at(target);
+
+				bool holds = true;
+				for (const std::uint32_t option : test.options)
+				{
+					holds = holds && ((inputs >> option) & 1) != 0;
+				}
+
+				target = holds ? test.on_true : test.on_false;
+			}
+
+			const std::uint32_t exported = target == std::uint32_t(-1) ? state : state_indices.at(target);
+
+			std::vector<std::uint64_t> words(fsm.input_word_count(), 0);
+			words[0] = inputs;
+
+			if (exported != fsm.next_state(state, words.data()))
+			{
+				++mismatches;
+			}
+		}
+	}
+
+	return mismatches;
+}
+
+nodes::IfNode& make_if(FsmEditor& editor, const widgets::BoolExpressionOption* option, ed::PinId from)
+{
+	auto& node = editor.make_node<nodes::IfNode>();
+	node.get_expression().set_input_type(widgets::ExpressionInputType::SimpleExpression);
+	node.get_expression().get_raw_simple_expression_input().options.insert(option);
+	editor.create_link({from, node.inputs()[0]});
+	return node;
+}
+
+/**
+ * @brief Exports an If chain whose suffix is copied elsewhere in the graph, with a profile that moves a condition of the
+ * suffix to the front of the chain: the copy must not be redirected to the chain, whose IDs are relabeled.
+ */
+bool test_reordered_chain_with_copied_suffix()
+{
+	widgets::BoolExpressionAutocomplete autocomplete;
+	benchmarks::make_autocomplete(autocomplete, option_count);
+
+	FsmEditor editor;
+	editor.set_autocomplete_provider(&autocomplete);
+
+	std::vector<nodes::StateNode*> states;
+	for (int i = 0; i < 6; ++i)
+	{
+		auto& state = editor.make_node<nodes::StateNode>();
+		state.get_name_input().set_text("state_" + std::to_string(i));
+		states.push_back(&state);
+	}
+
+	const auto link = [&](ed::PinId from, nodes::StateNode& to) { editor.create_link({from, to.inputs()[0]}); };
+
+	// X(option 0) -> state 1, else Y(option 1) -> state 1, else Z(option 2) -> state 2, else state 4
+	nodes::IfNode& x = make_if(editor, &autocomplete.get_option(0), states[0]->outputs()[0]);
+	nodes::IfNode& y = make_if(editor, &autocomplete.get_option(1), x.outputs()[1]);
+	nodes::IfNode& z = make_if(editor, &autocomplete.get_option(2), y.outputs()[1]);
+	link(x.outputs()[0], *states[1]);
+	link(y.outputs()[0], *states[1]);
+	link(z.outputs()[0], *states[2]);
+	link(z.outputs()[1], *states[4]);
+
+	// Copy of Y then Z, reached from state 5
+	nodes::IfNode& y_copy = make_if(editor, &autocomplete.get_option(1), states[5]->outputs()[0]);
+	nodes::IfNode& z_copy = make_if(editor, &autocomplete.get_option(2), y_copy.outputs()[1]);
+	link(y_copy.outputs()[0], *states[1]);
+	link(z_copy.outputs()[0], *states[2]);
+	link(z_copy.outputs()[1], *states[4]);
+
+	// Y and X lead to the same state, so Y may be tested first
+	detail::ConditionProfile profile;
+	profile.add(std::uint32_t(std::uintptr_t(x.node_id())), 100, 1);
+	profile.add(std::uint32_t(std::uintptr_t(y.node_id())), 99, 90);
+	profile.add(std::uint32_t(std::uintptr_t(z.node_id())), 9, 1);
+
+	const simulation::CompiledFsm fsm = visitors::FsmCompiler::compile(editor);
+
+	visitors::CentauriGraphOptions options;
+	options.profile = &profile;
+
+	detail::TextWriter text;
+	visitors::CentauriSerializer::serialize_graph(text, editor, options);
+	const std::string exported(text.data(), text.size());
+
+	text.clear();
+	visitors::CentauriSerializer::serialize_graph(text, editor);
+	const std::string unordered(text.data(), text.size());
+
+	if (exported == unordered)
+	{
+		std::fprintf(stderr, "The chain was not reordered:\n%s", exported.c_str());
+		return false;
+	}
+
+	const std::size_t mismatches = count_mismatches(parse_export(exported, autocomplete), fsm);
+	if (mismatches != 0)
+	{
+		std::fprintf(stderr, "%zu transitions differ from the graph in:\n%s", mismatches, exported.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+}
+
+int main()
+{
+	int failed_count = 0;
+
+	if (!test_reordered_chain_with_copied_suffix())
+	{
+		std::fprintf(stderr, "FAILED: reordered chain with a copied suffix\n");
+		++failed_count;
+	}
+
+	return failed_count == 0 ? 0 : 1;
+}